@@ -0,0 +1,22 @@
+
+#include <qjs.h>
+
+extern qjs_module_t  qjs_buffer_module;
+extern qjs_module_t  qjs_crypto_module;
+extern qjs_module_t  qjs_fs_module;
+extern qjs_module_t  qjs_query_string_module;
+extern qjs_module_t  qjs_webcrypto_module;
+extern qjs_module_t  qjs_xml_module;
+extern qjs_module_t  qjs_zlib_module;
+
+qjs_module_t *qjs_modules[] = {
+    &qjs_buffer_module,
+    &qjs_crypto_module,
+    &qjs_fs_module,
+    &qjs_query_string_module,
+    &qjs_webcrypto_module,
+    &qjs_xml_module,
+    &qjs_zlib_module,
+    NULL
+};
+
@@ -16,6 +16,19 @@
 
 static const u_char* njs_regex_pcre2_error(int errcode, u_char buffer[128]);
 
+#ifdef NJS_HAVE_PCRE2_JIT
+
+#define NJS_REGEX_JIT_STACK_MIN  (32 * 1024)
+#define NJS_REGEX_JIT_STACK_MAX  (512 * 1024)
+
+/*
+ * The JIT stack and the match context referring to it are created on
+ * the first JIT compilation and are shared by all VMs of the process.
+ */
+static pcre2_match_context  *njs_regex_jit_match_ctx;
+
+#endif
+
 #else
 
 #include <pcre.h>
@@ -565,6 +578,56 @@ done:
 }
 
 
+njs_int_t
+njs_regex_jit_compile(njs_regex_t *regex)
+{
+#ifdef NJS_HAVE_PCRE2_JIT
+
+    int               ret;
+    pcre2_jit_stack  *stack;
+
+    if (njs_regex_jit_match_ctx == NULL) {
+        njs_regex_jit_match_ctx = pcre2_match_context_create(NULL);
+        if (njs_slow_path(njs_regex_jit_match_ctx == NULL)) {
+            return NJS_ERROR;
+        }
+
+        stack = pcre2_jit_stack_create(NJS_REGEX_JIT_STACK_MIN,
+                                       NJS_REGEX_JIT_STACK_MAX, NULL);
+
+        /* Without the stack JIT uses 32K of the machine stack. */
+
+        if (stack != NULL) {
+            pcre2_jit_stack_assign(njs_regex_jit_match_ctx, NULL, stack);
+        }
+    }
+
+    ret = pcre2_jit_compile(regex->code, PCRE2_JIT_COMPLETE);
+
+    return (ret == 0) ? NJS_OK : NJS_DECLINED;
+
+#else
+
+    return NJS_DECLINED;
+
+#endif
+}
+
+
+void
+njs_regex_free(njs_regex_t *regex)
+{
+#ifdef NJS_HAVE_PCRE2
+
+    /* The JIT code is allocated outside of the pattern memory. */
+
+    pcre2_code_free(regex->code);
+    regex->code = NULL;
+
+#endif
+}
+
+
 njs_bool_t
 njs_regex_is_valid(njs_regex_t *regex)
 {
@@ -659,8 +722,22 @@ njs_regex_match(njs_regex_t *regex, const u_char *subject, size_t off,
     int     ret;
     u_char  errstr[128];
 
+#ifdef NJS_HAVE_PCRE2_JIT
+
+    ret = pcre2_match(regex->code, subject, len, off, 0, match_data,
+                      njs_regex_jit_match_ctx);
+
+    if (njs_slow_path(ret == PCRE2_ERROR_JIT_STACKLIMIT)) {
+        ret = pcre2_match(regex->code, subject, len, off, PCRE2_NO_JIT,
+                          match_data, NULL);
+    }
+
+#else
+
     ret = pcre2_match(regex->code, subject, len, off, 0, match_data, NULL);
 
+#endif
+
     if (ret < 0) {
         if (ret == PCRE2_ERROR_NOMATCH) {
             return NJS_DECLINED;
@@ -53,6 +53,7 @@ typedef struct {
 
 
 typedef struct ngx_http_js_ctx_s  ngx_http_js_ctx_t;
+typedef struct ngx_http_js_file_s  ngx_http_js_file_t;
 
 struct ngx_http_js_ctx_s {
     NGX_JS_COMMON_CTX;
@@ -61,6 +62,7 @@ struct ngx_http_js_ctx_s {
     njs_opaque_value_t     rargs;
     njs_opaque_value_t     request_body;
     njs_opaque_value_t     response_body;
+    ngx_http_js_file_t    *request_body_files;
     ngx_str_t              redirect_uri;
 
     ngx_int_t              filter;
@@ -84,6 +86,19 @@ typedef struct {
 }  ngx_http_js_header_t;
 
 
+typedef struct {
+    void                  *addr;
+    size_t                 size;
+} ngx_http_js_body_map_t;
+
+
+struct ngx_http_js_file_s {
+    ngx_buf_t             *buf;
+    u_char                *data;
+    ngx_http_js_file_t    *next;
+};
+
+
 typedef njs_int_t (*njs_http_js_header_handler_t)(njs_vm_t *vm,
     ngx_http_request_t *r, unsigned flags, njs_str_t *name, njs_value_t *setval,
     njs_value_t *retval);
@@ -211,6 +226,14 @@ static njs_int_t ngx_http_js_ext_get_args(njs_vm_t *vm,
 static njs_int_t ngx_http_js_ext_get_request_body(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
+static njs_int_t ngx_http_js_ext_get_request_buffers(njs_vm_t *vm,
+    njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
+    njs_value_t *setval, njs_value_t *retval);
+static u_char *ngx_http_js_request_body_file(ngx_http_request_t *r,
+    ngx_buf_t *buf);
+#if !(NGX_WIN32)
+static void ngx_http_js_request_body_unmap(void *data);
+#endif
 static njs_int_t ngx_http_js_ext_header_in(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t atom_id, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
@@ -303,6 +326,8 @@ static JSValue ngx_http_qjs_ext_remote_address(JSContext *cx,
     JSValueConst this_val);
 static JSValue ngx_http_qjs_ext_request_body(JSContext *cx,
     JSValueConst this_val, int type);
+static JSValue ngx_http_qjs_ext_request_buffers(JSContext *cx,
+    JSValueConst this_val);
 static JSValue ngx_http_qjs_ext_response_body(JSContext *cx,
     JSValueConst this_val, int type);
 static JSValue ngx_http_qjs_ext_return(JSContext *cx, JSValueConst this_val,
@@ -366,6 +391,7 @@ static size_t ngx_http_js_buffer_size(ngx_http_request_t *r);
 static size_t ngx_http_js_max_response_buffer_size(ngx_http_request_t *r);
 static void ngx_http_js_event_finalize(ngx_http_request_t *r, ngx_int_t rc);
 static ngx_js_ctx_t *ngx_http_js_ctx(ngx_http_request_t *r);
+static ngx_js_loc_conf_t *ngx_http_js_loc_conf(ngx_http_request_t *r);
 
 static void ngx_http_js_periodic_handler(ngx_event_t *ev);
 static void ngx_http_js_periodic_shutdown_handler(ngx_event_t *ev);
@@ -385,6 +411,8 @@ static char *ngx_http_js_content(ngx_conf_t *cf, ngx_command_t *cmd,
     void *conf);
 static char *ngx_http_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd,
     void *conf);
+static char *ngx_http_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+    void *conf);
 static char *ngx_http_js_body_filter_set(ngx_conf_t *cf, ngx_command_t *cmd,
     void *conf);
 static ngx_int_t ngx_http_js_init_conf_vm(ngx_conf_t *cf,
@@ -527,6 +555,62 @@ static ngx_command_t  ngx_http_js_commands[] = {
       offsetof(ngx_http_js_loc_conf_t, timeout),
       NULL },
 
+    { ngx_string("js_fetch_keepalive"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_keepalive),
+      NULL },
+
+    { ngx_string("js_fetch_keepalive_timeout"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_msec_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_keepalive_timeout),
+      NULL },
+
+    { ngx_string("js_fetch_keepalive_requests"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_keepalive_requests),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_resolver_cache),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache_negative"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_sec_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_resolver_cache_negative),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache_stale"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_sec_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_resolver_cache_stale),
+      NULL },
+
+    { ngx_string("js_fetch_http2"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_FLAG,
+      ngx_conf_set_flag_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_http2),
+      NULL },
+
+    { ngx_string("js_fetch_decompress"),
+      NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_FLAG,
+      ngx_conf_set_flag_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_js_loc_conf_t, fetch_decompress),
+      NULL },
+
 #if (NGX_HTTP_SSL)
 
     { ngx_string("js_fetch_ciphers"),
@@ -573,6 +657,13 @@ static ngx_command_t  ngx_http_js_commands[] = {
       0,
       NULL },
 
+    { ngx_string("js_fetch_cache_zone"),
+      NGX_HTTP_MAIN_CONF|NGX_CONF_1MORE,
+      ngx_http_js_fetch_cache_zone,
+      0,
+      0,
+      NULL },
+
       ngx_null_command
 };
 
@@ -798,6 +889,14 @@ static njs_external_t  ngx_http_js_ext_request[] = {
         }
     },
 
+    {
+        .flags = NJS_EXTERN_PROPERTY,
+        .name.string = njs_str("requestBuffers"),
+        .u.property = {
+            .handler = ngx_http_js_ext_get_request_buffers,
+        }
+    },
+
     {
         .flags = NJS_EXTERN_PROPERTY,
         .name.string = njs_str("requestText"),
@@ -982,6 +1081,7 @@ static uintptr_t ngx_http_js_uptr[] = {
     (uintptr_t) ngx_http_js_max_response_buffer_size,
     (uintptr_t) 0 /* main_conf ptr */,
     (uintptr_t) ngx_http_js_ctx,
+    (uintptr_t) ngx_http_js_loc_conf,
 };
 
 
@@ -1064,6 +1164,7 @@ static const JSCFunctionListEntry ngx_http_qjs_ext_request[] = {
     JS_CGETSET_DEF("remoteAddress", ngx_http_qjs_ext_remote_address, NULL),
     JS_CGETSET_MAGIC_DEF("requestBuffer", ngx_http_qjs_ext_request_body, NULL,
                          NGX_JS_BUFFER),
+    JS_CGETSET_DEF("requestBuffers", ngx_http_qjs_ext_request_buffers, NULL),
     JS_CGETSET_MAGIC_DEF("requestText", ngx_http_qjs_ext_request_body, NULL,
                          NGX_JS_STRING),
     JS_CGETSET_MAGIC_DEF("responseBuffer", ngx_http_qjs_ext_response_body, NULL,
@@ -2938,7 +3039,6 @@ ngx_http_js_ext_get_request_body(njs_vm_t *vm, njs_object_prop_t *prop,
 {
     u_char              *p, *body;
     size_t               len;
-    ssize_t              n;
     uint32_t             buffer_type;
     ngx_buf_t           *buf;
     njs_int_t            ret;
@@ -2985,14 +3085,8 @@ ngx_http_js_ext_get_request_body(njs_vm_t *vm, njs_object_prop_t *prop,
 
         len = buf->file_last - buf->file_pos;
 
-        body = ngx_pnalloc(r->pool, len);
+        body = ngx_http_js_request_body_file(r, buf);
         if (body == NULL) {
-            njs_vm_memory_error(vm);
-            return NJS_ERROR;
-        }
-
-        n = ngx_read_file(buf->file, body, len, buf->file_pos);
-        if (n != (ssize_t) len) {
             njs_vm_internal_error(vm, "failed to read request body");
             return NJS_ERROR;
         }
@@ -3042,6 +3136,176 @@ done:
 }
 
 
+static njs_int_t
+ngx_http_js_ext_get_request_buffers(njs_vm_t *vm, njs_object_prop_t *prop,
+    uint32_t unused, njs_value_t *value, njs_value_t *setval,
+    njs_value_t *retval)
+{
+    u_char              *data;
+    size_t               len;
+    njs_int_t            ret;
+    ngx_buf_t           *buf;
+    njs_value_t         *item;
+    ngx_chain_t         *cl;
+    ngx_http_request_t  *r;
+
+    r = njs_vm_external(vm, ngx_http_js_request_proto_id, value);
+    if (r == NULL) {
+        njs_value_undefined_set(retval);
+        return NJS_DECLINED;
+    }
+
+    if (r->request_body == NULL || r->request_body->bufs == NULL) {
+        njs_value_undefined_set(retval);
+        return NJS_DECLINED;
+    }
+
+    ret = njs_vm_array_alloc(vm, retval, 2);
+    if (ret != NJS_OK) {
+        return NJS_ERROR;
+    }
+
+    /*
+     * the buffers reference the request body memory without copying
+     * unless the VM may be reused, see ngx_js_buffer_set()
+     */
+
+    for (cl = r->request_body->bufs; cl != NULL; cl = cl->next) {
+        buf = cl->buf;
+
+        if (buf->in_file) {
+            len = buf->file_last - buf->file_pos;
+
+            data = ngx_http_js_request_body_file(r, buf);
+            if (data == NULL) {
+                njs_vm_internal_error(vm, "failed to read request body");
+                return NJS_ERROR;
+            }
+
+        } else {
+            len = buf->last - buf->pos;
+            data = buf->pos;
+        }
+
+        if (len == 0) {
+            continue;
+        }
+
+        item = njs_vm_array_push(vm, retval);
+        if (item == NULL) {
+            return NJS_ERROR;
+        }
+
+        ret = ngx_js_buffer_set(vm, item, data, len);
+        if (ret != NJS_OK) {
+            return NJS_ERROR;
+        }
+    }
+
+    return NJS_OK;
+}
+
+
+static u_char *
+ngx_http_js_request_body_file(ngx_http_request_t *r, ngx_buf_t *buf)
+{
+    u_char                  *p;
+    size_t                   len;
+    ssize_t                  n;
+    ngx_http_js_ctx_t       *ctx;
+    ngx_http_js_file_t      *bf;
+#if !(NGX_WIN32)
+    off_t                    offset;
+    ngx_pool_cleanup_t      *cln;
+    ngx_http_js_body_map_t  *map;
+#endif
+
+    ctx = ngx_http_get_module_ctx(r, ngx_http_js_module);
+
+    for (bf = ctx->request_body_files; bf != NULL; bf = bf->next) {
+        if (bf->buf == buf) {
+            return bf->data;
+        }
+    }
+
+    bf = ngx_palloc(r->pool, sizeof(ngx_http_js_file_t));
+    if (bf == NULL) {
+        return NULL;
+    }
+
+    len = buf->file_last - buf->file_pos;
+
+#if !(NGX_WIN32)
+
+    /*
+     * the file is mapped privately, so the pages are shared with
+     * the page cache and modifications are not written back
+     */
+
+    offset = buf->file_pos & ~((off_t) ngx_pagesize - 1);
+
+    cln = ngx_pool_cleanup_add(r->pool, sizeof(ngx_http_js_body_map_t));
+    if (cln == NULL) {
+        return NULL;
+    }
+
+    map = cln->data;
+    map->size = len + (size_t) (buf->file_pos - offset);
+
+    map->addr = mmap(NULL, map->size, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                     buf->file->fd, offset);
+
+    if (map->addr != MAP_FAILED) {
+        cln->handler = ngx_http_js_request_body_unmap;
+
+        p = (u_char *) map->addr + (buf->file_pos - offset);
+        goto done;
+    }
+
+    ngx_log_debug1(NGX_LOG_DEBUG_HTTP, r->connection->log, ngx_errno,
+                   "http js mmap(\"%V\") failed", &buf->file->name);
+
+#endif
+
+    p = ngx_pnalloc(r->pool, len);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    n = ngx_read_file(buf->file, p, len, buf->file_pos);
+    if (n != (ssize_t) len) {
+        return NULL;
+    }
+
+#if !(NGX_WIN32)
+done:
+#endif
+
+    bf->buf = buf;
+    bf->data = p;
+    bf->next = ctx->request_body_files;
+    ctx->request_body_files = bf;
+
+    return p;
+}
+
+
+#if !(NGX_WIN32)
+
+static void
+ngx_http_js_request_body_unmap(void *data)
+{
+    ngx_http_js_body_map_t  *map = data;
+
+    if (munmap(map->addr, map->size) == -1) {
+        ngx_log_error(NGX_LOG_ALERT, ngx_cycle->log, ngx_errno,
+                      "munmap() failed");
+    }
+}
+
+#endif
+
+
 #if defined(nginx_version) && (nginx_version < 1023000)
 static njs_int_t
 ngx_http_js_ext_header_in(njs_vm_t *vm, njs_object_prop_t *prop, uint32_t atom_id,
@@ -3721,6 +3985,10 @@ ngx_http_js_subrequest_done(ngx_http_request_t *r, void *data, ngx_int_t rc)
         return NGX_ERROR;
     }
 
+    /* the reply refers to the subrequest allocated from the request pool */
+
+    ctx->external_memory = 1;
+
     rc = ngx_js_call(vm, njs_value_function(njs_value_arg(&event->function)),
                      &reply, 1);
 
@@ -4719,6 +4987,17 @@ ngx_http_js_ctx(ngx_http_request_t *r)
 }
 
 
+static ngx_js_loc_conf_t *
+ngx_http_js_loc_conf(ngx_http_request_t *r)
+{
+    ngx_http_js_loc_conf_t  *jlcf;
+
+    jlcf = ngx_http_get_module_loc_conf(r, ngx_http_js_module);
+
+    return (ngx_js_loc_conf_t *) jlcf;
+}
+
+
 static njs_int_t
 ngx_js_http_init(njs_vm_t *vm)
 {
@@ -5321,7 +5600,6 @@ ngx_http_qjs_ext_request_body(JSContext *cx, JSValueConst this_val, int type)
 {
     u_char                  *p, *data;
     size_t                   len;
-    ssize_t                  n;
     JSValue                  body;
     uint32_t                 buffer_type;
     ngx_buf_t               *buf;
@@ -5363,13 +5641,8 @@ ngx_http_qjs_ext_request_body(JSContext *cx, JSValueConst this_val, int type)
 
         len = buf->file_last - buf->file_pos;
 
-        data = ngx_pnalloc(r->pool, len);
+        data = ngx_http_js_request_body_file(r, buf);
         if (data == NULL) {
-            return JS_ThrowOutOfMemory(cx);
-        }
-
-        n = ngx_read_file(buf->file, data, len, buf->file_pos);
-        if (n != (ssize_t) len) {
             return JS_ThrowInternalError(cx, "failed to read request body");
         }
 
@@ -5417,6 +5690,81 @@ done:
 }
 
 
+static JSValue
+ngx_http_qjs_ext_request_buffers(JSContext *cx, JSValueConst this_val)
+{
+    u_char                  *data;
+    size_t                   len;
+    JSValue                  arr, buffer;
+    uint32_t                 i;
+    ngx_buf_t               *buf;
+    ngx_uint_t               copy;
+    ngx_chain_t             *cl;
+    ngx_http_request_t      *r;
+    ngx_http_js_loc_conf_t  *jlcf;
+
+    r = ngx_http_qjs_request(this_val);
+    if (r == NULL) {
+        return JS_ThrowInternalError(cx, "\"this\" is not a request object");
+    }
+
+    if (r->request_body == NULL || r->request_body->bufs == NULL) {
+        return JS_UNDEFINED;
+    }
+
+    /* a reused context must not refer to the request memory */
+
+    jlcf = ngx_http_get_module_loc_conf(r, ngx_http_js_module);
+    copy = (ngx_js_reuse(jlcf) != 0);
+
+    arr = JS_NewArray(cx);
+    if (JS_IsException(arr)) {
+        return JS_EXCEPTION;
+    }
+
+    i = 0;
+
+    for (cl = r->request_body->bufs; cl != NULL; cl = cl->next) {
+        buf = cl->buf;
+
+        if (buf->in_file) {
+            len = buf->file_last - buf->file_pos;
+
+            data = ngx_http_js_request_body_file(r, buf);
+            if (data == NULL) {
+                JS_FreeValue(cx, arr);
+                return JS_ThrowInternalError(cx,
+                                             "failed to read request body");
+            }
+
+        } else {
+            len = buf->last - buf->pos;
+            data = buf->pos;
+        }
+
+        if (len == 0) {
+            continue;
+        }
+
+        buffer = copy ? qjs_buffer_create(cx, data, len)
+                      : qjs_buffer_view(cx, data, len);
+        if (JS_IsException(buffer)) {
+            JS_FreeValue(cx, arr);
+            return JS_EXCEPTION;
+        }
+
+        if (JS_DefinePropertyValueUint32(cx, arr, i++, buffer,
+                                         JS_PROP_C_W_E) < 0)
+        {
+            JS_FreeValue(cx, arr);
+            return JS_EXCEPTION;
+        }
+    }
+
+    return arr;
+}
+
+
 static JSValue
 ngx_http_qjs_ext_return(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv)
@@ -7670,6 +8018,8 @@ ngx_http_js_init_conf_vm(ngx_conf_t *cf, ngx_js_loc_conf_t *conf)
     jmcf = ngx_http_conf_get_module_main_conf(cf, ngx_http_js_module);
     ngx_http_js_uptr[NGX_JS_MAIN_CONF_INDEX] = (uintptr_t) jmcf;
 
+    options.main_conf = jmcf;
+
     if (conf->type == NGX_ENGINE_NJS) {
         options.u.njs.metas = &ngx_http_js_metas;
         options.u.njs.addons = njs_http_js_addon_modules;
@@ -8101,6 +8451,14 @@ ngx_http_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd,
 }
 
 
+static char *
+ngx_http_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+    void *conf)
+{
+    return ngx_js_fetch_cache_zone(cf, cmd, conf, &ngx_http_js_module);
+}
+
+
 static char *
 ngx_http_js_body_filter_set(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
 {
@@ -8158,6 +8516,9 @@ ngx_http_js_create_main_conf(ngx_conf_t *cf)
      *
      *     jmcf->dicts = NULL;
      *     jmcf->periodics = NULL;
+     *     jmcf->engines = NULL;
+     *     jmcf->fetch_cache = NULL;
+     *     jmcf->fetch_cache_inactive = 0;
      */
 
     return jmcf;
@@ -8,8 +8,10 @@
 
 #include <ngx_config.h>
 #include <ngx_core.h>
+#include <ngx_event_connect.h>
 #include <math.h>
 #include "ngx_js.h"
+#include "ngx_js_http.h"
 
 
 typedef struct {
@@ -39,6 +41,31 @@ typedef struct {
 } njs_module_info_t;
 
 
+typedef struct {
+    ngx_uint_t           type;
+    ngx_array_t         *imports;
+    ngx_array_t         *paths;
+    ngx_array_t         *preload_objects;
+    ngx_engine_t        *engine;
+} ngx_js_shared_engine_t;
+
+
+#if (NJS_HAVE_QUICKJS)
+
+typedef struct {
+    ngx_queue_t          queue;
+    ngx_str_t            name;
+    ngx_str_t            file;
+    time_t               mtime;
+    off_t                size;
+    uint32_t             crc32;
+    u_char              *code;
+    size_t               code_size;
+} ngx_qjs_code_cache_t;
+
+#endif
+
+
 static ngx_int_t ngx_engine_njs_init(ngx_engine_t *engine,
     ngx_engine_opts_t *opts);
 static ngx_int_t ngx_engine_njs_compile(ngx_js_loc_conf_t *conf, ngx_log_t *log,
@@ -51,6 +78,7 @@ static ngx_int_t ngx_engine_njs_string(ngx_engine_t *e,
     njs_opaque_value_t *value, ngx_str_t *str);
 static void ngx_engine_njs_destroy(ngx_engine_t *e, ngx_js_ctx_t *ctx,
     ngx_js_loc_conf_t *conf);
+static void ngx_js_cleanup_reuse_vm(void *data);
 static ngx_int_t ngx_js_init_preload_vm(njs_vm_t *vm, ngx_js_loc_conf_t *conf);
 
 #if (NJS_HAVE_QUICKJS)
@@ -77,6 +105,8 @@ static JSValue ngx_qjs_ext_conf_prefix(JSContext *cx, JSValueConst this_val);
 static JSValue ngx_qjs_ext_constant_integer(JSContext *cx,
     JSValueConst this_val, int magic);
 static JSValue ngx_qjs_ext_error_log_path(JSContext *cx, JSValueConst this_val);
+static JSValue ngx_qjs_ext_fetch_ssl_sessions_reused(JSContext *cx,
+    JSValueConst this_val);
 static JSValue ngx_qjs_ext_log(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv, int level);
 static JSValue ngx_qjs_ext_console_time(JSContext *cx, JSValueConst this_val,
@@ -90,6 +120,11 @@ static void ngx_qjs_console_finalizer(JSRuntime *rt, JSValue val);
 
 static JSModuleDef *ngx_qjs_module_loader(JSContext *ctx,
     const char *module_name, void *opaque);
+static ngx_qjs_code_cache_t *ngx_qjs_code_cache_find(njs_module_info_t *info);
+static ngx_qjs_code_cache_t *ngx_qjs_code_cache_lookup(njs_module_info_t *info,
+    struct stat *sb, uint32_t crc32);
+static void ngx_qjs_code_cache_add(njs_module_info_t *info, struct stat *sb,
+    uint32_t crc32, u_char *code, size_t code_size);
 static int ngx_qjs_unhandled_rejection(ngx_js_ctx_t *ctx);
 static void ngx_qjs_rejection_tracker(JSContext *ctx, JSValueConst promise,
     JSValueConst reason, JS_BOOL is_handled, void *opaque);
@@ -113,6 +148,9 @@ static njs_int_t ngx_js_ext_conf_prefix(njs_vm_t *vm, njs_object_prop_t *prop,
 static njs_int_t ngx_js_ext_error_log_path(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
+static njs_int_t ngx_js_ext_fetch_ssl_sessions_reused(njs_vm_t *vm,
+    njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
+    njs_value_t *setval, njs_value_t *retval);
 static njs_int_t ngx_js_ext_prefix(njs_vm_t *vm, njs_object_prop_t *prop,
     uint32_t unused, njs_value_t *value, njs_value_t *setval,
     njs_value_t *retval);
@@ -143,6 +181,12 @@ static njs_int_t ngx_js_module_read(njs_mp_t *mp, int fd, njs_str_t *text);
 static njs_int_t ngx_js_set_cwd(njs_mp_t *mp, ngx_js_loc_conf_t *conf,
     njs_str_t *path);
 static void ngx_js_cleanup_vm(void *data);
+static ngx_uint_t ngx_js_named_paths_equal(ngx_array_t *a, ngx_array_t *b);
+static ngx_uint_t ngx_js_paths_equal(ngx_array_t *a, ngx_array_t *b);
+static ngx_engine_t *ngx_js_shared_engine(ngx_js_main_conf_t *jmcf,
+    ngx_js_loc_conf_t *conf);
+static ngx_int_t ngx_js_add_shared_engine(ngx_conf_t *cf,
+    ngx_js_main_conf_t *jmcf, ngx_js_loc_conf_t *conf);
 
 static njs_int_t ngx_js_core_init(njs_vm_t *vm);
 static uint64_t ngx_js_monotonic_time(void);
@@ -229,6 +273,15 @@ static njs_external_t  ngx_js_ext_core[] = {
         }
     },
 
+    {
+        .flags = NJS_EXTERN_PROPERTY,
+        .name.string = njs_str("fetch_ssl_sessions_reused"),
+        .enumerable = 1,
+        .u.property = {
+            .handler = ngx_js_ext_fetch_ssl_sessions_reused,
+        }
+    },
+
     {
         .flags = NJS_EXTERN_PROPERTY,
         .name.string = njs_str("INFO"),
@@ -428,6 +481,13 @@ static njs_int_t      ngx_js_console_proto_id;
 
 #if (NJS_HAVE_QUICKJS)
 
+/*
+ * The module bytecode is kept by the master process across
+ * configuration reloads, unchanged modules are not compiled again.
+ */
+
+static ngx_queue_t    ngx_qjs_code_cache;
+
 static const JSCFunctionListEntry ngx_qjs_ext_ngx[] = {
     JS_CGETSET_DEF("build", ngx_qjs_ext_build, NULL),
     JS_CGETSET_DEF("conf_prefix", ngx_qjs_ext_conf_prefix, NULL),
@@ -436,6 +496,8 @@ static const JSCFunctionListEntry ngx_qjs_ext_ngx[] = {
                          NGX_LOG_ERR),
     JS_CGETSET_DEF("error_log_path", ngx_qjs_ext_error_log_path, NULL),
     JS_CFUNC_DEF("fetch", 2, ngx_qjs_ext_fetch),
+    JS_CGETSET_DEF("fetch_ssl_sessions_reused",
+                   ngx_qjs_ext_fetch_ssl_sessions_reused, NULL),
     JS_CGETSET_MAGIC_DEF("INFO", ngx_qjs_ext_constant_integer, NULL,
                          NGX_LOG_INFO),
     JS_CFUNC_MAGIC_DEF("log", 1, ngx_qjs_ext_log, 0),
@@ -657,6 +719,16 @@ ngx_njs_clone(ngx_js_ctx_t *ctx, ngx_js_loc_conf_t *cf, void *external)
     ngx_engine_t        *engine;
     njs_opaque_value_t   retval;
 
+    if (cf->reuse_queue != NULL) {
+        engine = ngx_js_queue_pop(cf->reuse_queue);
+        if (engine != NULL) {
+            ngx_log_debug1(NGX_LOG_DEBUG_HTTP, ctx->log, 0,
+                           "js reused vm: %p", engine->u.njs.vm);
+            njs_vm_reset(engine->u.njs.vm, external);
+            return engine;
+        }
+    }
+
     vm = njs_vm_clone(cf->engine->u.njs.vm, external);
     if (vm == NULL) {
         return NULL;
@@ -669,6 +741,7 @@ ngx_njs_clone(ngx_js_ctx_t *ctx, ngx_js_loc_conf_t *cf, void *external)
 
     memcpy(engine, cf->engine, sizeof(ngx_engine_t));
     engine->pool = njs_vm_memory_pool(vm);
+    engine->parent = cf->engine;
     engine->u.njs.vm = vm;
 
     if (njs_vm_start(vm, njs_value_arg(&retval)) == NJS_ERROR) {
@@ -764,13 +837,33 @@ ngx_engine_njs_string(ngx_engine_t *e, njs_opaque_value_t *value,
 }
 
 
+static void
+ngx_js_cleanup_reuse_vm(void *data)
+{
+    ngx_engine_t  *e;
+
+    ngx_js_queue_t  *reuse = data;
+
+    for ( ;; ) {
+        e = ngx_js_queue_pop(reuse);
+        if (e == NULL) {
+            break;
+        }
+
+        njs_vm_destroy(e->u.njs.vm);
+    }
+}
+
+
 static void
 ngx_engine_njs_destroy(ngx_engine_t *e, ngx_js_ctx_t *ctx,
     ngx_js_loc_conf_t *conf)
 {
     ngx_str_t           exception;
+    njs_mp_stat_t       stat;
     ngx_js_event_t     *event;
     njs_rbtree_node_t  *node;
+    ngx_pool_cleanup_t *cln;
 
     if (ctx != NULL) {
         node = njs_rbtree_min(&ctx->waiting_events);
@@ -791,8 +884,72 @@ ngx_engine_njs_destroy(ngx_engine_t *e, ngx_js_ctx_t *ctx,
             ngx_log_error(NGX_LOG_ERR, ctx->log, 0,
                           "js unhandled rejection: %V", &exception);
         }
+
+        /*
+         * The location may be changed after the VM is cloned,
+         * the VM is reused only by the engine it was cloned from.
+         */
+
+        if (conf != NULL
+            && ngx_js_reuse(conf) != 0
+            && e->parent == conf->engine)
+        {
+            if (conf->reuse_queue == NULL) {
+                conf->reuse_queue = ngx_js_queue_create(ngx_cycle->pool,
+                                                        ngx_js_reuse(conf));
+                if (conf->reuse_queue == NULL) {
+                    goto free_vm;
+                }
+
+                cln = ngx_pool_cleanup_add(ngx_cycle->pool, 0);
+                if (cln == NULL) {
+                    goto free_vm;
+                }
+
+                cln->handler = ngx_js_cleanup_reuse_vm;
+                cln->data = conf->reuse_queue;
+            }
+
+            /*
+             * The memory allocated while handling a request is returned
+             * to the VM pool only when the VM is destroyed, so the pool
+             * grows with every reuse.
+             */
+
+            njs_mp_stat(e->pool, &stat);
+
+            if (stat.size > conf->reuse_max_size) {
+                ngx_log_debug1(NGX_LOG_DEBUG_HTTP, ctx->log, 0,
+                               "js vm memory usage %uz exceeds "
+                               "\"js_context_reuse_max_size\" limit, "
+                               "not reusing it", stat.size);
+                goto free_vm;
+            }
+
+            /*
+             * The values referencing the request memory may still be
+             * reachable from the global scope, such a VM is not reused.
+             * The request object is detached from the finalized request,
+             * so its properties are undefined for the next requests.
+             */
+
+            if (ctx->external_memory) {
+                ngx_log_debug0(NGX_LOG_DEBUG_HTTP, ctx->log, 0,
+                               "js vm refers to request memory, "
+                               "not reusing it");
+                goto free_vm;
+            }
+
+            njs_value_external_detach(njs_value_arg(&ctx->args[0]));
+
+            if (ngx_js_queue_push(conf->reuse_queue, e) == NGX_OK) {
+                return;
+            }
+        }
     }
 
+free_vm:
+
     njs_vm_destroy(e->u.njs.vm);
 
     /*
@@ -1181,10 +1338,10 @@ ngx_engine_qjs_destroy(ngx_engine_t *e, ngx_js_ctx_t *ctx,
 
     njs_mp_destroy(e->pool);
 
-    if (conf != NULL && conf->reuse != 0) {
+    if (conf != NULL && ngx_js_reuse(conf) != 0) {
         if (conf->reuse_queue == NULL) {
             conf->reuse_queue = ngx_js_queue_create(ngx_cycle->pool,
-                                                    conf->reuse);
+                                                    ngx_js_reuse(conf));
             if (conf->reuse_queue == NULL) {
                 goto free_ctx;
             }
@@ -1717,6 +1874,13 @@ ngx_qjs_ext_error_log_path(JSContext *cx, JSValueConst this_val)
 }
 
 
+static JSValue
+ngx_qjs_ext_fetch_ssl_sessions_reused(JSContext *cx, JSValueConst this_val)
+{
+    return JS_NewFloat64(cx, ngx_js_http_ssl_reused);
+}
+
+
 static JSValue
 ngx_qjs_ext_prefix(JSContext *cx, JSValueConst this_val)
 {
@@ -1978,13 +2142,16 @@ not_found:
 static JSModuleDef *
 ngx_qjs_module_loader(JSContext *cx, const char *module_name, void *opaque)
 {
-    JSValue               func_val;
-    njs_int_t             ret;
-    njs_str_t             text;
-    JSModuleDef          *m;
-    njs_module_info_t     info;
-    ngx_js_loc_conf_t    *conf;
-    ngx_js_code_entry_t  *pc;
+    JSValue                func_val;
+    uint32_t               crc32;
+    njs_int_t              ret;
+    njs_str_t              text;
+    struct stat            sb;
+    JSModuleDef           *m;
+    njs_module_info_t      info;
+    ngx_js_loc_conf_t     *conf;
+    ngx_js_code_entry_t   *pc;
+    ngx_qjs_code_cache_t  *cache;
 
     conf = opaque;
 
@@ -2007,6 +2174,11 @@ ngx_qjs_module_loader(JSContext *cx, const char *module_name, void *opaque)
 
     ret = ngx_js_module_read(conf->engine->pool, info.fd, &text);
 
+    if (ret == NJS_OK && fstat(info.fd, &sb) == -1) {
+        njs_mp_free(conf->engine->pool, text.start);
+        ret = NJS_ERROR;
+    }
+
     (void) close(info.fd);
 
     if (ret != NJS_OK) {
@@ -2015,13 +2187,41 @@ ngx_qjs_module_loader(JSContext *cx, const char *module_name, void *opaque)
         return NULL;
     }
 
-    func_val = JS_Eval(cx, (char *) text.start, text.length, module_name,
-                       JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    crc32 = ngx_crc32_long(text.start, text.length);
 
-    njs_mp_free(conf->engine->pool, text.start);
+    cache = ngx_qjs_code_cache_lookup(&info, &sb, crc32);
 
-    if (JS_IsException(func_val)) {
-        return NULL;
+    if (cache != NULL) {
+        ngx_log_debug1(NGX_LOG_DEBUG_CORE, ngx_cycle->log, 0,
+                       "js module bytecode cached: \"%s\"", module_name);
+
+        njs_mp_free(conf->engine->pool, text.start);
+
+        func_val = JS_ReadObject(cx, cache->code, cache->code_size,
+                                 JS_READ_OBJ_BYTECODE);
+        if (JS_IsException(func_val)) {
+            return NULL;
+        }
+
+        /*
+         * The imported modules are loaded before the module is added,
+         * as with the compilation.
+         */
+
+        if (JS_ResolveModule(cx, func_val) < 0) {
+            JS_FreeValue(cx, func_val);
+            return NULL;
+        }
+
+    } else {
+        func_val = JS_Eval(cx, (char *) text.start, text.length, module_name,
+                           JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+
+        njs_mp_free(conf->engine->pool, text.start);
+
+        if (JS_IsException(func_val)) {
+            return NULL;
+        }
     }
 
     if (conf->engine->precompiled == NULL) {
@@ -2041,12 +2241,27 @@ ngx_qjs_module_loader(JSContext *cx, const char *module_name, void *opaque)
         return NULL;
     }
 
-    pc->code = JS_WriteObject(cx, &pc->code_size, func_val,
-                              JS_WRITE_OBJ_BYTECODE);
-    if (pc->code == NULL) {
-        JS_FreeValue(cx, func_val);
-        JS_ThrowInternalError(cx, "could not write module bytecode");
-        return NULL;
+    if (cache != NULL) {
+        pc->code_size = cache->code_size;
+
+        pc->code = js_malloc(cx, pc->code_size);
+        if (pc->code == NULL) {
+            JS_FreeValue(cx, func_val);
+            return NULL;
+        }
+
+        ngx_memcpy(pc->code, cache->code, pc->code_size);
+
+    } else {
+        pc->code = JS_WriteObject(cx, &pc->code_size, func_val,
+                                  JS_WRITE_OBJ_BYTECODE);
+        if (pc->code == NULL) {
+            JS_FreeValue(cx, func_val);
+            JS_ThrowInternalError(cx, "could not write module bytecode");
+            return NULL;
+        }
+
+        ngx_qjs_code_cache_add(&info, &sb, crc32, pc->code, pc->code_size);
     }
 
     m = JS_VALUE_GET_PTR(func_val);
@@ -2056,6 +2271,102 @@ ngx_qjs_module_loader(JSContext *cx, const char *module_name, void *opaque)
 }
 
 
+static ngx_qjs_code_cache_t *
+ngx_qjs_code_cache_find(njs_module_info_t *info)
+{
+    ngx_queue_t           *q;
+    ngx_qjs_code_cache_t  *cache;
+
+    if (ngx_qjs_code_cache.prev == NULL) {
+        ngx_queue_init(&ngx_qjs_code_cache);
+    }
+
+    for (q = ngx_queue_head(&ngx_qjs_code_cache);
+         q != ngx_queue_sentinel(&ngx_qjs_code_cache);
+         q = ngx_queue_next(q))
+    {
+        cache = ngx_queue_data(q, ngx_qjs_code_cache_t, queue);
+
+        if (cache->name.len == info->name.length
+            && cache->file.len == info->file.length
+            && ngx_strncmp(cache->name.data, info->name.start,
+                           info->name.length) == 0
+            && ngx_strncmp(cache->file.data, info->file.start,
+                           info->file.length) == 0)
+        {
+            return cache;
+        }
+    }
+
+    return NULL;
+}
+
+
+static ngx_qjs_code_cache_t *
+ngx_qjs_code_cache_lookup(njs_module_info_t *info, struct stat *sb,
+    uint32_t crc32)
+{
+    ngx_qjs_code_cache_t  *cache;
+
+    cache = ngx_qjs_code_cache_find(info);
+
+    if (cache == NULL
+        || cache->mtime != sb->st_mtime
+        || cache->size != sb->st_size
+        || cache->crc32 != crc32)
+    {
+        return NULL;
+    }
+
+    return cache;
+}
+
+
+static void
+ngx_qjs_code_cache_add(njs_module_info_t *info, struct stat *sb,
+    uint32_t crc32, u_char *code, size_t code_size)
+{
+    u_char                *p;
+    ngx_qjs_code_cache_t  *cache;
+
+    /* the bytecode of the previous version of the module is replaced */
+
+    cache = ngx_qjs_code_cache_find(info);
+
+    if (cache != NULL) {
+        ngx_queue_remove(&cache->queue);
+        ngx_free(cache);
+    }
+
+    cache = ngx_alloc(sizeof(ngx_qjs_code_cache_t) + info->name.length
+                      + info->file.length + code_size, ngx_cycle->log);
+    if (cache == NULL) {
+        /* the module is compiled again on the next reload */
+        return;
+    }
+
+    p = (u_char *) &cache[1];
+
+    cache->name.data = p;
+    cache->name.len = info->name.length;
+    p = ngx_cpymem(p, info->name.start, info->name.length);
+
+    cache->file.data = p;
+    cache->file.len = info->file.length;
+    p = ngx_cpymem(p, info->file.start, info->file.length);
+
+    cache->code = p;
+    cache->code_size = code_size;
+    ngx_memcpy(p, code, code_size);
+
+    cache->mtime = sb->st_mtime;
+    cache->size = sb->st_size;
+    cache->crc32 = crc32;
+
+    ngx_queue_insert_tail(&ngx_qjs_code_cache, &cache->queue);
+}
+
+
 static int
 ngx_qjs_unhandled_rejection(ngx_js_ctx_t *ctx)
 {
@@ -2304,6 +2615,48 @@ ngx_js_string(njs_vm_t *vm, njs_value_t *value, njs_str_t *str)
 }
 
 
+/*
+ * Buffers created with ngx_js_prop() refer to the request or session
+ * memory.  If the VM may be reused, the data is copied to the VM pool,
+ * otherwise the VM is marked to be destroyed with the request.
+ */
+
+njs_int_t
+ngx_js_buffer_set(njs_vm_t *vm, njs_value_t *value, const u_char *start,
+    size_t len)
+{
+    u_char              *p;
+    ngx_js_ctx_t        *ctx;
+    ngx_js_loc_conf_t   *conf;
+    njs_external_ptr_t   external;
+
+    external = njs_vm_external_ptr(vm);
+
+    if (external == NULL || len == 0) {
+        return njs_vm_value_buffer_set(vm, value, start, len);
+    }
+
+    conf = ngx_external_loc_conf(vm, external);
+
+    if (ngx_js_reuse(conf) == 0) {
+        ctx = ngx_external_ctx(vm, external);
+        ctx->external_memory = 1;
+
+        return njs_vm_value_buffer_set(vm, value, start, len);
+    }
+
+    p = njs_mp_alloc(njs_vm_memory_pool(vm), len);
+    if (p == NULL) {
+        njs_vm_memory_error(vm);
+        return NJS_ERROR;
+    }
+
+    ngx_memcpy(p, start, len);
+
+    return njs_vm_value_buffer_set(vm, value, p, len);
+}
+
+
 ngx_int_t
 ngx_js_ngx_string(njs_vm_t *vm, njs_value_t *value, ngx_str_t *str)
 {
@@ -2578,6 +2931,16 @@ ngx_js_ext_error_log_path(njs_vm_t *vm, njs_object_prop_t *prop, uint32_t unused
 }
 
 
+static njs_int_t
+ngx_js_ext_fetch_ssl_sessions_reused(njs_vm_t *vm, njs_object_prop_t *prop,
+    uint32_t unused, njs_value_t *value, njs_value_t *setval,
+    njs_value_t *retval)
+{
+    njs_value_number_set(retval, ngx_js_http_ssl_reused);
+    return NJS_OK;
+}
+
+
 njs_int_t
 ngx_js_ext_prefix(njs_vm_t *vm, njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval)
@@ -3837,9 +4200,20 @@ ngx_js_init_conf_vm(ngx_conf_t *cf, ngx_js_loc_conf_t *conf,
     size_t                size;
     ngx_str_t            *m, file;
     ngx_uint_t            i;
+    ngx_engine_t         *engine;
     ngx_pool_cleanup_t   *cln;
     ngx_js_named_path_t  *import;
 
+    engine = ngx_js_shared_engine(options->main_conf, conf);
+
+    if (engine != NULL) {
+        ngx_log_debug1(NGX_LOG_DEBUG_CORE, cf->log, 0,
+                       "js vm shared: %p", engine);
+
+        conf->engine = engine;
+        return NGX_OK;
+    }
+
     if (ngx_set_environment(cf->cycle, NULL) == NULL) {
         return NGX_ERROR;
     }
@@ -3913,7 +4287,139 @@ ngx_js_init_conf_vm(ngx_conf_t *cf, ngx_js_loc_conf_t *conf,
         }
     }
 
-    return conf->engine->compile(conf, cf->log, start, size);
+    if (conf->engine->compile(conf, cf->log, start, size) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    return ngx_js_add_shared_engine(cf, options->main_conf, conf);
+}
+
+
+static ngx_uint_t
+ngx_js_named_paths_equal(ngx_array_t *a, ngx_array_t *b)
+{
+    ngx_uint_t            i;
+    ngx_js_named_path_t  *pa, *pb;
+
+    if (a == b) {
+        return 1;
+    }
+
+    if (a == NGX_CONF_UNSET_PTR
+        || b == NGX_CONF_UNSET_PTR
+        || a->nelts != b->nelts)
+    {
+        return 0;
+    }
+
+    pa = a->elts;
+    pb = b->elts;
+
+    for (i = 0; i < a->nelts; i++) {
+        if (pa[i].name.len != pb[i].name.len
+            || pa[i].path.len != pb[i].path.len
+            || ngx_strncmp(pa[i].name.data, pb[i].name.data,
+                           pa[i].name.len) != 0
+            || ngx_strncmp(pa[i].path.data, pb[i].path.data,
+                           pa[i].path.len) != 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+static ngx_uint_t
+ngx_js_paths_equal(ngx_array_t *a, ngx_array_t *b)
+{
+    ngx_str_t   *sa, *sb;
+    ngx_uint_t   i;
+
+    if (a == b) {
+        return 1;
+    }
+
+    if (a == NGX_CONF_UNSET_PTR
+        || b == NGX_CONF_UNSET_PTR
+        || a->nelts != b->nelts)
+    {
+        return 0;
+    }
+
+    sa = a->elts;
+    sb = b->elts;
+
+    for (i = 0; i < a->nelts; i++) {
+        if (sa[i].len != sb[i].len
+            || ngx_strncmp(sa[i].data, sb[i].data, sa[i].len) != 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+static ngx_engine_t *
+ngx_js_shared_engine(ngx_js_main_conf_t *jmcf, ngx_js_loc_conf_t *conf)
+{
+    ngx_uint_t               i;
+    ngx_js_shared_engine_t  *se;
+
+    if (jmcf == NULL || jmcf->engines == NULL) {
+        return NULL;
+    }
+
+    se = jmcf->engines->elts;
+
+    for (i = 0; i < jmcf->engines->nelts; i++) {
+        if (se[i].type == conf->type
+            && ngx_js_named_paths_equal(se[i].imports, conf->imports)
+            && ngx_js_named_paths_equal(se[i].preload_objects,
+                                        conf->preload_objects)
+            && ngx_js_paths_equal(se[i].paths, conf->paths))
+        {
+            return se[i].engine;
+        }
+    }
+
+    return NULL;
+}
+
+
+static ngx_int_t
+ngx_js_add_shared_engine(ngx_conf_t *cf, ngx_js_main_conf_t *jmcf,
+    ngx_js_loc_conf_t *conf)
+{
+    ngx_js_shared_engine_t  *se;
+
+    if (jmcf == NULL) {
+        return NGX_OK;
+    }
+
+    if (jmcf->engines == NULL) {
+        jmcf->engines = ngx_array_create(cf->pool, 4,
+                                         sizeof(ngx_js_shared_engine_t));
+        if (jmcf->engines == NULL) {
+            return NGX_ERROR;
+        }
+    }
+
+    se = ngx_array_push(jmcf->engines);
+    if (se == NULL) {
+        return NGX_ERROR;
+    }
+
+    se->type = conf->type;
+    se->imports = conf->imports;
+    se->paths = conf->paths;
+    se->preload_objects = conf->preload_objects;
+    se->engine = conf->engine;
+
+    return NGX_OK;
 }
 
 
@@ -3976,6 +4482,14 @@ ngx_js_create_conf(ngx_conf_t *cf, size_t size)
     conf->buffer_size = NGX_CONF_UNSET_SIZE;
     conf->max_response_body_size = NGX_CONF_UNSET_SIZE;
     conf->timeout = NGX_CONF_UNSET_MSEC;
+    conf->fetch_keepalive = NGX_CONF_UNSET_UINT;
+    conf->fetch_keepalive_timeout = NGX_CONF_UNSET_MSEC;
+    conf->fetch_keepalive_requests = NGX_CONF_UNSET_UINT;
+    conf->fetch_resolver_cache = NGX_CONF_UNSET_UINT;
+    conf->fetch_resolver_cache_negative = NGX_CONF_UNSET;
+    conf->fetch_resolver_cache_stale = NGX_CONF_UNSET;
+    conf->fetch_http2 = NGX_CONF_UNSET;
+    conf->fetch_decompress = NGX_CONF_UNSET;
 
     return conf;
 }
@@ -4062,6 +4576,10 @@ ngx_js_set_ssl(ngx_conf_t *cf, ngx_js_loc_conf_t *conf)
         return NGX_CONF_ERROR;
     }
 
+    if (ngx_ssl_client_session_cache(cf, ssl, 1) != NGX_OK) {
+        return NGX_CONF_ERROR;
+    }
+
     return NGX_CONF_OK;
 }
 
@@ -4081,12 +4599,25 @@ ngx_js_merge_conf(ngx_conf_t *cf, void *parent, void *child,
     }
 
     ngx_conf_merge_msec_value(conf->timeout, prev->timeout, 60000);
-    ngx_conf_merge_size_value(conf->reuse, prev->reuse, 128);
+    ngx_conf_merge_size_value(conf->reuse, prev->reuse, NGX_CONF_UNSET_SIZE);
     ngx_conf_merge_size_value(conf->reuse_max_size, prev->reuse_max_size,
                               4 * 1024 * 1024);
     ngx_conf_merge_size_value(conf->buffer_size, prev->buffer_size, 16384);
     ngx_conf_merge_size_value(conf->max_response_body_size,
                               prev->max_response_body_size, 1048576);
+    ngx_conf_merge_uint_value(conf->fetch_keepalive, prev->fetch_keepalive, 0);
+    ngx_conf_merge_msec_value(conf->fetch_keepalive_timeout,
+                              prev->fetch_keepalive_timeout, 60000);
+    ngx_conf_merge_uint_value(conf->fetch_keepalive_requests,
+                              prev->fetch_keepalive_requests, 1000);
+    ngx_conf_merge_uint_value(conf->fetch_resolver_cache,
+                              prev->fetch_resolver_cache, 0);
+    ngx_conf_merge_value(conf->fetch_resolver_cache_negative,
+                         prev->fetch_resolver_cache_negative, 0);
+    ngx_conf_merge_value(conf->fetch_resolver_cache_stale,
+                         prev->fetch_resolver_cache_stale, 0);
+    ngx_conf_merge_value(conf->fetch_http2, prev->fetch_http2, 0);
+    ngx_conf_merge_value(conf->fetch_decompress, prev->fetch_decompress, 0);
 
     if (ngx_js_merge_vm(cf, (ngx_js_loc_conf_t *) conf,
                         (ngx_js_loc_conf_t *) prev,
@@ -81,6 +81,7 @@ typedef ngx_flag_t (*ngx_external_flag_pt)(njs_external_ptr_t e);
 typedef ngx_flag_t (*ngx_external_size_pt)(njs_external_ptr_t e);
 typedef ngx_ssl_t *(*ngx_external_ssl_pt)(njs_external_ptr_t e);
 typedef ngx_js_ctx_t *(*ngx_js_external_ctx_pt)(njs_external_ptr_t e);
+typedef ngx_js_loc_conf_t *(*ngx_external_loc_conf_pt)(njs_external_ptr_t e);
 
 
 typedef struct {
@@ -115,7 +116,10 @@ typedef struct {
 
 #define NGX_JS_COMMON_MAIN_CONF                                               \
     ngx_js_dict_t         *dicts;                                             \
-    ngx_array_t           *periodics                                          \
+    ngx_array_t           *periodics;                                         \
+    ngx_array_t           *engines;                                           \
+    ngx_js_dict_t         *fetch_cache;                                       \
+    ngx_msec_t             fetch_cache_inactive                               \
 
 
 #define _NGX_JS_COMMON_LOC_CONF                                               \
@@ -132,7 +136,18 @@ typedef struct {
                                                                               \
     size_t                 buffer_size;                                       \
     size_t                 max_response_body_size;                            \
-    ngx_msec_t             timeout
+    ngx_msec_t             timeout;                                           \
+                                                                              \
+    ngx_uint_t             fetch_keepalive;                                   \
+    ngx_msec_t             fetch_keepalive_timeout;                           \
+    ngx_uint_t             fetch_keepalive_requests;                          \
+                                                                              \
+    ngx_uint_t             fetch_resolver_cache;                              \
+    time_t                 fetch_resolver_cache_negative;                     \
+    time_t                 fetch_resolver_cache_stale;                        \
+                                                                              \
+    ngx_flag_t             fetch_http2;                                       \
+    ngx_flag_t             fetch_decompress
 
 
 #if defined(NGX_HTTP_SSL) || defined(NGX_STREAM_SSL)
@@ -158,7 +173,18 @@ typedef struct {
     njs_opaque_value_t     retval;                                            \
     njs_arr_t             *rejected_promises;                                 \
     njs_rbtree_t           waiting_events;                                    \
-    ngx_socket_t           event_id
+    ngx_socket_t           event_id;                                          \
+    unsigned               external_memory:1
+
+
+/*
+ * QuickJS contexts are reused by default.  njs VMs are reused only when
+ * "js_context_reuse" is set explicitly, as njs releases the memory
+ * allocated by a request only with the VM.
+ */
+#define ngx_js_reuse(conf)                                                    \
+    (((conf)->reuse != NGX_CONF_UNSET_SIZE) ? (conf)->reuse                   \
+     : ((conf)->type == NGX_ENGINE_QJS) ? 128 : 0)
 
 
 #define ngx_js_add_event(ctx, event)                                          \
@@ -220,6 +246,7 @@ typedef struct ngx_engine_opts_s {
 
     njs_str_t                   file;
     ngx_js_loc_conf_t          *conf;
+    ngx_js_main_conf_t         *main_conf;
     ngx_engine_t             *(*clone)(ngx_js_ctx_t *ctx,
                                         ngx_js_loc_conf_t *cf, njs_int_t pr_id,
                                         void *external);
@@ -266,6 +293,7 @@ struct ngx_engine_s {
     const char                 *name;
     njs_mp_t                   *pool;
     njs_arr_t                  *precompiled;
+    ngx_engine_t               *parent;
 };
 
 
@@ -294,11 +322,13 @@ struct ngx_engine_s {
 	((ngx_js_main_conf_t *) njs_vm_meta(vm, NGX_JS_MAIN_CONF_INDEX))
 #define ngx_external_ctx(vm, e) \
     ((ngx_js_external_ctx_pt) njs_vm_meta(vm, 11))(e)
+#define ngx_external_loc_conf(vm, e)                                          \
+    ((ngx_external_loc_conf_pt) njs_vm_meta(vm, 12))(e)
 
 
 #define ngx_js_prop(vm, type, value, start, len)                              \
     ((type == NGX_JS_STRING) ? njs_vm_value_string_create(vm, value, start, len) \
-                             : njs_vm_value_buffer_set(vm, value, start, len))
+                             : ngx_js_buffer_set(vm, value, start, len))
 
 
 void ngx_js_ctx_init(ngx_js_ctx_t *ctx, ngx_log_t *log);
@@ -386,6 +416,8 @@ JSValue ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
     ((ngx_js_main_conf_t *) ngx_qjs_meta(cx, NGX_JS_MAIN_CONF_INDEX))
 #define ngx_qjs_external_ctx(cx, e)                                          \
     ((ngx_js_external_ctx_pt) ngx_qjs_meta(cx, 11))(e)
+#define ngx_qjs_external_loc_conf(cx, e)                                     \
+    ((ngx_external_loc_conf_pt) ngx_qjs_meta(cx, 12))(e)
 
 extern qjs_module_t  qjs_webcrypto_module;
 extern qjs_module_t  qjs_xml_module;
@@ -415,6 +447,8 @@ char * ngx_js_merge_conf(ngx_conf_t *cf, void *parent, void *child,
    ngx_int_t (*init_vm)(ngx_conf_t *cf, ngx_js_loc_conf_t *conf));
 char *ngx_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
     void *tag);
+char *ngx_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
+    void *tag);
 
 njs_int_t ngx_js_ext_string(njs_vm_t *vm, njs_object_prop_t *prop, uint32_t unused,
     njs_value_t *value, njs_value_t *setval, njs_value_t *retval);
@@ -426,6 +460,8 @@ njs_int_t ngx_js_ext_flags(njs_vm_t *vm, njs_object_prop_t *prop, uint32_t unuse
     njs_value_t *value, njs_value_t *setval, njs_value_t *retval);
 
 ngx_int_t ngx_js_string(njs_vm_t *vm, njs_value_t *value, njs_str_t *str);
+njs_int_t ngx_js_buffer_set(njs_vm_t *vm, njs_value_t *value,
+    const u_char *start, size_t len);
 ngx_int_t ngx_js_ngx_string(njs_vm_t *vm, njs_value_t *value, ngx_str_t *str);
 ngx_int_t ngx_js_integer(njs_vm_t *vm, njs_value_t *value, ngx_int_t *n);
 const char *ngx_js_errno_string(int errnum);
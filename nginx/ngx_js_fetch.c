@@ -31,6 +31,17 @@ typedef struct {
 
     njs_opaque_value_t             promise;
     njs_opaque_value_t             promise_callbacks[2];
+
+    njs_opaque_value_t             read_callbacks[2];
+    njs_opaque_value_t             error_value;
+
+    njs_function_t                *body_pull;
+    njs_opaque_value_t             body_args[3];
+
+    unsigned                       streaming:1;
+    unsigned                       reading:1;
+    unsigned                       finished:1;
+    unsigned                       failed:1;
 } ngx_js_fetch_t;
 
 
@@ -59,6 +70,26 @@ static ngx_int_t ngx_js_fetch_append_headers(ngx_js_http_t *http,
     ngx_js_headers_t *headers, u_char *name, size_t len, u_char *value,
     size_t vlen);
 static void ngx_js_fetch_process_done(ngx_js_http_t *http);
+static void ngx_js_fetch_body_handler(ngx_js_http_t *http);
+static ngx_int_t ngx_js_fetch_call(ngx_js_fetch_t *fetch,
+    njs_opaque_value_t *action, njs_opaque_value_t *value);
+static void ngx_js_fetch_finish(ngx_js_fetch_t *fetch, ngx_int_t rc);
+static njs_int_t ngx_js_fetch_read_result(njs_vm_t *vm, ngx_js_http_t *http,
+    njs_value_t *retval);
+static njs_bool_t ngx_js_fetch_body_is_iterator(njs_vm_t *vm,
+    njs_value_t *value);
+static njs_int_t ngx_js_fetch_body_init(njs_vm_t *vm, ngx_js_fetch_t *fetch,
+    njs_value_t *iterator);
+static njs_int_t ngx_js_fetch_body_bind(njs_vm_t *vm, ngx_js_fetch_t *fetch,
+    njs_function_native_t native, njs_opaque_value_t *retval);
+static void ngx_js_fetch_body_next(ngx_js_http_t *http);
+static njs_int_t ngx_js_fetch_body_pull(njs_vm_t *vm, njs_value_t *args,
+    njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
+static njs_int_t ngx_js_fetch_body_chunk(njs_vm_t *vm, njs_value_t *args,
+    njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
+static njs_int_t ngx_js_fetch_body_rejected(njs_vm_t *vm, njs_value_t *args,
+    njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
+static ngx_js_http_t *ngx_js_fetch_body_http(njs_vm_t *vm, njs_value_t *id);
 static njs_int_t ngx_js_headers_append(njs_vm_t *vm, ngx_js_headers_t *headers,
     u_char *name, size_t len, u_char *value, size_t vlen);
 
@@ -116,6 +147,8 @@ static njs_int_t ngx_response_js_ext_type(njs_vm_t *vm,
     njs_value_t *setval, njs_value_t *retval);
 static njs_int_t ngx_response_js_ext_body(njs_vm_t *vm, njs_value_t *args,
      njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
+static njs_int_t ngx_response_js_ext_read(njs_vm_t *vm, njs_value_t *args,
+     njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
 
 static njs_int_t ngx_fetch_flag(njs_vm_t *vm, const ngx_js_entry_t *entries,
     njs_int_t value, njs_value_t *retval);
@@ -432,6 +465,17 @@ static njs_external_t  ngx_js_ext_http_response[] = {
         }
     },
 
+    {
+        .flags = NJS_EXTERN_METHOD,
+        .name.string = njs_str("read"),
+        .writable = 1,
+        .configurable = 1,
+        .enumerable = 1,
+        .u.method = {
+            .native = ngx_response_js_ext_read,
+        }
+    },
+
     {
         .flags = NJS_EXTERN_PROPERTY,
         .name.string = njs_str("redirected"),
@@ -511,6 +555,7 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
     njs_int_t            ret;
+    ngx_int_t            rc;
     ngx_url_t            u;
     ngx_uint_t           i;
     njs_bool_t           has_host;
@@ -523,12 +568,15 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     ngx_js_tb_elt_t     *h;
     ngx_js_request_t     request;
     ngx_connection_t    *c;
-    ngx_resolver_ctx_t  *ctx;
+    ngx_js_loc_conf_t   *conf;
+    ngx_js_main_conf_t  *jmcf;
     njs_external_ptr_t   external;
     njs_opaque_value_t   lvalue;
 
+    static const njs_str_t body_key = njs_str("body");
     static const njs_str_t buffer_size_key = njs_str("buffer_size");
     static const njs_str_t body_size_key = njs_str("max_response_body_size");
+    static const njs_str_t stream_key = njs_str("stream");
 #if (NGX_SSL)
     static const njs_str_t verify_key = njs_str("verify");
 #endif
@@ -555,6 +603,20 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     http->max_response_body_size =
                            ngx_external_max_response_buffer_size(vm, external);
 
+    conf = ngx_external_loc_conf(vm, external);
+
+    http->keepalive = conf->fetch_keepalive;
+    http->keepalive_timeout = conf->fetch_keepalive_timeout;
+    http->keepalive_requests = conf->fetch_keepalive_requests;
+    http->resolver_cache = conf->fetch_resolver_cache;
+    http->resolver_cache_negative = conf->fetch_resolver_cache_negative;
+    http->resolver_cache_stale = conf->fetch_resolver_cache_stale;
+    http->http2 = conf->fetch_http2;
+
+#ifdef NJS_HAVE_ZLIB
+    http->decompress = conf->fetch_decompress;
+#endif
+
 #if (NGX_SSL)
     if (u.default_port == 443) {
         http->ssl = ngx_external_ssl(vm, external);
@@ -581,12 +643,26 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
             goto fail;
         }
 
+        value = njs_vm_object_prop(vm, init, &stream_key, &lvalue);
+        if (value != NULL) {
+            http->stream = njs_value_bool(value);
+        }
+
 #if (NGX_SSL)
         value = njs_vm_object_prop(vm, init, &verify_key, &lvalue);
         if (value != NULL) {
             http->ssl_verify = njs_value_bool(value);
         }
 #endif
+
+        if (request.body_stream) {
+            value = njs_vm_object_prop(vm, init, &body_key, &lvalue);
+            if (value == NULL
+                || ngx_js_fetch_body_init(vm, fetch, value) != NJS_OK)
+            {
+                goto fail;
+            }
+        }
     }
 
     if (request.method.len == 4
@@ -595,6 +671,23 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         http->header_only = 1;
     }
 
+    http->idempotent = ngx_js_http_idempotent(&request.method);
+
+    jmcf = ngx_main_conf(vm);
+
+    if (jmcf->fetch_cache != NULL
+        && !http->stream
+        && request.cache_mode != CACHE_MODE_NO_STORE
+        && request.body.len == 0
+        && !request.body_stream
+        && request.method.len == 3
+        && ngx_strncasecmp(request.method.data, (u_char *) "GET", 3) == 0)
+    {
+        http->cache = jmcf->fetch_cache;
+        http->cache_mode = request.cache_mode;
+        http->cache_inactive = jmcf->fetch_cache_inactive;
+    }
+
     NJS_CHB_MP_INIT(&http->chain, njs_vm_memory_pool(vm));
     NJS_CHB_MP_INIT(&http->response.chain, njs_vm_memory_pool(vm));
 
@@ -682,23 +775,74 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
             continue;
         }
 
+        if (h[i].key.len == 15
+            && ngx_strncasecmp(h[i].key.data, (u_char *) "Accept-Encoding",
+                               15)
+            == 0)
+        {
+            /* the response is left as is if the encoding is set explicitly */
+
+            http->decompress = 0;
+        }
+
         njs_chb_append(&http->chain, h[i].key.data, h[i].key.len);
         njs_chb_append_literal(&http->chain, ": ");
         njs_chb_append(&http->chain, h[i].value.data, h[i].value.len);
         njs_chb_append_literal(&http->chain, CRLF);
     }
 
-    njs_chb_append_literal(&http->chain, "Connection: close" CRLF);
+    if (http->decompress) {
+        njs_chb_append_literal(&http->chain,
+                               "Accept-Encoding: gzip, deflate" CRLF);
+    }
+
+    if (http->cache != NULL) {
+        if (ngx_js_http_cache_key(http, &request.url, &request.headers)
+            != NGX_OK)
+        {
+            njs_vm_memory_error(vm);
+            return NJS_ERROR;
+        }
+
+        rc = ngx_js_http_cache_lookup(http);
+
+        if (rc == NGX_OK) {
+            http->ready_handler(http);
+            njs_value_assign(retval, njs_value_arg(&fetch->promise));
+            return NJS_OK;
+        }
+
+        if (rc == NGX_ABORT) {
+            njs_vm_error(vm, "no cached response for \"only-if-cached\"");
+            goto fail;
+        }
+
+        if (rc == NGX_ERROR) {
+            njs_vm_memory_error(vm);
+            return NJS_ERROR;
+        }
+    }
+
+    if (http->keepalive) {
+        njs_chb_append_literal(&http->chain, "Connection: keep-alive" CRLF);
+
+    } else {
+        njs_chb_append_literal(&http->chain, "Connection: close" CRLF);
+    }
 
 #if (NGX_SSL)
     http->tls_name.data = u.host.data;
     http->tls_name.len = u.host.len;
 #endif
 
-    if (request.body.len != 0) {
+    if (http->body_stream) {
+        njs_chb_append_literal(&http->chain,
+                               "Transfer-Encoding: chunked" CRLF CRLF);
+
+    } else if (request.body.len != 0) {
         njs_chb_sprintf(&http->chain, 32, "Content-Length: %uz" CRLF CRLF,
                         request.body.len);
-        njs_chb_append(&http->chain, request.body.data, request.body.len);
+        http->body = request.body;
 
     } else {
         method = request.method;
@@ -715,16 +859,32 @@ ngx_js_ext_fetch(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         }
     }
 
+    if (u.addrs == NULL && u.no_port) {
+        rc = ngx_js_http_upstream(http, &u.host);
+        if (rc == NGX_ERROR) {
+            njs_vm_memory_error(vm);
+            return NJS_ERROR;
+        }
+
+        if (rc == NGX_OK) {
+            ngx_js_http_connect(http);
+
+            njs_value_assign(retval, njs_value_arg(&fetch->promise));
+
+            return NJS_OK;
+        }
+    }
+
     if (u.addrs == NULL) {
-        ctx = ngx_js_http_resolve(http, ngx_external_resolver(vm, external),
-                                  &u.host, u.port,
-                                  ngx_external_resolver_timeout(vm, external));
-        if (ctx == NULL) {
+        rc = ngx_js_http_resolve(http, ngx_external_resolver(vm, external),
+                                 &u.host, u.port,
+                                 ngx_external_resolver_timeout(vm, external));
+        if (rc == NGX_ERROR) {
             njs_vm_memory_error(vm);
             return NJS_ERROR;
         }
 
-        if (ctx == NGX_NO_RESOLVER) {
+        if (rc == NGX_DECLINED) {
             njs_vm_error(vm, "no resolver defined");
             goto fail;
         }
@@ -817,6 +977,11 @@ ngx_js_ext_request_constructor(njs_vm_t *vm, njs_value_t *args,
         return NJS_ERROR;
     }
 
+    if (request->body_stream) {
+        njs_vm_error(vm, "invalid Request body");
+        return NJS_ERROR;
+    }
+
     return njs_vm_external_create(vm, retval,
                                   ngx_http_js_fetch_request_proto_id, request,
                                   0);
@@ -1159,6 +1324,7 @@ ngx_js_fetch_alloc(njs_vm_t *vm, ngx_pool_t *pool, ngx_log_t *log)
 
     http->append_headers = ngx_js_fetch_append_headers;
     http->ready_handler = ngx_js_fetch_process_done;
+    http->body_handler = ngx_js_fetch_body_handler;
     http->error_handler = ngx_js_fetch_error;
 
     ret = njs_vm_promise_create(vm, njs_value_arg(&fetch->promise),
@@ -1205,12 +1371,30 @@ failed:
 static void
 ngx_js_fetch_error(ngx_js_http_t *http, const char *err)
 {
+    ngx_int_t        rc;
     ngx_js_fetch_t  *fetch;
 
     fetch = (ngx_js_fetch_t *) http;
 
     njs_vm_error(fetch->vm, err);
 
+    if (fetch->streaming) {
+        njs_vm_exception_get(fetch->vm, njs_value_arg(&fetch->error_value));
+
+        fetch->failed = 1;
+
+        rc = NGX_OK;
+
+        if (fetch->reading) {
+            fetch->reading = 0;
+            rc = ngx_js_fetch_call(fetch, &fetch->read_callbacks[1],
+                                   &fetch->error_value);
+        }
+
+        ngx_js_fetch_finish(fetch, rc);
+        return;
+    }
+
     njs_vm_exception_get(fetch->vm, njs_value_arg(&fetch->response_value));
 
     ngx_js_fetch_done(fetch, &fetch->response_value, NJS_ERROR);
@@ -1525,7 +1709,10 @@ ngx_js_request_constructor(njs_vm_t *vm, ngx_js_request_t *request,
         }
 
         value = njs_vm_object_prop(vm, init, &body_key, &lvalue);
-        if (value != NULL) {
+        if (value != NULL && ngx_js_fetch_body_is_iterator(vm, value)) {
+            request->body_stream = 1;
+
+        } else if (value != NULL) {
             if (ngx_js_ngx_string(vm, value, &request->body) != NGX_OK) {
                 njs_vm_error(vm, "invalid Request body");
                 return NJS_ERROR;
@@ -1583,6 +1770,373 @@ ngx_js_fetch_process_done(ngx_js_http_t *http)
 }
 
 
+static void
+ngx_js_fetch_body_handler(ngx_js_http_t *http)
+{
+    njs_vm_t            *vm;
+    njs_int_t            ret;
+    ngx_int_t            rc;
+    ngx_js_fetch_t      *fetch;
+    njs_opaque_value_t   value;
+
+    fetch = (ngx_js_fetch_t *) http;
+    vm = fetch->vm;
+
+    rc = NGX_OK;
+
+    if (!fetch->streaming) {
+        ret = njs_vm_external_create(vm,
+                                     njs_value_arg(&fetch->response_value),
+                                     ngx_http_js_fetch_response_proto_id,
+                                     &http->response, 0);
+        if (ret != NJS_OK) {
+            ngx_js_fetch_error(http, "fetch response creation failed");
+            return;
+        }
+
+        fetch->streaming = 1;
+        http->response.http = http;
+
+        rc = ngx_js_fetch_call(fetch, &fetch->promise_callbacks[0],
+                               &fetch->response_value);
+    }
+
+    if (rc == NGX_OK
+        && fetch->reading
+        && (http->response.chain.nodes != NULL || http->done))
+    {
+        fetch->reading = 0;
+
+        ret = ngx_js_fetch_read_result(vm, http, njs_value_arg(&value));
+        if (ret != NJS_OK) {
+            njs_vm_exception_get(vm, njs_value_arg(&value));
+        }
+
+        rc = ngx_js_fetch_call(fetch, &fetch->read_callbacks[ret != NJS_OK],
+                               &value);
+    }
+
+    if (rc != NGX_OK || http->done) {
+        ngx_js_fetch_finish(fetch, rc);
+        return;
+    }
+
+    ngx_external_event_finalize(vm)(njs_vm_external_ptr(vm), rc);
+}
+
+
+static ngx_int_t
+ngx_js_fetch_call(ngx_js_fetch_t *fetch, njs_opaque_value_t *action,
+    njs_opaque_value_t *value)
+{
+    njs_function_t      *function;
+    njs_opaque_value_t   arguments[2];
+
+    njs_value_assign(&arguments[0], action);
+    njs_value_assign(&arguments[1], value);
+
+    function = njs_value_function(njs_value_arg(&fetch->event->function));
+
+    return ngx_js_call(fetch->vm, function, &arguments[0], 2);
+}
+
+
+static void
+ngx_js_fetch_finish(ngx_js_fetch_t *fetch, ngx_int_t rc)
+{
+    njs_vm_t      *vm;
+    ngx_js_ctx_t  *ctx;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, fetch->http.log, 0,
+                   "js http finish fetch:%p rc:%i", fetch, rc);
+
+    fetch->finished = 1;
+
+    vm = fetch->vm;
+
+    ctx = ngx_external_ctx(vm, njs_vm_external_ptr(vm));
+    ngx_js_del_event(ctx, fetch->event);
+
+    ngx_external_event_finalize(vm)(njs_vm_external_ptr(vm), rc);
+}
+
+
+static njs_int_t
+ngx_js_fetch_read_result(njs_vm_t *vm, ngx_js_http_t *http,
+    njs_value_t *retval)
+{
+    njs_str_t  data;
+
+    if (ngx_js_http_stream_read(http, &data) != NGX_OK) {
+        njs_vm_memory_error(vm);
+        return NJS_ERROR;
+    }
+
+    if (data.length == 0) {
+        njs_value_undefined_set(retval);
+        return NJS_OK;
+    }
+
+    /*
+     * The chunk is not copied.  As the ArrayBuffer may be kept by the code,
+     * the memory cannot be reused for the next chunk and is released with
+     * the VM, so it is bounded only with the QuickJS engine.
+     */
+
+    return njs_vm_value_array_buffer_set(vm, retval, data.start, data.length);
+}
+
+
+static njs_bool_t
+ngx_js_fetch_body_is_iterator(njs_vm_t *vm, njs_value_t *value)
+{
+    njs_value_t         *next;
+    njs_opaque_value_t   lvalue;
+
+    static const njs_str_t next_key = njs_str("next");
+
+    if (!njs_value_is_object(value)) {
+        return 0;
+    }
+
+    next = njs_vm_object_prop(vm, value, &next_key, &lvalue);
+
+    return (next != NULL && njs_value_is_function(next));
+}
+
+
+static njs_int_t
+ngx_js_fetch_body_init(njs_vm_t *vm, ngx_js_fetch_t *fetch,
+    njs_value_t *iterator)
+{
+    njs_int_t       ret;
+    ngx_js_http_t  *http;
+
+    fetch->body_pull = njs_vm_function_alloc(vm, ngx_js_fetch_body_pull, 0, 0);
+    if (fetch->body_pull == NULL) {
+        return NJS_ERROR;
+    }
+
+    njs_value_assign(&fetch->body_args[0], iterator);
+
+    ret = ngx_js_fetch_body_bind(vm, fetch, ngx_js_fetch_body_chunk,
+                                 &fetch->body_args[1]);
+    if (ret != NJS_OK) {
+        return NJS_ERROR;
+    }
+
+    ret = ngx_js_fetch_body_bind(vm, fetch, ngx_js_fetch_body_rejected,
+                                 &fetch->body_args[2]);
+    if (ret != NJS_OK) {
+        return NJS_ERROR;
+    }
+
+    http = &fetch->http;
+
+    http->body_stream = 1;
+    http->body_next = ngx_js_fetch_body_next;
+
+    /*
+     * a request with the streamed body cannot be repeated
+     * over another connection if a cached one turns out to be closed
+     */
+
+    http->keepalive = 0;
+
+    return NJS_OK;
+}
+
+
+static njs_int_t
+ngx_js_fetch_body_bind(njs_vm_t *vm, ngx_js_fetch_t *fetch,
+    njs_function_native_t native, njs_opaque_value_t *retval)
+{
+    njs_value_t         *bind;
+    njs_function_t      *function;
+    njs_opaque_value_t   value, id, lvalue;
+
+    static const njs_str_t bind_key = njs_str("bind");
+
+    /*
+     * the iterator callbacks are bound to the fetch event id
+     * which is looked up when they are called, as the fetch
+     * may be already completed by that time
+     */
+
+    function = njs_vm_function_alloc(vm, native, 0, 0);
+    if (function == NULL) {
+        return NJS_ERROR;
+    }
+
+    njs_value_function_set(njs_value_arg(&value), function);
+    njs_value_number_set(njs_value_arg(&id), fetch->event->fd);
+
+    bind = njs_vm_object_prop(vm, njs_value_arg(&value), &bind_key, &lvalue);
+    if (bind == NULL || !njs_value_is_function(bind)) {
+        njs_vm_error(vm, "internal error");
+        return NJS_ERROR;
+    }
+
+    return njs_vm_invoke_method(vm, njs_value_function(bind),
+                                njs_value_arg(&value), njs_value_arg(&id), 1,
+                                njs_value_arg(retval));
+}
+
+
+static void
+ngx_js_fetch_body_next(ngx_js_http_t *http)
+{
+    njs_vm_t        *vm;
+    ngx_int_t        rc;
+    ngx_js_fetch_t  *fetch;
+
+    fetch = (ngx_js_fetch_t *) http;
+    vm = fetch->vm;
+
+    rc = ngx_js_call(vm, fetch->body_pull, &fetch->body_args[0], 3);
+    if (rc != NGX_OK) {
+        ngx_js_fetch_error(http, "request body stream failed");
+        return;
+    }
+
+    ngx_external_event_finalize(vm)(njs_vm_external_ptr(vm), rc);
+}
+
+
+static njs_int_t
+ngx_js_fetch_body_pull(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
+    njs_index_t unused, njs_value_t *retval)
+{
+    njs_int_t            ret;
+    njs_value_t         *iterator, *next, *then;
+    njs_opaque_value_t   result, lvalue;
+
+    static const njs_str_t next_key = njs_str("next");
+    static const njs_str_t then_key = njs_str("then");
+
+    iterator = njs_argument(args, 1);
+
+    next = njs_vm_object_prop(vm, iterator, &next_key, &lvalue);
+    if (next == NULL || !njs_value_is_function(next)) {
+        njs_vm_type_error(vm, "request body is not an iterator");
+        return NJS_ERROR;
+    }
+
+    ret = njs_vm_invoke_method(vm, njs_value_function(next), iterator, NULL, 0,
+                               njs_value_arg(&result));
+    if (ret != NJS_OK) {
+        return NJS_ERROR;
+    }
+
+    if (njs_value_is_object(njs_value_arg(&result))) {
+        then = njs_vm_object_prop(vm, njs_value_arg(&result), &then_key,
+                                  &lvalue);
+
+        if (then != NULL && njs_value_is_function(then)) {
+            return njs_vm_invoke_method(vm, njs_value_function(then),
+                                        njs_value_arg(&result),
+                                        njs_argument(args, 2), 2, retval);
+        }
+    }
+
+    /* a synchronous iterator result */
+
+    return njs_vm_invoke(vm, njs_value_function(njs_argument(args, 2)),
+                         njs_value_arg(&result), 1, retval);
+}
+
+
+static njs_int_t
+ngx_js_fetch_body_chunk(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
+    njs_index_t unused, njs_value_t *retval)
+{
+    ngx_str_t            data;
+    njs_value_t         *result, *value;
+    ngx_js_http_t       *http;
+    njs_opaque_value_t   lvalue;
+
+    static const njs_str_t done_key = njs_str("done");
+    static const njs_str_t value_key = njs_str("value");
+
+    njs_value_undefined_set(retval);
+
+    http = ngx_js_fetch_body_http(vm, njs_argument(args, 0));
+    if (http == NULL) {
+        return NJS_OK;
+    }
+
+    result = njs_arg(args, nargs, 1);
+
+    if (!njs_value_is_object(result)) {
+        ngx_js_http_body_error(http, "invalid request body chunk");
+        return NJS_OK;
+    }
+
+    value = njs_vm_object_prop(vm, result, &done_key, &lvalue);
+
+    if (value != NULL && njs_value_bool(value)) {
+        ngx_str_null(&data);
+        ngx_js_http_send_body(http, &data, 1);
+        return NJS_OK;
+    }
+
+    value = njs_vm_object_prop(vm, result, &value_key, &lvalue);
+
+    if (ngx_js_ngx_string(vm, value, &data) != NGX_OK) {
+        ngx_js_http_body_error(http, "invalid request body chunk");
+        return NJS_OK;
+    }
+
+    ngx_js_http_send_body(http, &data, 0);
+
+    return NJS_OK;
+}
+
+
+static njs_int_t
+ngx_js_fetch_body_rejected(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
+    njs_index_t unused, njs_value_t *retval)
+{
+    ngx_js_http_t  *http;
+
+    http = ngx_js_fetch_body_http(vm, njs_argument(args, 0));
+    if (http != NULL) {
+        ngx_js_http_body_error(http, "request body stream failed");
+    }
+
+    njs_value_undefined_set(retval);
+
+    return NJS_OK;
+}
+
+
+static ngx_js_http_t *
+ngx_js_fetch_body_http(njs_vm_t *vm, njs_value_t *id)
+{
+    ngx_js_ctx_t       *ctx;
+    ngx_js_fetch_t     *fetch;
+    ngx_js_event_t      event_lookup, *event;
+    njs_rbtree_node_t  *rb;
+
+    if (!njs_value_is_number(id)) {
+        return NULL;
+    }
+
+    ctx = ngx_external_ctx(vm, njs_vm_external_ptr(vm));
+    event_lookup.fd = njs_value_number(id);
+
+    rb = njs_rbtree_find(&ctx->waiting_events, &event_lookup.node);
+    if (rb == NULL) {
+        return NULL;
+    }
+
+    event = (ngx_js_event_t *) ((u_char *) rb - offsetof(ngx_js_event_t, node));
+    fetch = event->data;
+
+    return &fetch->http;
+}
+
+
 static njs_int_t
 ngx_js_headers_append(njs_vm_t *vm, ngx_js_headers_t *headers,
     u_char *name, size_t len, u_char *value, size_t vlen)
@@ -2367,6 +2921,11 @@ ngx_response_js_ext_body(njs_vm_t *vm, njs_value_t *args,
         return NJS_ERROR;
     }
 
+    if (response->http != NULL && !response->http->done) {
+        njs_vm_error(vm, "body is being streamed");
+        return NJS_ERROR;
+    }
+
     response->body_used = 1;
 
     ret = njs_chb_join(&response->chain, &string);
@@ -2407,6 +2966,89 @@ ngx_response_js_ext_body(njs_vm_t *vm, njs_value_t *args,
 }
 
 
+static njs_int_t
+ngx_response_js_ext_read(njs_vm_t *vm, njs_value_t *args,
+     njs_uint_t nargs, njs_index_t unused, njs_value_t *retval)
+{
+    njs_int_t            ret;
+    njs_str_t            string;
+    ngx_js_http_t       *http;
+    ngx_js_fetch_t      *fetch;
+    ngx_js_response_t   *response;
+    njs_opaque_value_t   result;
+
+    response = njs_vm_external(vm, ngx_http_js_fetch_response_proto_id,
+                               njs_argument(args, 0));
+    if (response == NULL) {
+        njs_value_undefined_set(retval);
+        return NJS_DECLINED;
+    }
+
+    http = response->http;
+
+    if (http == NULL) {
+
+        /* the body is already received, it is returned as a single chunk */
+
+        njs_value_undefined_set(njs_value_arg(&result));
+
+        if (!response->body_used) {
+            response->body_used = 1;
+
+            ret = njs_chb_join(&response->chain, &string);
+            if (ret != NJS_OK) {
+                njs_vm_memory_error(vm);
+                return NJS_ERROR;
+            }
+
+            if (string.length != 0) {
+                ret = njs_vm_value_array_buffer_set(vm, njs_value_arg(&result),
+                                                    string.start,
+                                                    string.length);
+                if (ret != NJS_OK) {
+                    njs_vm_memory_error(vm);
+                    return NJS_ERROR;
+                }
+            }
+        }
+
+        return ngx_js_fetch_promissified_result(vm, njs_value_arg(&result),
+                                                NJS_OK, retval);
+    }
+
+    fetch = (ngx_js_fetch_t *) http;
+
+    if (fetch->reading) {
+        njs_vm_error(vm, "body read is already pending");
+        return NJS_ERROR;
+    }
+
+    response->body_used = 1;
+
+    if (fetch->failed) {
+        njs_vm_throw(vm, njs_value_arg(&fetch->error_value));
+        return ngx_js_fetch_promissified_result(vm, njs_value_arg(&result),
+                                                NJS_ERROR, retval);
+    }
+
+    if (http->response.chain.nodes != NULL || fetch->finished) {
+        ret = ngx_js_fetch_read_result(vm, http, njs_value_arg(&result));
+        return ngx_js_fetch_promissified_result(vm, njs_value_arg(&result),
+                                                ret, retval);
+    }
+
+    ret = njs_vm_promise_create(vm, retval,
+                                njs_value_arg(&fetch->read_callbacks));
+    if (ret != NJS_OK) {
+        return NJS_ERROR;
+    }
+
+    fetch->reading = 1;
+
+    return NJS_OK;
+}
+
+
 static njs_int_t
 ngx_response_js_ext_body_used(njs_vm_t *vm, njs_object_prop_t *prop,
     uint32_t unused, njs_value_t *value, njs_value_t *setval,
@@ -13,17 +13,157 @@
 #include <ngx_event_connect.h>
 #include "ngx_js.h"
 #include "ngx_js_http.h"
+#include "ngx_js_shared_dict.h"
+
+#if (NGX_HTTP)
+#include <ngx_http.h>
+#endif
+
+#ifdef NJS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+
+typedef struct {
+    ngx_queue_t                    queue;
+    ngx_connection_t              *connection;
+    socklen_t                      socklen;
+    ngx_sockaddr_t                 sockaddr;
+#if (NGX_SSL)
+    ngx_ssl_t                     *ssl;
+    njs_bool_t                     ssl_verify;
+    ngx_str_t                      tls_name;
+#endif
+} ngx_js_http_cache_t;
+
+
+#if (NGX_SSL)
+
+#define NGX_JS_HTTP_SSL_SESSIONS  256
+
+
+typedef struct {
+    ngx_queue_t                    queue;
+    ngx_ssl_t                     *ssl;
+    ngx_ssl_session_t             *session;
+    socklen_t                      socklen;
+    ngx_sockaddr_t                 sockaddr;
+    ngx_str_t                      name;
+} ngx_js_http_ssl_session_t;
+
+#endif
+
+
+#define NGX_JS_HTTP_DNS_VALID  30
+
+
+typedef struct {
+    ngx_queue_t                    queue;
+    ngx_resolver_t                *resolver;
+    ngx_str_t                      name;
+    time_t                         valid;
+    ngx_int_t                      state;
+    ngx_uint_t                     next;
+    ngx_uint_t                     naddrs;
+    ngx_resolver_addr_t           *addrs;
+    ngx_resolver_ctx_t            *updating;
+} ngx_js_http_dns_t;
+
+
+/*
+ * Cached response: the header followed by the status text,
+ * the response headers as pairs of name and value, each prefixed
+ * with its length (uint32_t), and the response body.
+ */
+
+typedef struct {
+    time_t                         valid;
+    uint32_t                       code;
+    uint32_t                       status_len;
+    uint32_t                       headers_len;
+    uint32_t                       body_len;
+} ngx_js_http_cache_header_t;
+
+
+typedef struct {
+    time_t                         valid;
+    ngx_uint_t                     code;
+    ngx_str_t                      status;
+    ngx_str_t                      headers;
+    ngx_str_t                      body;
+} ngx_js_http_cached_t;
+
+
+typedef struct {
+    time_t                         max_age;
+    time_t                         expires;
+    time_t                         date;
+    ngx_str_t                      etag;
+    ngx_str_t                      last_modified;
+    unsigned                       no_store:1;
+    unsigned                       no_cache:1;
+    unsigned                       vary:1;
+} ngx_js_http_cache_info_t;
 
 
 static void ngx_js_http_resolve_handler(ngx_resolver_ctx_t *ctx);
-static void ngx_js_http_next(ngx_js_http_t *http);
+static ngx_int_t ngx_js_http_set_addrs(ngx_js_http_t *http,
+    ngx_resolver_addr_t *addrs, ngx_uint_t naddrs, ngx_uint_t start);
+static ngx_int_t ngx_js_http_dns_cached(ngx_js_http_t *http, ngx_str_t *host,
+    ngx_msec_t timeout);
+static ngx_js_http_dns_t *ngx_js_http_dns_lookup(ngx_resolver_t *r,
+    ngx_str_t *name);
+static void ngx_js_http_dns_store(ngx_js_http_t *http,
+    ngx_resolver_ctx_t *ctx);
+static ngx_int_t ngx_js_http_dns_update(ngx_js_http_dns_t *dns,
+    ngx_resolver_ctx_t *ctx, time_t negative);
+static void ngx_js_http_dns_refresh(ngx_js_http_dns_t *dns,
+    ngx_msec_t timeout);
+static void ngx_js_http_dns_refresh_handler(ngx_resolver_ctx_t *ctx);
+static void ngx_js_http_dns_free(ngx_js_http_dns_t *dns);
+static ngx_int_t ngx_js_http_upstream_get(ngx_js_http_t *http);
+static void ngx_js_http_upstream_free(ngx_js_http_t *http, ngx_uint_t state);
+static ngx_connection_t *ngx_js_http_keepalive_get(ngx_js_http_t *http,
+    ngx_addr_t *addr);
+static void ngx_js_http_keepalive_put(ngx_js_http_t *http);
+static void ngx_js_http_keepalive_close_handler(ngx_event_t *ev);
+static void ngx_js_http_keepalive_close(ngx_connection_t *c);
 static void ngx_js_http_write_handler(ngx_event_t *wev);
+static ngx_int_t ngx_js_http_output(ngx_js_http_t *http);
+static ngx_chain_t *ngx_js_http_chain_link(ngx_js_http_t *http, u_char *data,
+    size_t len);
 static void ngx_js_http_read_handler(ngx_event_t *rev);
 static void ngx_js_http_dummy_handler(ngx_event_t *ev);
 
 static ngx_int_t ngx_js_http_process_status_line(ngx_js_http_t *http);
 static ngx_int_t ngx_js_http_process_headers(ngx_js_http_t *http);
 static ngx_int_t ngx_js_http_process_body(ngx_js_http_t *http);
+static ngx_int_t ngx_js_http_process_done(ngx_js_http_t *http);
+static ssize_t ngx_js_http_body_size(ngx_js_http_t *http);
+#ifdef NJS_HAVE_ZLIB
+static ngx_int_t ngx_js_http_inflate(ngx_js_http_t *http, u_char *data,
+    size_t len);
+static void ngx_js_http_inflate_cleanup(void *data);
+#endif
+static void ngx_js_http_stream(ngx_js_http_t *http);
+static ngx_int_t ngx_js_http_cache_parse(ngx_str_t *entry,
+    ngx_js_http_cached_t *cached);
+static u_char *ngx_js_http_cache_next(u_char *p, u_char *end, ngx_str_t *name,
+    ngx_str_t *value);
+static void ngx_js_http_cache_info(ngx_js_headers_t *headers,
+    ngx_js_http_cache_info_t *ci);
+static void ngx_js_http_cache_entry_info(ngx_js_http_cached_t *cached,
+    ngx_js_http_cache_info_t *ci);
+static void ngx_js_http_cache_header(ngx_js_http_cache_info_t *ci,
+    ngx_str_t *name, ngx_str_t *value);
+static time_t ngx_js_http_cache_lifetime(ngx_js_http_cache_info_t *ci);
+static ngx_int_t ngx_js_http_cache_response(ngx_js_http_t *http,
+    ngx_js_http_cached_t *cached);
+static ngx_int_t ngx_js_http_cache_store(ngx_js_http_t *http);
+static ngx_int_t ngx_js_http_cache_revalidated(ngx_js_http_t *http);
+static ngx_int_t ngx_js_http_cache_save(ngx_js_http_t *http, time_t lifetime);
+static ngx_int_t ngx_js_http_cache_skip(ngx_js_http_t *http,
+    ngx_js_tb_elt_t *h);
 static ngx_int_t ngx_js_http_parse_status_line(ngx_js_http_parse_t *hp,
     ngx_buf_t *b);
 static ngx_int_t ngx_js_http_parse_header_line(ngx_js_http_parse_t *hp,
@@ -33,13 +173,30 @@ static ngx_int_t ngx_js_http_parse_chunked(ngx_js_http_chunk_parse_t *hcp,
 
 #if (NGX_SSL)
 static void ngx_js_http_ssl_init_connection(ngx_js_http_t *http);
+static ngx_js_http_ssl_session_t *ngx_js_http_ssl_session_lookup(
+    ngx_js_http_t *http);
+static void ngx_js_http_ssl_save_session(ngx_connection_t *c);
 static void ngx_js_http_ssl_handshake_handler(ngx_connection_t *c);
 static void ngx_js_http_ssl_handshake(ngx_js_http_t *http);
 static ngx_int_t ngx_js_http_ssl_name(ngx_js_http_t *http);
 #endif
 
 
-static void
+static ngx_queue_t  ngx_js_http_cache;
+static ngx_uint_t   ngx_js_http_ncached;
+
+static ngx_queue_t  ngx_js_http_dns_cache;
+static ngx_uint_t   ngx_js_http_ndns;
+
+#if (NGX_SSL)
+static ngx_queue_t  ngx_js_http_ssl_sessions;
+static ngx_uint_t   ngx_js_http_nsessions;
+#endif
+
+ngx_uint_t          ngx_js_http_ssl_reused;
+
+
+void
 ngx_js_http_error(ngx_js_http_t *http, const char *fmt, ...)
 {
     u_char   *p, *end;
@@ -57,24 +214,33 @@ ngx_js_http_error(ngx_js_http_t *http, const char *fmt, ...)
 }
 
 
-ngx_resolver_ctx_t *
+ngx_int_t
 ngx_js_http_resolve(ngx_js_http_t *http, ngx_resolver_t *r, ngx_str_t *host,
     in_port_t port, ngx_msec_t timeout)
 {
     ngx_int_t            ret;
     ngx_resolver_ctx_t  *ctx;
 
+    http->port = port;
+    http->resolver = r;
+
+    if (http->resolver_cache) {
+        ret = ngx_js_http_dns_cached(http, host, timeout);
+        if (ret != NGX_DECLINED) {
+            return ret;
+        }
+    }
+
     ctx = ngx_resolve_start(r, NULL);
     if (ctx == NULL) {
-        return NULL;
+        return NGX_ERROR;
     }
 
     if (ctx == NGX_NO_RESOLVER) {
-        return ctx;
+        return NGX_DECLINED;
     }
 
     http->ctx = ctx;
-    http->port = port;
 
     ctx->name = *host;
     ctx->handler = ngx_js_http_resolve_handler;
@@ -84,25 +250,24 @@ ngx_js_http_resolve(ngx_js_http_t *http, ngx_resolver_t *r, ngx_str_t *host,
     ret = ngx_resolve_name(ctx);
     if (ret != NGX_OK) {
         http->ctx = NULL;
-        return NULL;
+        return NGX_ERROR;
     }
 
-    return ctx;
+    return NGX_OK;
 }
 
 
 static void
 ngx_js_http_resolve_handler(ngx_resolver_ctx_t *ctx)
 {
-    u_char           *p;
-    size_t            len;
-    socklen_t         socklen;
-    ngx_uint_t        i;
-    ngx_js_http_t    *http;
-    struct sockaddr  *sockaddr;
+    ngx_js_http_t  *http;
 
     http = ctx->data;
 
+    if (http->resolver_cache) {
+        ngx_js_http_dns_store(http, ctx);
+    }
+
     if (ctx->state) {
         ngx_js_http_error(http, "\"%V\" could not be resolved (%i: %s)",
                           &ctx->name, ctx->state,
@@ -131,22 +296,44 @@ ngx_js_http_resolve_handler(ngx_resolver_ctx_t *ctx)
     }
 #endif
 
-    http->naddrs = ctx->naddrs;
-    http->addrs = ngx_pcalloc(http->pool, http->naddrs * sizeof(ngx_addr_t));
+    if (ngx_js_http_set_addrs(http, ctx->addrs, ctx->naddrs, 0) != NGX_OK) {
+        ngx_js_http_error(http, "memory error");
+        return;
+    }
+
+    ngx_js_http_resolve_done(http);
+
+    ngx_js_http_connect(http);
+}
+
+
+static ngx_int_t
+ngx_js_http_set_addrs(ngx_js_http_t *http, ngx_resolver_addr_t *addrs,
+    ngx_uint_t naddrs, ngx_uint_t start)
+{
+    u_char           *p;
+    size_t            len;
+    socklen_t         socklen;
+    ngx_uint_t        i, n;
+    struct sockaddr  *sockaddr;
+
+    http->naddrs = naddrs;
+    http->addrs = ngx_pcalloc(http->pool, naddrs * sizeof(ngx_addr_t));
 
     if (http->addrs == NULL) {
-        goto failed;
+        return NGX_ERROR;
     }
 
-    for (i = 0; i < ctx->naddrs; i++) {
-        socklen = ctx->addrs[i].socklen;
+    for (i = 0; i < naddrs; i++) {
+        n = (start + i) % naddrs;
+        socklen = addrs[n].socklen;
 
         sockaddr = ngx_palloc(http->pool, socklen);
         if (sockaddr == NULL) {
-            goto failed;
+            return NGX_ERROR;
         }
 
-        ngx_memcpy(sockaddr, ctx->addrs[i].sockaddr, socklen);
+        ngx_memcpy(sockaddr, addrs[n].sockaddr, socklen);
         ngx_inet_set_port(sockaddr, http->port);
 
         http->addrs[i].sockaddr = sockaddr;
@@ -154,7 +341,7 @@ ngx_js_http_resolve_handler(ngx_resolver_ctx_t *ctx)
 
         p = ngx_pnalloc(http->pool, NGX_SOCKADDR_STRLEN);
         if (p == NULL) {
-            goto failed;
+            return NGX_ERROR;
         }
 
         len = ngx_sock_ntop(sockaddr, socklen, p, NGX_SOCKADDR_STRLEN, 1);
@@ -162,698 +349,2764 @@ ngx_js_http_resolve_handler(ngx_resolver_ctx_t *ctx)
         http->addrs[i].name.data = p;
     }
 
-    ngx_js_http_resolve_done(http);
-
-    ngx_js_http_connect(http);
-
-    return;
-
-failed:
-
-    ngx_js_http_error(http, "memory error");
+    return NGX_OK;
 }
 
 
-static void
-ngx_js_http_close_connection(ngx_connection_t *c)
+static ngx_int_t
+ngx_js_http_dns_cached(ngx_js_http_t *http, ngx_str_t *host,
+    ngx_msec_t timeout)
 {
-    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, c->log, 0,
-                   "js http close connection: %d", c->fd);
+    time_t              now;
+    ngx_uint_t          start;
+    ngx_js_http_dns_t  *dns;
 
-#if (NGX_SSL)
-    if (c->ssl) {
-        c->ssl->no_wait_shutdown = 1;
+    dns = ngx_js_http_dns_lookup(http->resolver, host);
+    if (dns == NULL) {
+        return NGX_DECLINED;
+    }
 
-        if (ngx_ssl_shutdown(c) == NGX_AGAIN) {
-            c->ssl->handler = ngx_js_http_close_connection;
-            return;
+    now = ngx_time();
+
+    if (dns->valid < now) {
+        if (dns->naddrs == 0
+            || dns->valid + http->resolver_cache_stale < now)
+        {
+            return NGX_DECLINED;
+        }
+
+        if (dns->updating == NULL) {
+            ngx_js_http_dns_refresh(dns, timeout);
         }
     }
-#endif
 
-    c->destroyed = 1;
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http resolver cache hit: \"%V\" naddrs:%ui",
+                   host, dns->naddrs);
 
-    ngx_close_connection(c);
-}
+    if (dns->naddrs == 0) {
+        ngx_js_http_error(http, "\"%V\" could not be resolved (%i: %s)",
+                          host, dns->state,
+                          ngx_resolver_strerror(dns->state));
+        return NGX_OK;
+    }
 
+    start = dns->next++ % dns->naddrs;
 
-void
-ngx_js_http_resolve_done(ngx_js_http_t *http)
-{
-    if (http->ctx != NULL) {
-        ngx_resolve_name_done(http->ctx);
-        http->ctx = NULL;
+    if (ngx_js_http_set_addrs(http, dns->addrs, dns->naddrs, start)
+        != NGX_OK)
+    {
+        return NGX_ERROR;
     }
+
+    ngx_js_http_connect(http);
+
+    return NGX_OK;
 }
 
 
-void
-ngx_js_http_close_peer(ngx_js_http_t *http)
+static ngx_js_http_dns_t *
+ngx_js_http_dns_lookup(ngx_resolver_t *r, ngx_str_t *name)
 {
-    if (http->peer.connection != NULL) {
-        ngx_js_http_close_connection(http->peer.connection);
-        http->peer.connection = NULL;
+    ngx_queue_t        *q;
+    ngx_js_http_dns_t  *dns;
+
+    if (ngx_js_http_dns_cache.next == NULL) {
+        ngx_queue_init(&ngx_js_http_dns_cache);
+        return NULL;
     }
-}
 
+    for (q = ngx_queue_head(&ngx_js_http_dns_cache);
+         q != ngx_queue_sentinel(&ngx_js_http_dns_cache);
+         q = ngx_queue_next(q))
+    {
+        dns = ngx_queue_data(q, ngx_js_http_dns_t, queue);
 
-void
-ngx_js_http_connect(ngx_js_http_t *http)
-{
-    ngx_int_t    rc;
-    ngx_addr_t  *addr;
+        if (dns->resolver == r
+            && dns->name.len == name->len
+            && ngx_strncasecmp(dns->name.data, name->data, name->len) == 0)
+        {
+            ngx_queue_remove(q);
+            ngx_queue_insert_head(&ngx_js_http_dns_cache, q);
 
-    addr = &http->addrs[http->naddr];
+            return dns;
+        }
+    }
 
-    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                   "js http connect %ui/%ui", http->naddr, http->naddrs);
+    return NULL;
+}
 
-    http->peer.sockaddr = addr->sockaddr;
-    http->peer.socklen = addr->socklen;
-    http->peer.name = &addr->name;
-    http->peer.get = ngx_event_get_peer;
-    http->peer.log = http->log;
-    http->peer.log_error = NGX_ERROR_ERR;
 
-    rc = ngx_event_connect_peer(&http->peer);
+static void
+ngx_js_http_dns_store(ngx_js_http_t *http, ngx_resolver_ctx_t *ctx)
+{
+    ngx_queue_t        *q;
+    ngx_js_http_dns_t  *dns;
 
-    if (rc == NGX_ERROR) {
-        ngx_js_http_error(http, "connect failed");
-        return;
-    }
+    if (ctx->state) {
+        if (ctx->state != NGX_RESOLVE_NXDOMAIN
+            || http->resolver_cache_negative == 0)
+        {
+            return;
+        }
 
-    if (rc == NGX_BUSY || rc == NGX_DECLINED) {
-        ngx_js_http_next(http);
+    } else if (ctx->naddrs == 0) {
         return;
     }
 
-    http->peer.connection->data = http;
-    http->peer.connection->pool = http->pool;
+    dns = ngx_js_http_dns_lookup(http->resolver, &ctx->name);
 
-    http->peer.connection->write->handler = ngx_js_http_write_handler;
-    http->peer.connection->read->handler = ngx_js_http_read_handler;
+    if (dns == NULL) {
+        if (ngx_js_http_ndns >= http->resolver_cache) {
+            q = ngx_queue_last(&ngx_js_http_dns_cache);
+            ngx_queue_remove(q);
+            ngx_js_http_ndns--;
 
-    http->process = ngx_js_http_process_status_line;
+            ngx_js_http_dns_free(ngx_queue_data(q, ngx_js_http_dns_t, queue));
+        }
 
-    ngx_add_timer(http->peer.connection->read, http->timeout);
-    ngx_add_timer(http->peer.connection->write, http->timeout);
+        dns = ngx_alloc(sizeof(ngx_js_http_dns_t) + ctx->name.len,
+                        ngx_cycle->log);
+        if (dns == NULL) {
+            return;
+        }
 
-#if (NGX_SSL)
-    if (http->ssl != NULL && http->peer.connection->ssl == NULL) {
-        ngx_js_http_ssl_init_connection(http);
-        return;
-    }
-#endif
+        ngx_memzero(dns, sizeof(ngx_js_http_dns_t));
 
-    if (rc == NGX_OK) {
-        ngx_js_http_write_handler(http->peer.connection->write);
+        dns->resolver = http->resolver;
+        dns->name.len = ctx->name.len;
+        dns->name.data = (u_char *) dns + sizeof(ngx_js_http_dns_t);
+        ngx_memcpy(dns->name.data, ctx->name.data, ctx->name.len);
+
+        ngx_queue_insert_head(&ngx_js_http_dns_cache, &dns->queue);
+        ngx_js_http_ndns++;
     }
-}
 
+    (void) ngx_js_http_dns_update(dns, ctx, http->resolver_cache_negative);
+}
 
-#if (NGX_SSL)
 
-static void
-ngx_js_http_ssl_init_connection(ngx_js_http_t *http)
+static ngx_int_t
+ngx_js_http_dns_update(ngx_js_http_dns_t *dns, ngx_resolver_ctx_t *ctx,
+    time_t negative)
 {
-    ngx_int_t          rc;
-    ngx_connection_t  *c;
+    u_char               *p;
+    ngx_uint_t            i, naddrs;
+    ngx_resolver_addr_t  *addrs;
 
-    c = http->peer.connection;
+    addrs = NULL;
+    naddrs = (ctx->state == 0) ? ctx->naddrs : 0;
 
-    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                   "js http secure connect %ui/%ui", http->naddr,
-                   http->naddrs);
+    if (naddrs != 0) {
+        p = ngx_alloc(naddrs * (sizeof(ngx_resolver_addr_t)
+                                + sizeof(ngx_sockaddr_t)),
+                      ngx_cycle->log);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
 
-    if (ngx_ssl_create_connection(http->ssl, c, NGX_SSL_BUFFER|NGX_SSL_CLIENT)
-        != NGX_OK)
-    {
-        ngx_js_http_error(http, "failed to create ssl connection");
-        return;
-    }
+        addrs = (ngx_resolver_addr_t *) p;
+        p += naddrs * sizeof(ngx_resolver_addr_t);
 
-    c->sendfile = 0;
+        for (i = 0; i < naddrs; i++) {
+            ngx_memzero(&addrs[i], sizeof(ngx_resolver_addr_t));
 
-    if (ngx_js_http_ssl_name(http) != NGX_OK) {
-        ngx_js_http_error(http, "failed to create ssl connection");
-        return;
+            addrs[i].sockaddr = (struct sockaddr *) p;
+            addrs[i].socklen = ctx->addrs[i].socklen;
+            ngx_memcpy(p, ctx->addrs[i].sockaddr, ctx->addrs[i].socklen);
+
+            p += sizeof(ngx_sockaddr_t);
+        }
     }
 
-    c->log->action = "SSL handshaking to http target";
+    if (dns->addrs != NULL) {
+        ngx_free(dns->addrs);
+    }
 
-    rc = ngx_ssl_handshake(c);
+    dns->addrs = addrs;
+    dns->naddrs = naddrs;
+    dns->state = ctx->state;
 
-    if (rc == NGX_AGAIN) {
-        c->data = http;
-        c->ssl->handler = ngx_js_http_ssl_handshake_handler;
-        return;
+    if (naddrs == 0) {
+        dns->valid = ngx_time() + negative;
+
+    } else {
+#if defined(nginx_version) && (nginx_version >= 1027003)
+        dns->valid = ctx->valid;
+#else
+        dns->valid = ngx_time() + (ctx->resolver->valid
+                                   ? ctx->resolver->valid
+                                   : NGX_JS_HTTP_DNS_VALID);
+#endif
     }
 
-    ngx_js_http_ssl_handshake(http);
+    return NGX_OK;
 }
 
 
 static void
-ngx_js_http_ssl_handshake_handler(ngx_connection_t *c)
+ngx_js_http_dns_refresh(ngx_js_http_dns_t *dns, ngx_msec_t timeout)
 {
-    ngx_js_http_t  *http;
+    ngx_resolver_ctx_t  *ctx;
 
-    http = c->data;
+    ctx = ngx_resolve_start(dns->resolver, NULL);
+    if (ctx == NULL || ctx == NGX_NO_RESOLVER) {
+        return;
+    }
 
-    http->peer.connection->write->handler = ngx_js_http_write_handler;
-    http->peer.connection->read->handler = ngx_js_http_read_handler;
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, ngx_cycle->log, 0,
+                   "js http resolver cache refresh: \"%V\"", &dns->name);
 
-    ngx_js_http_ssl_handshake(http);
+    ctx->name = dns->name;
+    ctx->handler = ngx_js_http_dns_refresh_handler;
+    ctx->data = dns;
+    ctx->timeout = timeout;
+
+    dns->updating = ctx;
+
+    if (ngx_resolve_name(ctx) != NGX_OK) {
+        dns->updating = NULL;
+    }
 }
 
 
 static void
-ngx_js_http_ssl_handshake(ngx_js_http_t *http)
+ngx_js_http_dns_refresh_handler(ngx_resolver_ctx_t *ctx)
 {
-    long               rc;
-    ngx_connection_t  *c;
+    ngx_js_http_dns_t  *dns;
 
-    c = http->peer.connection;
+    dns = ctx->data;
 
-    if (c->ssl->handshaked) {
-        if (http->ssl_verify) {
-            rc = SSL_get_verify_result(c->ssl->connection);
+    /* on failure, the stale addresses are kept until the stale period ends */
 
-            if (rc != X509_V_OK) {
-                ngx_log_error(NGX_LOG_ERR, c->log, 0,
-                              "js http SSL certificate verify error: (%l:%s)",
-                              rc, X509_verify_cert_error_string(rc));
-                goto failed;
-            }
+    if (ctx->state == 0 && ctx->naddrs != 0) {
+        (void) ngx_js_http_dns_update(dns, ctx, 0);
+    }
 
-            if (ngx_ssl_check_host(c, &http->tls_name) != NGX_OK) {
-                ngx_log_error(NGX_LOG_ERR, c->log, 0,
-                              "js http SSL certificate does not match \"%V\"",
-                              &http->tls_name);
-                goto failed;
-            }
-        }
+    dns->updating = NULL;
 
-        c->write->handler = ngx_js_http_write_handler;
-        c->read->handler = ngx_js_http_read_handler;
+    ngx_resolve_name_done(ctx);
+}
 
-        if (c->read->ready) {
-            ngx_post_event(c->read, &ngx_posted_events);
-        }
 
-        http->process = ngx_js_http_process_status_line;
-        ngx_js_http_write_handler(c->write);
-
-        return;
+static void
+ngx_js_http_dns_free(ngx_js_http_dns_t *dns)
+{
+    if (dns->updating != NULL) {
+        ngx_resolve_name_done(dns->updating);
     }
 
-failed:
+    if (dns->addrs != NULL) {
+        ngx_free(dns->addrs);
+    }
 
-    ngx_js_http_next(http);
+    ngx_free(dns);
 }
 
 
-static ngx_int_t
-ngx_js_http_ssl_name(ngx_js_http_t *http)
+ngx_int_t
+ngx_js_http_upstream(ngx_js_http_t *http, ngx_str_t *host)
 {
-#ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
-    u_char  *p;
+#if (NGX_HTTP)
+    ngx_uint_t                          i, n;
+    ngx_http_upstream_srv_conf_t      **uscfp;
+    ngx_http_upstream_rr_peers_t       *peers;
+    ngx_http_upstream_main_conf_t      *umcf;
+    ngx_http_upstream_rr_peer_data_t   *rrp;
+
+    umcf = ngx_http_cycle_get_module_main_conf(ngx_cycle,
+                                               ngx_http_upstream_module);
+    if (umcf == NULL) {
+        return NGX_DECLINED;
+    }
 
-    /* as per RFC 6066, literal IPv4 and IPv6 addresses are not permitted */
-    ngx_str_t  *name = &http->tls_name;
+    uscfp = umcf->upstreams.elts;
 
-    if (name->len == 0 || *name->data == '[') {
-        goto done;
+    for (i = 0; i < umcf->upstreams.nelts; i++) {
+        if ((uscfp[i]->flags & NGX_HTTP_UPSTREAM_CREATE)
+            && uscfp[i]->host.len == host->len
+            && ngx_strncasecmp(uscfp[i]->host.data, host->data, host->len)
+               == 0)
+        {
+            goto found;
+        }
     }
 
-    if (ngx_inet_addr(name->data, name->len) != INADDR_NONE) {
-        goto done;
-    }
+    return NGX_DECLINED;
+
+found:
 
     /*
-     * SSL_set_tlsext_host_name() needs a null-terminated string,
-     * hence we explicitly null-terminate name here
+     * the standard balancers keep the round-robin peers
+     * as the upstream peer data, the peers are selected
+     * with the round-robin method, which does not need a request
      */
 
-    p = ngx_pnalloc(http->pool, name->len + 1);
-    if (p == NULL) {
+    peers = uscfp[i]->peer.data;
+    if (peers == NULL) {
+        return NGX_DECLINED;
+    }
+
+    rrp = ngx_pcalloc(http->pool, sizeof(ngx_http_upstream_rr_peer_data_t));
+    if (rrp == NULL) {
         return NGX_ERROR;
     }
 
-    (void) ngx_cpystrn(p, name->data, name->len + 1);
+    rrp->peers = peers;
 
-    name->data = p;
+    ngx_http_upstream_rr_peers_rlock(peers);
 
-    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                   "js http SSL server name: \"%s\"", name->data);
+#if (NGX_HTTP_UPSTREAM_ZONE)
+#if defined(nginx_version) && (nginx_version >= 1027003)
+    rrp->config = peers->config ? *peers->config : 0;
+#endif
+#endif
 
-    if (SSL_set_tlsext_host_name(http->peer.connection->ssl->connection,
-                                 (char *) name->data)
-        == 0)
-    {
-        ngx_ssl_error(NGX_LOG_ERR, http->log, 0,
-                      "SSL_set_tlsext_host_name(\"%s\") failed", name->data);
-        return NGX_ERROR;
+    n = peers->number;
+
+    if (peers->next != NULL && peers->next->number > n) {
+        n = peers->next->number;
     }
 
-#endif
-done:
+    http->peer.tries = ngx_http_upstream_tries(peers);
+
+    ngx_http_upstream_rr_peers_unlock(peers);
+
+    if (n <= 8 * sizeof(uintptr_t)) {
+        rrp->tried = &rrp->data;
+
+    } else {
+        n = (n + (8 * sizeof(uintptr_t) - 1)) / (8 * sizeof(uintptr_t));
+
+        rrp->tried = ngx_pcalloc(http->pool, n * sizeof(uintptr_t));
+        if (rrp->tried == NULL) {
+            return NGX_ERROR;
+        }
+    }
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http upstream: \"%V\"", host);
+
+    http->upstream = rrp;
 
     return NGX_OK;
+#else
+    return NGX_DECLINED;
+#endif
 }
 
+
+static ngx_int_t
+ngx_js_http_upstream_get(ngx_js_http_t *http)
+{
+#if (NGX_HTTP)
+    ngx_int_t  rc;
+
+    rc = ngx_http_upstream_get_round_robin_peer(&http->peer, http->upstream);
+    if (rc != NGX_OK) {
+        return rc;
+    }
+
+    http->upstream_peer = 1;
+
+    http->addr.sockaddr = http->peer.sockaddr;
+    http->addr.socklen = http->peer.socklen;
+    http->addr.name = *http->peer.name;
+
+    return NGX_OK;
+#else
+    return NGX_ERROR;
 #endif
+}
 
 
 static void
-ngx_js_http_next(ngx_js_http_t *http)
+ngx_js_http_upstream_free(ngx_js_http_t *http, ngx_uint_t state)
 {
-    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0, "js http next addr");
-
-    if (++http->naddr >= http->naddrs) {
-        ngx_js_http_error(http, "connect failed");
+#if (NGX_HTTP)
+    if (!http->upstream_peer) {
         return;
     }
 
-    if (http->peer.connection != NULL) {
-        ngx_js_http_close_connection(http->peer.connection);
-        http->peer.connection = NULL;
+    http->upstream_peer = 0;
+
+    ngx_http_upstream_free_round_robin_peer(&http->peer, http->upstream,
+                                            state);
+#endif
+}
+
+
+static void
+ngx_js_http_close_connection(ngx_connection_t *c)
+{
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, c->log, 0,
+                   "js http close connection: %d", c->fd);
+
+#if (NGX_SSL)
+    if (c->ssl) {
+        c->ssl->no_wait_shutdown = 1;
+
+        if (ngx_ssl_shutdown(c) == NGX_AGAIN) {
+            c->ssl->handler = ngx_js_http_close_connection;
+            return;
+        }
     }
+#endif
 
-    http->buffer = NULL;
+    c->destroyed = 1;
 
-    ngx_js_http_connect(http);
+    ngx_close_connection(c);
 }
 
 
-static void
-ngx_js_http_write_handler(ngx_event_t *wev)
+void
+ngx_js_http_resolve_done(ngx_js_http_t *http)
 {
-    ssize_t            n, size;
-    ngx_buf_t         *b;
-    ngx_js_http_t     *http;
-    ngx_connection_t  *c;
+    if (http->ctx != NULL) {
+        ngx_resolve_name_done(http->ctx);
+        http->ctx = NULL;
+    }
+}
 
-    c = wev->data;
-    http = c->data;
 
-    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, wev->log, 0, "js http write handler");
+void
+ngx_js_http_close_peer(ngx_js_http_t *http)
+{
+    ngx_js_http_upstream_free(http, 0);
 
-    if (wev->timedout) {
-        ngx_js_http_error(http, "write timed out");
+#if (NGX_HTTP_V2)
+    if (http->v2 != NULL) {
+        ngx_js_http_v2_close(http);
+    }
+#endif
+
+    if (http->peer.connection == NULL) {
         return;
     }
 
-#if (NGX_SSL)
-    if (http->ssl != NULL && http->peer.connection->ssl == NULL) {
-        ngx_js_http_ssl_init_connection(http);
+    if (!http->keepalive) {
+        ngx_js_http_close_connection(http->peer.connection);
+        http->peer.connection = NULL;
         return;
     }
-#endif
 
-    b = http->buffer;
+    if (http->keepalive_ready) {
+        ngx_js_http_keepalive_put(http);
+        return;
+    }
 
-    if (b == NULL) {
-        size = njs_chb_size(&http->chain);
-        if (size < 0) {
-            ngx_js_http_error(http, "memory error");
-            return;
+    ngx_js_http_keepalive_close(http->peer.connection);
+    http->peer.connection = NULL;
+}
+
+
+static ngx_connection_t *
+ngx_js_http_keepalive_get(ngx_js_http_t *http, ngx_addr_t *addr)
+{
+    ngx_queue_t          *q;
+    ngx_connection_t     *c;
+    ngx_js_http_cache_t  *item;
+
+    if (ngx_js_http_cache.next == NULL) {
+        return NULL;
+    }
+
+    for (q = ngx_queue_head(&ngx_js_http_cache);
+         q != ngx_queue_sentinel(&ngx_js_http_cache);
+         q = ngx_queue_next(q))
+    {
+        item = ngx_queue_data(q, ngx_js_http_cache_t, queue);
+
+        if (ngx_cmp_sockaddr(&item->sockaddr.sockaddr, item->socklen,
+                             addr->sockaddr, addr->socklen, 1)
+            != NGX_OK)
+        {
+            continue;
         }
 
-        b = ngx_create_temp_buf(http->pool, size);
-        if (b == NULL) {
-            ngx_js_http_error(http, "memory error");
-            return;
+#if (NGX_SSL)
+        if (item->ssl != http->ssl) {
+            continue;
         }
 
-        njs_chb_join_to(&http->chain, b->last);
-        b->last += size;
+        if (http->ssl != NULL
+            && (item->ssl_verify != http->ssl_verify
+                || item->tls_name.len != http->tls_name.len
+                || ngx_strncasecmp(item->tls_name.data, http->tls_name.data,
+                                   http->tls_name.len)
+                   != 0))
+        {
+            continue;
+        }
+#endif
 
-        http->buffer = b;
+        goto found;
     }
 
-    size = b->last - b->pos;
+    return NULL;
 
-    n = c->send(c, b->pos, size);
+found:
 
-    if (n == NGX_ERROR) {
-        ngx_js_http_next(http);
-        return;
+    ngx_queue_remove(q);
+    ngx_js_http_ncached--;
+
+    c = item->connection;
+
+    ngx_free(item);
+
+    if (c->read->timer_set) {
+        ngx_del_timer(c->read);
     }
 
-    if (n > 0) {
-        b->pos += n;
+    c->idle = 0;
+    c->log = http->log;
+    c->read->log = http->log;
+    c->write->log = http->log;
+    c->pool->log = http->log;
 
-        if (n == size) {
-            wev->handler = ngx_js_http_dummy_handler;
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http get keepalive connection: %d", c->fd);
 
-            http->buffer = NULL;
+    return c;
+}
 
-            if (wev->timer_set) {
-                ngx_del_timer(wev);
-            }
 
-            if (ngx_handle_write_event(wev, 0) != NGX_OK) {
-                ngx_js_http_error(http, "write failed");
-            }
+static void
+ngx_js_http_keepalive_put(ngx_js_http_t *http)
+{
+    size_t                len;
+    ngx_queue_t          *q;
+    ngx_connection_t     *c;
+    ngx_js_http_cache_t  *item;
 
-            return;
-        }
+    c = http->peer.connection;
+    http->peer.connection = NULL;
+
+    if (c->requests >= http->keepalive_requests
+        || c->read->eof
+        || c->read->error
+        || c->read->timedout
+        || c->write->error
+        || c->write->timedout
+        || ngx_terminate
+        || ngx_exiting)
+    {
+        goto close;
+    }
+
+    if (c->read->timer_set) {
+        ngx_del_timer(c->read);
+    }
+
+    if (c->write->timer_set) {
+        ngx_del_timer(c->write);
+    }
+
+    if (ngx_handle_read_event(c->read, 0) != NGX_OK) {
+        goto close;
+    }
+
+    if (ngx_js_http_cache.next == NULL) {
+        ngx_queue_init(&ngx_js_http_cache);
+    }
+
+    if (ngx_js_http_ncached >= http->keepalive) {
+        q = ngx_queue_last(&ngx_js_http_cache);
+        ngx_queue_remove(q);
+        ngx_js_http_ncached--;
+
+        item = ngx_queue_data(q, ngx_js_http_cache_t, queue);
+
+        ngx_js_http_keepalive_close(item->connection);
+        ngx_free(item);
+    }
+
+    len = sizeof(ngx_js_http_cache_t);
+
+#if (NGX_SSL)
+    len += http->tls_name.len;
+#endif
+
+    item = ngx_alloc(len, ngx_cycle->log);
+    if (item == NULL) {
+        goto close;
     }
 
-    if (!wev->timer_set) {
-        ngx_add_timer(wev, http->timeout);
+    item->connection = c;
+    item->socklen = http->peer.socklen;
+    ngx_memcpy(&item->sockaddr, http->peer.sockaddr, http->peer.socklen);
+
+#if (NGX_SSL)
+    item->ssl = http->ssl;
+    item->ssl_verify = http->ssl_verify;
+    item->tls_name.len = http->tls_name.len;
+    item->tls_name.data = (u_char *) item + sizeof(ngx_js_http_cache_t);
+    ngx_memcpy(item->tls_name.data, http->tls_name.data, http->tls_name.len);
+#endif
+
+    ngx_queue_insert_head(&ngx_js_http_cache, &item->queue);
+    ngx_js_http_ncached++;
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http put keepalive connection: %d", c->fd);
+
+    c->data = item;
+    c->idle = 1;
+    c->log = ngx_cycle->log;
+    c->read->log = ngx_cycle->log;
+    c->write->log = ngx_cycle->log;
+    c->pool->log = ngx_cycle->log;
+
+    c->read->handler = ngx_js_http_keepalive_close_handler;
+    c->write->handler = ngx_js_http_dummy_handler;
+
+    ngx_add_timer(c->read, http->keepalive_timeout);
+
+    if (c->read->ready) {
+        ngx_js_http_keepalive_close_handler(c->read);
     }
+
+    return;
+
+close:
+
+    ngx_js_http_keepalive_close(c);
 }
 
 
 static void
-ngx_js_http_read_handler(ngx_event_t *rev)
+ngx_js_http_keepalive_close_handler(ngx_event_t *ev)
 {
-    ssize_t            n, size;
-    ngx_int_t          rc;
-    ngx_buf_t         *b;
-    ngx_js_http_t     *http;
-    ngx_connection_t  *c;
+    int                   n;
+    char                  buf[1];
+    ngx_connection_t     *c;
+    ngx_js_http_cache_t  *item;
 
-    c = rev->data;
-    http = c->data;
+    c = ev->data;
 
-    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, rev->log, 0, "js http read handler");
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, ev->log, 0,
+                   "js http keepalive close handler");
 
-    if (rev->timedout) {
-        ngx_js_http_error(http, "read timed out");
-        return;
+    if (c->close || ev->timedout) {
+        goto close;
     }
 
-    if (http->buffer == NULL) {
-        b = ngx_create_temp_buf(http->pool, http->buffer_size);
-        if (b == NULL) {
-            ngx_js_http_error(http, "memory error");
-            return;
+    n = recv(c->fd, buf, 1, MSG_PEEK);
+
+    if (n == -1 && ngx_socket_errno == NGX_EAGAIN) {
+        ev->ready = 0;
+
+        if (ngx_handle_read_event(ev, 0) != NGX_OK) {
+            goto close;
         }
 
-        http->buffer = b;
+        return;
     }
 
-    for ( ;; ) {
-        b = http->buffer;
-        size = b->end - b->last;
+close:
 
-        n = c->recv(c, b->last, size);
+    item = c->data;
 
-        if (n > 0) {
-            b->last += n;
+    ngx_queue_remove(&item->queue);
+    ngx_js_http_ncached--;
 
-            rc = http->process(http);
+    ngx_free(item);
 
-            if (rc == NGX_ERROR) {
-                return;
-            }
+    ngx_js_http_keepalive_close(c);
+}
 
-            continue;
-        }
 
-        if (n == NGX_AGAIN) {
-            if (ngx_handle_read_event(rev, 0) != NGX_OK) {
-                ngx_js_http_error(http, "read failed");
-            }
+static void
+ngx_js_http_keepalive_close(ngx_connection_t *c)
+{
+    ngx_pool_t  *pool;
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, c->log, 0,
+                   "js http close keepalive connection: %d", c->fd);
 
+#if (NGX_SSL)
+    if (c->ssl) {
+        c->ssl->no_wait_shutdown = 1;
+
+        if (ngx_ssl_shutdown(c) == NGX_AGAIN) {
+            c->ssl->handler = ngx_js_http_keepalive_close;
             return;
         }
+    }
+#endif
 
-        if (n == NGX_ERROR) {
+    pool = c->pool;
+
+    c->destroyed = 1;
+
+    ngx_close_connection(c);
+
+    if (pool != NULL) {
+        ngx_destroy_pool(pool);
+    }
+}
+
+
+void
+ngx_js_http_connect(ngx_js_http_t *http)
+{
+    ngx_int_t          rc;
+    ngx_addr_t        *addr;
+    ngx_connection_t  *c;
+
+    if (http->upstream != NULL) {
+        if (ngx_js_http_upstream_get(http) != NGX_OK) {
+            ngx_js_http_error(http, "no live upstreams");
+            return;
+        }
+
+        addr = &http->addr;
+
+        ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http connect upstream peer \"%V\"", &addr->name);
+
+    } else {
+        addr = &http->addrs[http->naddr];
+
+        ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http connect %ui/%ui", http->naddr, http->naddrs);
+
+        http->peer.sockaddr = addr->sockaddr;
+        http->peer.socklen = addr->socklen;
+        http->peer.name = &addr->name;
+    }
+
+    http->peer.get = ngx_event_get_peer;
+    http->peer.log = http->log;
+    http->peer.log_error = NGX_ERROR_ERR;
+
+#if (NGX_HTTP_V2)
+
+    /* streamed requests and responses are made over HTTP/1.1 */
+
+    if (http->http2 && !http->stream && !http->body_stream) {
+        ngx_js_http_v2_connect(http);
+        return;
+    }
+#endif
+
+    http->keepalive_reused = 0;
+    http->request_sent = 0;
+
+    if (http->keepalive) {
+        c = ngx_js_http_keepalive_get(http, addr);
+
+        if (c != NULL) {
+            http->peer.connection = c;
+            http->keepalive_reused = 1;
+
+            rc = NGX_OK;
+            goto connected;
+        }
+    }
+
+    rc = ngx_event_connect_peer(&http->peer);
+
+    if (rc == NGX_ERROR) {
+        ngx_js_http_error(http, "connect failed");
+        return;
+    }
+
+    if (rc == NGX_BUSY || rc == NGX_DECLINED) {
+        ngx_js_http_next(http);
+        return;
+    }
+
+    if (http->keepalive) {
+        /*
+         * a connection which may outlive the request
+         * needs a pool of its own
+         */
+
+        http->peer.connection->pool = ngx_create_pool(128, http->log);
+        if (http->peer.connection->pool == NULL) {
+            ngx_js_http_error(http, "memory error");
+            return;
+        }
+
+    } else {
+        http->peer.connection->pool = http->pool;
+    }
+
+connected:
+
+    http->peer.connection->data = http;
+    http->peer.connection->requests++;
+
+    http->peer.connection->write->handler = ngx_js_http_write_handler;
+    http->peer.connection->read->handler = ngx_js_http_read_handler;
+
+    http->process = ngx_js_http_process_status_line;
+
+    ngx_add_timer(http->peer.connection->read, http->timeout);
+    ngx_add_timer(http->peer.connection->write, http->timeout);
+
+#if (NGX_SSL)
+    if (http->ssl != NULL && http->peer.connection->ssl == NULL) {
+        ngx_js_http_ssl_init_connection(http);
+        return;
+    }
+#endif
+
+    if (rc == NGX_OK) {
+        ngx_js_http_write_handler(http->peer.connection->write);
+    }
+}
+
+
+#if (NGX_SSL)
+
+static void
+ngx_js_http_ssl_init_connection(ngx_js_http_t *http)
+{
+    ngx_int_t                   rc;
+    ngx_connection_t           *c;
+    ngx_js_http_ssl_session_t  *s;
+
+    c = http->peer.connection;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http secure connect %ui/%ui", http->naddr,
+                   http->naddrs);
+
+    if (ngx_ssl_create_connection(http->ssl, c, NGX_SSL_BUFFER|NGX_SSL_CLIENT)
+        != NGX_OK)
+    {
+        ngx_js_http_error(http, "failed to create ssl connection");
+        return;
+    }
+
+    c->sendfile = 0;
+
+    if (ngx_js_http_ssl_name(http) != NGX_OK) {
+        ngx_js_http_error(http, "failed to create ssl connection");
+        return;
+    }
+
+    s = ngx_js_http_ssl_session_lookup(http);
+
+    if (s != NULL && ngx_ssl_set_session(c, s->session) != NGX_OK) {
+        ngx_js_http_error(http, "failed to set ssl session");
+        return;
+    }
+
+    c->ssl->save_session = ngx_js_http_ssl_save_session;
+
+    c->log->action = "SSL handshaking to http target";
+
+    rc = ngx_ssl_handshake(c);
+
+    if (rc == NGX_AGAIN) {
+        c->data = http;
+        c->ssl->handler = ngx_js_http_ssl_handshake_handler;
+        return;
+    }
+
+    ngx_js_http_ssl_handshake(http);
+}
+
+
+static void
+ngx_js_http_ssl_handshake_handler(ngx_connection_t *c)
+{
+    ngx_js_http_t  *http;
+
+    http = c->data;
+
+    http->peer.connection->write->handler = ngx_js_http_write_handler;
+    http->peer.connection->read->handler = ngx_js_http_read_handler;
+
+    ngx_js_http_ssl_handshake(http);
+}
+
+
+static void
+ngx_js_http_ssl_handshake(ngx_js_http_t *http)
+{
+    long               rc;
+    ngx_connection_t  *c;
+
+    c = http->peer.connection;
+
+    if (c->ssl->handshaked) {
+        if (SSL_session_reused(c->ssl->connection)) {
+            ngx_js_http_ssl_reused++;
+        }
+
+        if (http->ssl_verify) {
+            rc = SSL_get_verify_result(c->ssl->connection);
+
+            if (rc != X509_V_OK) {
+                ngx_log_error(NGX_LOG_ERR, c->log, 0,
+                              "js http SSL certificate verify error: (%l:%s)",
+                              rc, X509_verify_cert_error_string(rc));
+                goto failed;
+            }
+
+            if (ngx_ssl_check_host(c, &http->tls_name) != NGX_OK) {
+                ngx_log_error(NGX_LOG_ERR, c->log, 0,
+                              "js http SSL certificate does not match \"%V\"",
+                              &http->tls_name);
+                goto failed;
+            }
+        }
+
+        c->write->handler = ngx_js_http_write_handler;
+        c->read->handler = ngx_js_http_read_handler;
+
+        if (c->read->ready) {
+            ngx_post_event(c->read, &ngx_posted_events);
+        }
+
+        http->process = ngx_js_http_process_status_line;
+        ngx_js_http_write_handler(c->write);
+
+        return;
+    }
+
+failed:
+
+    ngx_js_http_next(http);
+}
+
+
+static ngx_js_http_ssl_session_t *
+ngx_js_http_ssl_session_lookup(ngx_js_http_t *http)
+{
+    ngx_queue_t                *q;
+    ngx_js_http_ssl_session_t  *s;
+
+    if (ngx_js_http_ssl_sessions.next == NULL) {
+        ngx_queue_init(&ngx_js_http_ssl_sessions);
+        return NULL;
+    }
+
+    for (q = ngx_queue_head(&ngx_js_http_ssl_sessions);
+         q != ngx_queue_sentinel(&ngx_js_http_ssl_sessions);
+         q = ngx_queue_next(q))
+    {
+        s = ngx_queue_data(q, ngx_js_http_ssl_session_t, queue);
+
+        if (s->ssl == http->ssl
+            && s->name.len == http->tls_name.len
+            && ngx_strncasecmp(s->name.data, http->tls_name.data,
+                               http->tls_name.len) == 0
+            && ngx_cmp_sockaddr(&s->sockaddr.sockaddr, s->socklen,
+                                http->peer.sockaddr, http->peer.socklen, 1)
+               == NGX_OK)
+        {
+            ngx_queue_remove(q);
+            ngx_queue_insert_head(&ngx_js_http_ssl_sessions, q);
+
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void
+ngx_js_http_ssl_save_session(ngx_connection_t *c)
+{
+    ngx_queue_t                *q;
+    ngx_js_http_t              *http;
+    ngx_ssl_session_t          *session;
+    ngx_js_http_ssl_session_t  *s;
+
+    http = c->data;
+
+    session = ngx_ssl_get_session(c);
+    if (session == NULL) {
+        return;
+    }
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, c->log, 0,
+                   "js http save ssl session: %p \"%V\"", session,
+                   &http->tls_name);
+
+    s = ngx_js_http_ssl_session_lookup(http);
+
+    if (s != NULL) {
+        ngx_ssl_free_session(s->session);
+        s->session = session;
+        return;
+    }
+
+    if (ngx_js_http_nsessions >= NGX_JS_HTTP_SSL_SESSIONS) {
+        q = ngx_queue_last(&ngx_js_http_ssl_sessions);
+        ngx_queue_remove(q);
+        ngx_js_http_nsessions--;
+
+        s = ngx_queue_data(q, ngx_js_http_ssl_session_t, queue);
+
+        ngx_ssl_free_session(s->session);
+        ngx_free(s);
+    }
+
+    s = ngx_alloc(sizeof(ngx_js_http_ssl_session_t) + http->tls_name.len,
+                  c->log);
+    if (s == NULL) {
+        ngx_ssl_free_session(session);
+        return;
+    }
+
+    s->ssl = http->ssl;
+    s->session = session;
+    s->socklen = http->peer.socklen;
+    ngx_memcpy(&s->sockaddr, http->peer.sockaddr, http->peer.socklen);
+
+    s->name.len = http->tls_name.len;
+    s->name.data = (u_char *) s + sizeof(ngx_js_http_ssl_session_t);
+    ngx_memcpy(s->name.data, http->tls_name.data, http->tls_name.len);
+
+    ngx_queue_insert_head(&ngx_js_http_ssl_sessions, &s->queue);
+    ngx_js_http_nsessions++;
+}
+
+
+static ngx_int_t
+ngx_js_http_ssl_name(ngx_js_http_t *http)
+{
+#ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
+    u_char  *p;
+
+    /* as per RFC 6066, literal IPv4 and IPv6 addresses are not permitted */
+    ngx_str_t  *name = &http->tls_name;
+
+    if (name->len == 0 || *name->data == '[') {
+        goto done;
+    }
+
+    if (ngx_inet_addr(name->data, name->len) != INADDR_NONE) {
+        goto done;
+    }
+
+    /*
+     * SSL_set_tlsext_host_name() needs a null-terminated string,
+     * hence we explicitly null-terminate name here
+     */
+
+    p = ngx_pnalloc(http->pool, name->len + 1);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    (void) ngx_cpystrn(p, name->data, name->len + 1);
+
+    name->data = p;
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http SSL server name: \"%s\"", name->data);
+
+    if (SSL_set_tlsext_host_name(http->peer.connection->ssl->connection,
+                                 (char *) name->data)
+        == 0)
+    {
+        ngx_ssl_error(NGX_LOG_ERR, http->log, 0,
+                      "SSL_set_tlsext_host_name(\"%s\") failed", name->data);
+        return NGX_ERROR;
+    }
+
+#endif
+done:
+
+    return NGX_OK;
+}
+
+#endif
+
+
+void
+ngx_js_http_next(ngx_js_http_t *http)
+{
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0, "js http next addr");
+
+    if (http->body_started) {
+
+        /* the consumed part of the body stream cannot be sent again */
+
+        ngx_js_http_error(http, "request body stream failed");
+        return;
+    }
+
+    if (http->keepalive_reused) {
+
+        /*
+         * the cached connection was closed by the peer before any
+         * response byte arrived, the request is repeated
+         * with the same address unless the peer might have
+         * processed a request which is not idempotent
+         */
+
+        if (http->request_sent && !http->idempotent) {
+            ngx_js_http_error(http, "prematurely closed connection");
+            return;
+        }
+
+        ngx_js_http_close_peer(http);
+        http->buffer = NULL;
+        http->out = NULL;
+
+        ngx_js_http_connect(http);
+        return;
+    }
+
+    if (http->upstream != NULL) {
+        ngx_js_http_upstream_free(http, NGX_PEER_FAILED);
+
+        if (http->peer.tries == 0) {
+            ngx_js_http_error(http, "connect failed");
+            return;
+        }
+
+    } else if (++http->naddr >= http->naddrs) {
+        ngx_js_http_error(http, "connect failed");
+        return;
+    }
+
+    ngx_js_http_close_peer(http);
+
+    http->buffer = NULL;
+    http->out = NULL;
+
+    ngx_js_http_connect(http);
+}
+
+
+static void
+ngx_js_http_write_handler(ngx_event_t *wev)
+{
+    ngx_chain_t       *cl;
+    ngx_js_http_t     *http;
+    ngx_connection_t  *c;
+
+    c = wev->data;
+    http = c->data;
+
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, wev->log, 0, "js http write handler");
+
+    if (wev->timedout) {
+        ngx_js_http_upstream_free(http, NGX_PEER_FAILED);
+        ngx_js_http_error(http, "write timed out");
+        return;
+    }
+
+#if (NGX_SSL)
+    if (http->ssl != NULL && http->peer.connection->ssl == NULL) {
+        ngx_js_http_ssl_init_connection(http);
+        return;
+    }
+#endif
+
+    if (http->body_error != NULL) {
+        ngx_js_http_error(http, http->body_error);
+        return;
+    }
+
+    if (http->out == NULL && !http->body_started) {
+        if (ngx_js_http_output(http) != NGX_OK) {
+            ngx_js_http_error(http, "memory error");
+            return;
+        }
+    }
+
+    if (http->out != NULL) {
+        cl = c->send_chain(c, http->out, 0);
+
+        if (cl == NGX_CHAIN_ERROR) {
+            ngx_js_http_next(http);
+            return;
+        }
+
+        http->out = cl;
+
+        if (cl != NULL) {
+            if (!wev->timer_set) {
+                ngx_add_timer(wev, http->timeout);
+            }
+
+            return;
+        }
+    }
+
+    http->request_sent = 1;
+
+    wev->handler = ngx_js_http_dummy_handler;
+
+    if (wev->timer_set) {
+        ngx_del_timer(wev);
+    }
+
+    if (ngx_handle_write_event(wev, 0) != NGX_OK) {
+        ngx_js_http_error(http, "write failed");
+        return;
+    }
+
+    if (http->body_stream && !http->body_last && !http->body_pending) {
+
+        /*
+         * the next chunk is requested as the last action
+         * as the body source may finalize the request
+         */
+
+        http->body_started = 1;
+        http->body_pending = 1;
+
+        http->body_next(http);
+    }
+}
+
+
+static ngx_int_t
+ngx_js_http_output(ngx_js_http_t *http)
+{
+    ssize_t       size;
+    ngx_buf_t    *b;
+    ngx_chain_t  *cl;
+
+    size = njs_chb_size(&http->chain);
+    if (size < 0) {
+        return NGX_ERROR;
+    }
+
+    b = ngx_create_temp_buf(http->pool, size);
+    if (b == NULL) {
+        return NGX_ERROR;
+    }
+
+    njs_chb_join_to(&http->chain, b->last);
+    b->last += size;
+
+    cl = ngx_alloc_chain_link(http->pool);
+    if (cl == NULL) {
+        return NGX_ERROR;
+    }
+
+    cl->buf = b;
+    cl->next = NULL;
+
+    if (http->body.len != 0) {
+
+        /* the request body is sent from the original memory */
+
+        cl->next = ngx_js_http_chain_link(http, http->body.data,
+                                          http->body.len);
+        if (cl->next == NULL) {
+            return NGX_ERROR;
+        }
+    }
+
+    http->out = cl;
+
+    return NGX_OK;
+}
+
+
+static ngx_chain_t *
+ngx_js_http_chain_link(ngx_js_http_t *http, u_char *data, size_t len)
+{
+    ngx_buf_t    *b;
+    ngx_chain_t  *cl;
+
+    b = ngx_calloc_buf(http->pool);
+    if (b == NULL) {
+        return NULL;
+    }
+
+    b->start = data;
+    b->pos = data;
+    b->last = data + len;
+    b->end = b->last;
+    b->memory = 1;
+
+    cl = ngx_alloc_chain_link(http->pool);
+    if (cl == NULL) {
+        return NULL;
+    }
+
+    cl->buf = b;
+    cl->next = NULL;
+
+    return cl;
+}
+
+
+void
+ngx_js_http_send_body(ngx_js_http_t *http, ngx_str_t *data, ngx_uint_t last)
+{
+    u_char            *p;
+    ngx_chain_t      **ll;
+    ngx_connection_t  *c;
+
+    c = http->peer.connection;
+
+    if (c == NULL || http->body_error != NULL) {
+        return;
+    }
+
+    http->body_pending = 0;
+
+    for (ll = &http->out; *ll != NULL; ll = &(*ll)->next) { /* void */ }
+
+    if (data->len != 0) {
+        p = ngx_pnalloc(http->pool, NGX_SIZE_T_LEN + sizeof(CRLF) - 1);
+        if (p == NULL) {
+            goto failed;
+        }
+
+        *ll = ngx_js_http_chain_link(http, p,
+                                     ngx_sprintf(p, "%xz" CRLF, data->len)
+                                     - p);
+        if (*ll == NULL) {
+            goto failed;
+        }
+
+        ll = &(*ll)->next;
+
+        *ll = ngx_js_http_chain_link(http, data->data, data->len);
+        if (*ll == NULL) {
+            goto failed;
+        }
+
+        ll = &(*ll)->next;
+
+        *ll = ngx_js_http_chain_link(http, (u_char *) CRLF, sizeof(CRLF) - 1);
+        if (*ll == NULL) {
+            goto failed;
+        }
+
+        ll = &(*ll)->next;
+    }
+
+    if (last) {
+        *ll = ngx_js_http_chain_link(http, (u_char *) "0" CRLF CRLF,
+                                     sizeof("0" CRLF CRLF) - 1);
+        if (*ll == NULL) {
+            goto failed;
+        }
+
+        http->body_last = 1;
+    }
+
+    ngx_add_timer(c->read, http->timeout);
+
+    c->write->handler = ngx_js_http_write_handler;
+    ngx_post_event(c->write, &ngx_posted_events);
+
+    return;
+
+failed:
+
+    ngx_js_http_body_error(http, "memory error");
+}
+
+
+void
+ngx_js_http_body_error(ngx_js_http_t *http, const char *err)
+{
+    ngx_connection_t  *c;
+
+    c = http->peer.connection;
+
+    if (c == NULL || http->body_error != NULL) {
+        return;
+    }
+
+    /* the error is reported from the write handler */
+
+    http->body_error = err;
+
+    c->write->handler = ngx_js_http_write_handler;
+    ngx_post_event(c->write, &ngx_posted_events);
+}
+
+
+static void
+ngx_js_http_read_handler(ngx_event_t *rev)
+{
+    ssize_t            n, size;
+    ngx_int_t          rc;
+    ngx_buf_t         *b;
+    ngx_js_http_t     *http;
+    ngx_connection_t  *c;
+
+    c = rev->data;
+    http = c->data;
+
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, rev->log, 0, "js http read handler");
+
+    if (rev->timedout) {
+        ngx_js_http_upstream_free(http, NGX_PEER_FAILED);
+        ngx_js_http_error(http, "read timed out");
+        return;
+    }
+
+    if (http->stream_paused) {
+
+        /* the body is not consumed yet */
+
+        if (!(ngx_event_flags & NGX_USE_CLEAR_EVENT) && rev->active) {
+            if (ngx_del_event(rev, NGX_READ_EVENT, 0) != NGX_OK) {
+                ngx_js_http_error(http, "read failed");
+            }
+        }
+
+        return;
+    }
+
+    if (http->buffer == NULL) {
+        b = ngx_create_temp_buf(http->pool, http->buffer_size);
+        if (b == NULL) {
+            ngx_js_http_error(http, "memory error");
+            return;
+        }
+
+        http->buffer = b;
+    }
+
+    for ( ;; ) {
+        b = http->buffer;
+        size = b->end - b->last;
+
+        n = c->recv(c, b->last, size);
+
+        if (n > 0) {
+            b->last += n;
+            http->keepalive_reused = 0;
+
+            rc = http->process(http);
+
+            if (rc == NGX_ERROR || rc == NGX_DONE) {
+                /* NGX_DONE: handler was called */
+                return;
+            }
+
+            if (http->stream && http->response.chain.nodes != NULL) {
+                ngx_js_http_stream(http);
+                return;
+            }
+
+            continue;
+        }
+
+        if (n == NGX_AGAIN) {
+            if (ngx_handle_read_event(rev, 0) != NGX_OK) {
+                ngx_js_http_error(http, "read failed");
+            }
+
+            return;
+        }
+
+        if (n == NGX_ERROR) {
             ngx_js_http_next(http);
             return;
         }
 
-        break;
+        break;
+    }
+
+    if (http->keepalive_reused) {
+        ngx_js_http_next(http);
+        return;
+    }
+
+    http->done = 1;
+
+    rc = http->process(http);
+
+    if (rc == NGX_DONE) {
+        /* handler was called */
+        return;
+    }
+
+    if (rc == NGX_AGAIN) {
+        ngx_js_http_error(http, "prematurely closed connection");
+    }
+}
+
+
+static void
+ngx_js_http_dummy_handler(ngx_event_t *ev)
+{
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, ev->log, 0, "js http dummy handler");
+}
+
+
+static ngx_int_t
+ngx_js_http_process_status_line(ngx_js_http_t *http)
+{
+    ngx_int_t             rc;
+    ngx_js_http_parse_t  *hp;
+
+    hp = &http->http_parse;
+
+    rc = ngx_js_http_parse_status_line(hp, http->buffer);
+
+    if (rc == NGX_OK) {
+        ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0, "js http status %ui",
+                       hp->code);
+
+        http->response.code = hp->code;
+        http->response.status_text.data = hp->status_text;
+        http->response.status_text.len = hp->status_text_end - hp->status_text;
+        http->process = ngx_js_http_process_headers;
+
+        return http->process(http);
+    }
+
+    if (rc == NGX_AGAIN) {
+        return NGX_AGAIN;
+    }
+
+    /* rc == NGX_ERROR */
+
+    ngx_js_http_error(http, "invalid http status line");
+
+    return NGX_ERROR;
+}
+
+
+static ngx_int_t
+ngx_js_http_process_headers(ngx_js_http_t *http)
+{
+    size_t                len, vlen;
+    ngx_int_t             rc;
+    ngx_js_http_parse_t  *hp;
+
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http process headers");
+
+    hp = &http->http_parse;
+
+    if (http->response.headers.header_list.size == 0) {
+        rc = ngx_list_init(&http->response.headers.header_list, http->pool, 4,
+                           sizeof(ngx_js_tb_elt_t));
+        if (rc != NGX_OK) {
+            ngx_js_http_error(http, "alloc failed");
+            return NGX_ERROR;
+        }
+    }
+
+    for ( ;; ) {
+        rc = ngx_js_http_parse_header_line(hp, http->buffer);
+
+        if (rc == NGX_OK) {
+            len = hp->header_name_end - hp->header_name_start;
+            vlen = hp->header_end - hp->header_start;
+
+            rc = http->append_headers(http, &http->response.headers,
+                                       hp->header_name_start, len,
+                                       hp->header_start, vlen);
+
+            if (rc == NGX_ERROR) {
+                ngx_js_http_error(http, "cannot add respose header");
+                return NGX_ERROR;
+            }
+
+            ngx_log_debug4(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                           "js http header \"%*s: %*s\"",
+                           len, hp->header_name_start, vlen, hp->header_start);
+
+            if (len == (sizeof("Transfer-Encoding") -1)
+                && vlen == (sizeof("chunked") - 1)
+                && ngx_strncasecmp(hp->header_name_start,
+                                   (u_char *) "Transfer-Encoding", len) == 0
+                && ngx_strncasecmp(hp->header_start, (u_char *) "chunked",
+                                   vlen) == 0)
+            {
+                hp->chunked = 1;
+            }
+
+            if (len == (sizeof("Connection") - 1)
+                && ngx_strncasecmp(hp->header_name_start,
+                                   (u_char *) "Connection", len) == 0
+                && ngx_strlcasestrn(hp->header_start, hp->header_end,
+                                    (u_char *) "close", 5 - 1)
+                   != NULL)
+            {
+                hp->connection_close = 1;
+            }
+
+            if (len == (sizeof("Content-Encoding") - 1)
+                && ngx_strncasecmp(hp->header_name_start,
+                                   (u_char *) "Content-Encoding", len) == 0
+                && ngx_js_http_content_encoding(http, hp->header_start, vlen)
+                   != NGX_OK)
+            {
+                ngx_js_http_error(http, "memory error");
+                return NGX_ERROR;
+            }
+
+            if (len == (sizeof("Content-Length") - 1)
+                && ngx_strncasecmp(hp->header_name_start,
+                                   (u_char *) "Content-Length", len) == 0)
+            {
+                hp->content_length_n = ngx_atoof(hp->header_start, vlen);
+                if (hp->content_length_n == NGX_ERROR) {
+                    ngx_js_http_error(http, "invalid http content length");
+                    return NGX_ERROR;
+                }
+
+                if (!http->header_only
+                    && !http->stream
+                    && hp->content_length_n
+                       > (off_t) http->max_response_body_size)
+                {
+                    ngx_js_http_error(http,
+                                      "http content length is too large");
+                    return NGX_ERROR;
+                }
+            }
+
+            continue;
+        }
+
+        if (rc == NGX_DONE) {
+            http->response.headers.guard = GUARD_IMMUTABLE;
+            break;
+        }
+
+        if (rc == NGX_AGAIN) {
+            return NGX_AGAIN;
+        }
+
+        /* rc == NGX_ERROR */
+
+        ngx_js_http_error(http, "invalid http header");
+
+        return NGX_ERROR;
+    }
+
+    njs_chb_destroy(&http->chain);
+
+    http->process = ngx_js_http_process_body;
+
+    if (http->stream) {
+        rc = http->process(http);
+
+        if (rc == NGX_AGAIN) {
+            ngx_js_http_stream(http);
+            return NGX_DONE;
+        }
+
+        return rc;
+    }
+
+    return http->process(http);
+}
+
+
+static ngx_int_t
+ngx_js_http_process_body(ngx_js_http_t *http)
+{
+    ssize_t          size, chsize, need;
+    ngx_int_t        rc;
+    ngx_buf_t       *b;
+#ifdef NJS_HAVE_ZLIB
+    njs_chb_node_t  *node;
+#endif
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http process body done:%ui", (ngx_uint_t) http->done);
+
+    if (http->done) {
+        size = ngx_js_http_body_size(http);
+        if (size < 0) {
+            ngx_js_http_error(http, "memory error");
+            return NGX_ERROR;
+        }
+
+        if (!http->header_only
+            && http->http_parse.chunked
+            && http->http_parse.content_length_n == -1)
+        {
+            ngx_js_http_error(http, "invalid http chunked response");
+            return NGX_ERROR;
+        }
+
+        if (http->header_only
+            || http->http_parse.content_length_n == -1
+            || size == http->http_parse.content_length_n)
+        {
+            ngx_js_http_ready(http);
+            return NGX_DONE;
+        }
+
+        if (size < http->http_parse.content_length_n) {
+            return NGX_AGAIN;
+        }
+
+        ngx_js_http_error(http, "http trailing data");
+        return NGX_ERROR;
+    }
+
+    b = http->buffer;
+
+    if (http->keepalive
+        && (http->header_only
+            || http->http_parse.code == 204
+            || http->http_parse.code == 304))
+    {
+        return ngx_js_http_process_done(http);
+    }
+
+    if (http->http_parse.chunked) {
+        rc = ngx_js_http_parse_chunked(&http->http_chunk_parse, b,
+                                       (http->zstream != NULL)
+                                       ? &http->encoded
+                                       : &http->response.chain);
+        if (rc == NGX_ERROR) {
+            ngx_js_http_error(http, "invalid http chunked response");
+            return NGX_ERROR;
+        }
+
+#ifdef NJS_HAVE_ZLIB
+        if (http->zstream != NULL) {
+            for (node = http->encoded.nodes; node != NULL; node = node->next) {
+                if (ngx_js_http_inflate(http, node->start,
+                                        njs_chb_node_size(node))
+                    != NGX_OK)
+                {
+                    return NGX_ERROR;
+                }
+            }
+
+            njs_chb_drain(&http->encoded, njs_chb_size(&http->encoded));
+        }
+#endif
+
+        size = ngx_js_http_body_size(http);
+
+        if (rc == NGX_OK) {
+            http->http_parse.content_length_n = size;
+        }
+
+        if (!http->stream && size > http->max_response_body_size * 10) {
+            ngx_js_http_error(http, "very large http chunked response");
+            return NGX_ERROR;
+        }
+
+        b->pos = http->http_chunk_parse.pos;
+
+        if (rc == NGX_OK && http->keepalive) {
+            return ngx_js_http_process_done(http);
+        }
+
+    } else {
+        size = ngx_js_http_body_size(http);
+
+        if (http->header_only) {
+            need = 0;
+
+        } else if (http->http_parse.content_length_n != -1) {
+            need = http->http_parse.content_length_n - size;
+
+        } else if (http->stream) {
+            need = b->last - b->pos;
+
+        } else {
+            need = http->max_response_body_size - size;
+        }
+
+        chsize = ngx_min(need, b->last - b->pos);
+
+        if (!http->stream && size + chsize > http->max_response_body_size) {
+            ngx_js_http_error(http, "http response body is too large");
+            return NGX_ERROR;
+        }
+
+        if (chsize > 0) {
+            if (ngx_js_http_append_body(http, b->pos, chsize) != NGX_OK) {
+                return NGX_ERROR;
+            }
+
+            b->pos += chsize;
+        }
+
+        if (need <= chsize
+            && http->keepalive
+            && (http->header_only || http->http_parse.content_length_n != -1))
+        {
+            return ngx_js_http_process_done(http);
+        }
+
+        rc = NGX_AGAIN;
+    }
+
+    if (b->pos == b->end) {
+        if (http->chunk == NULL) {
+            b = ngx_create_temp_buf(http->pool, http->buffer_size);
+            if (b == NULL) {
+                ngx_js_http_error(http, "memory error");
+                return NGX_ERROR;
+            }
+
+            http->buffer = b;
+            http->chunk = b;
+
+        } else {
+            b->last = b->start;
+            b->pos = b->start;
+        }
+    }
+
+    return rc;
+}
+
+
+ngx_int_t
+ngx_js_http_content_encoding(ngx_js_http_t *http, u_char *value, size_t len)
+{
+#ifdef NJS_HAVE_ZLIB
+    z_stream            *zs;
+    ngx_pool_cleanup_t  *cln;
+
+    if (!http->decompress || http->zstream != NULL) {
+        return NGX_OK;
+    }
+
+    if (!(len == 4 && ngx_strncasecmp(value, (u_char *) "gzip", 4) == 0)
+        && !(len == 6 && ngx_strncasecmp(value, (u_char *) "x-gzip", 6) == 0)
+        && !(len == 7 && ngx_strncasecmp(value, (u_char *) "deflate", 7) == 0))
+    {
+        return NGX_OK;
+    }
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http inflate \"%*s\"", len, value);
+
+    cln = ngx_pool_cleanup_add(http->pool, sizeof(z_stream));
+    if (cln == NULL) {
+        return NGX_ERROR;
+    }
+
+    zs = cln->data;
+    ngx_memzero(zs, sizeof(z_stream));
+
+    /* both gzip and zlib headers are detected automatically */
+
+    if (inflateInit2(zs, MAX_WBITS + 32) != Z_OK) {
+        return NGX_ERROR;
+    }
+
+    cln->handler = ngx_js_http_inflate_cleanup;
+
+    njs_chb_init(&http->encoded, http->response.chain.pool,
+                 http->response.chain.alloc, http->response.chain.free);
+
+    http->zstream = zs;
+#endif
+
+    return NGX_OK;
+}
+
+
+ngx_int_t
+ngx_js_http_append_body(ngx_js_http_t *http, u_char *data, size_t len)
+{
+#ifdef NJS_HAVE_ZLIB
+    if (http->zstream != NULL) {
+        return ngx_js_http_inflate(http, data, len);
+    }
+#endif
+
+    njs_chb_append(&http->response.chain, data, len);
+
+    return NGX_OK;
+}
+
+
+static ssize_t
+ngx_js_http_body_size(ngx_js_http_t *http)
+{
+#ifdef NJS_HAVE_ZLIB
+    if (http->zstream != NULL) {
+
+        /* the encoded body is inflated as it is received */
+
+        return http->encoded_size;
+    }
+#endif
+
+    return njs_chb_size(&http->response.chain);
+}
+
+
+#ifdef NJS_HAVE_ZLIB
+
+static ngx_int_t
+ngx_js_http_inflate(ngx_js_http_t *http, u_char *data, size_t len)
+{
+    int        rc;
+    u_char    *p;
+    ssize_t    size;
+    z_stream  *zs;
+
+    zs = http->zstream;
+
+    zs->next_in = data;
+    zs->avail_in = len;
+
+    http->encoded_size += len;
+
+    while (zs->avail_in != 0) {
+        p = njs_chb_reserve(&http->response.chain, http->buffer_size);
+        if (p == NULL) {
+            ngx_js_http_error(http, "memory error");
+            return NGX_ERROR;
+        }
+
+        zs->next_out = p;
+        zs->avail_out = njs_chb_node_room(http->response.chain.last);
+
+        rc = inflate(zs, Z_NO_FLUSH);
+
+        njs_chb_written(&http->response.chain, zs->next_out - p);
+
+        ngx_log_debug3(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http inflate rc:%d in:%uD out:%uz", rc,
+                       zs->avail_in, (size_t) (zs->next_out - p));
+
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+            ngx_js_http_error(http, "invalid compressed http response");
+            return NGX_ERROR;
+        }
+
+        if (!http->stream) {
+            size = njs_chb_size(&http->response.chain);
+
+            if (size < 0 || size > http->max_response_body_size) {
+                ngx_js_http_error(http, "http response body is too large");
+                return NGX_ERROR;
+            }
+        }
+
+        if (rc != Z_OK) {
+
+            /* the data after the end of the compressed stream is ignored */
+
+            break;
+        }
+    }
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_js_http_inflate_cleanup(void *data)
+{
+    z_stream  *zs = data;
+
+    (void) inflateEnd(zs);
+}
+
+#endif
+
+
+static ngx_int_t
+ngx_js_http_process_done(ngx_js_http_t *http)
+{
+    ngx_js_http_parse_t  *hp;
+
+    /* the response is complete before the peer closed the connection */
+
+    hp = &http->http_parse;
+
+    http->done = 1;
+
+    if (http->buffer->pos == http->buffer->last
+        && !hp->connection_close
+        && hp->http_major == 1
+        && hp->http_minor >= 1)
+    {
+        http->keepalive_ready = 1;
+    }
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http process done keepalive:%ui",
+                   (ngx_uint_t) http->keepalive_ready);
+
+    ngx_js_http_ready(http);
+
+    return NGX_DONE;
+}
+
+
+static void
+ngx_js_http_stream(ngx_js_http_t *http)
+{
+    ngx_event_t  *rev;
+
+    /*
+     * The body handler is called as the last action as it may finalize
+     * the request, reading is continued from a posted event or suspended
+     * until the buffered data is consumed by ngx_js_http_stream_read().
+     */
+
+    rev = http->peer.connection->read;
+
+    if (njs_chb_size(&http->response.chain) >= http->buffer_size) {
+        ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http stream paused");
+
+        http->stream_paused = 1;
+
+    } else {
+        ngx_post_event(rev, &ngx_posted_events);
+    }
+
+    ngx_add_timer(rev, http->timeout);
+
+    http->body_handler(http);
+}
+
+
+ngx_int_t
+ngx_js_http_stream_read(ngx_js_http_t *http, njs_str_t *data)
+{
+    njs_chb_t  *chain;
+
+    chain = &http->response.chain;
+
+    if (njs_chb_join(chain, data) != NJS_OK) {
+        return NGX_ERROR;
+    }
+
+    njs_chb_destroy(chain);
+
+    chain->nodes = NULL;
+    chain->last = NULL;
+
+    if (http->stream_paused) {
+        http->stream_paused = 0;
+
+        if (http->peer.connection != NULL) {
+            ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                           "js http stream resumed");
+
+            ngx_post_event(http->peer.connection->read, &ngx_posted_events);
+        }
+    }
+
+    return NGX_OK;
+}
+
+
+void
+ngx_js_http_ready(ngx_js_http_t *http)
+{
+    ngx_int_t  rc;
+
+    if (http->stream) {
+        http->body_handler(http);
+        return;
+    }
+
+    rc = NGX_OK;
+
+    if (http->cache != NULL) {
+        if (http->response.code == 304 && http->cache_entry.len != 0) {
+            rc = ngx_js_http_cache_revalidated(http);
+
+        } else if (http->response.code == 200) {
+            rc = ngx_js_http_cache_store(http);
+        }
+    }
+
+    if (rc != NGX_OK) {
+        ngx_js_http_error(http, "memory error");
+        return;
+    }
+
+    http->ready_handler(http);
+}
+
+
+/*
+ * Responses to requests with credentials are cached per credentials,
+ * and the responses are cached per encoding: the MD5 hash of the
+ * "Authorization", "Cookie" and "Accept-Encoding" headers, and of the
+ * decompression state, is appended to the URL.
+ */
+
+ngx_int_t
+ngx_js_http_cache_key(ngx_js_http_t *http, ngx_str_t *url,
+    ngx_js_headers_t *headers)
+{
+    u_char           *p;
+    u_char            hash[16];
+    ngx_md5_t         md5;
+    ngx_uint_t        i, found;
+    ngx_js_tb_elt_t  *h;
+    ngx_list_part_t  *part;
+
+    found = 0;
+    ngx_md5_init(&md5);
+
+    part = &headers->header_list.part;
+    h = part->elts;
+
+    for (i = 0; /* void */; i++) {
+
+        if (i >= part->nelts) {
+            if (part->next == NULL) {
+                break;
+            }
+
+            part = part->next;
+            h = part->elts;
+            i = 0;
+        }
+
+        if (h[i].hash == 0) {
+            continue;
+        }
+
+        if ((h[i].key.len == 13
+             && ngx_strncasecmp(h[i].key.data, (u_char *) "Authorization",
+                                13) == 0)
+            || (h[i].key.len == 6
+                && ngx_strncasecmp(h[i].key.data, (u_char *) "Cookie", 6)
+                   == 0)
+            || (h[i].key.len == 15
+                && ngx_strncasecmp(h[i].key.data,
+                                   (u_char *) "Accept-Encoding", 15) == 0))
+        {
+            found = 1;
+            ngx_md5_update(&md5, h[i].key.data, h[i].key.len);
+            ngx_md5_update(&md5, ":", 1);
+            ngx_md5_update(&md5, h[i].value.data, h[i].value.len);
+            ngx_md5_update(&md5, CRLF, 2);
+        }
+    }
+
+    if (http->decompress) {
+        found = 1;
+        ngx_md5_update(&md5, "inflate" CRLF, sizeof("inflate" CRLF) - 1);
+    }
+
+    if (!found) {
+        http->cache_key = *url;
+        return NGX_OK;
+    }
+
+    ngx_md5_final(hash, &md5);
+
+    p = ngx_pnalloc(http->pool, url->len + 1 + 32);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    http->cache_key.data = p;
+
+    p = ngx_cpymem(p, url->data, url->len);
+    *p++ = ' ';
+    p = ngx_hex_dump(p, hash, 16);
+
+    http->cache_key.len = p - http->cache_key.data;
+
+    return NGX_OK;
+}
+
+
+ngx_int_t
+ngx_js_http_cache_lookup(ngx_js_http_t *http)
+{
+    ngx_int_t                 rc;
+    ngx_js_http_cached_t      cached;
+    ngx_js_http_cache_info_t  ci;
+
+    ngx_str_null(&http->cache_entry);
+
+    if (http->cache_mode == CACHE_MODE_RELOAD) {
+        return NGX_DECLINED;
+    }
+
+    rc = ngx_js_dict_get_string(http->cache, &http->cache_key, http->pool,
+                                &http->cache_entry);
+    if (rc == NGX_ERROR) {
+        return NGX_ERROR;
+    }
+
+    if (rc == NGX_OK
+        && ngx_js_http_cache_parse(&http->cache_entry, &cached) != NGX_OK)
+    {
+        rc = NGX_DECLINED;
+    }
+
+    if (rc == NGX_DECLINED) {
+        ngx_str_null(&http->cache_entry);
+
+        return (http->cache_mode == CACHE_MODE_ONLY_IF_CACHED) ? NGX_ABORT
+                                                               : NGX_DECLINED;
+    }
+
+    if (http->cache_mode == CACHE_MODE_FORCE_CACHE
+        || http->cache_mode == CACHE_MODE_ONLY_IF_CACHED
+        || (http->cache_mode == CACHE_MODE_DEFAULT
+            && cached.valid > ngx_time()))
+    {
+        ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http cache hit \"%V\"", &http->cache_key);
+
+        return ngx_js_http_cache_response(http, &cached);
+    }
+
+    /* the cached response is stale, or must be revalidated */
+
+    ngx_js_http_cache_entry_info(&cached, &ci);
+
+    if (ci.etag.len == 0 && ci.last_modified.len == 0) {
+        ngx_str_null(&http->cache_entry);
+        return NGX_DECLINED;
+    }
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http cache revalidate \"%V\"", &http->cache_key);
+
+    if (ci.etag.len != 0) {
+        njs_chb_append_literal(&http->chain, "If-None-Match: ");
+        njs_chb_append(&http->chain, ci.etag.data, ci.etag.len);
+        njs_chb_append_literal(&http->chain, CRLF);
+    }
+
+    if (ci.last_modified.len != 0) {
+        njs_chb_append_literal(&http->chain, "If-Modified-Since: ");
+        njs_chb_append(&http->chain, ci.last_modified.data,
+                       ci.last_modified.len);
+        njs_chb_append_literal(&http->chain, CRLF);
+    }
+
+    return NGX_DECLINED;
+}
+
+
+static ngx_int_t
+ngx_js_http_cache_parse(ngx_str_t *entry, ngx_js_http_cached_t *cached)
+{
+    u_char                      *p;
+    ngx_js_http_cache_header_t   h;
+
+    if (entry->len < sizeof(ngx_js_http_cache_header_t)) {
+        return NGX_ERROR;
+    }
+
+    ngx_memcpy(&h, entry->data, sizeof(ngx_js_http_cache_header_t));
+
+    if ((uint64_t) h.status_len + h.headers_len + h.body_len
+        != entry->len - sizeof(ngx_js_http_cache_header_t))
+    {
+        return NGX_ERROR;
+    }
+
+    p = entry->data + sizeof(ngx_js_http_cache_header_t);
+
+    cached->valid = h.valid;
+    cached->code = h.code;
+
+    cached->status.data = p;
+    cached->status.len = h.status_len;
+    p += h.status_len;
+
+    cached->headers.data = p;
+    cached->headers.len = h.headers_len;
+    p += h.headers_len;
+
+    cached->body.data = p;
+    cached->body.len = h.body_len;
+
+    return NGX_OK;
+}
+
+
+static u_char *
+ngx_js_http_cache_next(u_char *p, u_char *end, ngx_str_t *name,
+    ngx_str_t *value)
+{
+    uint32_t  len;
+
+    if (end - p < (ssize_t) sizeof(uint32_t)) {
+        return NULL;
+    }
+
+    ngx_memcpy(&len, p, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+
+    if ((size_t) (end - p) < len + sizeof(uint32_t)) {
+        return NULL;
+    }
+
+    name->data = p;
+    name->len = len;
+    p += len;
+
+    ngx_memcpy(&len, p, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+
+    if ((size_t) (end - p) < len) {
+        return NULL;
+    }
+
+    value->data = p;
+    value->len = len;
+
+    return p + len;
+}
+
+
+static void
+ngx_js_http_cache_info(ngx_js_headers_t *headers, ngx_js_http_cache_info_t *ci)
+{
+    ngx_uint_t        i;
+    ngx_js_tb_elt_t  *h;
+    ngx_list_part_t  *part;
+
+    ngx_memzero(ci, sizeof(ngx_js_http_cache_info_t));
+
+    ci->max_age = -1;
+    ci->expires = -1;
+    ci->date = -1;
+
+    part = &headers->header_list.part;
+    h = part->elts;
+
+    for (i = 0; /* void */; i++) {
+
+        if (i >= part->nelts) {
+            if (part->next == NULL) {
+                break;
+            }
+
+            part = part->next;
+            h = part->elts;
+            i = 0;
+        }
+
+        if (h[i].hash == 0) {
+            continue;
+        }
+
+        ngx_js_http_cache_header(ci, &h[i].key, &h[i].value);
+    }
+}
+
+
+static void
+ngx_js_http_cache_entry_info(ngx_js_http_cached_t *cached,
+    ngx_js_http_cache_info_t *ci)
+{
+    u_char     *p, *end;
+    ngx_str_t   name, value;
+
+    ngx_memzero(ci, sizeof(ngx_js_http_cache_info_t));
+
+    ci->max_age = -1;
+    ci->expires = -1;
+    ci->date = -1;
+
+    p = cached->headers.data;
+    end = p + cached->headers.len;
+
+    while (p < end) {
+        p = ngx_js_http_cache_next(p, end, &name, &value);
+        if (p == NULL) {
+            return;
+        }
+
+        ngx_js_http_cache_header(ci, &name, &value);
+    }
+}
+
+
+static void
+ngx_js_http_cache_header(ngx_js_http_cache_info_t *ci, ngx_str_t *name,
+    ngx_str_t *value)
+{
+    u_char  *p, *last, *end;
+    size_t   len;
+    time_t   max_age;
+
+    if (name->len == sizeof("Cache-Control") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "Cache-Control",
+                           name->len) == 0)
+    {
+        p = value->data;
+        end = p + value->len;
+
+        while (p < end) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+                p++;
+            }
+
+            for (last = p; last < end && *last != ','; last++) {
+                /* void */
+            }
+
+            len = last - p;
+
+            while (len && (p[len - 1] == ' ' || p[len - 1] == '\t')) {
+                len--;
+            }
+
+            if ((len == sizeof("no-store") - 1
+                 && ngx_strncasecmp(p, (u_char *) "no-store", len) == 0)
+                || (len == sizeof("private") - 1
+                    && ngx_strncasecmp(p, (u_char *) "private", len) == 0))
+            {
+                ci->no_store = 1;
+
+            } else if (len >= sizeof("no-cache") - 1
+                       && ngx_strncasecmp(p, (u_char *) "no-cache",
+                                          sizeof("no-cache") - 1) == 0)
+            {
+                ci->no_cache = 1;
+
+            } else if (len > sizeof("max-age=") - 1
+                       && ngx_strncasecmp(p, (u_char *) "max-age=",
+                                          sizeof("max-age=") - 1) == 0)
+            {
+                max_age = ngx_atotm(p + sizeof("max-age=") - 1,
+                                    len - (sizeof("max-age=") - 1));
+                if (max_age != NGX_ERROR) {
+                    ci->max_age = max_age;
+                }
+            }
+
+            p = last;
+        }
+
+        return;
+    }
+
+    if (name->len == sizeof("Expires") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "Expires", name->len) == 0)
+    {
+        ci->expires = ngx_parse_http_time(value->data, value->len);
+
+        if (ci->expires == NGX_ERROR) {
+            /* an invalid date means the response is already expired */
+            ci->expires = 0;
+        }
+
+        return;
     }
 
-    http->done = 1;
+    if (name->len == sizeof("Date") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "Date", name->len) == 0)
+    {
+        ci->date = ngx_parse_http_time(value->data, value->len);
+        return;
+    }
 
-    rc = http->process(http);
+    if (name->len == sizeof("ETag") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "ETag", name->len) == 0)
+    {
+        ci->etag = *value;
+        return;
+    }
 
-    if (rc == NGX_DONE) {
-        /* handler was called */
+    if (name->len == sizeof("Last-Modified") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "Last-Modified",
+                           name->len) == 0)
+    {
+        ci->last_modified = *value;
         return;
     }
 
-    if (rc == NGX_AGAIN) {
-        ngx_js_http_error(http, "prematurely closed connection");
+    if (name->len == sizeof("Vary") - 1
+        && ngx_strncasecmp(name->data, (u_char *) "Vary", name->len) == 0)
+    {
+        ci->vary = 1;
     }
 }
 
 
-static void
-ngx_js_http_dummy_handler(ngx_event_t *ev)
+static time_t
+ngx_js_http_cache_lifetime(ngx_js_http_cache_info_t *ci)
 {
-    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, ev->log, 0, "js http dummy handler");
+    time_t  lifetime;
+
+    if (ci->no_cache) {
+        return 0;
+    }
+
+    if (ci->max_age != -1) {
+        return ci->max_age;
+    }
+
+    if (ci->expires != -1) {
+        lifetime = ci->expires - ((ci->date != -1) ? ci->date : ngx_time());
+        return (lifetime > 0) ? lifetime : 0;
+    }
+
+    return -1;
 }
 
 
 static ngx_int_t
-ngx_js_http_process_status_line(ngx_js_http_t *http)
+ngx_js_http_cache_response(ngx_js_http_t *http, ngx_js_http_cached_t *cached)
 {
-    ngx_int_t             rc;
-    ngx_js_http_parse_t  *hp;
-
-    hp = &http->http_parse;
+    u_char            *p, *end;
+    ngx_str_t          name, value;
+    ngx_js_headers_t  *headers;
 
-    rc = ngx_js_http_parse_status_line(hp, http->buffer);
+    http->response.code = cached->code;
+    http->response.status_text = cached->status;
 
-    if (rc == NGX_OK) {
-        ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0, "js http status %ui",
-                       hp->code);
+    headers = &http->response.headers;
 
-        http->response.code = hp->code;
-        http->response.status_text.data = hp->status_text;
-        http->response.status_text.len = hp->status_text_end - hp->status_text;
-        http->process = ngx_js_http_process_headers;
+    headers->guard = GUARD_NONE;
+    headers->content_type = NULL;
 
-        return http->process(http);
+    if (ngx_list_init(&headers->header_list, http->pool, 4,
+                      sizeof(ngx_js_tb_elt_t))
+        != NGX_OK)
+    {
+        return NGX_ERROR;
     }
 
-    if (rc == NGX_AGAIN) {
-        return NGX_AGAIN;
+    p = cached->headers.data;
+    end = p + cached->headers.len;
+
+    while (p < end) {
+        p = ngx_js_http_cache_next(p, end, &name, &value);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
+
+        if (http->append_headers(http, headers, name.data, name.len,
+                                 value.data, value.len)
+            == NGX_ERROR)
+        {
+            return NGX_ERROR;
+        }
     }
 
-    /* rc == NGX_ERROR */
+    headers->guard = GUARD_IMMUTABLE;
 
-    ngx_js_http_error(http, "invalid http status line");
+    njs_chb_append(&http->response.chain, cached->body.data,
+                   cached->body.len);
 
-    return NGX_ERROR;
+    if (http->response.chain.error) {
+        return NGX_ERROR;
+    }
+
+    return NGX_OK;
 }
 
 
 static ngx_int_t
-ngx_js_http_process_headers(ngx_js_http_t *http)
+ngx_js_http_cache_store(ngx_js_http_t *http)
 {
-    size_t                len, vlen;
-    ngx_int_t             rc;
-    ngx_js_http_parse_t  *hp;
-
-    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                   "js http process headers");
+    time_t                    lifetime;
+    ngx_js_http_cache_info_t  ci;
 
-    hp = &http->http_parse;
+    ngx_js_http_cache_info(&http->response.headers, &ci);
 
-    if (http->response.headers.header_list.size == 0) {
-        rc = ngx_list_init(&http->response.headers.header_list, http->pool, 4,
-                           sizeof(ngx_js_tb_elt_t));
-        if (rc != NGX_OK) {
-            ngx_js_http_error(http, "alloc failed");
-            return NGX_ERROR;
-        }
+    if (ci.no_store || ci.vary) {
+        return NGX_OK;
     }
 
-    for ( ;; ) {
-        rc = ngx_js_http_parse_header_line(hp, http->buffer);
-
-        if (rc == NGX_OK) {
-            len = hp->header_name_end - hp->header_name_start;
-            vlen = hp->header_end - hp->header_start;
+    lifetime = ngx_js_http_cache_lifetime(&ci);
 
-            rc = http->append_headers(http, &http->response.headers,
-                                       hp->header_name_start, len,
-                                       hp->header_start, vlen);
+    if (lifetime == -1) {
+        lifetime = 0;
+    }
 
-            if (rc == NGX_ERROR) {
-                ngx_js_http_error(http, "cannot add respose header");
-                return NGX_ERROR;
-            }
+    if (lifetime == 0 && ci.etag.len == 0 && ci.last_modified.len == 0) {
+        return NGX_OK;
+    }
 
-            ngx_log_debug4(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                           "js http header \"%*s: %*s\"",
-                           len, hp->header_name_start, vlen, hp->header_start);
+    return ngx_js_http_cache_save(http, lifetime);
+}
 
-            if (len == (sizeof("Transfer-Encoding") -1)
-                && vlen == (sizeof("chunked") - 1)
-                && ngx_strncasecmp(hp->header_name_start,
-                                   (u_char *) "Transfer-Encoding", len) == 0
-                && ngx_strncasecmp(hp->header_start, (u_char *) "chunked",
-                                   vlen) == 0)
-            {
-                hp->chunked = 1;
-            }
 
-            if (len == (sizeof("Content-Length") - 1)
-                && ngx_strncasecmp(hp->header_name_start,
-                                   (u_char *) "Content-Length", len) == 0)
-            {
-                hp->content_length_n = ngx_atoof(hp->header_start, vlen);
-                if (hp->content_length_n == NGX_ERROR) {
-                    ngx_js_http_error(http, "invalid http content length");
-                    return NGX_ERROR;
-                }
+static ngx_int_t
+ngx_js_http_cache_revalidated(ngx_js_http_t *http)
+{
+    time_t                      lifetime;
+    ngx_str_t                   entry;
+    ngx_js_http_cached_t        cached;
+    ngx_js_http_cache_info_t    ci;
+    ngx_js_http_cache_header_t  h;
 
-                if (!http->header_only
-                    && hp->content_length_n
-                       > (off_t) http->max_response_body_size)
-                {
-                    ngx_js_http_error(http,
-                                      "http content length is too large");
-                    return NGX_ERROR;
-                }
-            }
+    entry = http->cache_entry;
 
-            continue;
-        }
+    if (ngx_js_http_cache_parse(&entry, &cached) != NGX_OK) {
+        return NGX_ERROR;
+    }
 
-        if (rc == NGX_DONE) {
-            http->response.headers.guard = GUARD_IMMUTABLE;
-            break;
-        }
+    /* the freshness of the 304 response takes precedence */
 
-        if (rc == NGX_AGAIN) {
-            return NGX_AGAIN;
-        }
+    ngx_js_http_cache_info(&http->response.headers, &ci);
 
-        /* rc == NGX_ERROR */
+    lifetime = ngx_js_http_cache_lifetime(&ci);
 
-        ngx_js_http_error(http, "invalid http header");
+    if (lifetime == -1) {
+        ngx_js_http_cache_entry_info(&cached, &ci);
+        lifetime = ngx_js_http_cache_lifetime(&ci);
+    }
 
-        return NGX_ERROR;
+    if (lifetime == -1) {
+        lifetime = 0;
     }
 
-    njs_chb_destroy(&http->chain);
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http cache revalidated \"%V\" lifetime:%T",
+                   &http->cache_key, lifetime);
 
-    http->process = ngx_js_http_process_body;
+    ngx_memcpy(&h, entry.data, sizeof(ngx_js_http_cache_header_t));
+    h.valid = ngx_time() + lifetime;
+    ngx_memcpy(entry.data, &h, sizeof(ngx_js_http_cache_header_t));
 
-    return http->process(http);
+    if (ngx_js_dict_set_string(http->cache, &http->cache_key, &entry,
+                               lifetime * 1000 + http->cache_inactive)
+        != NGX_OK)
+    {
+        ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http cache update failed");
+    }
+
+    return ngx_js_http_cache_response(http, &cached);
 }
 
 
 static ngx_int_t
-ngx_js_http_process_body(ngx_js_http_t *http)
+ngx_js_http_cache_save(ngx_js_http_t *http, time_t lifetime)
 {
-    ssize_t     size, chsize, need;
-    ngx_int_t   rc;
-    ngx_buf_t  *b;
+    u_char                      *p;
+    size_t                       len, headers_len;
+    int64_t                      size;
+    uint32_t                     n;
+    ngx_str_t                    entry;
+    ngx_uint_t                   i;
+    njs_chb_node_t              *node;
+    ngx_js_tb_elt_t             *h;
+    ngx_list_part_t             *part;
+    ngx_js_http_cache_header_t   hdr;
+
+    size = njs_chb_size(&http->response.chain);
+    if (size < 0) {
+        return NGX_ERROR;
+    }
 
-    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, http->log, 0,
-                   "js http process body done:%ui", (ngx_uint_t) http->done);
+    headers_len = 0;
 
-    if (http->done) {
-        size = njs_chb_size(&http->response.chain);
-        if (size < 0) {
-            ngx_js_http_error(http, "memory error");
-            return NGX_ERROR;
-        }
+    part = &http->response.headers.header_list.part;
+    h = part->elts;
 
-        if (!http->header_only
-            && http->http_parse.chunked
-            && http->http_parse.content_length_n == -1)
-        {
-            ngx_js_http_error(http, "invalid http chunked response");
-            return NGX_ERROR;
-        }
+    for (i = 0; /* void */; i++) {
 
-        if (http->header_only
-            || http->http_parse.content_length_n == -1
-            || size == http->http_parse.content_length_n)
-        {
-            http->ready_handler(http);
-            return NGX_DONE;
+        if (i >= part->nelts) {
+            if (part->next == NULL) {
+                break;
+            }
+
+            part = part->next;
+            h = part->elts;
+            i = 0;
         }
 
-        if (size < http->http_parse.content_length_n) {
-            return NGX_AGAIN;
+        if (h[i].hash == 0 || ngx_js_http_cache_skip(http, &h[i])) {
+            continue;
         }
 
-        ngx_js_http_error(http, "http trailing data");
-        return NGX_ERROR;
+        headers_len += 2 * sizeof(uint32_t) + h[i].key.len + h[i].value.len;
     }
 
-    b = http->buffer;
+    len = sizeof(ngx_js_http_cache_header_t)
+          + http->response.status_text.len + headers_len + size;
 
-    if (http->http_parse.chunked) {
-        rc = ngx_js_http_parse_chunked(&http->http_chunk_parse, b,
-                                       &http->response.chain);
-        if (rc == NGX_ERROR) {
-            ngx_js_http_error(http, "invalid http chunked response");
-            return NGX_ERROR;
-        }
+    entry.data = ngx_pnalloc(http->pool, len);
+    if (entry.data == NULL) {
+        return NGX_ERROR;
+    }
 
-        size = njs_chb_size(&http->response.chain);
+    entry.len = len;
 
-        if (rc == NGX_OK) {
-            http->http_parse.content_length_n = size;
-        }
+    hdr.valid = ngx_time() + lifetime;
+    hdr.code = http->response.code;
+    hdr.status_len = http->response.status_text.len;
+    hdr.headers_len = headers_len;
+    hdr.body_len = size;
 
-        if (size > http->max_response_body_size * 10) {
-            ngx_js_http_error(http, "very large http chunked response");
-            return NGX_ERROR;
-        }
+    p = ngx_cpymem(entry.data, &hdr, sizeof(ngx_js_http_cache_header_t));
+    p = ngx_cpymem(p, http->response.status_text.data,
+                   http->response.status_text.len);
 
-        b->pos = http->http_chunk_parse.pos;
+    part = &http->response.headers.header_list.part;
+    h = part->elts;
 
-    } else {
-        size = njs_chb_size(&http->response.chain);
+    for (i = 0; /* void */; i++) {
 
-        if (http->header_only) {
-            need = 0;
+        if (i >= part->nelts) {
+            if (part->next == NULL) {
+                break;
+            }
 
-        } else  if (http->http_parse.content_length_n == -1) {
-            need = http->max_response_body_size - size;
+            part = part->next;
+            h = part->elts;
+            i = 0;
+        }
 
-        } else {
-            need = http->http_parse.content_length_n - size;
+        if (h[i].hash == 0 || ngx_js_http_cache_skip(http, &h[i])) {
+            continue;
         }
 
-        chsize = ngx_min(need, b->last - b->pos);
+        n = h[i].key.len;
+        p = ngx_cpymem(p, &n, sizeof(uint32_t));
+        p = ngx_cpymem(p, h[i].key.data, n);
 
-        if (size + chsize > http->max_response_body_size) {
-            ngx_js_http_error(http, "http response body is too large");
-            return NGX_ERROR;
-        }
+        n = h[i].value.len;
+        p = ngx_cpymem(p, &n, sizeof(uint32_t));
+        p = ngx_cpymem(p, h[i].value.data, n);
+    }
 
-        if (chsize > 0) {
-            njs_chb_append(&http->response.chain, b->pos, chsize);
-            b->pos += chsize;
-        }
+    for (node = http->response.chain.nodes; node != NULL; node = node->next) {
+        p = ngx_cpymem(p, node->start, njs_chb_node_size(node));
+    }
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http cache store \"%V\" lifetime:%T",
+                   &http->cache_key, lifetime);
 
-        rc = (need > chsize) ? NGX_AGAIN : NGX_DONE;
+    if (ngx_js_dict_set_string(http->cache, &http->cache_key, &entry,
+                               lifetime * 1000 + http->cache_inactive)
+        != NGX_OK)
+    {
+        ngx_log_debug0(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                       "js http cache store failed");
     }
 
-    if (b->pos == b->end) {
-        if (http->chunk == NULL) {
-            b = ngx_create_temp_buf(http->pool, http->buffer_size);
-            if (b == NULL) {
-                ngx_js_http_error(http, "memory error");
-                return NGX_ERROR;
-            }
+    return NGX_OK;
+}
 
-            http->buffer = b;
-            http->chunk = b;
 
-        } else {
-            b->last = b->start;
-            b->pos = b->start;
-        }
+/*
+ * An inflated body is stored without the headers describing
+ * the encoded body.
+ */
+
+static ngx_int_t
+ngx_js_http_cache_skip(ngx_js_http_t *http, ngx_js_tb_elt_t *h)
+{
+    if (http->zstream == NULL) {
+        return 0;
     }
 
-    return rc;
+    return (h->key.len == sizeof("Content-Encoding") - 1
+            && ngx_strncasecmp(h->key.data, (u_char *) "Content-Encoding",
+                               h->key.len) == 0)
+           || (h->key.len == sizeof("Content-Length") - 1
+               && ngx_strncasecmp(h->key.data, (u_char *) "Content-Length",
+                                  h->key.len) == 0);
 }
 
 
@@ -942,6 +3195,7 @@ ngx_js_http_parse_status_line(ngx_js_http_parse_t *hp, ngx_buf_t *b)
                 return NGX_ERROR;
             }
 
+            hp->http_major = ch - '0';
             state = sw_major_digit;
             break;
 
@@ -956,6 +3210,11 @@ ngx_js_http_parse_status_line(ngx_js_http_parse_t *hp, ngx_buf_t *b)
                 return NGX_ERROR;
             }
 
+            if (hp->http_major > 99) {
+                return NGX_ERROR;
+            }
+
+            hp->http_major = hp->http_major * 10 + (ch - '0');
             break;
 
         /* the first digit of minor HTTP version */
@@ -964,6 +3223,7 @@ ngx_js_http_parse_status_line(ngx_js_http_parse_t *hp, ngx_buf_t *b)
                 return NGX_ERROR;
             }
 
+            hp->http_minor = ch - '0';
             state = sw_minor_digit;
             break;
 
@@ -978,6 +3238,11 @@ ngx_js_http_parse_status_line(ngx_js_http_parse_t *hp, ngx_buf_t *b)
                 return NGX_ERROR;
             }
 
+            if (hp->http_minor > 99) {
+                return NGX_ERROR;
+            }
+
+            hp->http_minor = hp->http_minor * 10 + (ch - '0');
             break;
 
         /* HTTP status code */
@@ -1528,3 +3793,29 @@ ngx_js_check_header_name(u_char *name, size_t len)
 
     return NGX_OK;
 }
+
+
+ngx_int_t
+ngx_js_http_idempotent(ngx_str_t *method)
+{
+    ngx_uint_t  i;
+
+    static ngx_str_t  methods[] = {
+        ngx_string("GET"),
+        ngx_string("HEAD"),
+        ngx_string("PUT"),
+        ngx_string("DELETE"),
+        ngx_string("OPTIONS"),
+    };
+
+    for (i = 0; i < njs_nitems(methods); i++) {
+        if (method->len == methods[i].len
+            && ngx_strncasecmp(method->data, methods[i].data, method->len)
+               == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -13,14 +13,21 @@
 
 typedef struct ngx_js_http_s  ngx_js_http_t;
 
+#if (NGX_HTTP_V2)
+typedef struct ngx_js_http_v2_stream_s  ngx_js_http_v2_stream_t;
+#endif
+
 
 typedef struct {
     ngx_uint_t                     state;
     ngx_uint_t                     code;
+    ngx_uint_t                     http_major;
+    ngx_uint_t                     http_minor;
     u_char                        *status_text;
     u_char                        *status_text_end;
     ngx_uint_t                     count;
     ngx_flag_t                     chunked;
+    ngx_flag_t                     connection_close;
     off_t                          content_length_n;
 
     u_char                        *header_name_start;
@@ -85,6 +92,7 @@ typedef struct {
     ngx_str_t                      method;
     u_char                         m[8];
     uint8_t                        body_used;
+    uint8_t                        body_stream;
     ngx_str_t                      body;
     ngx_js_headers_t               headers;
     njs_opaque_value_t             header_value;
@@ -99,6 +107,7 @@ typedef struct {
     njs_chb_t                      chain;
     ngx_js_headers_t               headers;
     njs_opaque_value_t             header_value;
+    ngx_js_http_t                 *http;
 } ngx_js_response_t;
 
 
@@ -113,6 +122,10 @@ struct ngx_js_http_s {
     ngx_uint_t                     naddr;
     in_port_t                      port;
 
+    /* ngx_http_upstream_rr_peer_data_t */
+    void                          *upstream;
+    unsigned                       upstream_peer:1;
+
     ngx_peer_connection_t          peer;
     ngx_msec_t                     timeout;
 
@@ -121,6 +134,35 @@ struct ngx_js_http_s {
 
     unsigned                       header_only;
 
+    unsigned                       stream:1;
+    unsigned                       stream_paused:1;
+
+    ngx_resolver_t                *resolver;
+    ngx_uint_t                     resolver_cache;
+    time_t                         resolver_cache_negative;
+    time_t                         resolver_cache_stale;
+
+    ngx_uint_t                     keepalive;
+    ngx_msec_t                     keepalive_timeout;
+    ngx_uint_t                     keepalive_requests;
+    unsigned                       keepalive_reused:1;
+    unsigned                       keepalive_ready:1;
+    unsigned                       idempotent:1;
+    unsigned                       request_sent:1;
+
+#if (NGX_HTTP_V2)
+    ngx_js_http_v2_stream_t       *v2;
+    ngx_msec_t                     v2_deadline;
+    ngx_uint_t                     v2_retries;
+#endif
+    unsigned                       http2:1;
+
+    ngx_js_dict_t                 *cache;
+    ngx_uint_t                     cache_mode;
+    ngx_msec_t                     cache_inactive;
+    ngx_str_t                      cache_key;
+    ngx_str_t                      cache_entry;
+
 #if (NGX_SSL)
     ngx_str_t                      tls_name;
     ngx_ssl_t                     *ssl;
@@ -131,8 +173,22 @@ struct ngx_js_http_s {
     ngx_buf_t                     *chunk;
     njs_chb_t                      chain;
 
+    ngx_str_t                      body;
+    ngx_chain_t                   *out;
+    const char                    *body_error;
+    unsigned                       body_stream:1;
+    unsigned                       body_started:1;
+    unsigned                       body_pending:1;
+    unsigned                       body_last:1;
+
     ngx_js_response_t              response;
 
+    /* z_stream */
+    void                          *zstream;
+    njs_chb_t                      encoded;
+    off_t                          encoded_size;
+    unsigned                       decompress:1;
+
     uint8_t                        done;
     ngx_js_http_parse_t            http_parse;
     ngx_js_http_chunk_parse_t      http_chunk_parse;
@@ -142,19 +198,45 @@ struct ngx_js_http_s {
                                                    u_char *name, size_t len,
                                                    u_char *value, size_t vlen);
     void                         (*ready_handler)(ngx_js_http_t *http);
+    void                         (*body_handler)(ngx_js_http_t *http);
+    void                         (*body_next)(ngx_js_http_t *http);
     void                         (*error_handler)(ngx_js_http_t *http,
                                                   const char *err);
 };
 
 
-ngx_resolver_ctx_t *ngx_js_http_resolve(ngx_js_http_t *http, ngx_resolver_t *r,
+extern ngx_uint_t  ngx_js_http_ssl_reused;
+
+
+ngx_int_t ngx_js_http_resolve(ngx_js_http_t *http, ngx_resolver_t *r,
     ngx_str_t *host, in_port_t port, ngx_msec_t timeout);
+ngx_int_t ngx_js_http_upstream(ngx_js_http_t *http, ngx_str_t *host);
 void ngx_js_http_connect(ngx_js_http_t *http);
 void ngx_js_http_resolve_done(ngx_js_http_t *http);
 void ngx_js_http_close_peer(ngx_js_http_t *http);
+void ngx_js_http_next(ngx_js_http_t *http);
+void ngx_js_http_ready(ngx_js_http_t *http);
+void ngx_js_http_error(ngx_js_http_t *http, const char *fmt, ...);
 void ngx_js_http_trim(u_char **value, size_t *len,
     int trim_c0_control_or_space);
 ngx_int_t ngx_js_check_header_name(u_char *name, size_t len);
+ngx_int_t ngx_js_http_idempotent(ngx_str_t *method);
+ngx_int_t ngx_js_http_cache_key(ngx_js_http_t *http, ngx_str_t *url,
+    ngx_js_headers_t *headers);
+ngx_int_t ngx_js_http_cache_lookup(ngx_js_http_t *http);
+ngx_int_t ngx_js_http_stream_read(ngx_js_http_t *http, njs_str_t *data);
+void ngx_js_http_send_body(ngx_js_http_t *http, ngx_str_t *data,
+    ngx_uint_t last);
+void ngx_js_http_body_error(ngx_js_http_t *http, const char *err);
+ngx_int_t ngx_js_http_content_encoding(ngx_js_http_t *http, u_char *value,
+    size_t len);
+ngx_int_t ngx_js_http_append_body(ngx_js_http_t *http, u_char *data,
+    size_t len);
+
+#if (NGX_HTTP_V2)
+void ngx_js_http_v2_connect(ngx_js_http_t *http);
+void ngx_js_http_v2_close(ngx_js_http_t *http);
+#endif
 
 
 #endif /* _NGX_JS_HTTP_H_INCLUDED_ */
@@ -0,0 +1,2682 @@
+
+/*
+ * Copyright (C) Dmitry Volyntsev
+ * Copyright (C) NGINX, Inc.
+ */
+
+
+#include <ngx_config.h>
+#include <ngx_core.h>
+#include <ngx_event.h>
+#include <ngx_event_connect.h>
+#include "ngx_js.h"
+#include "ngx_js_http.h"
+
+
+#if (NGX_HTTP_V2)
+
+#include <ngx_http.h>
+
+
+#define NGX_JS_HTTP_V2_PREFACE          "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define NGX_JS_HTTP_V2_ALPN             "\x02h2\x08http/1.1"
+
+#define NGX_JS_HTTP_V2_FRAME_HEADER     9
+#define NGX_JS_HTTP_V2_FRAME_SIZE       16384
+#define NGX_JS_HTTP_V2_MAX_FRAME_SIZE   ((1 << 24) - 1)
+#define NGX_JS_HTTP_V2_BUFFER_SIZE                                            \
+    (NGX_JS_HTTP_V2_FRAME_HEADER + NGX_JS_HTTP_V2_FRAME_SIZE)
+
+#define NGX_JS_HTTP_V2_DEFAULT_WINDOW   65535
+#define NGX_JS_HTTP_V2_MAX_WINDOW       0x7fffffff
+#define NGX_JS_HTTP_V2_STREAM_WINDOW    (1 << 20)
+#define NGX_JS_HTTP_V2_CONN_WINDOW      (1 << 24)
+
+#define NGX_JS_HTTP_V2_TABLE_SIZE       4096
+#define NGX_JS_HTTP_V2_TABLE_ENTRIES    (NGX_JS_HTTP_V2_TABLE_SIZE / 32)
+#define NGX_JS_HTTP_V2_ENTRY_SIZE       32
+#define NGX_JS_HTTP_V2_STATIC_ENTRIES   61
+
+#define NGX_JS_HTTP_V2_MAX_STREAMS      100
+#define NGX_JS_HTTP_V2_MAX_ID           0x7fffffff
+#define NGX_JS_HTTP_V2_MAX_BLOCK        65536
+#define NGX_JS_HTTP_V2_MAX_RETRIES      2
+
+#define NGX_JS_HTTP_V2_DATA             0x0
+#define NGX_JS_HTTP_V2_HEADERS          0x1
+#define NGX_JS_HTTP_V2_RST_STREAM       0x3
+#define NGX_JS_HTTP_V2_SETTINGS         0x4
+#define NGX_JS_HTTP_V2_PUSH_PROMISE     0x5
+#define NGX_JS_HTTP_V2_PING             0x6
+#define NGX_JS_HTTP_V2_GOAWAY           0x7
+#define NGX_JS_HTTP_V2_WINDOW_UPDATE    0x8
+#define NGX_JS_HTTP_V2_CONTINUATION     0x9
+
+#define NGX_JS_HTTP_V2_END_STREAM       0x01
+#define NGX_JS_HTTP_V2_ACK              0x01
+#define NGX_JS_HTTP_V2_END_HEADERS      0x04
+#define NGX_JS_HTTP_V2_PADDED           0x08
+#define NGX_JS_HTTP_V2_PRIORITY         0x20
+
+#define NGX_JS_HTTP_V2_HEADER_TABLE_SIZE      0x1
+#define NGX_JS_HTTP_V2_ENABLE_PUSH            0x2
+#define NGX_JS_HTTP_V2_MAX_CONCURRENT_STREAMS 0x3
+#define NGX_JS_HTTP_V2_INITIAL_WINDOW_SIZE    0x4
+#define NGX_JS_HTTP_V2_MAX_FRAME_SIZE_SETTING 0x5
+
+#define NGX_JS_HTTP_V2_REFUSED_STREAM   0x7
+#define NGX_JS_HTTP_V2_CANCEL           0x8
+
+
+typedef struct ngx_js_http_v2_conn_s  ngx_js_http_v2_conn_t;
+
+
+typedef struct {
+    ngx_str_t                      name;
+    ngx_str_t                      value;
+} ngx_js_http_v2_header_t;
+
+
+/* HPACK dynamic table, the entries are kept in a ring, newest last */
+
+typedef struct {
+    ngx_js_http_v2_header_t       *entries;
+    ngx_uint_t                     head;
+    ngx_uint_t                     count;
+    size_t                         size;
+    size_t                         max_size;
+} ngx_js_http_v2_table_t;
+
+
+typedef struct {
+    ngx_queue_t                    queue;
+    u_char                        *pos;
+    u_char                        *last;
+} ngx_js_http_v2_frame_t;
+
+
+struct ngx_js_http_v2_conn_s {
+    ngx_queue_t                    queue;
+    ngx_peer_connection_t          peer;
+    ngx_sockaddr_t                 sockaddr;
+    ngx_str_t                      name;
+    u_char                         name_data[NGX_SOCKADDR_STRLEN];
+
+#if (NGX_SSL)
+    ngx_ssl_t                     *ssl;
+    njs_bool_t                     ssl_verify;
+    ngx_str_t                      tls_name;
+#endif
+
+    ngx_queue_t                    streams;
+    ngx_uint_t                     nstreams;
+    ngx_uint_t                     max_streams;
+    uint32_t                       next_id;
+
+    ssize_t                        send_window;
+    ssize_t                        recv_window;
+    size_t                         init_window;
+    size_t                         frame_size;
+    ngx_msec_t                     idle_timeout;
+
+    ngx_queue_t                    out;
+
+    u_char                        *buffer;
+    size_t                         len;
+
+    u_char                        *block;
+    size_t                         block_len;
+    size_t                         block_size;
+    uint32_t                       block_sid;
+
+    ngx_js_http_v2_table_t         encoder;
+    ngx_js_http_v2_table_t         decoder;
+
+    unsigned                       connected:1;
+    unsigned                       goaway:1;
+    unsigned                       continuation:1;
+    unsigned                       block_end_stream:1;
+    unsigned                       size_update:1;
+};
+
+
+struct ngx_js_http_v2_stream_s {
+    ngx_queue_t                    queue;
+    ngx_js_http_v2_conn_t         *conn;
+    ngx_js_http_t                 *http;
+    ngx_event_t                    event;
+    const char                    *error;
+    uint32_t                       id;
+    ssize_t                        send_window;
+    ssize_t                        recv_window;
+    size_t                         sent;
+    unsigned                       headers:1;
+    unsigned                       end_stream:1;
+};
+
+
+static ngx_js_http_v2_conn_t *ngx_js_http_v2_lookup(ngx_js_http_t *http);
+static ngx_js_http_v2_conn_t *ngx_js_http_v2_create(ngx_js_http_t *http);
+static void ngx_js_http_v2_attach(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream);
+static void ngx_js_http_v2_detach(ngx_js_http_v2_stream_t *stream);
+static void ngx_js_http_v2_idle(ngx_js_http_v2_conn_t *conn);
+static void ngx_js_http_v2_goaway(ngx_js_http_v2_conn_t *conn);
+static void ngx_js_http_v2_close_conn(ngx_js_http_v2_conn_t *conn,
+    const char *err, ngx_event_handler_pt handler);
+static void ngx_js_http_v2_close_connection(ngx_connection_t *c);
+
+#if (NGX_SSL)
+static void ngx_js_http_v2_ssl_init_connection(ngx_js_http_v2_conn_t *conn);
+static void ngx_js_http_v2_ssl_handshake(ngx_connection_t *c);
+#endif
+
+static ngx_int_t ngx_js_http_v2_init(ngx_js_http_v2_conn_t *conn);
+static ngx_int_t ngx_js_http_v2_start(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream);
+static ngx_int_t ngx_js_http_v2_send_data(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream);
+static void ngx_js_http_v2_resume(ngx_js_http_v2_conn_t *conn);
+static ngx_int_t ngx_js_http_v2_send(ngx_js_http_v2_conn_t *conn);
+static void ngx_js_http_v2_write_handler(ngx_event_t *wev);
+static void ngx_js_http_v2_read_handler(ngx_event_t *rev);
+
+static ngx_int_t ngx_js_http_v2_process(ngx_js_http_v2_conn_t *conn);
+static ngx_int_t ngx_js_http_v2_process_frame(ngx_js_http_v2_conn_t *conn,
+    u_char *p);
+static ngx_int_t ngx_js_http_v2_process_data(ngx_js_http_v2_conn_t *conn,
+    uint32_t sid, ngx_uint_t flags, u_char *pos, u_char *end, size_t len);
+static ngx_int_t ngx_js_http_v2_process_block(ngx_js_http_v2_conn_t *conn,
+    ngx_uint_t flags, u_char *pos, u_char *end);
+static ngx_int_t ngx_js_http_v2_process_headers(ngx_js_http_v2_conn_t *conn);
+static ngx_int_t ngx_js_http_v2_process_settings(ngx_js_http_v2_conn_t *conn,
+    u_char *pos, u_char *end);
+static void ngx_js_http_v2_process_goaway(ngx_js_http_v2_conn_t *conn,
+    uint32_t last_id);
+static ngx_int_t ngx_js_http_v2_header(ngx_js_http_v2_stream_t *stream,
+    ngx_str_t *name, ngx_str_t *value);
+
+static ngx_js_http_v2_stream_t *ngx_js_http_v2_find(
+    ngx_js_http_v2_conn_t *conn, uint32_t sid);
+static void ngx_js_http_v2_stream_done(ngx_js_http_v2_stream_t *stream);
+static void ngx_js_http_v2_stream_error(ngx_js_http_v2_stream_t *stream,
+    const char *err, ngx_uint_t reset);
+static void ngx_js_http_v2_stream_post(ngx_js_http_v2_stream_t *stream,
+    ngx_event_handler_pt handler, const char *err);
+static void ngx_js_http_v2_timeout_handler(ngx_event_t *ev);
+static void ngx_js_http_v2_error_handler(ngx_event_t *ev);
+static void ngx_js_http_v2_next_handler(ngx_event_t *ev);
+static void ngx_js_http_v2_reconnect_handler(ngx_event_t *ev);
+static void ngx_js_http_v2_http1_handler(ngx_event_t *ev);
+
+static u_char *ngx_js_http_v2_frame(ngx_js_http_v2_conn_t *conn, size_t len);
+static u_char *ngx_js_http_v2_frame_head(u_char *p, size_t len,
+    ngx_uint_t type, ngx_uint_t flags, uint32_t sid);
+static ngx_int_t ngx_js_http_v2_rst_stream(ngx_js_http_v2_conn_t *conn,
+    uint32_t sid, ngx_uint_t code);
+static ngx_int_t ngx_js_http_v2_window_update(ngx_js_http_v2_conn_t *conn,
+    uint32_t sid, size_t inc);
+
+static u_char *ngx_js_http_v2_encode(ngx_js_http_v2_conn_t *conn, u_char *p,
+    u_char *tmp, ngx_str_t *name, ngx_str_t *value, ngx_uint_t indexed);
+static u_char *ngx_js_http_v2_write_int(u_char *p, ngx_uint_t prefix,
+    ngx_uint_t value);
+static u_char *ngx_js_http_v2_write_string(u_char *p, u_char *tmp,
+    ngx_str_t *str);
+static ngx_int_t ngx_js_http_v2_decode(ngx_js_http_v2_conn_t *conn,
+    u_char *p, u_char *end);
+static ngx_int_t ngx_js_http_v2_parse_int(u_char **pos, u_char *end,
+    ngx_uint_t prefix, ngx_uint_t *value);
+static ngx_int_t ngx_js_http_v2_parse_string(u_char **pos, u_char *end,
+    ngx_pool_t *pool, ngx_str_t *str);
+
+static ngx_int_t ngx_js_http_v2_table_find(ngx_js_http_v2_table_t *t,
+    ngx_str_t *name, ngx_str_t *value, ngx_uint_t *index);
+static ngx_int_t ngx_js_http_v2_table_get(ngx_js_http_v2_table_t *t,
+    ngx_uint_t index, ngx_js_http_v2_header_t *header);
+static ngx_int_t ngx_js_http_v2_table_add(ngx_js_http_v2_table_t *t,
+    ngx_str_t *name, ngx_str_t *value);
+static void ngx_js_http_v2_table_evict(ngx_js_http_v2_table_t *t,
+    size_t size);
+static void ngx_js_http_v2_table_free(ngx_js_http_v2_table_t *t);
+
+
+static ngx_queue_t  ngx_js_http_v2_conns;
+
+
+static ngx_js_http_v2_header_t  ngx_js_http_v2_static_table[] = {
+    { ngx_string(":authority"), ngx_string("") },
+    { ngx_string(":method"), ngx_string("GET") },
+    { ngx_string(":method"), ngx_string("POST") },
+    { ngx_string(":path"), ngx_string("/") },
+    { ngx_string(":path"), ngx_string("/index.html") },
+    { ngx_string(":scheme"), ngx_string("http") },
+    { ngx_string(":scheme"), ngx_string("https") },
+    { ngx_string(":status"), ngx_string("200") },
+    { ngx_string(":status"), ngx_string("204") },
+    { ngx_string(":status"), ngx_string("206") },
+    { ngx_string(":status"), ngx_string("304") },
+    { ngx_string(":status"), ngx_string("400") },
+    { ngx_string(":status"), ngx_string("404") },
+    { ngx_string(":status"), ngx_string("500") },
+    { ngx_string("accept-charset"), ngx_string("") },
+    { ngx_string("accept-encoding"), ngx_string("gzip, deflate") },
+    { ngx_string("accept-language"), ngx_string("") },
+    { ngx_string("accept-ranges"), ngx_string("") },
+    { ngx_string("accept"), ngx_string("") },
+    { ngx_string("access-control-allow-origin"), ngx_string("") },
+    { ngx_string("age"), ngx_string("") },
+    { ngx_string("allow"), ngx_string("") },
+    { ngx_string("authorization"), ngx_string("") },
+    { ngx_string("cache-control"), ngx_string("") },
+    { ngx_string("content-disposition"), ngx_string("") },
+    { ngx_string("content-encoding"), ngx_string("") },
+    { ngx_string("content-language"), ngx_string("") },
+    { ngx_string("content-length"), ngx_string("") },
+    { ngx_string("content-location"), ngx_string("") },
+    { ngx_string("content-range"), ngx_string("") },
+    { ngx_string("content-type"), ngx_string("") },
+    { ngx_string("cookie"), ngx_string("") },
+    { ngx_string("date"), ngx_string("") },
+    { ngx_string("etag"), ngx_string("") },
+    { ngx_string("expect"), ngx_string("") },
+    { ngx_string("expires"), ngx_string("") },
+    { ngx_string("from"), ngx_string("") },
+    { ngx_string("host"), ngx_string("") },
+    { ngx_string("if-match"), ngx_string("") },
+    { ngx_string("if-modified-since"), ngx_string("") },
+    { ngx_string("if-none-match"), ngx_string("") },
+    { ngx_string("if-range"), ngx_string("") },
+    { ngx_string("if-unmodified-since"), ngx_string("") },
+    { ngx_string("last-modified"), ngx_string("") },
+    { ngx_string("link"), ngx_string("") },
+    { ngx_string("location"), ngx_string("") },
+    { ngx_string("max-forwards"), ngx_string("") },
+    { ngx_string("proxy-authenticate"), ngx_string("") },
+    { ngx_string("proxy-authorization"), ngx_string("") },
+    { ngx_string("range"), ngx_string("") },
+    { ngx_string("referer"), ngx_string("") },
+    { ngx_string("refresh"), ngx_string("") },
+    { ngx_string("retry-after"), ngx_string("") },
+    { ngx_string("server"), ngx_string("") },
+    { ngx_string("set-cookie"), ngx_string("") },
+    { ngx_string("strict-transport-security"), ngx_string("") },
+    { ngx_string("transfer-encoding"), ngx_string("") },
+    { ngx_string("user-agent"), ngx_string("") },
+    { ngx_string("vary"), ngx_string("") },
+    { ngx_string("via"), ngx_string("") },
+    { ngx_string("www-authenticate"), ngx_string("") },
+};
+
+
+/* connection specific headers are not allowed in HTTP/2 */
+
+static ngx_str_t  ngx_js_http_v2_skip_headers[] = {
+    ngx_string("host"),
+    ngx_string("connection"),
+    ngx_string("keep-alive"),
+    ngx_string("proxy-connection"),
+    ngx_string("transfer-encoding"),
+    ngx_string("upgrade"),
+    ngx_null_string
+};
+
+
+#define ngx_js_http_v2_parse_uint32(p)                                        \
+    ((uint32_t) (p)[0] << 24 | (p)[1] << 16 | (p)[2] << 8 | (p)[3])
+
+#define ngx_js_http_v2_write_uint32(p, v)                                     \
+    ((p)[0] = (u_char) ((v) >> 24), (p)[1] = (u_char) ((v) >> 16),           \
+     (p)[2] = (u_char) ((v) >> 8), (p)[3] = (u_char) (v), (p) + 4)
+
+
+void
+ngx_js_http_v2_connect(ngx_js_http_t *http)
+{
+    ngx_int_t                 rc;
+    ngx_connection_t         *c;
+    ngx_js_http_v2_conn_t    *conn;
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ngx_pcalloc(http->pool, sizeof(ngx_js_http_v2_stream_t));
+    if (stream == NULL) {
+        ngx_js_http_error(http, "memory error");
+        return;
+    }
+
+    stream->http = http;
+    stream->event.data = stream;
+    stream->event.log = http->log;
+    stream->event.handler = ngx_js_http_v2_timeout_handler;
+
+    conn = ngx_js_http_v2_lookup(http);
+
+    if (conn != NULL) {
+        ngx_js_http_v2_attach(conn, stream);
+        return;
+    }
+
+    conn = ngx_js_http_v2_create(http);
+    if (conn == NULL) {
+        ngx_js_http_error(http, "memory error");
+        return;
+    }
+
+    rc = ngx_event_connect_peer(&conn->peer);
+
+    if (rc == NGX_ERROR) {
+        ngx_free(conn);
+        ngx_js_http_error(http, "connect failed");
+        return;
+    }
+
+    if (rc == NGX_BUSY || rc == NGX_DECLINED) {
+        ngx_free(conn);
+        ngx_js_http_next(http);
+        return;
+    }
+
+    c = conn->peer.connection;
+
+    c->pool = ngx_create_pool(128, ngx_cycle->log);
+    if (c->pool == NULL) {
+        ngx_js_http_v2_close_connection(c);
+        ngx_free(conn);
+        ngx_js_http_error(http, "memory error");
+        return;
+    }
+
+    c->data = conn;
+    c->write->handler = ngx_js_http_v2_write_handler;
+    c->read->handler = ngx_js_http_v2_read_handler;
+
+    ngx_add_timer(c->write, http->timeout);
+
+    if (ngx_js_http_v2_conns.next == NULL) {
+        ngx_queue_init(&ngx_js_http_v2_conns);
+    }
+
+    ngx_queue_insert_head(&ngx_js_http_v2_conns, &conn->queue);
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http2 connect: %p \"%V\"", conn, &conn->name);
+
+    ngx_js_http_v2_attach(conn, stream);
+
+    if (rc == NGX_OK) {
+        ngx_post_event(c->write, &ngx_posted_events);
+    }
+}
+
+
+void
+ngx_js_http_v2_close(ngx_js_http_t *http)
+{
+    ngx_js_http_v2_conn_t    *conn;
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = http->v2;
+    http->v2 = NULL;
+
+    if (stream->event.timer_set) {
+        ngx_del_timer(&stream->event);
+    }
+
+    if (stream->event.posted) {
+        ngx_delete_posted_event(&stream->event);
+    }
+
+    conn = stream->conn;
+
+    if (conn == NULL) {
+        return;
+    }
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http2 close stream: %p id:%uD", conn, stream->id);
+
+    if (stream->id != 0) {
+
+        /* the response is not complete, the peer stops sending it */
+
+        (void) ngx_js_http_v2_rst_stream(conn, stream->id,
+                                         NGX_JS_HTTP_V2_CANCEL);
+
+        ngx_post_event(conn->peer.connection->write, &ngx_posted_events);
+    }
+
+    ngx_js_http_v2_detach(stream);
+    ngx_js_http_v2_idle(conn);
+}
+
+
+static ngx_js_http_v2_conn_t *
+ngx_js_http_v2_lookup(ngx_js_http_t *http)
+{
+    ngx_queue_t            *q;
+    ngx_js_http_v2_conn_t  *conn;
+
+    if (ngx_js_http_v2_conns.next == NULL) {
+        return NULL;
+    }
+
+    for (q = ngx_queue_head(&ngx_js_http_v2_conns);
+         q != ngx_queue_sentinel(&ngx_js_http_v2_conns);
+         q = ngx_queue_next(q))
+    {
+        conn = ngx_queue_data(q, ngx_js_http_v2_conn_t, queue);
+
+        if (conn->nstreams >= conn->max_streams) {
+            continue;
+        }
+
+        if (ngx_cmp_sockaddr(&conn->sockaddr.sockaddr, conn->peer.socklen,
+                             http->peer.sockaddr, http->peer.socklen, 1)
+            != NGX_OK)
+        {
+            continue;
+        }
+
+#if (NGX_SSL)
+        if (conn->ssl != http->ssl) {
+            continue;
+        }
+
+        if (http->ssl != NULL
+            && (conn->ssl_verify != http->ssl_verify
+                || conn->tls_name.len != http->tls_name.len
+                || ngx_strncasecmp(conn->tls_name.data, http->tls_name.data,
+                                   http->tls_name.len)
+                   != 0))
+        {
+            continue;
+        }
+#endif
+
+        return conn;
+    }
+
+    return NULL;
+}
+
+
+static ngx_js_http_v2_conn_t *
+ngx_js_http_v2_create(ngx_js_http_t *http)
+{
+    size_t                  len;
+    ngx_js_http_v2_conn_t  *conn;
+
+    len = sizeof(ngx_js_http_v2_conn_t);
+
+#if (NGX_SSL)
+    len += http->tls_name.len + 1;
+#endif
+
+    conn = ngx_calloc(len, ngx_cycle->log);
+    if (conn == NULL) {
+        return NULL;
+    }
+
+    ngx_queue_init(&conn->streams);
+    ngx_queue_init(&conn->out);
+
+    ngx_memcpy(&conn->sockaddr, http->peer.sockaddr, http->peer.socklen);
+
+    conn->name.len = ngx_min(http->peer.name->len, NGX_SOCKADDR_STRLEN);
+    conn->name.data = conn->name_data;
+    ngx_memcpy(conn->name.data, http->peer.name->data, conn->name.len);
+
+    conn->peer.sockaddr = &conn->sockaddr.sockaddr;
+    conn->peer.socklen = http->peer.socklen;
+    conn->peer.name = &conn->name;
+    conn->peer.get = ngx_event_get_peer;
+    conn->peer.log = ngx_cycle->log;
+    conn->peer.log_error = NGX_ERROR_ERR;
+
+#if (NGX_SSL)
+    conn->ssl = http->ssl;
+    conn->ssl_verify = http->ssl_verify;
+    conn->tls_name.len = http->tls_name.len;
+    conn->tls_name.data = (u_char *) conn + sizeof(ngx_js_http_v2_conn_t);
+    ngx_memcpy(conn->tls_name.data, http->tls_name.data, http->tls_name.len);
+#endif
+
+    conn->max_streams = NGX_JS_HTTP_V2_MAX_STREAMS;
+    conn->next_id = 1;
+    conn->send_window = NGX_JS_HTTP_V2_DEFAULT_WINDOW;
+    conn->recv_window = NGX_JS_HTTP_V2_CONN_WINDOW;
+    conn->init_window = NGX_JS_HTTP_V2_DEFAULT_WINDOW;
+    conn->frame_size = NGX_JS_HTTP_V2_FRAME_SIZE;
+    conn->idle_timeout = http->keepalive_timeout;
+    conn->encoder.max_size = NGX_JS_HTTP_V2_TABLE_SIZE;
+    conn->decoder.max_size = NGX_JS_HTTP_V2_TABLE_SIZE;
+
+    return conn;
+}
+
+
+static void
+ngx_js_http_v2_attach(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream)
+{
+    ngx_msec_int_t     timer;
+    ngx_js_http_t     *http;
+    ngx_connection_t  *c;
+
+    http = stream->http;
+
+    stream->conn = conn;
+    http->v2 = stream;
+
+    ngx_queue_insert_tail(&conn->streams, &stream->queue);
+    conn->nstreams++;
+
+    /* a repeated stream keeps the deadline of the first attempt */
+
+    if (http->v2_retries == 0) {
+        http->v2_deadline = ngx_current_msec + http->timeout;
+    }
+
+    timer = (ngx_msec_int_t) (http->v2_deadline - ngx_current_msec);
+
+    ngx_add_timer(&stream->event, (timer > 0) ? (ngx_msec_t) timer : 1);
+
+    if (!conn->connected) {
+        return;
+    }
+
+    c = conn->peer.connection;
+
+    c->idle = 0;
+
+    if (c->read->timer_set) {
+        ngx_del_timer(c->read);
+    }
+
+    if (ngx_js_http_v2_start(conn, stream) != NGX_OK) {
+        ngx_js_http_v2_stream_post(stream, ngx_js_http_v2_error_handler,
+                                   "memory error");
+        return;
+    }
+
+    ngx_post_event(c->write, &ngx_posted_events);
+}
+
+
+static void
+ngx_js_http_v2_detach(ngx_js_http_v2_stream_t *stream)
+{
+    ngx_queue_remove(&stream->queue);
+    stream->conn->nstreams--;
+    stream->conn = NULL;
+}
+
+
+static void
+ngx_js_http_v2_idle(ngx_js_http_v2_conn_t *conn)
+{
+    ngx_connection_t  *c;
+
+    if (conn->nstreams != 0 || !conn->connected) {
+        return;
+    }
+
+    c = conn->peer.connection;
+
+    if (conn->goaway) {
+
+        /* the connection is closed by the read handler */
+
+        ngx_post_event(c->read, &ngx_posted_events);
+        return;
+    }
+
+    c->idle = 1;
+
+    ngx_add_timer(c->read, conn->idle_timeout);
+}
+
+
+static void
+ngx_js_http_v2_goaway(ngx_js_http_v2_conn_t *conn)
+{
+    if (conn->goaway) {
+        return;
+    }
+
+    /* no new streams are started on the connection */
+
+    conn->goaway = 1;
+    ngx_queue_remove(&conn->queue);
+}
+
+
+static void
+ngx_js_http_v2_close_conn(ngx_js_http_v2_conn_t *conn, const char *err,
+    ngx_event_handler_pt handler)
+{
+    ngx_queue_t              *q;
+    ngx_js_http_v2_frame_t   *f;
+    ngx_js_http_v2_stream_t  *stream;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, ngx_cycle->log, 0,
+                   "js http2 close connection: %p streams:%ui",
+                   conn, conn->nstreams);
+
+    ngx_js_http_v2_goaway(conn);
+
+    while (!ngx_queue_empty(&conn->streams)) {
+        q = ngx_queue_head(&conn->streams);
+        stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+
+        ngx_js_http_v2_stream_post(stream, handler, err);
+    }
+
+    while (!ngx_queue_empty(&conn->out)) {
+        q = ngx_queue_head(&conn->out);
+        ngx_queue_remove(q);
+
+        f = ngx_queue_data(q, ngx_js_http_v2_frame_t, queue);
+        ngx_free(f);
+    }
+
+    ngx_js_http_v2_table_free(&conn->encoder);
+    ngx_js_http_v2_table_free(&conn->decoder);
+
+    if (conn->buffer != NULL) {
+        ngx_free(conn->buffer);
+    }
+
+    if (conn->block != NULL) {
+        ngx_free(conn->block);
+    }
+
+    ngx_js_http_v2_close_connection(conn->peer.connection);
+
+    ngx_free(conn);
+}
+
+
+static void
+ngx_js_http_v2_close_connection(ngx_connection_t *c)
+{
+    ngx_pool_t  *pool;
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, c->log, 0,
+                   "js http2 close connection: %d", c->fd);
+
+#if (NGX_SSL)
+    if (c->ssl) {
+        c->ssl->no_wait_shutdown = 1;
+
+        if (ngx_ssl_shutdown(c) == NGX_AGAIN) {
+            c->ssl->handler = ngx_js_http_v2_close_connection;
+            return;
+        }
+    }
+#endif
+
+    pool = c->pool;
+
+    c->destroyed = 1;
+
+    ngx_close_connection(c);
+
+    if (pool != NULL) {
+        ngx_destroy_pool(pool);
+    }
+}
+
+
+#if (NGX_SSL)
+
+static void
+ngx_js_http_v2_ssl_init_connection(ngx_js_http_v2_conn_t *conn)
+{
+    ngx_int_t          rc;
+    ngx_str_t         *name;
+    ngx_connection_t  *c;
+
+    c = conn->peer.connection;
+
+    if (ngx_ssl_create_connection(conn->ssl, c, NGX_SSL_BUFFER|NGX_SSL_CLIENT)
+        != NGX_OK)
+    {
+        goto failed;
+    }
+
+    c->sendfile = 0;
+
+#ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
+    if (SSL_set_alpn_protos(c->ssl->connection,
+                            (u_char *) NGX_JS_HTTP_V2_ALPN,
+                            sizeof(NGX_JS_HTTP_V2_ALPN) - 1)
+        != 0)
+    {
+        goto failed;
+    }
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
+
+    /* as per RFC 6066, literal IPv4 and IPv6 addresses are not permitted */
+
+    name = &conn->tls_name;
+
+    if (name->len != 0
+        && *name->data != '['
+        && ngx_inet_addr(name->data, name->len) == INADDR_NONE)
+    {
+        /* the name is null-terminated in ngx_js_http_v2_create() */
+
+        if (SSL_set_tlsext_host_name(c->ssl->connection, (char *) name->data)
+            == 0)
+        {
+            goto failed;
+        }
+    }
+
+#else
+    (void) name;
+#endif
+
+    c->log->action = "SSL handshaking to http target";
+
+    rc = ngx_ssl_handshake(c);
+
+    if (rc == NGX_AGAIN) {
+        c->ssl->handler = ngx_js_http_v2_ssl_handshake;
+        return;
+    }
+
+    ngx_js_http_v2_ssl_handshake(c);
+
+    return;
+
+failed:
+
+    ngx_js_http_v2_close_conn(conn, "failed to create ssl connection",
+                              ngx_js_http_v2_error_handler);
+}
+
+
+static void
+ngx_js_http_v2_ssl_handshake(ngx_connection_t *c)
+{
+    long                    rc;
+    unsigned int            len;
+    const unsigned char    *data;
+    ngx_js_http_v2_conn_t  *conn;
+
+    conn = c->data;
+
+    c->write->handler = ngx_js_http_v2_write_handler;
+    c->read->handler = ngx_js_http_v2_read_handler;
+
+    if (!c->ssl->handshaked) {
+        goto failed;
+    }
+
+    if (conn->ssl_verify) {
+        rc = SSL_get_verify_result(c->ssl->connection);
+
+        if (rc != X509_V_OK) {
+            ngx_log_error(NGX_LOG_ERR, c->log, 0,
+                          "js http SSL certificate verify error: (%l:%s)",
+                          rc, X509_verify_cert_error_string(rc));
+            goto failed;
+        }
+
+        if (ngx_ssl_check_host(c, &conn->tls_name) != NGX_OK) {
+            ngx_log_error(NGX_LOG_ERR, c->log, 0,
+                          "js http SSL certificate does not match \"%V\"",
+                          &conn->tls_name);
+            goto failed;
+        }
+    }
+
+    len = 0;
+
+#ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
+    SSL_get0_alpn_selected(c->ssl->connection, &data, &len);
+#else
+    data = NULL;
+#endif
+
+    if (len != 2 || ngx_memcmp(data, "h2", 2) != 0) {
+
+        /* the peer does not support HTTP/2, HTTP/1.1 is used instead */
+
+        ngx_log_debug0(NGX_LOG_DEBUG_EVENT, c->log, 0,
+                       "js http2 is not negotiated");
+
+        ngx_js_http_v2_close_conn(conn, NULL, ngx_js_http_v2_http1_handler);
+        return;
+    }
+
+    ngx_js_http_v2_write_handler(c->write);
+
+    return;
+
+failed:
+
+    ngx_js_http_v2_close_conn(conn, NULL, ngx_js_http_v2_next_handler);
+}
+
+#endif
+
+
+static ngx_int_t
+ngx_js_http_v2_init(ngx_js_http_v2_conn_t *conn)
+{
+    u_char                   *p;
+    ngx_queue_t              *q, *next;
+    ngx_js_http_v2_stream_t  *stream;
+
+    conn->buffer = ngx_alloc(NGX_JS_HTTP_V2_BUFFER_SIZE, ngx_cycle->log);
+    if (conn->buffer == NULL) {
+        return NGX_ERROR;
+    }
+
+    p = ngx_js_http_v2_frame(conn, sizeof(NGX_JS_HTTP_V2_PREFACE) - 1
+                                   + NGX_JS_HTTP_V2_FRAME_HEADER + 2 * 6
+                                   + NGX_JS_HTTP_V2_FRAME_HEADER + 4);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    p = ngx_cpymem(p, NGX_JS_HTTP_V2_PREFACE,
+                   sizeof(NGX_JS_HTTP_V2_PREFACE) - 1);
+
+    p = ngx_js_http_v2_frame_head(p, 2 * 6, NGX_JS_HTTP_V2_SETTINGS, 0, 0);
+
+    *p++ = 0;
+    *p++ = NGX_JS_HTTP_V2_ENABLE_PUSH;
+    p = ngx_js_http_v2_write_uint32(p, 0);
+
+    *p++ = 0;
+    *p++ = NGX_JS_HTTP_V2_INITIAL_WINDOW_SIZE;
+    p = ngx_js_http_v2_write_uint32(p, NGX_JS_HTTP_V2_STREAM_WINDOW);
+
+    p = ngx_js_http_v2_frame_head(p, 4, NGX_JS_HTTP_V2_WINDOW_UPDATE, 0, 0);
+    (void) ngx_js_http_v2_write_uint32(p, NGX_JS_HTTP_V2_CONN_WINDOW
+                                          - NGX_JS_HTTP_V2_DEFAULT_WINDOW);
+
+    conn->connected = 1;
+
+    for (q = ngx_queue_head(&conn->streams);
+         q != ngx_queue_sentinel(&conn->streams);
+         q = next)
+    {
+        next = ngx_queue_next(q);
+        stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+
+        if (ngx_js_http_v2_start(conn, stream) != NGX_OK) {
+            ngx_js_http_v2_stream_post(stream, ngx_js_http_v2_error_handler,
+                                       "memory error");
+        }
+    }
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_start(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream)
+{
+    u_char         *text, *end, *p, *q, *line, *colon, *block, *b, *tmp;
+    size_t          size, len;
+    ssize_t         n;
+    ngx_str_t       name, value, method, path, authority, *skip;
+    ngx_uint_t      flags, type;
+    ngx_js_http_t  *http;
+
+    static ngx_str_t  method_name = ngx_string(":method");
+    static ngx_str_t  scheme_name = ngx_string(":scheme");
+    static ngx_str_t  path_name = ngx_string(":path");
+    static ngx_str_t  authority_name = ngx_string(":authority");
+    static ngx_str_t  http_scheme = ngx_string("http");
+    static ngx_str_t  https_scheme = ngx_string("https");
+
+    http = stream->http;
+
+    /*
+     * the request is converted from the prepared HTTP/1.1 request header,
+     * the chain is kept intact as the request may be repeated
+     */
+
+    n = njs_chb_size(&http->chain);
+    if (n < 0) {
+        return NGX_ERROR;
+    }
+
+    size = n;
+
+    text = ngx_pnalloc(http->pool, size * 4 + 128);
+    if (text == NULL) {
+        return NGX_ERROR;
+    }
+
+    njs_chb_join_to(&http->chain, text);
+
+    end = text + size;
+
+    /* header block and huffman encoding scratch space */
+
+    block = text + size;
+    tmp = block + size * 2 + 128;
+
+    p = ngx_strlchr(text, end, ' ');
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    method.data = text;
+    method.len = p - text;
+
+    path.data = p + 1;
+    p = ngx_strlchr(path.data, end, ' ');
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    path.len = p - path.data;
+
+    line = ngx_strlchr(p, end, LF);
+    if (line == NULL) {
+        return NGX_ERROR;
+    }
+
+    line++;
+
+    ngx_str_null(&authority);
+
+    for (p = line; p < end; p = q + 1) {
+        q = ngx_strlchr(p, end, LF);
+        if (q == NULL) {
+            return NGX_ERROR;
+        }
+
+        if (q - p > 5 && ngx_strncasecmp(p, (u_char *) "Host:", 5) == 0) {
+            authority.data = p + 5;
+
+            while (*authority.data == ' ') {
+                authority.data++;
+            }
+
+            authority.len = q - 1 - authority.data;
+            break;
+        }
+    }
+
+    b = block;
+
+    if (conn->size_update) {
+        conn->size_update = 0;
+
+        *b = 0x20;
+        b = ngx_js_http_v2_write_int(b, 0x1f, conn->encoder.max_size);
+    }
+
+    b = ngx_js_http_v2_encode(conn, b, tmp, &method_name, &method, 1);
+
+#if (NGX_SSL)
+    b = ngx_js_http_v2_encode(conn, b, tmp, &scheme_name,
+                              (http->ssl != NULL) ? &https_scheme
+                                                  : &http_scheme, 1);
+#else
+    b = ngx_js_http_v2_encode(conn, b, tmp, &scheme_name, &http_scheme, 1);
+#endif
+
+    b = ngx_js_http_v2_encode(conn, b, tmp, &path_name, &path, 0);
+    b = ngx_js_http_v2_encode(conn, b, tmp, &authority_name, &authority, 1);
+
+    for (p = line; p < end; p = line) {
+        line = ngx_strlchr(p, end, LF);
+        if (line == NULL) {
+            return NGX_ERROR;
+        }
+
+        line++;
+
+        if (*p == CR) {
+            break;
+        }
+
+        colon = ngx_strlchr(p, line, ':');
+        if (colon == NULL) {
+            return NGX_ERROR;
+        }
+
+        name.data = p;
+        name.len = colon - p;
+
+        ngx_strlow(name.data, name.data, name.len);
+
+        for (skip = ngx_js_http_v2_skip_headers; skip->len != 0; skip++) {
+            if (skip->len == name.len
+                && ngx_strncmp(skip->data, name.data, name.len) == 0)
+            {
+                break;
+            }
+        }
+
+        if (skip->len != 0) {
+            continue;
+        }
+
+        value.data = colon + 1;
+
+        while (*value.data == ' ') {
+            value.data++;
+        }
+
+        value.len = line - 2 - value.data;
+
+        b = ngx_js_http_v2_encode(conn, b, tmp, &name, &value,
+                                  !(name.len == 14
+                                    && ngx_strncmp(name.data,
+                                                   "content-length", 14)
+                                       == 0));
+    }
+
+    if (b == NULL) {
+        return NGX_ERROR;
+    }
+
+    stream->id = conn->next_id;
+    conn->next_id += 2;
+
+    if (conn->next_id > NGX_JS_HTTP_V2_MAX_ID) {
+        ngx_js_http_v2_goaway(conn);
+    }
+
+    stream->send_window = conn->init_window;
+    stream->recv_window = NGX_JS_HTTP_V2_STREAM_WINDOW;
+
+    ngx_log_debug3(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http2 start stream: %p id:%uD block:%uz",
+                   conn, stream->id, (size_t) (b - block));
+
+    /* the header block is split into HEADERS and CONTINUATION frames */
+
+    type = NGX_JS_HTTP_V2_HEADERS;
+    p = block;
+
+    do {
+        len = ngx_min((size_t) (b - p), conn->frame_size);
+
+        flags = (p + len == b) ? NGX_JS_HTTP_V2_END_HEADERS : 0;
+
+        if (type == NGX_JS_HTTP_V2_HEADERS && http->body.len == 0) {
+            flags |= NGX_JS_HTTP_V2_END_STREAM;
+        }
+
+        line = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER + len);
+        if (line == NULL) {
+            return NGX_ERROR;
+        }
+
+        line = ngx_js_http_v2_frame_head(line, len, type, flags, stream->id);
+        ngx_memcpy(line, p, len);
+
+        p += len;
+        type = NGX_JS_HTTP_V2_CONTINUATION;
+
+    } while (p < b);
+
+    if (http->body.len == 0) {
+        stream->end_stream = 1;
+        return NGX_OK;
+    }
+
+    return ngx_js_http_v2_send_data(conn, stream);
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_send_data(ngx_js_http_v2_conn_t *conn,
+    ngx_js_http_v2_stream_t *stream)
+{
+    u_char         *p;
+    size_t          size;
+    ngx_uint_t      flags;
+    ngx_js_http_t  *http;
+
+    http = stream->http;
+
+    /* the request body is sent as the flow control windows allow */
+
+    while (!stream->end_stream) {
+        size = http->body.len - stream->sent;
+        size = ngx_min(size, conn->frame_size);
+
+        if (stream->send_window <= 0 || conn->send_window <= 0) {
+            break;
+        }
+
+        size = ngx_min(size, (size_t) stream->send_window);
+        size = ngx_min(size, (size_t) conn->send_window);
+
+        flags = (stream->sent + size == http->body.len)
+                ? NGX_JS_HTTP_V2_END_STREAM : 0;
+
+        p = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER + size);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
+
+        p = ngx_js_http_v2_frame_head(p, size, NGX_JS_HTTP_V2_DATA, flags,
+                                      stream->id);
+        ngx_memcpy(p, http->body.data + stream->sent, size);
+
+        stream->sent += size;
+        stream->send_window -= size;
+        conn->send_window -= size;
+
+        if (flags & NGX_JS_HTTP_V2_END_STREAM) {
+            stream->end_stream = 1;
+        }
+    }
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_js_http_v2_resume(ngx_js_http_v2_conn_t *conn)
+{
+    ngx_queue_t              *q, *next;
+    ngx_js_http_v2_stream_t  *stream;
+
+    for (q = ngx_queue_head(&conn->streams);
+         q != ngx_queue_sentinel(&conn->streams);
+         q = next)
+    {
+        next = ngx_queue_next(q);
+        stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+
+        if (stream->id == 0 || stream->end_stream) {
+            continue;
+        }
+
+        if (ngx_js_http_v2_send_data(conn, stream) != NGX_OK) {
+            ngx_js_http_v2_stream_post(stream, ngx_js_http_v2_error_handler,
+                                       "memory error");
+        }
+    }
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_send(ngx_js_http_v2_conn_t *conn)
+{
+    ssize_t                  n;
+    ngx_queue_t             *q;
+    ngx_connection_t        *c;
+    ngx_js_http_v2_frame_t  *f;
+
+    c = conn->peer.connection;
+
+    while (!ngx_queue_empty(&conn->out)) {
+        q = ngx_queue_head(&conn->out);
+        f = ngx_queue_data(q, ngx_js_http_v2_frame_t, queue);
+
+        n = c->send(c, f->pos, f->last - f->pos);
+
+        if (n == NGX_ERROR) {
+            return NGX_ERROR;
+        }
+
+        if (n == NGX_AGAIN) {
+            break;
+        }
+
+        f->pos += n;
+
+        if (f->pos == f->last) {
+            ngx_queue_remove(q);
+            ngx_free(f);
+        }
+    }
+
+    if (ngx_handle_write_event(c->write, 0) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_js_http_v2_write_handler(ngx_event_t *wev)
+{
+    ngx_connection_t       *c;
+    ngx_js_http_v2_conn_t  *conn;
+
+    c = wev->data;
+    conn = c->data;
+
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, wev->log, 0,
+                   "js http2 write handler");
+
+    if (wev->timedout) {
+        ngx_js_http_v2_close_conn(conn, NULL, ngx_js_http_v2_next_handler);
+        return;
+    }
+
+    if (wev->timer_set) {
+        ngx_del_timer(wev);
+    }
+
+    if (!conn->connected) {
+
+#if (NGX_SSL)
+        if (conn->ssl != NULL && c->ssl == NULL) {
+            ngx_js_http_v2_ssl_init_connection(conn);
+            return;
+        }
+#endif
+
+        if (ngx_js_http_v2_init(conn) != NGX_OK) {
+            ngx_js_http_v2_close_conn(conn, "memory error",
+                                      ngx_js_http_v2_error_handler);
+            return;
+        }
+
+        if (c->read->ready) {
+            ngx_post_event(c->read, &ngx_posted_events);
+        }
+    }
+
+    if (ngx_js_http_v2_send(conn) != NGX_OK) {
+        ngx_js_http_v2_close_conn(conn, "write failed",
+                                  ngx_js_http_v2_error_handler);
+    }
+}
+
+
+static void
+ngx_js_http_v2_read_handler(ngx_event_t *rev)
+{
+    ssize_t                 n;
+    ngx_connection_t       *c;
+    ngx_js_http_v2_conn_t  *conn;
+
+    c = rev->data;
+    conn = c->data;
+
+    ngx_log_debug0(NGX_LOG_DEBUG_EVENT, rev->log, 0, "js http2 read handler");
+
+    if (!conn->connected) {
+        return;
+    }
+
+    if (c->close || rev->timedout) {
+        c->close = 0;
+        rev->timedout = 0;
+
+        ngx_js_http_v2_goaway(conn);
+    }
+
+    for ( ;; ) {
+        n = c->recv(c, conn->buffer + conn->len,
+                    NGX_JS_HTTP_V2_BUFFER_SIZE - conn->len);
+
+        if (n == NGX_AGAIN) {
+            break;
+        }
+
+        if (n == NGX_ERROR || n == 0) {
+            ngx_js_http_v2_close_conn(conn, "connection closed",
+                                      ngx_js_http_v2_error_handler);
+            return;
+        }
+
+        conn->len += n;
+
+        if (ngx_js_http_v2_process(conn) != NGX_OK) {
+            ngx_js_http_v2_close_conn(conn, "invalid http2 response",
+                                      ngx_js_http_v2_error_handler);
+            return;
+        }
+    }
+
+    if (conn->goaway && conn->nstreams == 0) {
+        ngx_js_http_v2_close_conn(conn, NULL, NULL);
+        return;
+    }
+
+    if (ngx_js_http_v2_send(conn) != NGX_OK
+        || ngx_handle_read_event(rev, 0) != NGX_OK)
+    {
+        ngx_js_http_v2_close_conn(conn, "read failed",
+                                  ngx_js_http_v2_error_handler);
+    }
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process(ngx_js_http_v2_conn_t *conn)
+{
+    u_char  *p, *end;
+    size_t   len;
+
+    p = conn->buffer;
+    end = p + conn->len;
+
+    while (end - p >= NGX_JS_HTTP_V2_FRAME_HEADER) {
+        len = (p[0] << 16) | (p[1] << 8) | p[2];
+
+        if (len > NGX_JS_HTTP_V2_FRAME_SIZE) {
+            return NGX_ERROR;
+        }
+
+        if ((size_t) (end - p) < NGX_JS_HTTP_V2_FRAME_HEADER + len) {
+            break;
+        }
+
+        if (ngx_js_http_v2_process_frame(conn, p) != NGX_OK) {
+            return NGX_ERROR;
+        }
+
+        p += NGX_JS_HTTP_V2_FRAME_HEADER + len;
+    }
+
+    conn->len = end - p;
+
+    if (conn->len != 0 && p != conn->buffer) {
+        ngx_memmove(conn->buffer, p, conn->len);
+    }
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process_frame(ngx_js_http_v2_conn_t *conn, u_char *p)
+{
+    u_char                   *pos, *end;
+    size_t                    len;
+    uint32_t                  sid, value;
+    ngx_uint_t                type, flags;
+    ngx_js_http_v2_stream_t  *stream;
+
+    len = (p[0] << 16) | (p[1] << 8) | p[2];
+    type = p[3];
+    flags = p[4];
+    sid = ngx_js_http_v2_parse_uint32(&p[5]) & NGX_JS_HTTP_V2_MAX_ID;
+
+    pos = p + NGX_JS_HTTP_V2_FRAME_HEADER;
+    end = pos + len;
+
+    ngx_log_debug4(NGX_LOG_DEBUG_EVENT, ngx_cycle->log, 0,
+                   "js http2 frame type:%ui flags:%ui sid:%uD len:%uz",
+                   type, flags, sid, len);
+
+    if (conn->continuation
+        && (type != NGX_JS_HTTP_V2_CONTINUATION || sid != conn->block_sid))
+    {
+        return NGX_ERROR;
+    }
+
+    switch (type) {
+
+    case NGX_JS_HTTP_V2_DATA:
+    case NGX_JS_HTTP_V2_HEADERS:
+
+        if (sid == 0) {
+            return NGX_ERROR;
+        }
+
+        if (flags & NGX_JS_HTTP_V2_PADDED) {
+            if (len == 0 || *pos >= len) {
+                return NGX_ERROR;
+            }
+
+            end -= *pos++;
+        }
+
+        if (type == NGX_JS_HTTP_V2_DATA) {
+            return ngx_js_http_v2_process_data(conn, sid, flags, pos, end,
+                                               len);
+        }
+
+        if (flags & NGX_JS_HTTP_V2_PRIORITY) {
+            if (end - pos < 5) {
+                return NGX_ERROR;
+            }
+
+            pos += 5;
+        }
+
+        conn->block_sid = sid;
+        conn->block_len = 0;
+        conn->block_end_stream = (flags & NGX_JS_HTTP_V2_END_STREAM) ? 1 : 0;
+
+        return ngx_js_http_v2_process_block(conn, flags, pos, end);
+
+    case NGX_JS_HTTP_V2_CONTINUATION:
+
+        if (!conn->continuation) {
+            return NGX_ERROR;
+        }
+
+        return ngx_js_http_v2_process_block(conn, flags, pos, end);
+
+    case NGX_JS_HTTP_V2_RST_STREAM:
+
+        if (len != 4 || sid == 0) {
+            return NGX_ERROR;
+        }
+
+        stream = ngx_js_http_v2_find(conn, sid);
+        if (stream == NULL) {
+            return NGX_OK;
+        }
+
+        value = ngx_js_http_v2_parse_uint32(pos);
+
+        if (value == NGX_JS_HTTP_V2_REFUSED_STREAM) {
+            ngx_js_http_v2_stream_post(stream,
+                                       ngx_js_http_v2_reconnect_handler,
+                                       NULL);
+            return NGX_OK;
+        }
+
+        ngx_js_http_v2_stream_error(stream, "http2 stream reset", 0);
+
+        return NGX_OK;
+
+    case NGX_JS_HTTP_V2_SETTINGS:
+
+        if (sid != 0) {
+            return NGX_ERROR;
+        }
+
+        if (flags & NGX_JS_HTTP_V2_ACK) {
+            return (len == 0) ? NGX_OK : NGX_ERROR;
+        }
+
+        return ngx_js_http_v2_process_settings(conn, pos, end);
+
+    case NGX_JS_HTTP_V2_PING:
+
+        if (len != 8 || sid != 0) {
+            return NGX_ERROR;
+        }
+
+        if (flags & NGX_JS_HTTP_V2_ACK) {
+            return NGX_OK;
+        }
+
+        p = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER + 8);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
+
+        p = ngx_js_http_v2_frame_head(p, 8, NGX_JS_HTTP_V2_PING,
+                                      NGX_JS_HTTP_V2_ACK, 0);
+        ngx_memcpy(p, pos, 8);
+
+        return NGX_OK;
+
+    case NGX_JS_HTTP_V2_GOAWAY:
+
+        if (len < 8 || sid != 0) {
+            return NGX_ERROR;
+        }
+
+        ngx_js_http_v2_process_goaway(conn,
+                                      ngx_js_http_v2_parse_uint32(pos)
+                                      & NGX_JS_HTTP_V2_MAX_ID);
+        return NGX_OK;
+
+    case NGX_JS_HTTP_V2_WINDOW_UPDATE:
+
+        if (len != 4) {
+            return NGX_ERROR;
+        }
+
+        value = ngx_js_http_v2_parse_uint32(pos) & NGX_JS_HTTP_V2_MAX_ID;
+
+        if (sid == 0) {
+            if (conn->send_window + (ssize_t) value
+                > NGX_JS_HTTP_V2_MAX_WINDOW)
+            {
+                return NGX_ERROR;
+            }
+
+            conn->send_window += value;
+
+        } else {
+            stream = ngx_js_http_v2_find(conn, sid);
+            if (stream == NULL) {
+                return NGX_OK;
+            }
+
+            stream->send_window += value;
+        }
+
+        ngx_js_http_v2_resume(conn);
+
+        return NGX_OK;
+
+    case NGX_JS_HTTP_V2_PUSH_PROMISE:
+
+        /* server push is disabled in the initial settings */
+
+        return NGX_ERROR;
+
+    default:
+
+        /* PRIORITY and unknown frames are ignored */
+
+        return NGX_OK;
+    }
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process_data(ngx_js_http_v2_conn_t *conn, uint32_t sid,
+    ngx_uint_t flags, u_char *pos, u_char *end, size_t len)
+{
+    ssize_t                   size;
+    ngx_js_http_t            *http;
+    ngx_js_http_v2_stream_t  *stream;
+
+    /* the flow control windows account the padding as well */
+
+    conn->recv_window -= len;
+
+    if (conn->recv_window < NGX_JS_HTTP_V2_CONN_WINDOW / 2) {
+        if (ngx_js_http_v2_window_update(conn, 0, NGX_JS_HTTP_V2_CONN_WINDOW
+                                                  - conn->recv_window)
+            != NGX_OK)
+        {
+            return NGX_ERROR;
+        }
+
+        conn->recv_window = NGX_JS_HTTP_V2_CONN_WINDOW;
+    }
+
+    stream = ngx_js_http_v2_find(conn, sid);
+    if (stream == NULL) {
+        return NGX_OK;
+    }
+
+    http = stream->http;
+
+    if (!stream->headers) {
+        ngx_js_http_v2_stream_error(stream, "invalid http2 response", 1);
+        return NGX_OK;
+    }
+
+    size = njs_chb_size(&http->response.chain);
+    if (size < 0) {
+        ngx_js_http_v2_stream_error(stream, "memory error", 1);
+        return NGX_OK;
+    }
+
+    if (http->zstream == NULL
+        && size + (end - pos) > http->max_response_body_size)
+    {
+        ngx_js_http_v2_stream_error(stream, "http response body is too large",
+                                    1);
+        return NGX_OK;
+    }
+
+    if (pos != end
+        && ngx_js_http_append_body(http, pos, end - pos) != NGX_OK)
+    {
+        /* the stream is reset as the fetch is finalized */
+
+        return NGX_OK;
+    }
+
+    if (flags & NGX_JS_HTTP_V2_END_STREAM) {
+        ngx_js_http_v2_stream_done(stream);
+        return NGX_OK;
+    }
+
+    stream->recv_window -= len;
+
+    if (stream->recv_window < NGX_JS_HTTP_V2_STREAM_WINDOW / 2) {
+        if (ngx_js_http_v2_window_update(conn, sid,
+                                         NGX_JS_HTTP_V2_STREAM_WINDOW
+                                         - stream->recv_window)
+            != NGX_OK)
+        {
+            return NGX_ERROR;
+        }
+
+        stream->recv_window = NGX_JS_HTTP_V2_STREAM_WINDOW;
+    }
+
+    ngx_add_timer(&stream->event, http->timeout);
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process_block(ngx_js_http_v2_conn_t *conn, ngx_uint_t flags,
+    u_char *pos, u_char *end)
+{
+    u_char  *p;
+    size_t   len, size;
+
+    len = end - pos;
+
+    if (flags & NGX_JS_HTTP_V2_END_HEADERS) {
+        conn->continuation = 0;
+
+        if (conn->block_len == 0) {
+
+            /* the whole header block is in a single frame */
+
+            return ngx_js_http_v2_decode(conn, pos, end);
+        }
+
+    } else {
+        conn->continuation = 1;
+    }
+
+    if (conn->block_len + len > NGX_JS_HTTP_V2_MAX_BLOCK) {
+        return NGX_ERROR;
+    }
+
+    if (conn->block_len + len > conn->block_size) {
+        size = ngx_max(conn->block_size * 2, conn->block_len + len);
+
+        p = ngx_alloc(size, ngx_cycle->log);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
+
+        if (conn->block != NULL) {
+            ngx_memcpy(p, conn->block, conn->block_len);
+            ngx_free(conn->block);
+        }
+
+        conn->block = p;
+        conn->block_size = size;
+    }
+
+    ngx_memcpy(conn->block + conn->block_len, pos, len);
+    conn->block_len += len;
+
+    if (conn->continuation) {
+        return NGX_OK;
+    }
+
+    return ngx_js_http_v2_process_headers(conn);
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process_headers(ngx_js_http_v2_conn_t *conn)
+{
+    size_t  len;
+
+    len = conn->block_len;
+    conn->block_len = 0;
+
+    return ngx_js_http_v2_decode(conn, conn->block, conn->block + len);
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_process_settings(ngx_js_http_v2_conn_t *conn, u_char *pos,
+    u_char *end)
+{
+    u_char                   *p;
+    ssize_t                   delta;
+    uint32_t                  value;
+    ngx_uint_t                id;
+    ngx_queue_t              *q;
+    ngx_js_http_v2_stream_t  *stream;
+
+    if ((end - pos) % 6 != 0) {
+        return NGX_ERROR;
+    }
+
+    for (p = pos; p < end; p += 6) {
+        id = (p[0] << 8) | p[1];
+        value = ngx_js_http_v2_parse_uint32(&p[2]);
+
+        switch (id) {
+
+        case NGX_JS_HTTP_V2_HEADER_TABLE_SIZE:
+
+            if (value < conn->encoder.max_size) {
+                ngx_js_http_v2_table_evict(&conn->encoder, value);
+                conn->encoder.max_size = value;
+                conn->size_update = 1;
+            }
+
+            break;
+
+        case NGX_JS_HTTP_V2_MAX_CONCURRENT_STREAMS:
+            conn->max_streams = value;
+            break;
+
+        case NGX_JS_HTTP_V2_INITIAL_WINDOW_SIZE:
+
+            if (value > NGX_JS_HTTP_V2_MAX_WINDOW) {
+                return NGX_ERROR;
+            }
+
+            delta = (ssize_t) value - (ssize_t) conn->init_window;
+            conn->init_window = value;
+
+            for (q = ngx_queue_head(&conn->streams);
+                 q != ngx_queue_sentinel(&conn->streams);
+                 q = ngx_queue_next(q))
+            {
+                stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+                stream->send_window += delta;
+            }
+
+            break;
+
+        case NGX_JS_HTTP_V2_MAX_FRAME_SIZE_SETTING:
+
+            if (value < NGX_JS_HTTP_V2_FRAME_SIZE
+                || value > NGX_JS_HTTP_V2_MAX_FRAME_SIZE)
+            {
+                return NGX_ERROR;
+            }
+
+            conn->frame_size = value;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    p = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    (void) ngx_js_http_v2_frame_head(p, 0, NGX_JS_HTTP_V2_SETTINGS,
+                                     NGX_JS_HTTP_V2_ACK, 0);
+
+    ngx_js_http_v2_resume(conn);
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_js_http_v2_process_goaway(ngx_js_http_v2_conn_t *conn, uint32_t last_id)
+{
+    ngx_queue_t              *q, *next;
+    ngx_js_http_v2_stream_t  *stream;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, ngx_cycle->log, 0,
+                   "js http2 goaway: %p last:%uD", conn, last_id);
+
+    ngx_js_http_v2_goaway(conn);
+
+    /* the streams not processed by the peer are repeated */
+
+    for (q = ngx_queue_head(&conn->streams);
+         q != ngx_queue_sentinel(&conn->streams);
+         q = next)
+    {
+        next = ngx_queue_next(q);
+        stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+
+        if (stream->id > last_id) {
+            ngx_js_http_v2_stream_post(stream,
+                                       ngx_js_http_v2_reconnect_handler,
+                                       NULL);
+        }
+    }
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_header(ngx_js_http_v2_stream_t *stream, ngx_str_t *name,
+    ngx_str_t *value)
+{
+    off_t           length;
+    ngx_int_t       code;
+    ngx_js_http_t  *http;
+
+    http = stream->http;
+
+    if (name->len == 7 && ngx_strncmp(name->data, ":status", 7) == 0) {
+        code = ngx_atoi(value->data, value->len);
+
+        if (value->len != 3 || code < 100) {
+            stream->error = "invalid http status line";
+            return NGX_ERROR;
+        }
+
+        http->response.code = code;
+        ngx_str_set(&http->response.status_text, "");
+
+        return NGX_OK;
+    }
+
+    if (name->len == 0 || name->data[0] == ':') {
+        return NGX_OK;
+    }
+
+    if (http->response.code < 200) {
+
+        /* informational response */
+
+        return NGX_OK;
+    }
+
+    if (http->response.headers.header_list.size == 0) {
+        if (ngx_list_init(&http->response.headers.header_list, http->pool, 4,
+                          sizeof(ngx_js_tb_elt_t))
+            != NGX_OK)
+        {
+            stream->error = "alloc failed";
+            return NGX_ERROR;
+        }
+    }
+
+    if (http->append_headers(http, &http->response.headers, name->data,
+                             name->len, value->data, value->len)
+        == NGX_ERROR)
+    {
+        stream->error = "cannot add response header";
+        return NGX_ERROR;
+    }
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http2 header \"%V: %V\"", name, value);
+
+    if (name->len == 16
+        && ngx_strncmp(name->data, "content-encoding", 16) == 0
+        && ngx_js_http_content_encoding(http, value->data, value->len)
+           != NGX_OK)
+    {
+        stream->error = "memory error";
+        return NGX_ERROR;
+    }
+
+    if (name->len == 14 && ngx_strncmp(name->data, "content-length", 14) == 0) {
+        length = ngx_atoof(value->data, value->len);
+
+        if (length == NGX_ERROR) {
+            stream->error = "invalid http content length";
+            return NGX_ERROR;
+        }
+
+        if (!http->header_only && length > http->max_response_body_size) {
+            stream->error = "http content length is too large";
+            return NGX_ERROR;
+        }
+    }
+
+    return NGX_OK;
+}
+
+
+static ngx_js_http_v2_stream_t *
+ngx_js_http_v2_find(ngx_js_http_v2_conn_t *conn, uint32_t sid)
+{
+    ngx_queue_t              *q;
+    ngx_js_http_v2_stream_t  *stream;
+
+    for (q = ngx_queue_head(&conn->streams);
+         q != ngx_queue_sentinel(&conn->streams);
+         q = ngx_queue_next(q))
+    {
+        stream = ngx_queue_data(q, ngx_js_http_v2_stream_t, queue);
+
+        if (stream->id == sid) {
+            return stream;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void
+ngx_js_http_v2_stream_done(ngx_js_http_v2_stream_t *stream)
+{
+    ngx_js_http_t          *http;
+    ngx_js_http_v2_conn_t  *conn;
+
+    http = stream->http;
+    conn = stream->conn;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, http->log, 0,
+                   "js http2 stream done: %p id:%uD", conn, stream->id);
+
+    if (stream->event.timer_set) {
+        ngx_del_timer(&stream->event);
+    }
+
+    ngx_js_http_v2_detach(stream);
+    ngx_js_http_v2_idle(conn);
+
+    http->done = 1;
+
+    ngx_js_http_ready(http);
+}
+
+
+static void
+ngx_js_http_v2_stream_error(ngx_js_http_v2_stream_t *stream, const char *err,
+    ngx_uint_t reset)
+{
+    ngx_js_http_v2_conn_t  *conn;
+
+    conn = stream->conn;
+
+    if (stream->event.timer_set) {
+        ngx_del_timer(&stream->event);
+    }
+
+    if (reset && stream->id != 0) {
+        (void) ngx_js_http_v2_rst_stream(conn, stream->id,
+                                         NGX_JS_HTTP_V2_CANCEL);
+
+        ngx_post_event(conn->peer.connection->write, &ngx_posted_events);
+    }
+
+    ngx_js_http_v2_detach(stream);
+    ngx_js_http_v2_idle(conn);
+
+    ngx_js_http_error(stream->http, "%s", err);
+}
+
+
+static void
+ngx_js_http_v2_stream_post(ngx_js_http_v2_stream_t *stream,
+    ngx_event_handler_pt handler, const char *err)
+{
+    /*
+     * the stream owner is notified from a posted event
+     * as the handlers may finalize the request
+     */
+
+    ngx_js_http_v2_detach(stream);
+
+    if (stream->event.timer_set) {
+        ngx_del_timer(&stream->event);
+    }
+
+    stream->error = err;
+    stream->event.handler = handler;
+
+    ngx_post_event(&stream->event, &ngx_posted_events);
+}
+
+
+static void
+ngx_js_http_v2_timeout_handler(ngx_event_t *ev)
+{
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ev->data;
+
+    ngx_js_http_v2_stream_error(stream, "read timed out", 1);
+}
+
+
+static void
+ngx_js_http_v2_error_handler(ngx_event_t *ev)
+{
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ev->data;
+
+    ngx_js_http_error(stream->http, "%s", stream->error);
+}
+
+
+static void
+ngx_js_http_v2_next_handler(ngx_event_t *ev)
+{
+    ngx_js_http_t            *http;
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ev->data;
+    http = stream->http;
+
+    http->v2 = NULL;
+
+    ngx_js_http_next(http);
+}
+
+
+static void
+ngx_js_http_v2_reconnect_handler(ngx_event_t *ev)
+{
+    ngx_js_http_t            *http;
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ev->data;
+    http = stream->http;
+
+    if (++http->v2_retries > NGX_JS_HTTP_V2_MAX_RETRIES) {
+        ngx_js_http_error(http, "http2 stream refused");
+        return;
+    }
+
+    http->v2 = NULL;
+
+    ngx_js_http_close_peer(http);
+    ngx_js_http_connect(http);
+}
+
+
+static void
+ngx_js_http_v2_http1_handler(ngx_event_t *ev)
+{
+    ngx_js_http_t            *http;
+    ngx_js_http_v2_stream_t  *stream;
+
+    stream = ev->data;
+    http = stream->http;
+
+    http->v2 = NULL;
+    http->http2 = 0;
+
+    ngx_js_http_close_peer(http);
+    ngx_js_http_connect(http);
+}
+
+
+static u_char *
+ngx_js_http_v2_frame(ngx_js_http_v2_conn_t *conn, size_t len)
+{
+    ngx_js_http_v2_frame_t  *f;
+
+    f = ngx_alloc(sizeof(ngx_js_http_v2_frame_t) + len, ngx_cycle->log);
+    if (f == NULL) {
+        return NULL;
+    }
+
+    f->pos = (u_char *) f + sizeof(ngx_js_http_v2_frame_t);
+    f->last = f->pos + len;
+
+    ngx_queue_insert_tail(&conn->out, &f->queue);
+
+    return f->pos;
+}
+
+
+static u_char *
+ngx_js_http_v2_frame_head(u_char *p, size_t len, ngx_uint_t type,
+    ngx_uint_t flags, uint32_t sid)
+{
+    *p++ = (u_char) (len >> 16);
+    *p++ = (u_char) (len >> 8);
+    *p++ = (u_char) len;
+    *p++ = (u_char) type;
+    *p++ = (u_char) flags;
+
+    return ngx_js_http_v2_write_uint32(p, sid);
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_rst_stream(ngx_js_http_v2_conn_t *conn, uint32_t sid,
+    ngx_uint_t code)
+{
+    u_char  *p;
+
+    p = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER + 4);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    p = ngx_js_http_v2_frame_head(p, 4, NGX_JS_HTTP_V2_RST_STREAM, 0, sid);
+    (void) ngx_js_http_v2_write_uint32(p, code);
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_window_update(ngx_js_http_v2_conn_t *conn, uint32_t sid,
+    size_t inc)
+{
+    u_char  *p;
+
+    p = ngx_js_http_v2_frame(conn, NGX_JS_HTTP_V2_FRAME_HEADER + 4);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    p = ngx_js_http_v2_frame_head(p, 4, NGX_JS_HTTP_V2_WINDOW_UPDATE, 0, sid);
+    (void) ngx_js_http_v2_write_uint32(p, inc);
+
+    return NGX_OK;
+}
+
+
+static u_char *
+ngx_js_http_v2_encode(ngx_js_http_v2_conn_t *conn, u_char *p, u_char *tmp,
+    ngx_str_t *name, ngx_str_t *value, ngx_uint_t indexed)
+{
+    ngx_int_t   rc;
+    ngx_uint_t  i;
+
+    if (p == NULL) {
+        return NULL;
+    }
+
+    rc = ngx_js_http_v2_table_find(&conn->encoder, name, value, &i);
+
+    if (rc == NGX_OK) {
+
+        /* indexed header field */
+
+        *p = 0x80;
+        return ngx_js_http_v2_write_int(p, 0x7f, i);
+    }
+
+    if (rc == NGX_DECLINED) {
+        i = 0;
+    }
+
+    /*
+     * the index of the name refers to the table as it was before
+     * the new entry is added, as the decoder sees it
+     */
+
+    if (indexed
+        && name->len + value->len + NGX_JS_HTTP_V2_ENTRY_SIZE
+           <= conn->encoder.max_size
+        && ngx_js_http_v2_table_add(&conn->encoder, name, value) == NGX_OK)
+    {
+        /* literal header field with incremental indexing */
+
+        *p = 0x40;
+        p = ngx_js_http_v2_write_int(p, 0x3f, i);
+
+    } else {
+
+        /* literal header field without indexing */
+
+        *p = 0x00;
+        p = ngx_js_http_v2_write_int(p, 0x0f, i);
+    }
+
+    if (i == 0) {
+        p = ngx_js_http_v2_write_string(p, tmp, name);
+    }
+
+    return ngx_js_http_v2_write_string(p, tmp, value);
+}
+
+
+static u_char *
+ngx_js_http_v2_write_int(u_char *p, ngx_uint_t prefix, ngx_uint_t value)
+{
+    if (value < prefix) {
+        *p++ |= value;
+        return p;
+    }
+
+    *p++ |= prefix;
+    value -= prefix;
+
+    while (value >= 128) {
+        *p++ = value % 128 + 128;
+        value /= 128;
+    }
+
+    *p++ = (u_char) value;
+
+    return p;
+}
+
+
+static u_char *
+ngx_js_http_v2_write_string(u_char *p, u_char *tmp, ngx_str_t *str)
+{
+    size_t  len;
+
+    len = ngx_http_huff_encode(str->data, str->len, tmp, 0);
+
+    if (len != 0) {
+        *p = 0x80;
+        p = ngx_js_http_v2_write_int(p, 0x7f, len);
+        return ngx_cpymem(p, tmp, len);
+    }
+
+    *p = 0x00;
+    p = ngx_js_http_v2_write_int(p, 0x7f, str->len);
+
+    return ngx_cpymem(p, str->data, str->len);
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_decode(ngx_js_http_v2_conn_t *conn, u_char *p, u_char *end)
+{
+    u_char                    ch;
+    ngx_uint_t                index, size, discard;
+    ngx_pool_t               *pool, *temp;
+    ngx_js_http_t            *http;
+    ngx_js_http_v2_stream_t  *stream;
+    ngx_js_http_v2_header_t   header;
+
+    /*
+     * header blocks of the closed streams and trailers are decoded
+     * as well to keep the dynamic table in sync with the peer
+     */
+
+    stream = ngx_js_http_v2_find(conn, conn->block_sid);
+
+    discard = (stream == NULL || stream->headers);
+
+    http = NULL;
+    temp = NULL;
+
+    if (discard) {
+        temp = ngx_create_pool(1024, ngx_cycle->log);
+        if (temp == NULL) {
+            return NGX_ERROR;
+        }
+
+        pool = temp;
+
+    } else {
+        http = stream->http;
+        pool = http->pool;
+        http->response.code = 0;
+    }
+
+    while (p < end) {
+        ch = *p;
+
+        if (ch & 0x80) {
+
+            /* indexed header field */
+
+            if (ngx_js_http_v2_parse_int(&p, end, 0x7f, &index) != NGX_OK
+                || ngx_js_http_v2_table_get(&conn->decoder, index, &header)
+                   != NGX_OK)
+            {
+                goto failed;
+            }
+
+            header.name.data = ngx_pstrdup(pool, &header.name);
+            header.value.data = ngx_pstrdup(pool, &header.value);
+
+            if ((header.name.len && header.name.data == NULL)
+                || (header.value.len && header.value.data == NULL))
+            {
+                goto failed;
+            }
+
+        } else if ((ch & 0xe0) == 0x20) {
+
+            /* dynamic table size update */
+
+            if (ngx_js_http_v2_parse_int(&p, end, 0x1f, &size) != NGX_OK
+                || size > NGX_JS_HTTP_V2_TABLE_SIZE)
+            {
+                goto failed;
+            }
+
+            ngx_js_http_v2_table_evict(&conn->decoder, size);
+            conn->decoder.max_size = size;
+
+            continue;
+
+        } else {
+
+            /*
+             * literal header field with incremental indexing,
+             * without indexing or never indexed
+             */
+
+            if (ngx_js_http_v2_parse_int(&p, end, (ch & 0x40) ? 0x3f : 0x0f,
+                                         &index)
+                != NGX_OK)
+            {
+                goto failed;
+            }
+
+            if (index == 0) {
+                if (ngx_js_http_v2_parse_string(&p, end, pool, &header.name)
+                    != NGX_OK)
+                {
+                    goto failed;
+                }
+
+            } else {
+                if (ngx_js_http_v2_table_get(&conn->decoder, index, &header)
+                    != NGX_OK)
+                {
+                    goto failed;
+                }
+
+                header.name.data = ngx_pstrdup(pool, &header.name);
+                if (header.name.len && header.name.data == NULL) {
+                    goto failed;
+                }
+            }
+
+            if (ngx_js_http_v2_parse_string(&p, end, pool, &header.value)
+                != NGX_OK)
+            {
+                goto failed;
+            }
+
+            if ((ch & 0x40)
+                && ngx_js_http_v2_table_add(&conn->decoder, &header.name,
+                                            &header.value)
+                   != NGX_OK)
+            {
+                goto failed;
+            }
+        }
+
+        if (!discard && stream->error == NULL) {
+            (void) ngx_js_http_v2_header(stream, &header.name, &header.value);
+        }
+    }
+
+    if (temp != NULL) {
+        ngx_destroy_pool(temp);
+    }
+
+    if (stream == NULL) {
+        return NGX_OK;
+    }
+
+    if (!discard) {
+        if (stream->error == NULL && http->response.code == 0) {
+            stream->error = "invalid http status line";
+        }
+
+        if (stream->error != NULL) {
+            ngx_js_http_v2_stream_error(stream, stream->error, 1);
+            return NGX_OK;
+        }
+
+        if (http->response.code < 200) {
+
+            /* the final response follows */
+
+            http->response.code = 0;
+            return NGX_OK;
+        }
+
+        stream->headers = 1;
+        http->response.headers.guard = GUARD_IMMUTABLE;
+    }
+
+    if (conn->block_end_stream) {
+        ngx_js_http_v2_stream_done(stream);
+        return NGX_OK;
+    }
+
+    ngx_add_timer(&stream->event, stream->http->timeout);
+
+    return NGX_OK;
+
+failed:
+
+    if (temp != NULL) {
+        ngx_destroy_pool(temp);
+    }
+
+    /* compression errors are connection errors */
+
+    return NGX_ERROR;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_parse_int(u_char **pos, u_char *end, ngx_uint_t prefix,
+    ngx_uint_t *value)
+{
+    u_char      *p;
+    ngx_uint_t   v, shift;
+
+    p = *pos;
+
+    if (p == end) {
+        return NGX_ERROR;
+    }
+
+    v = *p++ & prefix;
+
+    if (v == prefix) {
+        shift = 0;
+
+        do {
+            if (p == end || shift > 21) {
+                return NGX_ERROR;
+            }
+
+            v += (ngx_uint_t) (*p & 0x7f) << shift;
+            shift += 7;
+
+        } while (*p++ & 0x80);
+    }
+
+    *pos = p;
+    *value = v;
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_parse_string(u_char **pos, u_char *end, ngx_pool_t *pool,
+    ngx_str_t *str)
+{
+    u_char      *p, *dst, state;
+    ngx_uint_t   huff, len;
+
+    p = *pos;
+
+    if (p == end) {
+        return NGX_ERROR;
+    }
+
+    huff = *p & 0x80;
+
+    if (ngx_js_http_v2_parse_int(&p, end, 0x7f, &len) != NGX_OK
+        || (size_t) (end - p) < len)
+    {
+        return NGX_ERROR;
+    }
+
+    if (huff) {
+
+        /* the shortest huffman code is 5 bits long */
+
+        str->data = ngx_pnalloc(pool, len * 8 / 5 + 1);
+        if (str->data == NULL) {
+            return NGX_ERROR;
+        }
+
+        state = 0;
+        dst = str->data;
+
+        if (ngx_http_huff_decode(&state, p, len, &dst, 1, ngx_cycle->log)
+            != NGX_OK)
+        {
+            return NGX_ERROR;
+        }
+
+        str->len = dst - str->data;
+
+    } else {
+        str->data = ngx_pnalloc(pool, len + 1);
+        if (str->data == NULL) {
+            return NGX_ERROR;
+        }
+
+        ngx_memcpy(str->data, p, len);
+        str->len = len;
+    }
+
+    *pos = p + len;
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_table_find(ngx_js_http_v2_table_t *t, ngx_str_t *name,
+    ngx_str_t *value, ngx_uint_t *index)
+{
+    ngx_int_t                 rc;
+    ngx_uint_t                i, n;
+    ngx_js_http_v2_header_t  *h;
+
+    rc = NGX_DECLINED;
+
+    n = NGX_JS_HTTP_V2_STATIC_ENTRIES + t->count;
+
+    for (i = 1; i <= n; i++) {
+        if (i <= NGX_JS_HTTP_V2_STATIC_ENTRIES) {
+            h = &ngx_js_http_v2_static_table[i - 1];
+
+        } else {
+            h = &t->entries[(t->head + NGX_JS_HTTP_V2_TABLE_ENTRIES
+                             + NGX_JS_HTTP_V2_STATIC_ENTRIES - i)
+                            % NGX_JS_HTTP_V2_TABLE_ENTRIES];
+        }
+
+        if (h->name.len != name->len
+            || ngx_strncmp(h->name.data, name->data, name->len) != 0)
+        {
+            continue;
+        }
+
+        if (h->value.len == value->len
+            && ngx_strncmp(h->value.data, value->data, value->len) == 0)
+        {
+            *index = i;
+            return NGX_OK;
+        }
+
+        if (rc == NGX_DECLINED) {
+            *index = i;
+            rc = NGX_AGAIN;
+        }
+    }
+
+    return rc;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_table_get(ngx_js_http_v2_table_t *t, ngx_uint_t index,
+    ngx_js_http_v2_header_t *header)
+{
+    if (index == 0) {
+        return NGX_ERROR;
+    }
+
+    if (index <= NGX_JS_HTTP_V2_STATIC_ENTRIES) {
+        *header = ngx_js_http_v2_static_table[index - 1];
+        return NGX_OK;
+    }
+
+    index -= NGX_JS_HTTP_V2_STATIC_ENTRIES + 1;
+
+    if (index >= t->count) {
+        return NGX_ERROR;
+    }
+
+    *header = t->entries[(t->head + NGX_JS_HTTP_V2_TABLE_ENTRIES - 1 - index)
+                         % NGX_JS_HTTP_V2_TABLE_ENTRIES];
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_http_v2_table_add(ngx_js_http_v2_table_t *t, ngx_str_t *name,
+    ngx_str_t *value)
+{
+    u_char                   *p;
+    size_t                    size;
+    ngx_js_http_v2_header_t  *h;
+
+    size = name->len + value->len + NGX_JS_HTTP_V2_ENTRY_SIZE;
+
+    if (size > t->max_size) {
+
+        /* an entry larger than the table empties it */
+
+        ngx_js_http_v2_table_evict(t, 0);
+        return NGX_OK;
+    }
+
+    if (t->entries == NULL) {
+        t->entries = ngx_alloc(NGX_JS_HTTP_V2_TABLE_ENTRIES
+                               * sizeof(ngx_js_http_v2_header_t),
+                               ngx_cycle->log);
+        if (t->entries == NULL) {
+            return NGX_ERROR;
+        }
+    }
+
+    p = ngx_alloc(name->len + value->len + 1, ngx_cycle->log);
+    if (p == NULL) {
+        return NGX_ERROR;
+    }
+
+    ngx_js_http_v2_table_evict(t, t->max_size - size);
+
+    h = &t->entries[t->head];
+
+    h->name.len = name->len;
+    h->name.data = p;
+    h->value.len = value->len;
+    h->value.data = ngx_cpymem(p, name->data, name->len);
+    ngx_memcpy(h->value.data, value->data, value->len);
+
+    t->head = (t->head + 1) % NGX_JS_HTTP_V2_TABLE_ENTRIES;
+    t->count++;
+    t->size += size;
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_js_http_v2_table_evict(ngx_js_http_v2_table_t *t, size_t size)
+{
+    ngx_js_http_v2_header_t  *h;
+
+    while (t->size > size) {
+        h = &t->entries[(t->head + NGX_JS_HTTP_V2_TABLE_ENTRIES - t->count)
+                        % NGX_JS_HTTP_V2_TABLE_ENTRIES];
+
+        t->size -= h->name.len + h->value.len + NGX_JS_HTTP_V2_ENTRY_SIZE;
+        t->count--;
+
+        ngx_free(h->name.data);
+    }
+}
+
+
+static void
+ngx_js_http_v2_table_free(ngx_js_http_v2_table_t *t)
+{
+    ngx_js_http_v2_table_evict(t, 0);
+
+    if (t->entries != NULL) {
+        ngx_free(t->entries);
+    }
+}
+
+#endif
@@ -11,6 +11,10 @@
 #include "ngx_js_shared_dict.h"
 
 
+typedef struct ngx_js_dict_node_s  ngx_js_dict_node_t;
+typedef struct ngx_js_dict_save_s  ngx_js_dict_save_t;
+
+
 typedef struct {
     ngx_rbtree_t           rbtree;
     ngx_rbtree_node_t      sentinel;
@@ -19,8 +23,18 @@ typedef struct {
     ngx_rbtree_t           rbtree_expire;
     ngx_rbtree_node_t      sentinel_expire;
 
-    unsigned               dirty:1;
-    unsigned               writing:1;
+    ngx_uint_t             items;
+
+    ngx_js_dict_node_t   **buckets;
+    ngx_uint_t             nbuckets;
+} ngx_js_dict_shard_t;
+
+
+typedef struct {
+    ngx_atomic_t           dirty;
+    ngx_atomic_t           writing;
+
+    ngx_js_dict_shard_t    shards[1];
 } ngx_js_dict_sh_t;
 
 
@@ -41,10 +55,15 @@ struct ngx_js_dict_s {
 #define NGX_JS_DICT_TYPE_STRING  0
 #define NGX_JS_DICT_TYPE_NUMBER  1
     ngx_uint_t             type;
+    ngx_uint_t             shards;
 
     ngx_event_t            save_event;
     ngx_str_t              state_file;
     ngx_str_t              state_temp_file;
+#define NGX_JS_DICT_STATE_JSON    0
+#define NGX_JS_DICT_STATE_BINARY  1
+    ngx_uint_t             state_format;
+    ngx_js_dict_save_t    *save;
 
     ngx_js_dict_t         *next;
 };
@@ -56,11 +75,12 @@ typedef union {
 } ngx_js_dict_value_t;
 
 
-typedef struct {
+struct ngx_js_dict_node_s {
     ngx_str_node_t         sn;
     ngx_rbtree_node_t      expire;
     ngx_js_dict_value_t    value;
-} ngx_js_dict_node_t;
+    ngx_js_dict_node_t    *next;
+};
 
 
 typedef struct {
@@ -70,6 +90,56 @@ typedef struct {
 } ngx_js_dict_entry_t;
 
 
+/*
+ * Binary state file: the header followed by records of
+ * key length (uint32_t), key, value, expire (uint64_t), where value is
+ * either double or string length (uint32_t) and string.  Numbers are
+ * stored in the host byte order.
+ */
+
+#define NGX_JS_DICT_STATE_MAGIC    "NJSD"
+#define NGX_JS_DICT_STATE_VERSION  1
+
+#define NGX_JS_DICT_SAVE_CHUNK     65536
+
+
+typedef struct {
+    u_char                 magic[4];
+    u_char                 version;
+    u_char                 type;
+    u_char                 reserved[2];
+} ngx_js_dict_state_header_t;
+
+
+struct ngx_js_dict_save_s {
+    ngx_pool_t            *pool;
+    ngx_file_t             file;
+
+    /* the current shard and the last key saved from it */
+    ngx_uint_t             shard;
+    uint32_t               hash;
+    ngx_str_t              key;
+
+    /* the chunk buffer, or a temporary one for a larger record */
+    u_char                *chunk;
+    u_char                *start;
+    u_char                *pos;
+    u_char                *end;
+};
+
+
+typedef struct {
+    ngx_file_t            *file;
+    off_t                  size;
+    ngx_pool_t            *pool;
+
+    u_char                *start;
+    u_char                *pos;
+    u_char                *last;
+    u_char                *end;
+} ngx_js_dict_load_t;
+
+
 static njs_int_t njs_js_ext_shared_dict_capacity(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
@@ -102,8 +172,14 @@ static njs_int_t njs_js_ext_shared_dict_size(njs_vm_t *vm, njs_value_t *args,
 static njs_int_t njs_js_ext_shared_dict_type(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
-static ngx_js_dict_node_t *ngx_js_dict_lookup(ngx_js_dict_t *dict,
-    ngx_str_t *key);
+static ngx_js_dict_shard_t *ngx_js_dict_shard(ngx_js_dict_t *dict,
+    ngx_str_t *key, uint32_t *hash);
+static ngx_js_dict_node_t *ngx_js_dict_lookup(ngx_js_dict_shard_t *shard,
+    ngx_str_t *key, uint32_t hash);
+static void ngx_js_dict_hash_insert(ngx_js_dict_t *dict,
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node);
+static void ngx_js_dict_hash_delete(ngx_js_dict_shard_t *shard,
+    ngx_js_dict_node_t *node);
 
 #define NGX_JS_DICT_FLAG_MUST_EXIST       1
 #define NGX_JS_DICT_FLAG_MUST_NOT_EXIST   2
@@ -111,10 +187,11 @@ static ngx_js_dict_node_t *ngx_js_dict_lookup(ngx_js_dict_t *dict,
 static ngx_int_t ngx_js_dict_set(njs_vm_t *vm, ngx_js_dict_t *dict,
     ngx_str_t *key, njs_value_t *value, ngx_msec_t timeout, unsigned flags);
 static ngx_int_t ngx_js_dict_add(njs_vm_t *vm, ngx_js_dict_t *dict,
-    ngx_str_t *key, njs_value_t *value, ngx_msec_t timeout, ngx_msec_t now);
+    ngx_js_dict_shard_t *shard, ngx_str_t *key, uint32_t hash,
+    njs_value_t *value, ngx_msec_t timeout, ngx_msec_t now);
 static ngx_int_t ngx_js_dict_update(njs_vm_t *vm, ngx_js_dict_t *dict,
-    ngx_js_dict_node_t *node, njs_value_t *value, ngx_msec_t timeout,
-    ngx_msec_t now);
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node, njs_value_t *value,
+    ngx_msec_t timeout, ngx_msec_t now);
 static ngx_int_t ngx_js_dict_get(njs_vm_t *vm, ngx_js_dict_t *dict,
     ngx_str_t *key, njs_value_t *retval);
 static ngx_int_t ngx_js_dict_incr(njs_vm_t *vm, ngx_js_dict_t *dict,
@@ -125,18 +202,32 @@ static ngx_int_t ngx_js_dict_delete(njs_vm_t *vm, ngx_js_dict_t *dict,
 static ngx_int_t ngx_js_dict_copy_value_locked(njs_vm_t *vm,
     ngx_js_dict_t *dict, ngx_js_dict_node_t *node, njs_value_t *retval);
 
-static void ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_msec_t now);
-static void ngx_js_dict_evict(ngx_js_dict_t *dict, ngx_int_t count);
+static void ngx_js_dict_clear(ngx_js_dict_t *dict,
+    ngx_js_dict_shard_t *shard);
+static size_t ngx_js_dict_free_space(ngx_js_dict_t *dict);
+static ngx_uint_t ngx_js_dict_size(ngx_js_dict_t *dict);
+
+/* max number of expired entries removed by a single operation */
+#define NGX_JS_DICT_EXPIRE_BATCH          16
+
+static void ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_msec_t now, ngx_int_t count);
+static void ngx_js_dict_evict(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_int_t count);
 
 static njs_int_t ngx_js_dict_shared_error_name(njs_vm_t *vm,
     njs_object_prop_t *prop, uint32_t unused, njs_value_t *value,
     njs_value_t *setval, njs_value_t *retval);
 
 static ngx_int_t ngx_js_dict_init_zone(ngx_shm_zone_t *shm_zone, void *data);
+static ngx_int_t ngx_js_dict_parse_zone(ngx_conf_t *cf, ngx_str_t *value,
+    ngx_str_t *name, ssize_t *size);
+static ngx_js_dict_t *ngx_js_dict_add_zone(ngx_conf_t *cf, ngx_str_t *name,
+    ssize_t size, void *tag);
 static njs_int_t ngx_js_shared_dict_preinit(njs_vm_t *vm);
 static njs_int_t ngx_js_shared_dict_init(njs_vm_t *vm);
 static void ngx_js_dict_node_free(ngx_js_dict_t *dict,
-    ngx_js_dict_node_t *node);
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node);
 
 #if (NJS_HAVE_QUICKJS)
 static int ngx_qjs_shared_own_property(JSContext *cx,
@@ -176,10 +267,9 @@ static JSValue ngx_qjs_ext_shared_dict_size(JSContext *cx,
 
 static JSValue ngx_qjs_dict_copy_value_locked(JSContext *cx,
     ngx_js_dict_t *dict, ngx_js_dict_node_t *node);
-static ngx_js_dict_node_t *ngx_qjs_dict_lookup(ngx_js_dict_t *dict,
-    ngx_str_t *key);
 static ngx_int_t ngx_qjs_dict_add(JSContext *cx, ngx_js_dict_t *dict,
-    ngx_str_t *key, JSValue value, ngx_msec_t timeout, ngx_msec_t now);
+    ngx_js_dict_shard_t *shard, ngx_str_t *key, uint32_t hash, JSValue value,
+    ngx_msec_t timeout, ngx_msec_t now);
 static JSValue ngx_qjs_dict_delete(JSContext *cx, ngx_js_dict_t *dict,
     ngx_str_t *key, int retval);
 static JSValue ngx_qjs_dict_get(JSContext *cx, ngx_js_dict_t *dict,
@@ -189,8 +279,8 @@ static JSValue ngx_qjs_dict_incr(JSContext *cx, ngx_js_dict_t *dict,
 static JSValue ngx_qjs_dict_set(JSContext *cx, ngx_js_dict_t *dict,
     ngx_str_t *key, JSValue value, ngx_msec_t timeout, unsigned flags);
 static ngx_int_t ngx_qjs_dict_update(JSContext *cx, ngx_js_dict_t *dict,
-    ngx_js_dict_node_t *node, JSValue value, ngx_msec_t timeout,
-    ngx_msec_t now);
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node, JSValue value,
+    ngx_msec_t timeout, ngx_msec_t now);
 
 static JSValue ngx_qjs_throw_shared_memory_error(JSContext *cx);
 
@@ -606,10 +696,10 @@ static njs_int_t
 njs_js_ext_shared_dict_clear(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
-    ngx_rbtree_t       *rbtree;
-    ngx_js_dict_t      *dict;
-    ngx_shm_zone_t     *shm_zone;
-    ngx_rbtree_node_t  *rn, *next;
+    ngx_uint_t            i;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = njs_vm_external(vm, ngx_js_shared_dict_proto_id,
                                njs_argument(args, 0));
@@ -620,36 +710,16 @@ njs_js_ext_shared_dict_clear(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        ngx_js_dict_evict(dict, 0x7fffffff /* INT_MAX */);
-
-    } else {
-        rbtree = &dict->sh->rbtree;
-
-        if (rbtree->root == rbtree->sentinel) {
-            goto done;
-        }
-
-        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-             rn != NULL;
-             rn = next)
-        {
-            next = ngx_rbtree_next(rbtree, rn);
-
-            ngx_rbtree_delete(rbtree, rn);
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-            ngx_js_dict_node_free(dict, (ngx_js_dict_node_t *) rn);
-        }
+        ngx_rwlock_wlock(&shard->rwlock);
+        ngx_js_dict_clear(dict, shard);
+        ngx_rwlock_unlock(&shard->rwlock);
     }
 
-done:
-
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
-
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
     }
@@ -677,9 +747,7 @@ njs_js_ext_shared_dict_free_space(njs_vm_t *vm, njs_value_t *args,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-    bytes = dict->shpool->pfree * ngx_pagesize;
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    bytes = ngx_js_dict_free_space(dict);
 
     njs_value_number_set(retval, bytes);
 
@@ -747,12 +815,14 @@ static njs_int_t
 njs_js_ext_shared_dict_has(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
-    ngx_str_t            key;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_str_t             key;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = njs_vm_external(vm, ngx_js_shared_dict_proto_id,
                                njs_argument(args, 0));
@@ -766,10 +836,11 @@ njs_js_ext_shared_dict_has(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     }
 
     dict = shm_zone->data;
+    shard = ngx_js_dict_shard(dict, &key, &hash);
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    ngx_rwlock_rlock(&shard->rwlock);
 
-    node = ngx_js_dict_lookup(dict, &key);
+    node = ngx_js_dict_lookup(shard, &key, hash);
 
     if (node != NULL && dict->timeout) {
         tp = ngx_timeofday();
@@ -780,7 +851,7 @@ njs_js_ext_shared_dict_has(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         }
     }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     njs_value_boolean_set(retval, node != NULL);
 
@@ -792,16 +863,18 @@ static njs_int_t
 njs_js_ext_shared_dict_keys(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
-    njs_int_t            rc;
-    ngx_int_t            max_count;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    njs_value_t         *value;
-    ngx_rbtree_t        *rbtree;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_rbtree_node_t   *rn;
-    ngx_js_dict_node_t  *node;
+    njs_int_t             rc;
+    ngx_int_t             max_count;
+    ngx_uint_t            i;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    njs_value_t          *value;
+    ngx_rbtree_t         *rbtree;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = njs_vm_external(vm, ngx_js_shared_dict_proto_id,
                                njs_argument(args, 0));
@@ -825,51 +898,56 @@ njs_js_ext_shared_dict_keys(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         return NJS_ERROR;
     }
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
 
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-    rbtree = &dict->sh->rbtree;
+        ngx_rwlock_rlock(&shard->rwlock);
 
-    if (rbtree->root == rbtree->sentinel) {
-        goto done;
-    }
+        rbtree = &shard->rbtree;
 
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        if (max_count-- == 0) {
-            break;
+        if (rbtree->root == rbtree->sentinel) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            continue;
         }
 
-        node = (ngx_js_dict_node_t *) rn;
+        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+             rn != NULL;
+             rn = ngx_rbtree_next(rbtree, rn))
+        {
+            node = (ngx_js_dict_node_t *) rn;
+
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
+            }
 
-        value = njs_vm_array_push(vm, retval);
-        if (value == NULL) {
-            goto fail;
-        }
+            if (max_count-- == 0) {
+                ngx_rwlock_unlock(&shard->rwlock);
+                return NJS_OK;
+            }
 
-        rc = njs_vm_value_string_create(vm, value, node->sn.str.data,
-                                        node->sn.str.len);
-        if (rc != NJS_OK) {
-            goto fail;
-        }
-    }
+            value = njs_vm_array_push(vm, retval);
+            if (value == NULL) {
+                goto fail;
+            }
 
-done:
+            rc = njs_vm_value_string_create(vm, value, node->sn.str.data,
+                                            node->sn.str.len);
+            if (rc != NJS_OK) {
+                goto fail;
+            }
+        }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
+    }
 
     return NJS_OK;
 
 fail:
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return NJS_ERROR;
 }
@@ -962,16 +1040,18 @@ static njs_int_t
 njs_js_ext_shared_dict_items(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
-    njs_int_t            rc;
-    ngx_int_t            max_count;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    njs_value_t         *value, *kv;
-    ngx_rbtree_t        *rbtree;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_rbtree_node_t   *rn;
-    ngx_js_dict_node_t  *node;
+    njs_int_t             rc;
+    ngx_int_t             max_count;
+    ngx_uint_t            i;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    njs_value_t          *value, *kv;
+    ngx_rbtree_t         *rbtree;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = njs_vm_external(vm, ngx_js_shared_dict_proto_id,
                                njs_argument(args, 0));
@@ -995,71 +1075,76 @@ njs_js_ext_shared_dict_items(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         return NJS_ERROR;
     }
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
 
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-    rbtree = &dict->sh->rbtree;
+        ngx_rwlock_rlock(&shard->rwlock);
 
-    if (rbtree->root == rbtree->sentinel) {
-        goto done;
-    }
+        rbtree = &shard->rbtree;
 
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        if (max_count-- == 0) {
-            break;
+        if (rbtree->root == rbtree->sentinel) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            continue;
         }
 
-        node = (ngx_js_dict_node_t *) rn;
+        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+             rn != NULL;
+             rn = ngx_rbtree_next(rbtree, rn))
+        {
+            node = (ngx_js_dict_node_t *) rn;
 
-        kv = njs_vm_array_push(vm, retval);
-        if (kv == NULL) {
-            goto fail;
-        }
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
+            }
 
-        rc = njs_vm_array_alloc(vm, kv, 2);
-        if (rc != NJS_OK) {
-            goto fail;
-        }
+            if (max_count-- == 0) {
+                ngx_rwlock_unlock(&shard->rwlock);
+                return NJS_OK;
+            }
 
-        value = njs_vm_array_push(vm, kv);
-        if (value == NULL) {
-            goto fail;
-        }
+            kv = njs_vm_array_push(vm, retval);
+            if (kv == NULL) {
+                goto fail;
+            }
 
-        rc = njs_vm_value_string_create(vm, value, node->sn.str.data,
-                                        node->sn.str.len);
-        if (rc != NJS_OK) {
-            goto fail;
-        }
+            rc = njs_vm_array_alloc(vm, kv, 2);
+            if (rc != NJS_OK) {
+                goto fail;
+            }
 
-        value = njs_vm_array_push(vm, kv);
-        if (value == NULL) {
-            goto fail;
-        }
+            value = njs_vm_array_push(vm, kv);
+            if (value == NULL) {
+                goto fail;
+            }
 
-        rc = ngx_js_dict_copy_value_locked(vm, dict, node, value);
-        if (rc != NJS_OK) {
-            goto fail;
-        }
-    }
+            rc = njs_vm_value_string_create(vm, value, node->sn.str.data,
+                                            node->sn.str.len);
+            if (rc != NJS_OK) {
+                goto fail;
+            }
 
-done:
+            value = njs_vm_array_push(vm, kv);
+            if (value == NULL) {
+                goto fail;
+            }
+
+            rc = ngx_js_dict_copy_value_locked(vm, dict, node, value);
+            if (rc != NJS_OK) {
+                goto fail;
+            }
+        }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
+    }
 
     return NJS_OK;
 
 fail:
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return NJS_ERROR;
 }
@@ -1194,13 +1279,8 @@ static njs_int_t
 njs_js_ext_shared_dict_size(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
     njs_index_t unused, njs_value_t *retval)
 {
-    njs_int_t           items;
-    ngx_msec_t          now;
-    ngx_time_t         *tp;
-    ngx_rbtree_t       *rbtree;
-    ngx_js_dict_t      *dict;
-    ngx_shm_zone_t     *shm_zone;
-    ngx_rbtree_node_t  *rn;
+    ngx_js_dict_t   *dict;
+    ngx_shm_zone_t  *shm_zone;
 
     shm_zone = njs_vm_external(vm, ngx_js_shared_dict_proto_id,
                                njs_argument(args, 0));
@@ -1211,33 +1291,7 @@ njs_js_ext_shared_dict_size(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
-
-    rbtree = &dict->sh->rbtree;
-
-    if (rbtree->root == rbtree->sentinel) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
-        njs_value_number_set(retval, 0);
-        return NJS_OK;
-    }
-
-    items = 0;
-
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        items++;
-    }
-
-    ngx_rwlock_unlock(&dict->sh->rwlock);
-    njs_value_number_set(retval, items);
+    njs_value_number_set(retval, ngx_js_dict_size(dict));
 
     return NJS_OK;
 }
@@ -1283,135 +1337,315 @@ ngx_js_dict_shared_error_name(njs_vm_t *vm, njs_object_prop_t *prop,
 }
 
 
-static ngx_js_dict_node_t *
-ngx_js_dict_lookup(ngx_js_dict_t *dict, ngx_str_t *key)
+static ngx_js_dict_shard_t *
+ngx_js_dict_shard(ngx_js_dict_t *dict, ngx_str_t *key, uint32_t *hash)
 {
-    uint32_t       hash;
-    ngx_rbtree_t  *rbtree;
+    *hash = ngx_crc32_long(key->data, key->len);
+
+    return &dict->sh->shards[((uint64_t) *hash * dict->shards) >> 32];
+}
+
+
+/*
+ * The key tree is kept for iteration only, point lookups use a chained
+ * hash table.  The higher bits of the hash select the shard, so buckets
+ * are selected by the lower bits.
+ */
+
+#define NGX_JS_DICT_HASH_SIZE  16
+
+#define ngx_js_dict_bucket(shard, hash)                                       \
+    (&(shard)->buckets[(hash) & ((shard)->nbuckets - 1)])
+
 
-    rbtree = &dict->sh->rbtree;
+static ngx_js_dict_node_t *
+ngx_js_dict_lookup(ngx_js_dict_shard_t *shard, ngx_str_t *key, uint32_t hash)
+{
+    ngx_js_dict_node_t  *node;
 
-    hash = ngx_crc32_long(key->data, key->len);
+    for (node = *ngx_js_dict_bucket(shard, hash);
+         node != NULL;
+         node = node->next)
+    {
+        if (node->sn.node.key == hash
+            && node->sn.str.len == key->len
+            && ngx_memcmp(node->sn.str.data, key->data, key->len) == 0)
+        {
+            return node;
+        }
+    }
 
-    return (ngx_js_dict_node_t *) ngx_str_rbtree_lookup(rbtree, key, hash);
+    return NULL;
 }
 
 
+/*
+ * The slab pool is shared by all shards of a zone.  A single shard zone
+ * accesses it under the shard lock, otherwise the slab pool mutex is used.
+ */
+
 static void *
-ngx_js_dict_alloc(ngx_js_dict_t *dict, size_t n)
+ngx_js_dict_slab_alloc(ngx_js_dict_t *dict, size_t n)
 {
-    void  *p;
+    if (dict->shards == 1) {
+        return ngx_slab_alloc_locked(dict->shpool, n);
+    }
+
+    return ngx_slab_alloc(dict->shpool, n);
+}
 
-    p = ngx_slab_alloc_locked(dict->shpool, n);
 
-    if (p == NULL && dict->evict) {
-        ngx_js_dict_evict(dict, 16);
-        p = ngx_slab_alloc_locked(dict->shpool, n);
+static void
+ngx_js_dict_slab_free(ngx_js_dict_t *dict, void *p)
+{
+    if (dict->shards == 1) {
+        ngx_slab_free_locked(dict->shpool, p);
+        return;
     }
 
-    return p;
+    ngx_slab_free(dict->shpool, p);
 }
 
 
-static void
-ngx_js_dict_node_free(ngx_js_dict_t *dict, ngx_js_dict_node_t *node)
+static void *
+ngx_js_dict_alloc(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard, size_t n)
 {
-    ngx_slab_pool_t  *shpool;
+    void  *p;
 
-    shpool = dict->shpool;
+    p = ngx_js_dict_slab_alloc(dict, n);
 
-    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
-        ngx_slab_free_locked(shpool, node->value.str.data);
+    if (p == NULL && dict->evict) {
+        ngx_js_dict_evict(dict, shard, 16);
+        p = ngx_js_dict_slab_alloc(dict, n);
     }
 
-    ngx_slab_free_locked(shpool, node);
+    return p;
 }
 
 
-static ngx_int_t
-ngx_js_dict_set(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
-    njs_value_t *value, ngx_msec_t timeout, unsigned flags)
+static void
+ngx_js_dict_hash_insert(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_js_dict_node_t *node)
 {
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    ngx_uint_t            i, n;
+    ngx_js_dict_node_t   *rn, *next, **bucket, **buckets, **old;
 
-    tp = ngx_timeofday();
-    now = tp->sec * 1000 + tp->msec;
+    if (shard->items >= shard->nbuckets) {
+        n = shard->nbuckets * 2;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+        buckets = ngx_js_dict_slab_alloc(dict,
+                                         n * sizeof(ngx_js_dict_node_t *));
 
-    node = ngx_js_dict_lookup(dict, key);
+        /* a failed resize only results in longer chains */
 
-    if (node == NULL) {
-        if (flags & NGX_JS_DICT_FLAG_MUST_EXIST) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            return NGX_DECLINED;
-        }
+        if (buckets != NULL) {
+            ngx_memzero(buckets, n * sizeof(ngx_js_dict_node_t *));
 
-        if (ngx_js_dict_add(vm, dict, key, value, timeout, now) != NGX_OK) {
-            goto memory_error;
-        }
+            old = shard->buckets;
 
-    } else {
-        if (flags & NGX_JS_DICT_FLAG_MUST_NOT_EXIST) {
-            if (!dict->timeout || now < node->expire.key) {
-                ngx_rwlock_unlock(&dict->sh->rwlock);
-                return NGX_DECLINED;
+            shard->buckets = buckets;
+            shard->nbuckets = n;
+
+            for (i = 0; i < n / 2; i++) {
+                for (rn = old[i]; rn != NULL; rn = next) {
+                    next = rn->next;
+
+                    bucket = ngx_js_dict_bucket(shard, rn->sn.node.key);
+
+                    rn->next = *bucket;
+                    *bucket = rn;
+                }
             }
-        }
 
-        if (ngx_js_dict_update(vm, dict, node, value, timeout, now) != NGX_OK) {
-            goto memory_error;
+            ngx_js_dict_slab_free(dict, old);
         }
     }
 
-    dict->sh->dirty = 1;
+    bucket = ngx_js_dict_bucket(shard, node->sn.node.key);
+
+    node->next = *bucket;
+    *bucket = node;
+}
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
 
-    if (dict->state_file.data && !dict->save_event.timer_set) {
-        ngx_add_timer(&dict->save_event, 1000);
+static void
+ngx_js_dict_hash_delete(ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node)
+{
+    ngx_js_dict_node_t  **bucket;
+
+    for (bucket = ngx_js_dict_bucket(shard, node->sn.node.key);
+         *bucket != NULL;
+         bucket = &(*bucket)->next)
+    {
+        if (*bucket == node) {
+            *bucket = node->next;
+            return;
+        }
     }
+}
 
-    return NGX_OK;
 
-memory_error:
+static void
+ngx_js_dict_node_free(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_js_dict_node_t *node)
+{
+    ngx_js_dict_hash_delete(shard, node);
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+        ngx_js_dict_slab_free(dict, node->value.str.data);
+    }
 
-    njs_vm_error3(vm, ngx_js_shared_dict_error_id, "", 0);
+    ngx_js_dict_slab_free(dict, node);
 
-    return NGX_ERROR;
+    shard->items--;
 }
 
 
-static ngx_int_t
-ngx_js_dict_add_value(ngx_js_dict_t *dict, ngx_str_t *key,
-    ngx_js_dict_value_t *value, ngx_msec_t timeout, ngx_msec_t now)
+static size_t
+ngx_js_dict_free_space(ngx_js_dict_t *dict)
 {
-    size_t               n;
-    uint32_t             hash;
-    ngx_js_dict_node_t  *node;
+    size_t  bytes;
 
-    if (dict->timeout) {
-        ngx_js_dict_expire(dict, now);
+    if (dict->shards == 1) {
+        ngx_rwlock_rlock(&dict->sh->shards[0].rwlock);
+        bytes = dict->shpool->pfree * ngx_pagesize;
+        ngx_rwlock_unlock(&dict->sh->shards[0].rwlock);
+
+        return bytes;
     }
 
-    n = sizeof(ngx_js_dict_node_t) + key->len;
-    hash = ngx_crc32_long(key->data, key->len);
+    ngx_shmtx_lock(&dict->shpool->mutex);
+    bytes = dict->shpool->pfree * ngx_pagesize;
+    ngx_shmtx_unlock(&dict->shpool->mutex);
 
-    node = ngx_js_dict_alloc(dict, n);
-    if (node == NULL) {
-        return NGX_ERROR;
-    }
+    return bytes;
+}
 
-    node->sn.str.data = (u_char *) node + sizeof(ngx_js_dict_node_t);
 
-    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
-        node->value.str.data = ngx_js_dict_alloc(dict, value->str.len);
+static ngx_uint_t
+ngx_js_dict_size(ngx_js_dict_t *dict)
+{
+    ngx_uint_t            i, items;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_shard_t  *shard;
+
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
+    items = 0;
+
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
+
+        if (dict->timeout) {
+            ngx_rwlock_wlock(&shard->rwlock);
+            ngx_js_dict_expire(dict, shard, now, NGX_JS_DICT_EXPIRE_BATCH);
+
+        } else {
+            ngx_rwlock_rlock(&shard->rwlock);
+        }
+
+        items += shard->items;
+
+        ngx_rwlock_unlock(&shard->rwlock);
+    }
+
+    return items;
+}
+
+
+static ngx_int_t
+ngx_js_dict_set(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
+    njs_value_t *value, ngx_msec_t timeout, unsigned flags)
+{
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
+
+    ngx_rwlock_wlock(&shard->rwlock);
+
+    node = ngx_js_dict_lookup(shard, key, hash);
+
+    if (node == NULL) {
+        if (flags & NGX_JS_DICT_FLAG_MUST_EXIST) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            return NGX_DECLINED;
+        }
+
+        if (ngx_js_dict_add(vm, dict, shard, key, hash, value, timeout, now)
+            != NGX_OK)
+        {
+            goto memory_error;
+        }
+
+    } else {
+        if (flags & NGX_JS_DICT_FLAG_MUST_NOT_EXIST) {
+            if (!dict->timeout || now < node->expire.key) {
+                ngx_rwlock_unlock(&shard->rwlock);
+                return NGX_DECLINED;
+            }
+        }
+
+        if (ngx_js_dict_update(vm, dict, shard, node, value, timeout, now)
+            != NGX_OK)
+        {
+            goto memory_error;
+        }
+    }
+
+    dict->sh->dirty = 1;
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    if (dict->state_file.data && !dict->save_event.timer_set) {
+        ngx_add_timer(&dict->save_event, 1000);
+    }
+
+    return NGX_OK;
+
+memory_error:
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    njs_vm_error3(vm, ngx_js_shared_dict_error_id, "", 0);
+
+    return NGX_ERROR;
+}
+
+
+static ngx_int_t
+ngx_js_dict_add_value(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_str_t *key, uint32_t hash, ngx_js_dict_value_t *value,
+    ngx_msec_t timeout, ngx_msec_t now)
+{
+    size_t               n;
+    ngx_js_dict_node_t  *node;
+
+    if (dict->timeout) {
+        ngx_js_dict_expire(dict, shard, now, NGX_JS_DICT_EXPIRE_BATCH);
+    }
+
+    n = sizeof(ngx_js_dict_node_t) + key->len;
+
+    node = ngx_js_dict_alloc(dict, shard, n);
+    if (node == NULL) {
+        return NGX_ERROR;
+    }
+
+    node->sn.str.data = (u_char *) node + sizeof(ngx_js_dict_node_t);
+
+    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+        node->value.str.data = ngx_js_dict_alloc(dict, shard, value->str.len);
         if (node->value.str.data == NULL) {
-            ngx_slab_free_locked(dict->shpool, node);
+            ngx_js_dict_slab_free(dict, node);
             return NGX_ERROR;
         }
 
@@ -1427,20 +1661,25 @@ ngx_js_dict_add_value(ngx_js_dict_t *dict, ngx_str_t *key,
     ngx_memcpy(node->sn.str.data, key->data, key->len);
     node->sn.str.len = key->len;
 
-    ngx_rbtree_insert(&dict->sh->rbtree, &node->sn.node);
+    ngx_rbtree_insert(&shard->rbtree, &node->sn.node);
 
     if (dict->timeout) {
         node->expire.key = now + timeout;
-        ngx_rbtree_insert(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_insert(&shard->rbtree_expire, &node->expire);
     }
 
+    ngx_js_dict_hash_insert(dict, shard, node);
+
+    shard->items++;
+
     return NGX_OK;
 }
 
 
 static ngx_int_t
-ngx_js_dict_add(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
-    njs_value_t *value, ngx_msec_t timeout, ngx_msec_t now)
+ngx_js_dict_add(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_str_t *key, uint32_t hash, njs_value_t *value, ngx_msec_t timeout,
+    ngx_msec_t now)
 {
     njs_str_t            string;
     ngx_js_dict_value_t  entry;
@@ -1457,13 +1696,14 @@ ngx_js_dict_add(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
         entry.number = njs_value_number(value);
     }
 
-    return ngx_js_dict_add_value(dict, key, &entry, timeout, now);
+    return ngx_js_dict_add_value(dict, shard, key, hash, &entry, timeout, now);
 }
 
 
 static ngx_int_t
-ngx_js_dict_update(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_js_dict_node_t *node,
-    njs_value_t *value, ngx_msec_t timeout, ngx_msec_t now)
+ngx_js_dict_update(njs_vm_t *vm, ngx_js_dict_t *dict,
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node, njs_value_t *value,
+    ngx_msec_t timeout, ngx_msec_t now)
 {
     u_char     *p;
     njs_str_t   string;
@@ -1471,12 +1711,12 @@ ngx_js_dict_update(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_js_dict_node_t *node,
     if (dict->type == NGX_JS_DICT_TYPE_STRING) {
         njs_value_string_get(vm, value, &string);
 
-        p = ngx_js_dict_alloc(dict, string.length);
+        p = ngx_js_dict_alloc(dict, shard, string.length);
         if (p == NULL) {
             return NGX_ERROR;
         }
 
-        ngx_slab_free_locked(dict->shpool, node->value.str.data);
+        ngx_js_dict_slab_free(dict, node->value.str.data);
         ngx_memcpy(p, string.start, string.length);
 
         node->value.str.data = p;
@@ -1487,9 +1727,9 @@ ngx_js_dict_update(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_js_dict_node_t *node,
     }
 
     if (dict->timeout) {
-        ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
         node->expire.key = now + timeout;
-        ngx_rbtree_insert(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_insert(&shard->rbtree_expire, &node->expire);
     }
 
     return NGX_OK;
@@ -1500,25 +1740,29 @@ static ngx_int_t
 ngx_js_dict_delete(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
     njs_value_t *retval)
 {
-    ngx_int_t            rc;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_int_t             rc;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+    shard = ngx_js_dict_shard(dict, key, &hash);
 
-    node = ngx_js_dict_lookup(dict, key);
+    ngx_rwlock_wlock(&shard->rwlock);
+
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
         return NGX_DECLINED;
     }
 
     if (dict->timeout) {
-        ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
     }
 
-    ngx_rbtree_delete(&dict->sh->rbtree, (ngx_rbtree_node_t *) node);
+    ngx_rbtree_delete(&shard->rbtree, (ngx_rbtree_node_t *) node);
 
     if (retval != NULL) {
         tp = ngx_timeofday();
@@ -1535,11 +1779,11 @@ ngx_js_dict_delete(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
         rc = NGX_OK;
     }
 
-    ngx_js_dict_node_free(dict, node);
+    ngx_js_dict_node_free(dict, shard, node);
 
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
@@ -1553,22 +1797,28 @@ static ngx_int_t
 ngx_js_dict_incr(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
     njs_value_t *delta, njs_value_t *init, double *value, ngx_msec_t timeout)
 {
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     tp = ngx_timeofday();
     now = tp->sec * 1000 + tp->msec;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+    shard = ngx_js_dict_shard(dict, key, &hash);
 
-    node = ngx_js_dict_lookup(dict, key);
+    ngx_rwlock_wlock(&shard->rwlock);
+
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
         njs_value_number_set(init, njs_value_number(init)
                                    + njs_value_number(delta));
-        if (ngx_js_dict_add(vm, dict, key, init, timeout, now) != NGX_OK) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
+        if (ngx_js_dict_add(vm, dict, shard, key, hash, init, timeout, now)
+            != NGX_OK)
+        {
+            ngx_rwlock_unlock(&shard->rwlock);
             return NGX_ERROR;
         }
 
@@ -1579,15 +1829,15 @@ ngx_js_dict_incr(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
         *value = node->value.number;
 
         if (dict->timeout) {
-            ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+            ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
             node->expire.key = now + timeout;
-            ngx_rbtree_insert(&dict->sh->rbtree_expire, &node->expire);
+            ngx_rbtree_insert(&shard->rbtree_expire, &node->expire);
         }
     }
 
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
@@ -1601,14 +1851,18 @@ static ngx_int_t
 ngx_js_dict_get(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
     njs_value_t *retval)
 {
-    ngx_int_t            rc;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_int_t             rc;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    ngx_rwlock_rlock(&shard->rwlock);
 
-    node = ngx_js_dict_lookup(dict, key);
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
         goto not_found;
@@ -1624,19 +1878,113 @@ ngx_js_dict_get(njs_vm_t *vm, ngx_js_dict_t *dict, ngx_str_t *key,
     }
 
     rc = ngx_js_dict_copy_value_locked(vm, dict, node, retval);
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return rc;
 
 not_found:
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
     njs_value_undefined_set(retval);
 
     return NGX_OK;
 }
 
 
+ngx_int_t
+ngx_js_dict_get_string(ngx_js_dict_t *dict, ngx_str_t *key, ngx_pool_t *pool,
+    ngx_str_t *value)
+{
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
+
+    ngx_rwlock_rlock(&shard->rwlock);
+
+    node = ngx_js_dict_lookup(shard, key, hash);
+
+    if (node == NULL) {
+        goto not_found;
+    }
+
+    if (dict->timeout) {
+        tp = ngx_timeofday();
+        now = tp->sec * 1000 + tp->msec;
+
+        if (now >= node->expire.key) {
+            goto not_found;
+        }
+    }
+
+    value->data = ngx_pnalloc(pool, node->value.str.len);
+    if (value->data == NULL) {
+        ngx_rwlock_unlock(&shard->rwlock);
+        return NGX_ERROR;
+    }
+
+    ngx_memcpy(value->data, node->value.str.data, node->value.str.len);
+    value->len = node->value.str.len;
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    return NGX_OK;
+
+not_found:
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    return NGX_DECLINED;
+}
+
+
+ngx_int_t
+ngx_js_dict_set_string(ngx_js_dict_t *dict, ngx_str_t *key, ngx_str_t *value,
+    ngx_msec_t timeout)
+{
+    uint32_t              hash;
+    ngx_int_t             rc;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+    ngx_js_dict_value_t   entry;
+
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
+    entry.str = *value;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
+
+    ngx_rwlock_wlock(&shard->rwlock);
+
+    node = ngx_js_dict_lookup(shard, key, hash);
+
+    if (node != NULL) {
+        if (dict->timeout) {
+            ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
+        }
+
+        ngx_rbtree_delete(&shard->rbtree, (ngx_rbtree_node_t *) node);
+
+        ngx_js_dict_node_free(dict, shard, node);
+    }
+
+    rc = ngx_js_dict_add_value(dict, shard, key, hash, &entry,
+                               timeout ? timeout : dict->timeout, now);
+
+    dict->sh->dirty = 1;
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    return rc;
+}
+
+
 static ngx_int_t
 ngx_js_dict_copy_value_locked(njs_vm_t *vm, ngx_js_dict_t *dict,
     ngx_js_dict_node_t *node, njs_value_t *retval)
@@ -1662,13 +2010,44 @@ ngx_js_dict_copy_value_locked(njs_vm_t *vm, ngx_js_dict_t *dict,
 
 
 static void
-ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_msec_t now)
+ngx_js_dict_clear(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard)
+{
+    ngx_rbtree_t       *rbtree;
+    ngx_rbtree_node_t  *rn, *next;
+
+    if (dict->timeout) {
+        ngx_js_dict_evict(dict, shard, 0x7fffffff /* INT_MAX */);
+        return;
+    }
+
+    rbtree = &shard->rbtree;
+
+    if (rbtree->root == rbtree->sentinel) {
+        return;
+    }
+
+    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+         rn != NULL;
+         rn = next)
+    {
+        next = ngx_rbtree_next(rbtree, rn);
+
+        ngx_rbtree_delete(rbtree, rn);
+
+        ngx_js_dict_node_free(dict, shard, (ngx_js_dict_node_t *) rn);
+    }
+}
+
+
+static void
+ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_msec_t now, ngx_int_t count)
 {
     ngx_rbtree_t        *rbtree;
     ngx_rbtree_node_t   *rn, *next;
     ngx_js_dict_node_t  *node;
 
-    rbtree = &dict->sh->rbtree_expire;
+    rbtree = &shard->rbtree_expire;
 
     if (rbtree->root == rbtree->sentinel) {
         return;
@@ -1678,7 +2057,7 @@ ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_msec_t now)
          rn != NULL;
          rn = next)
     {
-        if (rn->key > now) {
+        if (rn->key > now || count-- == 0) {
             return;
         }
 
@@ -1689,21 +2068,22 @@ ngx_js_dict_expire(ngx_js_dict_t *dict, ngx_msec_t now)
 
         ngx_rbtree_delete(rbtree, rn);
 
-        ngx_rbtree_delete(&dict->sh->rbtree, (ngx_rbtree_node_t *) node);
+        ngx_rbtree_delete(&shard->rbtree, (ngx_rbtree_node_t *) node);
 
-        ngx_js_dict_node_free(dict, node);
+        ngx_js_dict_node_free(dict, shard, node);
     }
 }
 
 
 static void
-ngx_js_dict_evict(ngx_js_dict_t *dict, ngx_int_t count)
+ngx_js_dict_evict(ngx_js_dict_t *dict, ngx_js_dict_shard_t *shard,
+    ngx_int_t count)
 {
     ngx_rbtree_t        *rbtree;
     ngx_rbtree_node_t   *rn, *next;
     ngx_js_dict_node_t  *node;
 
-    rbtree = &dict->sh->rbtree_expire;
+    rbtree = &shard->rbtree_expire;
 
     if (rbtree->root == rbtree->sentinel) {
         return;
@@ -1724,9 +2104,9 @@ ngx_js_dict_evict(ngx_js_dict_t *dict, ngx_int_t count)
 
         ngx_rbtree_delete(rbtree, rn);
 
-        ngx_rbtree_delete(&dict->sh->rbtree, (ngx_rbtree_node_t *) node);
+        ngx_rbtree_delete(&shard->rbtree, (ngx_rbtree_node_t *) node);
 
-        ngx_js_dict_node_free(dict, node);
+        ngx_js_dict_node_free(dict, shard, node);
     }
 }
 
@@ -1816,83 +2196,111 @@ ngx_js_render_string(njs_chb_t *chain, ngx_str_t *str)
 }
 
 
+static ngx_int_t
+ngx_js_dict_render_node(ngx_js_dict_t *dict, ngx_js_dict_node_t *node,
+    njs_chb_t *chain)
+{
+    u_char  *p, *dst;
+    size_t   len;
+
+    if (ngx_js_render_string(chain, &node->sn.str) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    njs_chb_append_literal(chain,":{");
+
+    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+        njs_chb_append_literal(chain,"\"value\":");
+
+        if (ngx_js_render_string(chain, &node->value.str) != NGX_OK) {
+            return NGX_ERROR;
+        }
+
+    } else {
+        len = sizeof("\"value\":.") + 18 + 6;
+        dst = njs_chb_reserve(chain, len);
+        if (dst == NULL) {
+            return NGX_ERROR;
+        }
+
+        p = njs_sprintf(dst, dst + len, "\"value\":%.6f",
+                        node->value.number);
+        njs_chb_written(chain, p - dst);
+    }
+
+    if (dict->timeout) {
+        len = sizeof(",\"expire\":1000000000");
+        dst = njs_chb_reserve(chain, len);
+        if (dst == NULL) {
+            return NGX_ERROR;
+        }
+
+        p = njs_sprintf(dst, dst + len, ",\"expire\":%ui",
+                        node->expire.key);
+        njs_chb_written(chain, p - dst);
+    }
+
+    njs_chb_append_literal(chain, "}");
+
+    return NGX_OK;
+}
+
+
 static ngx_int_t
 ngx_js_dict_render_json(ngx_js_dict_t *dict, njs_chb_t *chain)
 {
-    u_char              *p, *dst;
-    size_t               len;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_rbtree_t        *rbtree;
-    ngx_rbtree_node_t   *rn, *next;
-    ngx_js_dict_node_t  *node;
+    ngx_int_t             rc;
+    ngx_uint_t            i, first;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_rbtree_t         *rbtree;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     tp = ngx_timeofday();
     now = tp->sec * 1000 + tp->msec;
 
-    rbtree = &dict->sh->rbtree;
-
     njs_chb_append_literal(chain,"{");
 
-    if (rbtree->root == rbtree->sentinel) {
-        njs_chb_append_literal(chain, "}");
-        return NGX_OK;
-    }
+    first = 1;
 
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = next)
-    {
-        node = (ngx_js_dict_node_t *) rn;
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-        next = ngx_rbtree_next(rbtree, rn);
+        ngx_rwlock_rlock(&shard->rwlock);
 
-        if (dict->timeout && now >= node->expire.key) {
-            continue;
-        }
+        rbtree = &shard->rbtree;
 
-        if (ngx_js_render_string(chain, &node->sn.str) != NGX_OK) {
-            return NGX_ERROR;
+        if (rbtree->root == rbtree->sentinel) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            continue;
         }
 
-        njs_chb_append_literal(chain,":{");
-
-        if (dict->type == NGX_JS_DICT_TYPE_STRING) {
-            njs_chb_append_literal(chain,"\"value\":");
+        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+             rn != NULL;
+             rn = ngx_rbtree_next(rbtree, rn))
+        {
+            node = (ngx_js_dict_node_t *) rn;
 
-            if (ngx_js_render_string(chain, &node->value.str) != NGX_OK) {
-                return NGX_ERROR;
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
             }
 
-        } else {
-            len = sizeof("\"value\":.") + 18 + 6;
-            dst = njs_chb_reserve(chain, len);
-            if (dst == NULL) {
-                return NGX_ERROR;
+            if (!first) {
+                njs_chb_append_literal(chain, ",");
             }
 
-            p = njs_sprintf(dst, dst + len, "\"value\":%.6f",
-                            node->value.number);
-            njs_chb_written(chain, p - dst);
-        }
+            first = 0;
 
-        if (dict->timeout) {
-            len = sizeof(",\"expire\":1000000000");
-            dst = njs_chb_reserve(chain, len);
-            if (dst == NULL) {
+            rc = ngx_js_dict_render_node(dict, node, chain);
+            if (rc != NGX_OK) {
+                ngx_rwlock_unlock(&shard->rwlock);
                 return NGX_ERROR;
             }
-
-            p = njs_sprintf(dst, dst + len, ",\"expire\":%ui",
-                            node->expire.key);
-            njs_chb_written(chain, p - dst);
         }
 
-        njs_chb_append_literal(chain, "}");
-
-        if (next != NULL) {
-            njs_chb_append_literal(chain, ",");
-        }
+        ngx_rwlock_unlock(&shard->rwlock);
     }
 
     njs_chb_append_literal(chain, "}");
@@ -2400,36 +2808,35 @@ ngx_js_dict_save(ngx_js_dict_t *dict)
         return NGX_ERROR;
     }
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
-
     if (!dict->sh->dirty) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
         ngx_destroy_pool(pool);
         return NGX_OK;
     }
 
-    if (dict->sh->writing) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
+    if (!ngx_atomic_cmp_set(&dict->sh->writing, 0, ngx_pid)) {
         ngx_destroy_pool(pool);
         return NGX_AGAIN;
     }
 
-    ngx_rwlock_downgrade(&dict->sh->rwlock);
+    /*
+     * The shards are rendered one by one under their own locks,
+     * changes made while rendering mark the zone as dirty again.
+     */
+
+    dict->sh->dirty = 0;
 
     NGX_CHB_CTX_INIT(&chain, pool);
 
     rc = ngx_js_dict_render_json(dict, &chain);
 
     if (rc != NGX_OK) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
         ngx_destroy_pool(pool);
-        return rc;
-    }
 
-    dict->sh->writing = 1;
-    dict->sh->dirty = 0;
+        dict->sh->writing = 0;
+        dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+        return rc;
+    }
 
     name = dict->state_temp_file.data;
 
@@ -2523,11 +2930,566 @@ error:
 }
 
 
+static size_t
+ngx_js_dict_record_size(ngx_js_dict_t *dict, ngx_js_dict_node_t *node)
+{
+    size_t  len;
+
+    len = sizeof(uint32_t) + node->sn.str.len + sizeof(uint64_t);
+
+    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+        len += sizeof(uint32_t) + node->value.str.len;
+
+    } else {
+        len += sizeof(double);
+    }
+
+    return len;
+}
+
+
+static u_char *
+ngx_js_dict_record_write(ngx_js_dict_t *dict, ngx_js_dict_node_t *node,
+    u_char *p)
+{
+    uint32_t  len;
+    uint64_t  expire;
+
+    len = node->sn.str.len;
+    p = ngx_cpymem(p, &len, sizeof(uint32_t));
+    p = ngx_cpymem(p, node->sn.str.data, node->sn.str.len);
+
+    if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+        len = node->value.str.len;
+        p = ngx_cpymem(p, &len, sizeof(uint32_t));
+        p = ngx_cpymem(p, node->value.str.data, node->value.str.len);
+
+    } else {
+        p = ngx_cpymem(p, &node->value.number, sizeof(double));
+    }
+
+    expire = dict->timeout ? node->expire.key : 0;
+
+    return ngx_cpymem(p, &expire, sizeof(uint64_t));
+}
+
+
+static ngx_rbtree_node_t *
+ngx_js_dict_save_next(ngx_rbtree_t *rbtree, uint32_t hash, ngx_str_t *key)
+{
+    ngx_int_t           rc;
+    ngx_str_node_t     *n;
+    ngx_rbtree_node_t  *node, *sentinel, *next;
+
+    /* the first node following the key in ngx_str_rbtree_insert_value order */
+
+    node = rbtree->root;
+    sentinel = rbtree->sentinel;
+    next = NULL;
+
+    while (node != sentinel) {
+
+        if (hash != node->key) {
+
+            if (hash < node->key) {
+                next = node;
+                node = node->left;
+
+            } else {
+                node = node->right;
+            }
+
+            continue;
+        }
+
+        n = (ngx_str_node_t *) node;
+
+        rc = ngx_memn2cmp(key->data, n->str.data, key->len, n->str.len);
+
+        if (rc < 0) {
+            next = node;
+            node = node->left;
+
+        } else {
+            node = node->right;
+        }
+    }
+
+    return next;
+}
+
+
+static ngx_int_t
+ngx_js_dict_save_chunk(ngx_js_dict_t *dict, ngx_js_dict_save_t *save)
+{
+    u_char               *p;
+    size_t                len;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_rbtree_t         *rbtree;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node, *last;
+    ngx_js_dict_shard_t  *shard;
+
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
+    while (save->shard < dict->shards) {
+        shard = &dict->sh->shards[save->shard];
+        rbtree = &shard->rbtree;
+
+        ngx_rwlock_rlock(&shard->rwlock);
+
+        if (save->key.data != NULL) {
+            rn = ngx_js_dict_save_next(rbtree, save->hash, &save->key);
+
+        } else if (rbtree->root != rbtree->sentinel) {
+            rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+
+        } else {
+            rn = NULL;
+        }
+
+        last = NULL;
+
+        for ( /* void */ ; rn != NULL; rn = ngx_rbtree_next(rbtree, rn)) {
+            node = (ngx_js_dict_node_t *) rn;
+
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
+            }
+
+            len = ngx_js_dict_record_size(dict, node);
+
+            if ((size_t) (save->end - save->pos) < len) {
+
+                if (save->pos != save->start) {
+                    goto again;
+                }
+
+                p = ngx_pnalloc(save->pool, len);
+                if (p == NULL) {
+                    ngx_rwlock_unlock(&shard->rwlock);
+                    return NGX_ERROR;
+                }
+
+                save->start = p;
+                save->pos = ngx_js_dict_record_write(dict, node, p);
+                save->end = save->pos;
+
+                last = node;
+
+                goto again;
+            }
+
+            save->pos = ngx_js_dict_record_write(dict, node, save->pos);
+
+            last = node;
+        }
+
+        ngx_rwlock_unlock(&shard->rwlock);
+
+        save->shard++;
+        save->key.data = NULL;
+    }
+
+    return NGX_OK;
+
+again:
+
+    if (last != NULL) {
+        save->hash = last->sn.node.key;
+        save->key.len = last->sn.str.len;
+
+        save->key.data = ngx_pnalloc(save->pool, save->key.len + 1);
+        if (save->key.data == NULL) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            return NGX_ERROR;
+        }
+
+        ngx_memcpy(save->key.data, last->sn.str.data, save->key.len);
+    }
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    return NGX_AGAIN;
+}
+
+
+static ngx_int_t
+ngx_js_dict_save_binary(ngx_js_dict_t *dict)
+{
+    u_char                      *p;
+    ngx_int_t                    rc;
+    ngx_log_t                   *log;
+    ngx_pool_t                  *pool;
+    ngx_js_dict_save_t          *save;
+    ngx_ext_rename_file_t        ext;
+    ngx_js_dict_state_header_t   header;
+
+    log = dict->shm_zone->shm.log;
+
+    save = dict->save;
+
+    if (save == NULL) {
+
+        if (!dict->sh->dirty) {
+            return NGX_OK;
+        }
+
+        if (!ngx_atomic_cmp_set(&dict->sh->writing, 0, ngx_pid)) {
+            return NGX_AGAIN;
+        }
+
+        pool = ngx_create_pool(NGX_DEFAULT_POOL_SIZE, log);
+        if (pool == NULL) {
+            dict->sh->writing = 0;
+            return NGX_ERROR;
+        }
+
+        save = ngx_pcalloc(pool, sizeof(ngx_js_dict_save_t));
+        if (save == NULL) {
+            ngx_destroy_pool(pool);
+            dict->sh->writing = 0;
+            return NGX_ERROR;
+        }
+
+        p = ngx_pnalloc(pool, NGX_JS_DICT_SAVE_CHUNK);
+        if (p == NULL) {
+            ngx_destroy_pool(pool);
+            dict->sh->writing = 0;
+            return NGX_ERROR;
+        }
+
+        save->pool = pool;
+        save->chunk = p;
+        save->start = p;
+        save->pos = p;
+        save->end = p + NGX_JS_DICT_SAVE_CHUNK;
+
+        save->file.name = dict->state_temp_file;
+        save->file.log = log;
+
+        save->file.fd = ngx_open_file(save->file.name.data, NGX_FILE_WRONLY,
+                                      NGX_FILE_TRUNCATE,
+                                      NGX_FILE_DEFAULT_ACCESS);
+
+        if (save->file.fd == NGX_INVALID_FILE) {
+            ngx_log_error(NGX_LOG_ALERT, log, ngx_errno,
+                          ngx_open_file_n " \"%s\" failed",
+                          save->file.name.data);
+            ngx_destroy_pool(pool);
+            dict->sh->writing = 0;
+            return NGX_ERROR;
+        }
+
+        dict->save = save;
+
+        /*
+         * The state is written in chunks across several event loop
+         * iterations, changes made meanwhile mark the zone as dirty again.
+         */
+
+        dict->sh->dirty = 0;
+
+        ngx_memcpy(header.magic, NGX_JS_DICT_STATE_MAGIC, 4);
+        header.version = NGX_JS_DICT_STATE_VERSION;
+        header.type = (u_char) dict->type;
+        header.reserved[0] = 0;
+        header.reserved[1] = 0;
+
+        save->pos = ngx_cpymem(save->pos, &header, sizeof(header));
+    }
+
+    rc = ngx_js_dict_save_chunk(dict, save);
+
+    if (rc == NGX_ERROR) {
+        goto failed;
+    }
+
+    if (save->pos != save->start) {
+        if (ngx_write_file(&save->file, save->start, save->pos - save->start,
+                           save->file.offset)
+            == NGX_ERROR)
+        {
+            goto failed;
+        }
+
+        if (save->start != save->chunk) {
+            ngx_pfree(save->pool, save->start);
+
+            save->start = save->chunk;
+            save->end = save->chunk + NGX_JS_DICT_SAVE_CHUNK;
+        }
+
+        save->pos = save->start;
+    }
+
+    if (rc == NGX_AGAIN) {
+        return NGX_DONE;
+    }
+
+    if (ngx_close_file(save->file.fd) == NGX_FILE_ERROR) {
+        ngx_log_error(NGX_LOG_ALERT, log, ngx_errno,
+                      ngx_close_file_n " \"%s\" failed", save->file.name.data);
+    }
+
+    save->file.fd = NGX_INVALID_FILE;
+
+    ext.access = 0;
+    ext.time = -1;
+    ext.create_path = 0;
+    ext.delete_file = 0;
+    ext.log = log;
+
+    if (ngx_ext_rename_file(&dict->state_temp_file, &dict->state_file, &ext)
+        != NGX_OK)
+    {
+        goto failed;
+    }
+
+    ngx_destroy_pool(save->pool);
+    dict->save = NULL;
+
+    /* no lock required */
+    dict->sh->writing = 0;
+
+    return NGX_OK;
+
+failed:
+
+    if (save->file.fd != NGX_INVALID_FILE
+        && ngx_close_file(save->file.fd) == NGX_FILE_ERROR)
+    {
+        ngx_log_error(NGX_LOG_ALERT, log, ngx_errno,
+                      ngx_close_file_n " \"%s\" failed", save->file.name.data);
+    }
+
+    ngx_destroy_pool(save->pool);
+    dict->save = NULL;
+
+    /* no lock required */
+    dict->sh->writing = 0;
+    dict->sh->dirty = 1;
+
+    return NGX_ERROR;
+}
+
+
+static ngx_int_t
+ngx_js_dict_restore(ngx_js_dict_t *dict, ngx_js_dict_entry_t *entry,
+    ngx_msec_t now)
+{
+    uint32_t              hash;
+    ngx_msec_t            expire;
+    ngx_js_dict_shard_t  *shard;
+
+    if (dict->timeout) {
+        expire = entry->expire;
+
+        if (expire && now >= expire) {
+            dict->sh->dirty = 1;
+            return NGX_OK;
+        }
+
+        if (expire == 0) {
+            /* treat state without expire as new */
+            expire = now + dict->timeout;
+            dict->sh->dirty = 1;
+        }
+
+    } else {
+        expire = 0;
+    }
+
+    shard = ngx_js_dict_shard(dict, &entry->key, &hash);
+
+    if (ngx_js_dict_lookup(shard, &entry->key, hash) != NULL) {
+        return NGX_ERROR;
+    }
+
+    return ngx_js_dict_add_value(dict, shard, &entry->key, hash,
+                                 &entry->value, expire, 1);
+}
+
+
+static ngx_int_t
+ngx_js_dict_load_fill(ngx_js_dict_load_t *ld, size_t n)
+{
+    u_char   *p;
+    size_t    len, size;
+    ssize_t   rd;
+
+    len = ld->last - ld->pos;
+
+    if (len >= n) {
+        return NGX_OK;
+    }
+
+    if ((off_t) (n - len) > ld->size - ld->file->offset) {
+        ngx_log_error(NGX_LOG_EMERG, ld->file->log, 0,
+                      "state file \"%V\" is truncated", &ld->file->name);
+        return NGX_ERROR;
+    }
+
+    if (n > (size_t) (ld->end - ld->start)) {
+        size = ngx_max(n, NGX_JS_DICT_SAVE_CHUNK);
+
+        p = ngx_pnalloc(ld->pool, size);
+        if (p == NULL) {
+            return NGX_ERROR;
+        }
+
+        ld->start = p;
+        ld->end = p + size;
+
+    } else {
+        p = ld->start;
+    }
+
+    if (len) {
+        ngx_memmove(p, ld->pos, len);
+    }
+
+    ld->pos = p;
+    ld->last = p + len;
+
+    size = ngx_min((off_t) (ld->end - ld->last),
+                   ld->size - ld->file->offset);
+
+    rd = ngx_read_file(ld->file, ld->last, size, ld->file->offset);
+
+    if (rd == NGX_ERROR) {
+        return NGX_ERROR;
+    }
+
+    if ((size_t) rd != size) {
+        ngx_log_error(NGX_LOG_EMERG, ld->file->log, 0,
+                      ngx_read_file_n " has read only %z of %uz from %V",
+                      rd, size, &ld->file->name);
+        return NGX_ERROR;
+    }
+
+    ld->last += rd;
+
+    return NGX_OK;
+}
+
+
+static ngx_int_t
+ngx_js_dict_load_binary(ngx_js_dict_t *dict, ngx_file_t *file, off_t size,
+    ngx_pool_t *pool)
+{
+    u_char                      *p;
+    size_t                       n;
+    uint32_t                     len;
+    uint64_t                     expire;
+    ngx_msec_t                   now;
+    ngx_time_t                  *tp;
+    ngx_js_dict_load_t           ld;
+    ngx_js_dict_entry_t          entry;
+    ngx_js_dict_state_header_t   header;
+
+    ngx_memzero(&ld, sizeof(ngx_js_dict_load_t));
+
+    ld.file = file;
+    ld.size = size;
+    ld.pool = pool;
+
+    if (ngx_js_dict_load_fill(&ld, sizeof(header)) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    ngx_memcpy(&header, ld.pos, sizeof(header));
+    ld.pos += sizeof(header);
+
+    if (header.version != NGX_JS_DICT_STATE_VERSION) {
+        ngx_log_error(NGX_LOG_EMERG, file->log, 0,
+                      "state file \"%V\" has unsupported version %ui",
+                      &file->name, (ngx_uint_t) header.version);
+        return NGX_ERROR;
+    }
+
+    if (header.type != dict->type) {
+        ngx_log_error(NGX_LOG_EMERG, file->log, 0,
+                      "state file \"%V\" has a different dict type",
+                      &file->name);
+        return NGX_ERROR;
+    }
+
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
+    while (ld.pos < ld.last || file->offset < size) {
+
+        n = sizeof(uint32_t);
+
+        if (ngx_js_dict_load_fill(&ld, n) != NGX_OK) {
+            return NGX_ERROR;
+        }
+
+        ngx_memcpy(&len, ld.pos, sizeof(uint32_t));
+        n += len;
+
+        if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+            if (ngx_js_dict_load_fill(&ld, n + sizeof(uint32_t)) != NGX_OK) {
+                return NGX_ERROR;
+            }
+
+            ngx_memcpy(&len, ld.pos + n, sizeof(uint32_t));
+            n += sizeof(uint32_t) + len;
+
+        } else {
+            n += sizeof(double);
+        }
+
+        n += sizeof(uint64_t);
+
+        if (ngx_js_dict_load_fill(&ld, n) != NGX_OK) {
+            return NGX_ERROR;
+        }
+
+        p = ld.pos;
+
+        ngx_memcpy(&len, p, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+
+        entry.key.data = p;
+        entry.key.len = len;
+        p += len;
+
+        if (dict->type == NGX_JS_DICT_TYPE_STRING) {
+            ngx_memcpy(&len, p, sizeof(uint32_t));
+            p += sizeof(uint32_t);
+
+            entry.value.str.data = p;
+            entry.value.str.len = len;
+            p += len;
+
+        } else {
+            ngx_memcpy(&entry.value.number, p, sizeof(double));
+            p += sizeof(double);
+        }
+
+        ngx_memcpy(&expire, p, sizeof(uint64_t));
+        entry.expire = (ngx_msec_t) expire;
+
+        if (ngx_js_dict_restore(dict, &entry, now) != NGX_OK) {
+            return NGX_ERROR;
+        }
+
+        ld.pos += n;
+    }
+
+    return NGX_OK;
+}
+
+
 static ngx_int_t
 ngx_js_dict_load(ngx_js_dict_t *dict)
 {
     off_t                        size;
-    u_char                      *name, *buf;
+    u_char                      *name, *buf, magic[4];
     size_t                       len;
     ssize_t                      n;
     ngx_fd_t                     fd;
@@ -2535,7 +3497,8 @@ ngx_js_dict_load(ngx_js_dict_t *dict)
     ngx_int_t                    rc;
     ngx_log_t                   *log;
     ngx_uint_t                   i;
-    ngx_msec_t                   now, expire;
+    ngx_msec_t                   now;
+    ngx_file_t                   file;
     ngx_time_t                  *tp;
     ngx_pool_t                  *pool;
     ngx_array_t                  data;
@@ -2587,6 +3550,31 @@ ngx_js_dict_load(ngx_js_dict_t *dict)
         goto failed;
     }
 
+    ngx_memzero(&file, sizeof(ngx_file_t));
+    file.fd = fd;
+    file.name = dict->state_file;
+    file.log = log;
+
+    if (size >= (off_t) sizeof(ngx_js_dict_state_header_t)) {
+        n = ngx_read_file(&file, magic, sizeof(magic), 0);
+
+        if (n == NGX_ERROR) {
+            goto failed;
+        }
+
+        if (n == sizeof(magic)
+            && ngx_memcmp(magic, NGX_JS_DICT_STATE_MAGIC, sizeof(magic)) == 0)
+        {
+            file.offset = 0;
+
+            if (ngx_js_dict_load_binary(dict, &file, size, pool) != NGX_OK) {
+                goto failed;
+            }
+
+            goto done;
+        }
+    }
+
     len = size;
 
     buf = ngx_pnalloc(pool, len);
@@ -2594,30 +3582,19 @@ ngx_js_dict_load(ngx_js_dict_t *dict)
         goto failed;
     }
 
-    n = ngx_read_fd(fd, buf, len);
+    n = ngx_read_file(&file, buf, len, 0);
 
-    if (n == -1) {
-        ngx_log_error(NGX_LOG_EMERG, log, ngx_errno,
-                      ngx_read_fd_n " \"%s\" failed", name);
+    if (n == NGX_ERROR) {
         goto failed;
     }
 
     if ((size_t) n != len) {
         ngx_log_error(NGX_LOG_EMERG, log, 0,
-                      ngx_read_fd_n " has read only %z of %uz from %s",
+                      ngx_read_file_n " has read only %z of %uz from %s",
                       n, len, name);
         goto failed;
     }
 
-    if (ngx_close_file(fd) == NGX_FILE_ERROR) {
-        ngx_log_error(NGX_LOG_EMERG, log, ngx_errno,
-                      ngx_close_file_n " \"%s\" failed", name);
-        fd = NGX_INVALID_FILE;
-        goto failed;
-    }
-
-    fd = NGX_INVALID_FILE;
-
     if (ngx_array_init(&data, pool, 4, sizeof(ngx_js_dict_entry_t))
         != NGX_OK)
     {
@@ -2636,35 +3613,18 @@ ngx_js_dict_load(ngx_js_dict_t *dict)
     now = tp->sec * 1000 + tp->msec;
 
     for (i = 0; i < data.nelts; i++) {
-
-        if (dict->timeout) {
-            expire = entries[i].expire;
-
-            if (expire && now >= expire) {
-                dict->sh->dirty = 1;
-                continue;
-            }
-
-            if (expire == 0) {
-                /* treat state without expire as new */
-                expire = now + dict->timeout;
-                dict->sh->dirty = 1;
-            }
-
-        } else {
-            expire = 0;
-        }
-
-        if (ngx_js_dict_lookup(dict, &entries[i].key) != NULL) {
+        if (ngx_js_dict_restore(dict, &entries[i], now) != NGX_OK) {
             goto failed;
         }
+    }
 
-        if (ngx_js_dict_add_value(dict, &entries[i].key, &entries[i].value,
-                                  expire, 1)
-            != NGX_OK)
-        {
-            goto failed;
-        }
+done:
+
+    if (ngx_close_file(fd) == NGX_FILE_ERROR) {
+        ngx_log_error(NGX_LOG_EMERG, log, ngx_errno,
+                      ngx_close_file_n " \"%s\" failed", name);
+        fd = NGX_INVALID_FILE;
+        goto failed;
     }
 
     ngx_destroy_pool(pool);
@@ -2694,12 +3654,23 @@ ngx_js_dict_save_handler(ngx_event_t *ev)
 
     dict = ev->data;
 
-    rc = ngx_js_dict_save(dict);
+    if (dict->state_format == NGX_JS_DICT_STATE_BINARY) {
+        rc = ngx_js_dict_save_binary(dict);
+
+    } else {
+        rc = ngx_js_dict_save(dict);
+    }
 
     if (rc == NGX_OK) {
         return;
     }
 
+    if (rc == NGX_DONE) {
+        /* continue saving on the next event loop iteration */
+        ngx_add_timer(ev, 1);
+        return;
+    }
+
     if (rc == NGX_ERROR && (ngx_terminate || ngx_exiting)) {
         ngx_log_error(NGX_LOG_ALERT, ev->log, 0,
                       "failed to save the state of shared dict zone \"%V\"",
@@ -2716,21 +3687,37 @@ ngx_js_dict_save_handler(ngx_event_t *ev)
 ngx_int_t
 ngx_js_dict_init_worker(ngx_js_main_conf_t *jmcf)
 {
+    ngx_pid_t       pid;
+    ngx_uint_t      save;
     ngx_js_dict_t  *dict;
 
-    if ((ngx_process != NGX_PROCESS_WORKER || ngx_worker != 0)
-        && ngx_process != NGX_PROCESS_SINGLE)
-    {
-        return NGX_OK;
-    }
-
     if (jmcf->dicts == NULL) {
         return NGX_OK;
     }
 
+    save = (ngx_process == NGX_PROCESS_WORKER && ngx_worker == 0)
+           || ngx_process == NGX_PROCESS_SINGLE;
+
     for (dict = jmcf->dicts; dict != NULL; dict = dict->next) {
 
-        if (!dict->sh->dirty || !dict->state_file.data) {
+        if (!dict->state_file.data) {
+            continue;
+        }
+
+        pid = (ngx_pid_t) dict->sh->writing;
+
+        if (pid != 0 && kill(pid, 0) == -1 && ngx_errno == NGX_ESRCH) {
+
+            /* the process saving the state has exited */
+
+            if (ngx_atomic_cmp_set(&dict->sh->writing, pid, 0)) {
+                dict->sh->dirty = 1;
+                ngx_add_timer(&dict->save_event, 1000);
+                continue;
+            }
+        }
+
+        if (!save || !dict->sh->dirty) {
             continue;
         }
 
@@ -2746,8 +3733,10 @@ ngx_js_dict_init_zone(ngx_shm_zone_t *shm_zone, void *data)
 {
     ngx_js_dict_t  *prev = data;
 
-    size_t          len;
-    ngx_js_dict_t  *dict;
+    size_t                len;
+    ngx_uint_t            i;
+    ngx_js_dict_t        *dict;
+    ngx_js_dict_shard_t  *shard;
 
     dict = shm_zone->data;
 
@@ -2768,6 +3757,13 @@ ngx_js_dict_init_zone(ngx_shm_zone_t *shm_zone, void *data)
             return NGX_ERROR;
         }
 
+        if (dict->shards != prev->shards) {
+            ngx_log_error(NGX_LOG_EMERG, shm_zone->shm.log, 0,
+                          "js_shared_dict_zone \"%V\" had previously a "
+                          "different number of shards", &shm_zone->shm.name);
+            return NGX_ERROR;
+        }
+
         dict->sh = prev->sh;
         dict->shpool = prev->shpool;
 
@@ -2781,20 +3777,34 @@ ngx_js_dict_init_zone(ngx_shm_zone_t *shm_zone, void *data)
         return NGX_OK;
     }
 
-    dict->sh = ngx_slab_calloc(dict->shpool, sizeof(ngx_js_dict_sh_t));
+    len = offsetof(ngx_js_dict_sh_t, shards)
+          + dict->shards * sizeof(ngx_js_dict_shard_t);
+
+    dict->sh = ngx_slab_calloc(dict->shpool, len);
     if (dict->sh == NULL) {
         return NGX_ERROR;
     }
 
     dict->shpool->data = dict->sh;
 
-    ngx_rbtree_init(&dict->sh->rbtree, &dict->sh->sentinel,
-                    ngx_str_rbtree_insert_value);
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-    if (dict->timeout) {
-        ngx_rbtree_init(&dict->sh->rbtree_expire,
-                        &dict->sh->sentinel_expire,
-                        ngx_rbtree_insert_timer_value);
+        ngx_rbtree_init(&shard->rbtree, &shard->sentinel,
+                        ngx_str_rbtree_insert_value);
+
+        shard->nbuckets = NGX_JS_DICT_HASH_SIZE;
+        shard->buckets = ngx_slab_calloc(dict->shpool,
+                                         shard->nbuckets
+                                         * sizeof(ngx_js_dict_node_t *));
+        if (shard->buckets == NULL) {
+            return NGX_ERROR;
+        }
+
+        if (dict->timeout) {
+            ngx_rbtree_init(&shard->rbtree_expire, &shard->sentinel_expire,
+                            ngx_rbtree_insert_timer_value);
+        }
     }
 
     len = sizeof(" in js shared dict zone \"\"") + shm_zone->shm.name.len;
@@ -2821,21 +3831,23 @@ ngx_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
 {
     ngx_js_main_conf_t  *jmcf = conf;
 
-    u_char          *p;
-    ssize_t          size;
-    ngx_str_t       *value, name, file, s;
-    ngx_flag_t       evict;
-    ngx_msec_t       timeout;
-    ngx_uint_t       i, type;
-    ngx_js_dict_t   *dict;
-    ngx_shm_zone_t  *shm_zone;
+    u_char         *p;
+    ssize_t         size;
+    ngx_int_t       shards;
+    ngx_str_t      *value, name, file, s;
+    ngx_flag_t      evict;
+    ngx_msec_t      timeout;
+    ngx_uint_t      i, type, format;
+    ngx_js_dict_t  *dict;
 
     size = 0;
     evict = 0;
+    shards = 1;
     timeout = 0;
     name.len = 0;
     ngx_str_null(&file);
     type = NGX_JS_DICT_TYPE_STRING;
+    format = NGX_JS_DICT_STATE_JSON;
 
     value = cf->args->elts;
 
@@ -2843,92 +3855,191 @@ ngx_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
 
         if (ngx_strncmp(value[i].data, "zone=", 5) == 0) {
 
-            name.data = value[i].data + 5;
+            if (ngx_js_dict_parse_zone(cf, &value[i], &name, &size)
+                != NGX_OK)
+            {
+                return NGX_CONF_ERROR;
+            }
 
-            p = (u_char *) ngx_strchr(name.data, ':');
+            continue;
+        }
 
-            if (p == NULL) {
+        if (ngx_strncmp(value[i].data, "evict", 5) == 0) {
+            evict = 1;
+            continue;
+        }
+
+        if (ngx_strncmp(value[i].data, "shards=", 7) == 0) {
+
+            shards = ngx_atoi(value[i].data + 7, value[i].len - 7);
+            if (shards == NGX_ERROR || shards == 0) {
                 ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "invalid zone size \"%V\"", &value[i]);
+                                   "invalid shards value \"%V\"", &value[i]);
                 return NGX_CONF_ERROR;
             }
 
-            name.len = p - name.data;
+            continue;
+        }
 
-            if (name.len == 0) {
-                ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "invalid zone name \"%V\"", &value[i]);
+        if (ngx_strncmp(value[i].data, "state=", 6) == 0) {
+            file.data = value[i].data + 6;
+            file.len = value[i].len - 6;
+
+            if (ngx_conf_full_name(cf->cycle, &file, 0) != NGX_OK) {
                 return NGX_CONF_ERROR;
             }
 
-            s.data = p + 1;
-            s.len = value[i].data + value[i].len - s.data;
+            continue;
+        }
+
+        if (ngx_strncmp(value[i].data, "state_format=", 13) == 0) {
+
+            if (ngx_strcmp(&value[i].data[13], "json") == 0) {
+                format = NGX_JS_DICT_STATE_JSON;
 
-            size = ngx_parse_size(&s);
+            } else if (ngx_strcmp(&value[i].data[13], "binary") == 0) {
+                format = NGX_JS_DICT_STATE_BINARY;
 
-            if (size == NGX_ERROR) {
+            } else {
                 ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "invalid zone size \"%V\"", &value[i]);
+                                   "invalid state format \"%s\"",
+                                   &value[i].data[13]);
                 return NGX_CONF_ERROR;
             }
 
-            if (size < (ssize_t) (8 * ngx_pagesize)) {
+            continue;
+        }
+
+        if (ngx_strncmp(value[i].data, "timeout=", 8) == 0) {
+
+            s.data = value[i].data + 8;
+            s.len = value[i].len - 8;
+
+            timeout = ngx_parse_time(&s, 0);
+            if (timeout == (ngx_msec_t) NGX_ERROR) {
                 ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "zone \"%V\" is too small", &value[i]);
+                                   "invalid timeout value \"%V\"", &value[i]);
                 return NGX_CONF_ERROR;
             }
 
             continue;
         }
 
-        if (ngx_strncmp(value[i].data, "evict", 5) == 0) {
-            evict = 1;
-            continue;
-        }
+        if (ngx_strncmp(value[i].data, "type=", 5) == 0) {
 
-        if (ngx_strncmp(value[i].data, "state=", 6) == 0) {
-            file.data = value[i].data + 6;
-            file.len = value[i].len - 6;
+            if (ngx_strcmp(&value[i].data[5], "string") == 0) {
+                type = NGX_JS_DICT_TYPE_STRING;
 
-            if (ngx_conf_full_name(cf->cycle, &file, 0) != NGX_OK) {
+            } else if (ngx_strcmp(&value[i].data[5], "number") == 0) {
+                type = NGX_JS_DICT_TYPE_NUMBER;
+
+            } else {
+                ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                                   "invalid dict type \"%s\"",
+                                   &value[i].data[5]);
                 return NGX_CONF_ERROR;
             }
 
             continue;
         }
+    }
 
-        if (ngx_strncmp(value[i].data, "timeout=", 8) == 0) {
+    if (name.len == 0) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "\"%V\" must have \"zone\" parameter", &cmd->name);
+        return NGX_CONF_ERROR;
+    }
 
-            s.data = value[i].data + 8;
-            s.len = value[i].len - 8;
+    if (evict && timeout == 0) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "evict requires timeout=");
+        return NGX_CONF_ERROR;
+    }
+
+    dict = ngx_js_dict_add_zone(cf, &name, size, tag);
+    if (dict == NULL) {
+        return NGX_CONF_ERROR;
+    }
+
+    dict->next = jmcf->dicts;
+    jmcf->dicts = dict;
+
+    dict->evict = evict;
+    dict->timeout = timeout;
+    dict->type = type;
+    dict->shards = shards;
+    dict->state_format = format;
+
+    if (file.data) {
+        dict->state_file = file;
+
+        p = ngx_pnalloc(cf->pool, file.len + sizeof(".tmp"));
+        if (p == NULL) {
+            return NGX_CONF_ERROR;
+        }
+
+        dict->state_temp_file.data = p;
+        dict->state_temp_file.len = ngx_sprintf(p, "%V.tmp%Z", &file) - p - 1;
+    }
+
+    return NGX_CONF_OK;
+}
+
+
+char *
+ngx_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
+    void *tag)
+{
+    ngx_js_main_conf_t  *jmcf = conf;
+
+    ssize_t         size;
+    ngx_str_t      *value, name, s;
+    ngx_msec_t      inactive;
+    ngx_uint_t      i;
+    ngx_js_dict_t  *dict;
+
+    if (jmcf->fetch_cache != NULL) {
+        return "is duplicate";
+    }
+
+    size = 0;
+    name.len = 0;
+    inactive = 600000;
+
+    value = cf->args->elts;
+
+    for (i = 1; i < cf->args->nelts; i++) {
+
+        if (ngx_strncmp(value[i].data, "zone=", 5) == 0) {
 
-            timeout = ngx_parse_time(&s, 0);
-            if (timeout == (ngx_msec_t) NGX_ERROR) {
-                ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "invalid timeout value \"%V\"", &value[i]);
+            if (ngx_js_dict_parse_zone(cf, &value[i], &name, &size)
+                != NGX_OK)
+            {
                 return NGX_CONF_ERROR;
             }
 
             continue;
         }
 
-        if (ngx_strncmp(value[i].data, "type=", 5) == 0) {
-
-            if (ngx_strcmp(&value[i].data[5], "string") == 0) {
-                type = NGX_JS_DICT_TYPE_STRING;
+        if (ngx_strncmp(value[i].data, "inactive=", 9) == 0) {
 
-            } else if (ngx_strcmp(&value[i].data[5], "number") == 0) {
-                type = NGX_JS_DICT_TYPE_NUMBER;
+            s.data = value[i].data + 9;
+            s.len = value[i].len - 9;
 
-            } else {
+            inactive = ngx_parse_time(&s, 0);
+            if (inactive == (ngx_msec_t) NGX_ERROR || inactive == 0) {
                 ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                                   "invalid dict type \"%s\"",
-                                   &value[i].data[5]);
+                                   "invalid inactive value \"%V\"",
+                                   &value[i]);
                 return NGX_CONF_ERROR;
             }
 
             continue;
         }
+
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "invalid parameter \"%V\"", &value[i]);
+        return NGX_CONF_ERROR;
     }
 
     if (name.len == 0) {
@@ -2937,57 +4048,108 @@ ngx_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf,
         return NGX_CONF_ERROR;
     }
 
-    if (evict && timeout == 0) {
-        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
-                           "evict requires timeout=");
+    dict = ngx_js_dict_add_zone(cf, &name, size, tag);
+    if (dict == NULL) {
         return NGX_CONF_ERROR;
     }
 
-    shm_zone = ngx_shared_memory_add(cf, &name, size, tag);
+    /*
+     * Cached responses are kept for "inactive" after they become stale
+     * to allow conditional revalidation, the least recently stored ones
+     * are evicted when the zone is full.
+     */
+
+    dict->evict = 1;
+    dict->timeout = inactive;
+    dict->type = NGX_JS_DICT_TYPE_STRING;
+    dict->shards = 1;
+
+    jmcf->fetch_cache = dict;
+    jmcf->fetch_cache_inactive = inactive;
+
+    return NGX_CONF_OK;
+}
+
+
+static ngx_int_t
+ngx_js_dict_parse_zone(ngx_conf_t *cf, ngx_str_t *value, ngx_str_t *name,
+    ssize_t *size)
+{
+    u_char     *p;
+    ngx_str_t   s;
+
+    name->data = value->data + 5;
+
+    p = (u_char *) ngx_strchr(name->data, ':');
+
+    if (p == NULL) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "invalid zone size \"%V\"", value);
+        return NGX_ERROR;
+    }
+
+    name->len = p - name->data;
+
+    if (name->len == 0) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "invalid zone name \"%V\"", value);
+        return NGX_ERROR;
+    }
+
+    s.data = p + 1;
+    s.len = value->data + value->len - s.data;
+
+    *size = ngx_parse_size(&s);
+
+    if (*size == NGX_ERROR) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "invalid zone size \"%V\"", value);
+        return NGX_ERROR;
+    }
+
+    if (*size < (ssize_t) (8 * ngx_pagesize)) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "zone \"%V\" is too small", value);
+        return NGX_ERROR;
+    }
+
+    return NGX_OK;
+}
+
+
+static ngx_js_dict_t *
+ngx_js_dict_add_zone(ngx_conf_t *cf, ngx_str_t *name, ssize_t size, void *tag)
+{
+    ngx_js_dict_t   *dict;
+    ngx_shm_zone_t  *shm_zone;
+
+    shm_zone = ngx_shared_memory_add(cf, name, size, tag);
     if (shm_zone == NULL) {
-        return NGX_CONF_ERROR;
+        return NULL;
     }
 
     if (shm_zone->data) {
         ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, "duplicate zone \"%V\"",
-                           &name);
-        return NGX_CONF_ERROR;
+                           name);
+        return NULL;
     }
 
     dict = ngx_pcalloc(cf->pool, sizeof(ngx_js_dict_t));
     if (dict == NULL) {
-        return NGX_CONF_ERROR;
+        return NULL;
     }
 
     dict->shm_zone = shm_zone;
-    dict->next = jmcf->dicts;
-    jmcf->dicts = dict;
 
     shm_zone->data = dict;
     shm_zone->init = ngx_js_dict_init_zone;
 
-    dict->evict = evict;
-    dict->timeout = timeout;
-    dict->type = type;
-
     dict->save_event.handler = ngx_js_dict_save_handler;
     dict->save_event.data = dict;
     dict->save_event.log = &cf->cycle->new_log;
     dict->fd = -1;
 
-    if (file.data) {
-        dict->state_file = file;
-
-        p = ngx_pnalloc(cf->pool, file.len + sizeof(".tmp"));
-        if (p == NULL) {
-            return NGX_CONF_ERROR;
-        }
-
-        dict->state_temp_file.data = p;
-        dict->state_temp_file.len = ngx_sprintf(p, "%V.tmp%Z", &file) - p - 1;
-    }
-
-    return NGX_CONF_OK;
+    return dict;
 }
 
 
@@ -3148,10 +4310,10 @@ static JSValue
 ngx_qjs_ext_shared_dict_clear(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv)
 {
-    ngx_rbtree_t       *rbtree;
-    ngx_js_dict_t      *dict;
-    ngx_shm_zone_t     *shm_zone;
-    ngx_rbtree_node_t  *rn, *next;
+    ngx_uint_t            i;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = JS_GetOpaque(this_val, NGX_QJS_CLASS_ID_SHARED_DICT);
     if (shm_zone == NULL) {
@@ -3160,36 +4322,16 @@ ngx_qjs_ext_shared_dict_clear(JSContext *cx, JSValueConst this_val,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        ngx_js_dict_evict(dict, 0x7fffffff /* INT_MAX */);
-
-    } else {
-        rbtree = &dict->sh->rbtree;
-
-        if (rbtree->root == rbtree->sentinel) {
-            goto done;
-        }
-
-        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-             rn != NULL;
-             rn = next)
-        {
-            next = ngx_rbtree_next(rbtree, rn);
-
-            ngx_rbtree_delete(rbtree, rn);
+    for (i = 0; i < dict->shards; i++) {
+        shard = &dict->sh->shards[i];
 
-            ngx_js_dict_node_free(dict, (ngx_js_dict_node_t *) rn);
-        }
+        ngx_rwlock_wlock(&shard->rwlock);
+        ngx_js_dict_clear(dict, shard);
+        ngx_rwlock_unlock(&shard->rwlock);
     }
 
-done:
-
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
-
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
     }
@@ -3233,9 +4375,7 @@ ngx_qjs_ext_shared_dict_free_space(JSContext *cx, JSValueConst this_val,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-    bytes = dict->shpool->pfree * ngx_pagesize;
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    bytes = ngx_js_dict_free_space(dict);
 
     return JS_NewInt32(cx, bytes);
 }
@@ -3265,12 +4405,14 @@ static JSValue
 ngx_qjs_ext_shared_dict_has(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv)
 {
-    ngx_str_t            key;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_str_t             key;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = JS_GetOpaque(this_val, NGX_QJS_CLASS_ID_SHARED_DICT);
     if (shm_zone == NULL) {
@@ -3282,10 +4424,11 @@ ngx_qjs_ext_shared_dict_has(JSContext *cx, JSValueConst this_val,
     }
 
     dict = shm_zone->data;
+    shard = ngx_js_dict_shard(dict, &key, &hash);
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    ngx_rwlock_rlock(&shard->rwlock);
 
-    node = ngx_qjs_dict_lookup(dict, &key);
+    node = ngx_js_dict_lookup(shard, &key, hash);
 
     if (node != NULL && dict->timeout) {
         tp = ngx_timeofday();
@@ -3296,7 +4439,7 @@ ngx_qjs_ext_shared_dict_has(JSContext *cx, JSValueConst this_val,
         }
     }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return JS_NewBool(cx, node != NULL);
 }
@@ -3365,15 +4508,17 @@ static JSValue
 ngx_qjs_ext_shared_dict_items(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv)
 {
-    JSValue              arr, kv, v;
-    uint32_t             max_count, i;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_rbtree_t        *rbtree;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_rbtree_node_t   *rn;
-    ngx_js_dict_node_t  *node;
+    JSValue               arr, kv, v;
+    uint32_t              max_count, i;
+    ngx_uint_t            n;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_rbtree_t         *rbtree;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = JS_GetOpaque(this_val, NGX_QJS_CLASS_ID_SHARED_DICT);
     if (shm_zone == NULL) {
@@ -3390,84 +4535,89 @@ ngx_qjs_ext_shared_dict_items(JSContext *cx, JSValueConst this_val,
         }
     }
 
-    rbtree = &dict->sh->rbtree;
-
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
-
-    if (rbtree->root == rbtree->sentinel) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
-        return JS_NewArray(cx);
-    }
-
     arr = JS_NewArray(cx);
     if (JS_IsException(arr)) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
         return JS_EXCEPTION;
     }
 
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
     i = 0;
 
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        if (max_count-- == 0) {
-            break;
-        }
+    for (n = 0; n < dict->shards; n++) {
+        shard = &dict->sh->shards[n];
 
-        node = (ngx_js_dict_node_t *) rn;
+        ngx_rwlock_rlock(&shard->rwlock);
 
-        kv = JS_NewArray(cx);
-        if (JS_IsException(kv)) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
-        }
+        rbtree = &shard->rbtree;
 
-        v = JS_NewStringLen(cx, (const char *) node->sn.str.data,
-                            node->sn.str.len);
-        if (JS_IsException(v)) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, kv);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
+        if (rbtree->root == rbtree->sentinel) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            continue;
         }
 
-        if (JS_DefinePropertyValueUint32(cx, kv, 0, v, JS_PROP_C_W_E) < 0) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, v);
-            JS_FreeValue(cx, kv);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
-        }
+        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+             rn != NULL;
+             rn = ngx_rbtree_next(rbtree, rn))
+        {
+            node = (ngx_js_dict_node_t *) rn;
+
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
+            }
 
-        v = ngx_qjs_dict_copy_value_locked(cx, dict, node);
+            if (max_count-- == 0) {
+                ngx_rwlock_unlock(&shard->rwlock);
+                return arr;
+            }
 
-        if (JS_DefinePropertyValueUint32(cx, kv, 1, v, JS_PROP_C_W_E) < 0) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, v);
-            JS_FreeValue(cx, kv);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
-        }
+            kv = JS_NewArray(cx);
+            if (JS_IsException(kv)) {
+                goto fail;
+            }
 
-        if (JS_DefinePropertyValueUint32(cx, arr, i++, kv, JS_PROP_C_W_E) < 0) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, kv);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
+            v = JS_NewStringLen(cx, (const char *) node->sn.str.data,
+                                node->sn.str.len);
+            if (JS_IsException(v)) {
+                JS_FreeValue(cx, kv);
+                goto fail;
+            }
+
+            if (JS_DefinePropertyValueUint32(cx, kv, 0, v, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(cx, v);
+                JS_FreeValue(cx, kv);
+                goto fail;
+            }
+
+            v = ngx_qjs_dict_copy_value_locked(cx, dict, node);
+
+            if (JS_DefinePropertyValueUint32(cx, kv, 1, v, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(cx, v);
+                JS_FreeValue(cx, kv);
+                goto fail;
+            }
+
+            if (JS_DefinePropertyValueUint32(cx, arr, i++, kv,
+                                             JS_PROP_C_W_E) < 0)
+            {
+                JS_FreeValue(cx, kv);
+                goto fail;
+            }
         }
-    }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
+    }
 
     return arr;
+
+fail:
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    JS_FreeValue(cx, arr);
+
+    return JS_EXCEPTION;
 }
 
 
@@ -3475,15 +4625,17 @@ static JSValue
 ngx_qjs_ext_shared_dict_keys(JSContext *cx, JSValueConst this_val, int argc,
     JSValueConst *argv)
 {
-    JSValue              arr, key;
-    uint32_t             max_count, i;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_rbtree_t        *rbtree;
-    ngx_js_dict_t       *dict;
-    ngx_shm_zone_t      *shm_zone;
-    ngx_rbtree_node_t   *rn;
-    ngx_js_dict_node_t  *node;
+    JSValue               arr, key;
+    uint32_t              max_count, i;
+    ngx_uint_t            n;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_rbtree_t         *rbtree;
+    ngx_js_dict_t        *dict;
+    ngx_shm_zone_t       *shm_zone;
+    ngx_rbtree_node_t    *rn;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     shm_zone = JS_GetOpaque(this_val, NGX_QJS_CLASS_ID_SHARED_DICT);
     if (shm_zone == NULL) {
@@ -3500,60 +4652,69 @@ ngx_qjs_ext_shared_dict_keys(JSContext *cx, JSValueConst this_val, int argc,
         }
     }
 
-    rbtree = &dict->sh->rbtree;
-
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
-
-    if (rbtree->root == rbtree->sentinel) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
-        return JS_NewArray(cx);
-    }
-
     arr = JS_NewArray(cx);
     if (JS_IsException(arr)) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
         return JS_EXCEPTION;
     }
 
+    tp = ngx_timeofday();
+    now = tp->sec * 1000 + tp->msec;
+
     i = 0;
 
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        if (max_count-- == 0) {
-            break;
-        }
+    for (n = 0; n < dict->shards; n++) {
+        shard = &dict->sh->shards[n];
 
-        node = (ngx_js_dict_node_t *) rn;
+        ngx_rwlock_rlock(&shard->rwlock);
 
-        key = JS_NewStringLen(cx, (const char *) node->sn.str.data,
-                              node->sn.str.len);
-        if (JS_IsException(key)) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
+        rbtree = &shard->rbtree;
+
+        if (rbtree->root == rbtree->sentinel) {
+            ngx_rwlock_unlock(&shard->rwlock);
+            continue;
         }
 
-        if (JS_DefinePropertyValueUint32(cx, arr, i++, key,
-                                         JS_PROP_C_W_E) < 0)
+        for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
+             rn != NULL;
+             rn = ngx_rbtree_next(rbtree, rn))
         {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
-            JS_FreeValue(cx, key);
-            JS_FreeValue(cx, arr);
-            return JS_EXCEPTION;
+            node = (ngx_js_dict_node_t *) rn;
+
+            if (dict->timeout && now >= node->expire.key) {
+                continue;
+            }
+
+            if (max_count-- == 0) {
+                ngx_rwlock_unlock(&shard->rwlock);
+                return arr;
+            }
+
+            key = JS_NewStringLen(cx, (const char *) node->sn.str.data,
+                                  node->sn.str.len);
+            if (JS_IsException(key)) {
+                goto fail;
+            }
+
+            if (JS_DefinePropertyValueUint32(cx, arr, i++, key,
+                                             JS_PROP_C_W_E) < 0)
+            {
+                JS_FreeValue(cx, key);
+                goto fail;
+            }
         }
-    }
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
+    }
 
     return arr;
+
+fail:
+
+    ngx_rwlock_unlock(&shard->rwlock);
+
+    JS_FreeValue(cx, arr);
+
+    return JS_EXCEPTION;
 }
 
 
@@ -3665,13 +4826,8 @@ static JSValue
 ngx_qjs_ext_shared_dict_size(JSContext *cx, JSValueConst this_val,
     int argc, JSValueConst *argv)
 {
-    njs_int_t           items;
-    ngx_msec_t          now;
-    ngx_time_t         *tp;
-    ngx_rbtree_t       *rbtree;
-    ngx_js_dict_t      *dict;
-    ngx_shm_zone_t     *shm_zone;
-    ngx_rbtree_node_t  *rn;
+    ngx_js_dict_t   *dict;
+    ngx_shm_zone_t  *shm_zone;
 
     shm_zone = JS_GetOpaque(this_val, NGX_QJS_CLASS_ID_SHARED_DICT);
     if (shm_zone == NULL) {
@@ -3680,33 +4836,7 @@ ngx_qjs_ext_shared_dict_size(JSContext *cx, JSValueConst this_val,
 
     dict = shm_zone->data;
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
-
-    if (dict->timeout) {
-        tp = ngx_timeofday();
-        now = tp->sec * 1000 + tp->msec;
-        ngx_js_dict_expire(dict, now);
-    }
-
-    rbtree = &dict->sh->rbtree;
-
-    if (rbtree->root == rbtree->sentinel) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
-        return JS_NewInt32(cx, 0);
-    }
-
-    items = 0;
-
-    for (rn = ngx_rbtree_min(rbtree->root, rbtree->sentinel);
-         rn != NULL;
-         rn = ngx_rbtree_next(rbtree, rn))
-    {
-        items++;
-    }
-
-    ngx_rwlock_unlock(&dict->sh->rwlock);
-
-    return JS_NewInt32(cx, items);
+    return JS_NewInt32(cx, ngx_js_dict_size(dict));
 }
 
 
@@ -3753,25 +4883,12 @@ ngx_qjs_dict_copy_value_locked(JSContext *cx, ngx_js_dict_t *dict,
 }
 
 
-static ngx_js_dict_node_t *
-ngx_qjs_dict_lookup(ngx_js_dict_t *dict, ngx_str_t *key)
-{
-    uint32_t       hash;
-    ngx_rbtree_t  *rbtree;
-
-    rbtree = &dict->sh->rbtree;
-
-    hash = ngx_crc32_long(key->data, key->len);
-
-    return (ngx_js_dict_node_t *) ngx_str_rbtree_lookup(rbtree, key, hash);
-}
-
-
 static ngx_int_t
-ngx_qjs_dict_add(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
-    JSValue value, ngx_msec_t timeout, ngx_msec_t now)
+ngx_qjs_dict_add(JSContext *cx, ngx_js_dict_t *dict,
+    ngx_js_dict_shard_t *shard, ngx_str_t *key, uint32_t hash, JSValue value,
+    ngx_msec_t timeout, ngx_msec_t now)
 {
-    ngx_int_t           rc;
+    ngx_int_t            rc;
     ngx_js_dict_value_t  entry;
 
     if (dict->type == NGX_JS_DICT_TYPE_STRING) {
@@ -3789,7 +4906,7 @@ ngx_qjs_dict_add(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
         }
     }
 
-    rc = ngx_js_dict_add_value(dict, key, &entry, timeout, now);
+    rc = ngx_js_dict_add_value(dict, shard, key, hash, &entry, timeout, now);
 
     if (dict->type == NGX_JS_DICT_TYPE_STRING) {
         JS_FreeCString(cx, (char *) entry.str.data);
@@ -3803,25 +4920,29 @@ static JSValue
 ngx_qjs_dict_delete(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
     int retval)
 {
-    JSValue              ret;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    JSValue               ret;
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+    ngx_rwlock_wlock(&shard->rwlock);
 
-    node = ngx_qjs_dict_lookup(dict, key);
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
-        ngx_rwlock_unlock(&dict->sh->rwlock);
+        ngx_rwlock_unlock(&shard->rwlock);
         return JS_UNDEFINED;
     }
 
     if (dict->timeout) {
-        ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
     }
 
-    ngx_rbtree_delete(&dict->sh->rbtree, (ngx_rbtree_node_t *) node);
+    ngx_rbtree_delete(&shard->rbtree, (ngx_rbtree_node_t *) node);
 
     if (retval) {
         tp = ngx_timeofday();
@@ -3838,11 +4959,11 @@ ngx_qjs_dict_delete(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
         ret = JS_TRUE;
     }
 
-    ngx_js_dict_node_free(dict, node);
+    ngx_js_dict_node_free(dict, shard, node);
 
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
@@ -3855,14 +4976,18 @@ ngx_qjs_dict_delete(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
 static JSValue
 ngx_qjs_dict_get(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key)
 {
-    JSValue              ret;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    JSValue               ret;
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
+
+    shard = ngx_js_dict_shard(dict, key, &hash);
 
-    ngx_rwlock_rlock(&dict->sh->rwlock);
+    ngx_rwlock_rlock(&shard->rwlock);
 
-    node = ngx_qjs_dict_lookup(dict, key);
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
         goto not_found;
@@ -3878,13 +5003,13 @@ ngx_qjs_dict_get(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key)
     }
 
     ret = ngx_qjs_dict_copy_value_locked(cx, dict, node);
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return ret;
 
 not_found:
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return JS_UNDEFINED;
 }
@@ -3894,22 +5019,28 @@ static JSValue
 ngx_qjs_dict_incr(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
     double delta, double init, ngx_msec_t timeout)
 {
-    JSValue              value;
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    JSValue               value;
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     tp = ngx_timeofday();
     now = tp->sec * 1000 + tp->msec;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+    shard = ngx_js_dict_shard(dict, key, &hash);
+
+    ngx_rwlock_wlock(&shard->rwlock);
 
-    node = ngx_qjs_dict_lookup(dict, key);
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
         value = JS_NewFloat64(cx, init + delta);
-        if (ngx_qjs_dict_add(cx, dict, key, value, timeout, now) != NGX_OK) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
+        if (ngx_qjs_dict_add(cx, dict, shard, key, hash, value, timeout, now)
+            != NGX_OK)
+        {
+            ngx_rwlock_unlock(&shard->rwlock);
             JS_FreeValue(cx, value);
             return ngx_qjs_throw_shared_memory_error(cx);
         }
@@ -3919,15 +5050,15 @@ ngx_qjs_dict_incr(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
         value = JS_NewFloat64(cx, node->value.number);
 
         if (dict->timeout) {
-            ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+            ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
             node->expire.key = now + timeout;
-            ngx_rbtree_insert(&dict->sh->rbtree_expire, &node->expire);
+            ngx_rbtree_insert(&shard->rbtree_expire, &node->expire);
         }
     }
 
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
@@ -3941,24 +5072,30 @@ static JSValue
 ngx_qjs_dict_set(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
     JSValue value, ngx_msec_t timeout, unsigned flags)
 {
-    ngx_msec_t           now;
-    ngx_time_t          *tp;
-    ngx_js_dict_node_t  *node;
+    uint32_t              hash;
+    ngx_msec_t            now;
+    ngx_time_t           *tp;
+    ngx_js_dict_node_t   *node;
+    ngx_js_dict_shard_t  *shard;
 
     tp = ngx_timeofday();
     now = tp->sec * 1000 + tp->msec;
 
-    ngx_rwlock_wlock(&dict->sh->rwlock);
+    shard = ngx_js_dict_shard(dict, key, &hash);
+
+    ngx_rwlock_wlock(&shard->rwlock);
 
-    node = ngx_qjs_dict_lookup(dict, key);
+    node = ngx_js_dict_lookup(shard, key, hash);
 
     if (node == NULL) {
         if (flags & NGX_JS_DICT_FLAG_MUST_EXIST) {
-            ngx_rwlock_unlock(&dict->sh->rwlock);
+            ngx_rwlock_unlock(&shard->rwlock);
             return JS_FALSE;
         }
 
-        if (ngx_qjs_dict_add(cx, dict, key, value, timeout, now) != NGX_OK) {
+        if (ngx_qjs_dict_add(cx, dict, shard, key, hash, value, timeout, now)
+            != NGX_OK)
+        {
             goto memory_error;
         }
 
@@ -3966,12 +5103,12 @@ ngx_qjs_dict_set(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
 
         if (flags & NGX_JS_DICT_FLAG_MUST_NOT_EXIST) {
             if (!dict->timeout || now < node->expire.key) {
-                ngx_rwlock_unlock(&dict->sh->rwlock);
+                ngx_rwlock_unlock(&shard->rwlock);
                 return JS_FALSE;
             }
         }
 
-        if (ngx_qjs_dict_update(cx, dict, node, value, timeout, now)
+        if (ngx_qjs_dict_update(cx, dict, shard, node, value, timeout, now)
             != NGX_OK)
         {
             goto memory_error;
@@ -3980,7 +5117,7 @@ ngx_qjs_dict_set(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
 
     dict->sh->dirty = 1;
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     if (dict->state_file.data && !dict->save_event.timer_set) {
         ngx_add_timer(&dict->save_event, 1000);
@@ -3990,7 +5127,7 @@ ngx_qjs_dict_set(JSContext *cx, ngx_js_dict_t *dict, ngx_str_t *key,
 
 memory_error:
 
-    ngx_rwlock_unlock(&dict->sh->rwlock);
+    ngx_rwlock_unlock(&shard->rwlock);
 
     return ngx_qjs_throw_shared_memory_error(cx);
 }
@@ -3998,7 +5135,8 @@ memory_error:
 
 static ngx_int_t
 ngx_qjs_dict_update(JSContext *cx, ngx_js_dict_t *dict,
-    ngx_js_dict_node_t *node, JSValue value, ngx_msec_t timeout, ngx_msec_t now)
+    ngx_js_dict_shard_t *shard, ngx_js_dict_node_t *node, JSValue value,
+    ngx_msec_t timeout, ngx_msec_t now)
 {
     u_char     *p;
     ngx_str_t   string;
@@ -4009,13 +5147,13 @@ ngx_qjs_dict_update(JSContext *cx, ngx_js_dict_t *dict,
             return NGX_ERROR;
         }
 
-        p = ngx_js_dict_alloc(dict, string.len);
+        p = ngx_js_dict_alloc(dict, shard, string.len);
         if (p == NULL) {
             JS_FreeCString(cx, (char *) string.data);
             return NGX_ERROR;
         }
 
-        ngx_slab_free_locked(dict->shpool, node->value.str.data);
+        ngx_js_dict_slab_free(dict, node->value.str.data);
         ngx_memcpy(p, string.data, string.len);
 
         node->value.str.data = p;
@@ -4030,9 +5168,9 @@ ngx_qjs_dict_update(JSContext *cx, ngx_js_dict_t *dict,
     }
 
     if (dict->timeout) {
-        ngx_rbtree_delete(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_delete(&shard->rbtree_expire, &node->expire);
         node->expire.key = now + timeout;
-        ngx_rbtree_insert(&dict->sh->rbtree_expire, &node->expire);
+        ngx_rbtree_insert(&shard->rbtree_expire, &node->expire);
     }
 
     return NGX_OK;
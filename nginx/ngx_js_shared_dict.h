@@ -14,6 +14,10 @@ njs_int_t njs_js_ext_global_shared_prop(njs_vm_t *vm, njs_object_prop_t *prop,
 njs_int_t njs_js_ext_global_shared_keys(njs_vm_t *vm, njs_value_t *value,
     njs_value_t *keys);
 ngx_int_t ngx_js_dict_init_worker(ngx_js_main_conf_t *jmcf);
+ngx_int_t ngx_js_dict_get_string(ngx_js_dict_t *dict, ngx_str_t *key,
+    ngx_pool_t *pool, ngx_str_t *value);
+ngx_int_t ngx_js_dict_set_string(ngx_js_dict_t *dict, ngx_str_t *key,
+    ngx_str_t *value, ngx_msec_t timeout);
 
 extern njs_module_t  ngx_js_shared_dict_module;
 
@@ -29,6 +29,17 @@ typedef struct {
 
     JSValue           promise;
     JSValue           promise_callbacks[2];
+
+    JSValue           read_callbacks[2];
+    JSValue           error_value;
+
+    JSValue           body_pull;
+    JSValue           body_args[3];
+
+    unsigned          streaming:1;
+    unsigned          reading:1;
+    unsigned          finished:1;
+    unsigned          failed:1;
 } ngx_qjs_fetch_t;
 
 
@@ -52,6 +63,22 @@ static ngx_int_t ngx_qjs_fetch_append_headers(ngx_js_http_t *http,
     ngx_js_headers_t *headers, u_char *name, size_t len, u_char *value,
     size_t vlen);
 static void ngx_qjs_fetch_process_done(ngx_js_http_t *http);
+static void ngx_qjs_fetch_body_handler(ngx_js_http_t *http);
+static void ngx_qjs_fetch_finish(ngx_qjs_fetch_t *fetch, ngx_int_t rc);
+static JSValue ngx_qjs_fetch_read_result(JSContext *cx, ngx_js_http_t *http);
+static njs_bool_t ngx_qjs_fetch_body_is_iterator(JSContext *cx,
+    JSValueConst value);
+static ngx_int_t ngx_qjs_fetch_body_init(JSContext *cx,
+    ngx_qjs_fetch_t *fetch, JSValueConst iterator);
+static void ngx_qjs_fetch_body_next(ngx_js_http_t *http);
+static JSValue ngx_qjs_fetch_body_pull(JSContext *cx, JSValueConst this_val,
+    int argc, JSValueConst *argv);
+static JSValue ngx_qjs_fetch_body_chunk(JSContext *cx, JSValueConst this_val,
+    int argc, JSValueConst *argv, int magic, JSValue *data);
+static JSValue ngx_qjs_fetch_body_rejected(JSContext *cx,
+    JSValueConst this_val, int argc, JSValueConst *argv, int magic,
+    JSValue *data);
+static ngx_js_http_t *ngx_qjs_fetch_body_http(JSContext *cx, JSValueConst id);
 static ngx_int_t ngx_qjs_headers_append(JSContext *cx,
     ngx_js_headers_t *headers, u_char *name, size_t len, u_char *value,
     size_t vlen);
@@ -109,6 +136,8 @@ static JSValue ngx_qjs_ext_fetch_response_type(JSContext *cx,
     JSValueConst this_val);
 static JSValue ngx_qjs_ext_fetch_response_body(JSContext *cx,
     JSValueConst this_val, int argc, JSValueConst *argv, int magic);
+static JSValue ngx_qjs_ext_fetch_response_read(JSContext *cx,
+    JSValueConst this_val, int argc, JSValueConst *argv);
 static JSValue ngx_qjs_ext_fetch_response_redirected(JSContext *cx,
     JSValueConst this_val);
 static JSValue ngx_qjs_ext_fetch_response_field(JSContext *cx,
@@ -164,6 +193,7 @@ static const JSCFunctionListEntry  ngx_qjs_ext_fetch_response_proto[] = {
     JS_CFUNC_MAGIC_DEF("json", 0, ngx_qjs_ext_fetch_response_body,
                        NGX_QJS_BODY_JSON),
     JS_CGETSET_DEF("ok", ngx_qjs_ext_fetch_response_ok, NULL),
+    JS_CFUNC_DEF("read", 0, ngx_qjs_ext_fetch_response_read),
     JS_CGETSET_DEF("redirected", ngx_qjs_ext_fetch_response_redirected, NULL),
     JS_CGETSET_DEF("status", ngx_qjs_ext_fetch_response_status, NULL),
     JS_CGETSET_DEF("statusText", ngx_qjs_ext_fetch_response_status_text, NULL),
@@ -251,7 +281,8 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
     ngx_js_tb_elt_t     *h;
     ngx_connection_t    *c;
     ngx_js_request_t     request;
-    ngx_resolver_ctx_t  *rs;
+    ngx_js_loc_conf_t   *conf;
+    ngx_js_main_conf_t  *jmcf;
 
     external = JS_GetContextOpaque(cx);
     c = ngx_qjs_external_connection(cx, external);
@@ -276,6 +307,20 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
     http->max_response_body_size =
                         ngx_qjs_external_max_response_buffer_size(cx, external);
 
+    conf = ngx_qjs_external_loc_conf(cx, external);
+
+    http->keepalive = conf->fetch_keepalive;
+    http->keepalive_timeout = conf->fetch_keepalive_timeout;
+    http->keepalive_requests = conf->fetch_keepalive_requests;
+    http->resolver_cache = conf->fetch_resolver_cache;
+    http->resolver_cache_negative = conf->fetch_resolver_cache_negative;
+    http->resolver_cache_stale = conf->fetch_resolver_cache_stale;
+    http->http2 = conf->fetch_http2;
+
+#ifdef NJS_HAVE_ZLIB
+    http->decompress = conf->fetch_decompress;
+#endif
+
 #if (NGX_SSL)
     if (u.default_port == 443) {
         http->ssl = ngx_qjs_external_ssl(cx, external);
@@ -311,6 +356,16 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
             }
         }
 
+        value = JS_GetPropertyStr(cx, init, "stream");
+        if (JS_IsException(value)) {
+            goto fail;
+        }
+
+        if (!JS_IsUndefined(value)) {
+            http->stream = JS_ToBool(cx, value);
+            JS_FreeValue(cx, value);
+        }
+
 #if (NGX_SSL)
         value = JS_GetPropertyStr(cx, init, "verify");
         if (JS_IsException(value)) {
@@ -321,6 +376,20 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
             http->ssl_verify = JS_ToBool(cx, value);
         }
 #endif
+
+        if (request.body_stream) {
+            value = JS_GetPropertyStr(cx, init, "body");
+            if (JS_IsException(value)) {
+                goto fail;
+            }
+
+            rc = ngx_qjs_fetch_body_init(cx, fetch, value);
+            JS_FreeValue(cx, value);
+
+            if (rc != NGX_OK) {
+                goto fail;
+            }
+        }
     }
 
     if (request.method.len == 4
@@ -329,6 +398,23 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
         http->header_only = 1;
     }
 
+    http->idempotent = ngx_js_http_idempotent(&request.method);
+
+    jmcf = ngx_qjs_main_conf(cx);
+
+    if (jmcf->fetch_cache != NULL
+        && !http->stream
+        && request.cache_mode != CACHE_MODE_NO_STORE
+        && request.body.len == 0
+        && !request.body_stream
+        && request.method.len == 3
+        && ngx_strncasecmp(request.method.data, (u_char *) "GET", 3) == 0)
+    {
+        http->cache = jmcf->fetch_cache;
+        http->cache_mode = request.cache_mode;
+        http->cache_inactive = jmcf->fetch_cache_inactive;
+    }
+
     ctx = ngx_qjs_external_ctx(cx, JS_GetContextOpaque(cx));
 
     NJS_CHB_MP_INIT(&http->chain, ctx->engine->pool);
@@ -418,23 +504,74 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
             continue;
         }
 
+        if (h[i].key.len == 15
+            && ngx_strncasecmp(h[i].key.data, (u_char *) "Accept-Encoding",
+                               15)
+            == 0)
+        {
+            /* the response is left as is if the encoding is set explicitly */
+
+            http->decompress = 0;
+        }
+
         njs_chb_append(&http->chain, h[i].key.data, h[i].key.len);
         njs_chb_append_literal(&http->chain, ": ");
         njs_chb_append(&http->chain, h[i].value.data, h[i].value.len);
         njs_chb_append_literal(&http->chain, CRLF);
     }
 
-    njs_chb_append_literal(&http->chain, "Connection: close" CRLF);
+    if (http->decompress) {
+        njs_chb_append_literal(&http->chain,
+                               "Accept-Encoding: gzip, deflate" CRLF);
+    }
+
+    if (http->cache != NULL) {
+        if (ngx_js_http_cache_key(http, &request.url, &request.headers)
+            != NGX_OK)
+        {
+            JS_FreeValue(cx, promise);
+            return JS_ThrowOutOfMemory(cx);
+        }
+
+        rc = ngx_js_http_cache_lookup(http);
+
+        if (rc == NGX_OK) {
+            http->ready_handler(http);
+            return promise;
+        }
+
+        if (rc == NGX_ABORT) {
+            JS_ThrowInternalError(cx,
+                                  "no cached response for \"only-if-cached\"");
+            goto fail;
+        }
+
+        if (rc == NGX_ERROR) {
+            JS_FreeValue(cx, promise);
+            return JS_ThrowOutOfMemory(cx);
+        }
+    }
+
+    if (http->keepalive) {
+        njs_chb_append_literal(&http->chain, "Connection: keep-alive" CRLF);
+
+    } else {
+        njs_chb_append_literal(&http->chain, "Connection: close" CRLF);
+    }
 
 #if (NGX_SSL)
     http->tls_name.data = u.host.data;
     http->tls_name.len = u.host.len;
 #endif
 
-    if (request.body.len != 0) {
+    if (http->body_stream) {
+        njs_chb_append_literal(&http->chain,
+                               "Transfer-Encoding: chunked" CRLF CRLF);
+
+    } else if (request.body.len != 0) {
         njs_chb_sprintf(&http->chain, 32, "Content-Length: %uz" CRLF CRLF,
                         request.body.len);
-        njs_chb_append(&http->chain, request.body.data, request.body.len);
+        http->body = request.body;
 
     } else {
         method = request.method;
@@ -451,16 +588,29 @@ ngx_qjs_ext_fetch(JSContext *cx, JSValueConst this_val, int argc,
         }
     }
 
+    if (u.addrs == NULL && u.no_port) {
+        rc = ngx_js_http_upstream(http, &u.host);
+        if (rc == NGX_ERROR) {
+            JS_FreeValue(cx, promise);
+            return JS_ThrowOutOfMemory(cx);
+        }
+
+        if (rc == NGX_OK) {
+            ngx_js_http_connect(http);
+            return promise;
+        }
+    }
+
     if (u.addrs == NULL) {
-        rs = ngx_js_http_resolve(http, ngx_qjs_external_resolver(cx, external),
+        rc = ngx_js_http_resolve(http, ngx_qjs_external_resolver(cx, external),
                                  &u.host, u.port,
                                ngx_qjs_external_resolver_timeout(cx, external));
-        if (rs == NULL) {
+        if (rc == NGX_ERROR) {
             JS_FreeValue(cx, promise);
             return JS_ThrowOutOfMemory(cx);
         }
 
-        if (rs == NGX_NO_RESOLVER) {
+        if (rc == NGX_DECLINED) {
             JS_ThrowInternalError(cx, "no resolver defined");
             goto fail;
         }
@@ -559,6 +709,10 @@ ngx_qjs_fetch_request_ctor(JSContext *cx, JSValueConst new_target, int argc,
         return JS_EXCEPTION;
     }
 
+    if (request->body_stream) {
+        return JS_ThrowInternalError(cx, "invalid Request body");
+    }
+
     proto = JS_GetPropertyStr(cx, new_target, "prototype");
     if (JS_IsException(proto)) {
         return JS_EXCEPTION;
@@ -773,7 +927,11 @@ ngx_qjs_request_ctor(JSContext *cx, ngx_js_request_t *request,
             return NGX_ERROR;
         }
 
-        if (!JS_IsUndefined(value)) {
+        if (ngx_qjs_fetch_body_is_iterator(cx, value)) {
+            request->body_stream = 1;
+            JS_FreeValue(cx, value);
+
+        } else if (!JS_IsUndefined(value)) {
             if (ngx_qjs_string(cx, value, &request->body) != NGX_OK) {
                 JS_FreeValue(cx, value);
                 JS_ThrowInternalError(cx, "invalid Request body");
@@ -1186,8 +1344,17 @@ ngx_qjs_fetch_alloc(JSContext *cx, ngx_pool_t *pool, ngx_log_t *log)
 
     http->append_headers = ngx_qjs_fetch_append_headers;
     http->ready_handler = ngx_qjs_fetch_process_done;
+    http->body_handler = ngx_qjs_fetch_body_handler;
     http->error_handler = ngx_qjs_fetch_error;
 
+    fetch->read_callbacks[0] = JS_UNDEFINED;
+    fetch->read_callbacks[1] = JS_UNDEFINED;
+    fetch->error_value = JS_UNDEFINED;
+    fetch->body_pull = JS_UNDEFINED;
+    fetch->body_args[0] = JS_UNDEFINED;
+    fetch->body_args[1] = JS_UNDEFINED;
+    fetch->body_args[2] = JS_UNDEFINED;
+
     fetch->promise = JS_NewPromiseCapability(cx, fetch->promise_callbacks);
     if (JS_IsException(fetch->promise)) {
         return NULL;
@@ -1229,12 +1396,29 @@ fail:
 static void
 ngx_qjs_fetch_error(ngx_js_http_t *http, const char *err)
 {
+    ngx_int_t         rc;
     ngx_qjs_fetch_t  *fetch;
 
     fetch = (ngx_qjs_fetch_t *) http;
 
     JS_ThrowInternalError(fetch->cx, "%s", err);
 
+    if (fetch->streaming) {
+        fetch->error_value = JS_GetException(fetch->cx);
+        fetch->failed = 1;
+
+        rc = NGX_OK;
+
+        if (fetch->reading) {
+            fetch->reading = 0;
+            rc = ngx_qjs_call(fetch->cx, fetch->read_callbacks[1],
+                              &fetch->error_value, 1);
+        }
+
+        ngx_qjs_fetch_finish(fetch, rc);
+        return;
+    }
+
     fetch->response_value = JS_GetException(fetch->cx);
 
     ngx_qjs_fetch_done(fetch, fetch->response_value, NGX_ERROR);
@@ -1262,6 +1446,13 @@ ngx_qjs_fetch_destructor(ngx_qjs_event_t *event)
     JS_FreeValue(cx, fetch->promise_callbacks[1]);
     JS_FreeValue(cx, fetch->promise);
     JS_FreeValue(cx, fetch->response_value);
+    JS_FreeValue(cx, fetch->read_callbacks[0]);
+    JS_FreeValue(cx, fetch->read_callbacks[1]);
+    JS_FreeValue(cx, fetch->error_value);
+    JS_FreeValue(cx, fetch->body_pull);
+    JS_FreeValue(cx, fetch->body_args[0]);
+    JS_FreeValue(cx, fetch->body_args[1]);
+    JS_FreeValue(cx, fetch->body_args[2]);
 }
 
 
@@ -1332,6 +1523,364 @@ ngx_qjs_fetch_process_done(ngx_js_http_t *http)
 }
 
 
+static void
+ngx_qjs_fetch_body_handler(ngx_js_http_t *http)
+{
+    JSValue           value, action;
+    JSContext        *cx;
+    ngx_int_t         rc;
+    ngx_qjs_fetch_t  *fetch;
+
+    fetch = (ngx_qjs_fetch_t *) http;
+    cx = fetch->cx;
+
+    rc = NGX_OK;
+
+    if (!fetch->streaming) {
+        fetch->response_value = JS_NewObjectClass(cx,
+                                              NGX_QJS_CLASS_ID_FETCH_RESPONSE);
+        if (JS_IsException(fetch->response_value)) {
+            ngx_qjs_fetch_error(http, "fetch response creation failed");
+            return;
+        }
+
+        JS_SetOpaque(fetch->response_value, &http->response);
+
+        fetch->streaming = 1;
+        http->response.http = http;
+
+        rc = ngx_qjs_call(cx, fetch->promise_callbacks[0],
+                          &fetch->response_value, 1);
+    }
+
+    if (rc == NGX_OK
+        && fetch->reading
+        && (http->response.chain.nodes != NULL || http->done))
+    {
+        fetch->reading = 0;
+
+        value = ngx_qjs_fetch_read_result(cx, http);
+
+        if (JS_IsException(value)) {
+            value = JS_GetException(cx);
+            action = fetch->read_callbacks[1];
+
+        } else {
+            action = fetch->read_callbacks[0];
+        }
+
+        rc = ngx_qjs_call(cx, action, &value, 1);
+
+        JS_FreeValue(cx, value);
+        JS_FreeValue(cx, fetch->read_callbacks[0]);
+        JS_FreeValue(cx, fetch->read_callbacks[1]);
+
+        fetch->read_callbacks[0] = JS_UNDEFINED;
+        fetch->read_callbacks[1] = JS_UNDEFINED;
+    }
+
+    if (rc != NGX_OK || http->done) {
+        ngx_qjs_fetch_finish(fetch, rc);
+        return;
+    }
+
+    ngx_qjs_external_event_finalize(cx)(JS_GetContextOpaque(cx), rc);
+}
+
+
+static void
+ngx_qjs_fetch_finish(ngx_qjs_fetch_t *fetch, ngx_int_t rc)
+{
+    void          *external;
+    JSContext     *cx;
+    ngx_js_ctx_t  *ctx;
+
+    ngx_log_debug2(NGX_LOG_DEBUG_EVENT, fetch->http.log, 0,
+                   "js http finish fetch:%p rc:%i", fetch, rc);
+
+    fetch->finished = 1;
+
+    cx = fetch->cx;
+    external = JS_GetContextOpaque(cx);
+
+    ctx = ngx_qjs_external_ctx(cx, external);
+    ngx_js_del_event(ctx, fetch->event);
+
+    ngx_qjs_external_event_finalize(cx)(external, rc);
+}
+
+
+static JSValue
+ngx_qjs_fetch_read_result(JSContext *cx, ngx_js_http_t *http)
+{
+    JSValue     result;
+    njs_str_t   data;
+    njs_chb_t  *chain;
+
+    chain = &http->response.chain;
+
+    if (ngx_js_http_stream_read(http, &data) != NGX_OK) {
+        return JS_ThrowOutOfMemory(cx);
+    }
+
+    if (data.length == 0) {
+        return JS_UNDEFINED;
+    }
+
+    result = JS_NewArrayBufferCopy(cx, data.start, data.length);
+
+    chain->free(chain->pool, data.start);
+
+    return result;
+}
+
+
+static njs_bool_t
+ngx_qjs_fetch_body_is_iterator(JSContext *cx, JSValueConst value)
+{
+    JSValue     next;
+    njs_bool_t  rc;
+
+    if (!JS_IsObject(value)) {
+        return 0;
+    }
+
+    next = JS_GetPropertyStr(cx, value, "next");
+    if (JS_IsException(next)) {
+        JS_FreeValue(cx, JS_GetException(cx));
+        return 0;
+    }
+
+    rc = JS_IsFunction(cx, next);
+
+    JS_FreeValue(cx, next);
+
+    return rc;
+}
+
+
+static ngx_int_t
+ngx_qjs_fetch_body_init(JSContext *cx, ngx_qjs_fetch_t *fetch,
+    JSValueConst iterator)
+{
+    JSValue         id;
+    ngx_js_http_t  *http;
+
+    /*
+     * the iterator callbacks refer to the fetch event id
+     * which is looked up when they are called, as the fetch
+     * may be already completed by that time
+     */
+
+    id = JS_NewInt32(cx, fetch->event->fd);
+
+    fetch->body_pull = JS_NewCFunction(cx, ngx_qjs_fetch_body_pull, "pull", 3);
+    if (JS_IsException(fetch->body_pull)) {
+        return NGX_ERROR;
+    }
+
+    fetch->body_args[0] = JS_DupValue(cx, iterator);
+
+    fetch->body_args[1] = JS_NewCFunctionData(cx, ngx_qjs_fetch_body_chunk, 1,
+                                              0, 1, &id);
+    if (JS_IsException(fetch->body_args[1])) {
+        return NGX_ERROR;
+    }
+
+    fetch->body_args[2] = JS_NewCFunctionData(cx, ngx_qjs_fetch_body_rejected,
+                                              1, 0, 1, &id);
+    if (JS_IsException(fetch->body_args[2])) {
+        return NGX_ERROR;
+    }
+
+    http = &fetch->http;
+
+    http->body_stream = 1;
+    http->body_next = ngx_qjs_fetch_body_next;
+
+    /*
+     * a request with the streamed body cannot be repeated
+     * over another connection if a cached one turns out to be closed
+     */
+
+    http->keepalive = 0;
+
+    return NGX_OK;
+}
+
+
+static void
+ngx_qjs_fetch_body_next(ngx_js_http_t *http)
+{
+    JSContext        *cx;
+    ngx_int_t         rc;
+    ngx_qjs_fetch_t  *fetch;
+
+    fetch = (ngx_qjs_fetch_t *) http;
+    cx = fetch->cx;
+
+    rc = ngx_qjs_call(cx, fetch->body_pull, fetch->body_args, 3);
+    if (rc != NGX_OK) {
+        ngx_qjs_fetch_error(http, "request body stream failed");
+        return;
+    }
+
+    ngx_qjs_external_event_finalize(cx)(JS_GetContextOpaque(cx), rc);
+}
+
+
+static JSValue
+ngx_qjs_fetch_body_pull(JSContext *cx, JSValueConst this_val, int argc,
+    JSValueConst *argv)
+{
+    JSValue  next, result, then, ret;
+
+    next = JS_GetPropertyStr(cx, argv[0], "next");
+    if (JS_IsException(next)) {
+        return JS_EXCEPTION;
+    }
+
+    if (!JS_IsFunction(cx, next)) {
+        JS_FreeValue(cx, next);
+        return JS_ThrowTypeError(cx, "request body is not an iterator");
+    }
+
+    result = JS_Call(cx, next, argv[0], 0, NULL);
+    JS_FreeValue(cx, next);
+
+    if (JS_IsException(result)) {
+        return JS_EXCEPTION;
+    }
+
+    then = JS_UNDEFINED;
+
+    if (JS_IsObject(result)) {
+        then = JS_GetPropertyStr(cx, result, "then");
+        if (JS_IsException(then)) {
+            JS_FreeValue(cx, result);
+            return JS_EXCEPTION;
+        }
+    }
+
+    if (JS_IsFunction(cx, then)) {
+        ret = JS_Call(cx, then, result, 2, &argv[1]);
+
+    } else {
+
+        /* a synchronous iterator result */
+
+        ret = JS_Call(cx, argv[1], JS_UNDEFINED, 1, &result);
+    }
+
+    JS_FreeValue(cx, then);
+    JS_FreeValue(cx, result);
+
+    return ret;
+}
+
+
+static JSValue
+ngx_qjs_fetch_body_chunk(JSContext *cx, JSValueConst this_val, int argc,
+    JSValueConst *argv, int magic, JSValue *data)
+{
+    JSValue         value;
+    ngx_str_t       chunk;
+    njs_bool_t      done;
+    ngx_js_http_t  *http;
+
+    http = ngx_qjs_fetch_body_http(cx, data[0]);
+    if (http == NULL) {
+        return JS_UNDEFINED;
+    }
+
+    if (!JS_IsObject(argv[0])) {
+        goto failed;
+    }
+
+    value = JS_GetPropertyStr(cx, argv[0], "done");
+    if (JS_IsException(value)) {
+        goto failed;
+    }
+
+    done = JS_ToBool(cx, value);
+    JS_FreeValue(cx, value);
+
+    if (done) {
+        ngx_str_null(&chunk);
+        ngx_js_http_send_body(http, &chunk, 1);
+        return JS_UNDEFINED;
+    }
+
+    value = JS_GetPropertyStr(cx, argv[0], "value");
+    if (JS_IsException(value)) {
+        goto failed;
+    }
+
+    if (ngx_qjs_string(cx, value, &chunk) != NGX_OK) {
+        JS_FreeValue(cx, value);
+        goto failed;
+    }
+
+    JS_FreeValue(cx, value);
+
+    ngx_js_http_send_body(http, &chunk, 0);
+
+    return JS_UNDEFINED;
+
+failed:
+
+    JS_FreeValue(cx, JS_GetException(cx));
+
+    ngx_js_http_body_error(http, "invalid request body chunk");
+
+    return JS_UNDEFINED;
+}
+
+
+static JSValue
+ngx_qjs_fetch_body_rejected(JSContext *cx, JSValueConst this_val, int argc,
+    JSValueConst *argv, int magic, JSValue *data)
+{
+    ngx_js_http_t  *http;
+
+    http = ngx_qjs_fetch_body_http(cx, data[0]);
+    if (http != NULL) {
+        ngx_js_http_body_error(http, "request body stream failed");
+    }
+
+    return JS_UNDEFINED;
+}
+
+
+static ngx_js_http_t *
+ngx_qjs_fetch_body_http(JSContext *cx, JSValueConst id)
+{
+    int32_t             fd;
+    ngx_js_ctx_t       *ctx;
+    ngx_qjs_fetch_t    *fetch;
+    ngx_qjs_event_t     event_lookup, *event;
+    njs_rbtree_node_t  *rb;
+
+    if (JS_ToInt32(cx, &fd, id) < 0) {
+        return NULL;
+    }
+
+    ctx = ngx_qjs_external_ctx(cx, JS_GetContextOpaque(cx));
+    event_lookup.fd = fd;
+
+    rb = njs_rbtree_find(&ctx->waiting_events, &event_lookup.node);
+    if (rb == NULL) {
+        return NULL;
+    }
+
+    event = (ngx_qjs_event_t *) ((u_char *) rb
+                                 - offsetof(ngx_qjs_event_t, node));
+    fetch = event->data;
+
+    return &fetch->http;
+}
+
+
 static ngx_int_t
 ngx_qjs_headers_append(JSContext *cx, ngx_js_headers_t *headers,
     u_char *name, size_t len, u_char *value, size_t vlen)
@@ -2310,6 +2859,10 @@ ngx_qjs_ext_fetch_response_body(JSContext *cx, JSValueConst this_val,
         return JS_ThrowInternalError(cx, "body stream already read");
     }
 
+    if (response->http != NULL && !response->http->done) {
+        return JS_ThrowInternalError(cx, "body is being streamed");
+    }
+
     response->body_used = 1;
 
     switch (magic) {
@@ -2362,6 +2915,78 @@ ngx_qjs_ext_fetch_response_body(JSContext *cx, JSValueConst this_val,
 }
 
 
+static JSValue
+ngx_qjs_ext_fetch_response_read(JSContext *cx, JSValueConst this_val,
+    int argc, JSValueConst *argv)
+{
+    JSValue             result, promise;
+    njs_int_t           ret;
+    njs_str_t           string;
+    ngx_js_http_t      *http;
+    ngx_qjs_fetch_t    *fetch;
+    ngx_js_response_t  *response;
+
+    response = JS_GetOpaque2(cx, this_val, NGX_QJS_CLASS_ID_FETCH_RESPONSE);
+    if (response == NULL) {
+        return JS_UNDEFINED;
+    }
+
+    http = response->http;
+
+    if (http == NULL) {
+
+        /* the body is already received, it is returned as a single chunk */
+
+        result = JS_UNDEFINED;
+
+        if (!response->body_used) {
+            response->body_used = 1;
+
+            ret = njs_chb_join(&response->chain, &string);
+            if (ret != NJS_OK) {
+                return JS_ThrowOutOfMemory(cx);
+            }
+
+            if (string.length != 0) {
+                result = JS_NewArrayBufferCopy(cx, string.start,
+                                               string.length);
+                if (JS_IsException(result)) {
+                    return JS_ThrowOutOfMemory(cx);
+                }
+            }
+        }
+
+        return qjs_promise_result(cx, result);
+    }
+
+    fetch = (ngx_qjs_fetch_t *) http;
+
+    if (fetch->reading) {
+        return JS_ThrowInternalError(cx, "body read is already pending");
+    }
+
+    response->body_used = 1;
+
+    if (fetch->failed) {
+        JS_Throw(cx, JS_DupValue(cx, fetch->error_value));
+        return qjs_promise_result(cx, JS_EXCEPTION);
+    }
+
+    if (http->response.chain.nodes != NULL || fetch->finished) {
+        return qjs_promise_result(cx, ngx_qjs_fetch_read_result(cx, http));
+    }
+
+    promise = JS_NewPromiseCapability(cx, fetch->read_callbacks);
+    if (JS_IsException(promise)) {
+        return JS_EXCEPTION;
+    }
+
+    fetch->reading = 1;
+
+    return promise;
+}
+
+
 static JSValue
 ngx_qjs_ext_fetch_response_redirected(JSContext *cx, JSValueConst this_val)
 {
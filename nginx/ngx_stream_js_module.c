@@ -20,6 +20,8 @@ typedef struct {
     ngx_str_t              access;
     ngx_str_t              preread;
     ngx_str_t              filter;
+
+    size_t                 gc_threshold;
 } ngx_stream_js_srv_conf_t;
 
 
@@ -72,6 +74,7 @@ struct ngx_stream_js_ctx_s {
 #define NGX_JS_EVENT_DOWNLOAD 1
 #define NGX_JS_EVENT_MAX      2
     ngx_stream_js_ev_t      events[NGX_JS_EVENT_MAX];
+    size_t                  gc_size;
     unsigned                filter:1;
     unsigned                in_progress:1;
     ngx_js_periodic_t      *periodic;
@@ -107,6 +110,8 @@ static ngx_int_t ngx_stream_njs_body_filter(ngx_stream_session_t *s,
     ngx_stream_js_ctx_t *ctx, ngx_chain_t *in, ngx_uint_t from_upstream);
 static ngx_int_t ngx_stream_js_next_filter(ngx_stream_session_t *s,
     ngx_stream_js_ctx_t *ctx, ngx_chain_t *out, ngx_uint_t from_upstream);
+static void ngx_stream_js_collect(ngx_stream_session_t *s,
+    ngx_stream_js_ctx_t *ctx);
 static ngx_int_t ngx_stream_js_variable_set(ngx_stream_session_t *s,
     ngx_stream_variable_value_t *v, uintptr_t data);
 static ngx_int_t ngx_stream_js_variable_var(ngx_stream_session_t *s,
@@ -202,6 +207,7 @@ static size_t ngx_stream_js_buffer_size(ngx_stream_session_t *s);
 static size_t ngx_stream_js_max_response_buffer_size(ngx_stream_session_t *s);
 static void ngx_stream_js_event_finalize(ngx_stream_session_t *s, ngx_int_t rc);
 static ngx_js_ctx_t *ngx_stream_js_ctx(ngx_stream_session_t *s);
+static ngx_js_loc_conf_t *ngx_stream_js_loc_conf(ngx_stream_session_t *s);
 
 static void ngx_stream_js_periodic_handler(ngx_event_t *ev);
 static void ngx_stream_js_periodic_event_handler(ngx_event_t *ev);
@@ -227,6 +233,8 @@ static char *ngx_stream_js_merge_srv_conf(ngx_conf_t *cf, void *parent,
     void *child);
 static char *ngx_stream_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd,
     void *conf);
+static char *ngx_stream_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+    void *conf);
 
 static ngx_ssl_t *ngx_stream_js_ssl(ngx_stream_session_t *s);
 static ngx_flag_t ngx_stream_js_ssl_verify(ngx_stream_session_t *s);
@@ -337,6 +345,13 @@ static ngx_command_t  ngx_stream_js_commands[] = {
       offsetof(ngx_stream_js_srv_conf_t, filter),
       NULL },
 
+    { ngx_string("js_context_gc_threshold"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_size_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, gc_threshold),
+      NULL },
+
     { ngx_string("js_fetch_buffer_size"),
       NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
       ngx_conf_set_size_slot,
@@ -358,6 +373,62 @@ static ngx_command_t  ngx_stream_js_commands[] = {
       offsetof(ngx_stream_js_srv_conf_t, timeout),
       NULL },
 
+    { ngx_string("js_fetch_keepalive"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_keepalive),
+      NULL },
+
+    { ngx_string("js_fetch_keepalive_timeout"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_msec_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_keepalive_timeout),
+      NULL },
+
+    { ngx_string("js_fetch_keepalive_requests"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_keepalive_requests),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_num_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_resolver_cache),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache_negative"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_sec_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_resolver_cache_negative),
+      NULL },
+
+    { ngx_string("js_fetch_resolver_cache_stale"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_sec_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_resolver_cache_stale),
+      NULL },
+
+    { ngx_string("js_fetch_http2"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_FLAG,
+      ngx_conf_set_flag_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_http2),
+      NULL },
+
+    { ngx_string("js_fetch_decompress"),
+      NGX_STREAM_MAIN_CONF|NGX_STREAM_SRV_CONF|NGX_CONF_FLAG,
+      ngx_conf_set_flag_slot,
+      NGX_STREAM_SRV_CONF_OFFSET,
+      offsetof(ngx_stream_js_srv_conf_t, fetch_decompress),
+      NULL },
+
 #if (NGX_STREAM_SSL)
 
     { ngx_string("js_fetch_ciphers"),
@@ -404,6 +475,13 @@ static ngx_command_t  ngx_stream_js_commands[] = {
       0,
       NULL },
 
+    { ngx_string("js_fetch_cache_zone"),
+      NGX_STREAM_MAIN_CONF|NGX_CONF_1MORE,
+      ngx_stream_js_fetch_cache_zone,
+      0,
+      0,
+      NULL },
+
       ngx_null_command
 };
 
@@ -720,6 +798,7 @@ static uintptr_t ngx_stream_js_uptr[] = {
     (uintptr_t) ngx_stream_js_max_response_buffer_size,
     (uintptr_t) 0 /* main_conf ptr */,
     (uintptr_t) ngx_stream_js_ctx,
+    (uintptr_t) ngx_stream_js_loc_conf,
 };
 
 
@@ -1011,7 +1090,11 @@ ngx_stream_js_body_filter(ngx_stream_session_t *s, ngx_chain_t *in,
     ctx->buf = NULL;
     *ctx->last_out = NULL;
 
-    return ngx_stream_js_next_filter(s, ctx, out, from_upstream);
+    rc = ngx_stream_js_next_filter(s, ctx, out, from_upstream);
+
+    ngx_stream_js_collect(s, ctx);
+
+    return rc;
 }
 
 
@@ -1048,16 +1131,76 @@ ngx_stream_js_next_filter(ngx_stream_session_t *s, ngx_stream_js_ctx_t *ctx,
 }
 
 
+static void
+ngx_stream_js_collect(ngx_stream_session_t *s, ngx_stream_js_ctx_t *ctx)
+{
+    size_t                     size;
+    njs_vm_t                  *vm;
+    njs_int_t                  ret;
+    njs_mp_stat_t              stat;
+    ngx_stream_js_srv_conf_t  *jscf;
+
+    jscf = ngx_stream_get_module_srv_conf(s, ngx_stream_js_module);
+
+    /*
+     * The unreachable VM memory is freed when the VM pool has grown
+     * by "js_context_gc_threshold" since the last collection, which is
+     * off by default.  The VM memory referenced only by nginx structures
+     * is not visible to the collector: variable values are copied when
+     * the collection is enabled, and it is not done while asynchronous
+     * operations are pending or data sent by s.send() is not written.
+     */
+
+    if (jscf->gc_threshold == 0
+        || ctx->engine->type != NGX_ENGINE_NJS
+        || ngx_js_ctx_pending(ctx)
+        || ctx->upstream_busy != NULL
+        || ctx->downstream_busy != NULL)
+    {
+        return;
+    }
+
+    vm = ctx->engine->u.njs.vm;
+
+    njs_mp_stat(njs_vm_memory_pool(vm), &stat);
+
+    if (stat.size < ctx->gc_size + jscf->gc_threshold) {
+        return;
+    }
+
+    size = stat.size;
+
+    /*
+     * The values kept by the module, such as the session object and
+     * the event handlers, are referenced from the context.
+     */
+
+    ret = njs_vm_collect(vm, ctx, sizeof(ngx_stream_js_ctx_t));
+    if (ret != NJS_OK) {
+        return;
+    }
+
+    njs_mp_stat(njs_vm_memory_pool(vm), &stat);
+
+    ngx_log_debug2(NGX_LOG_DEBUG_STREAM, s->connection->log, 0,
+                   "stream js vm collected, memory usage %uz -> %uz",
+                   size, stat.size);
+
+    ctx->gc_size = stat.size;
+}
+
+
 static ngx_int_t
 ngx_stream_js_variable_set(ngx_stream_session_t *s,
     ngx_stream_variable_value_t *v, uintptr_t data)
 {
     ngx_js_set_t *vdata = (ngx_js_set_t *) data;
 
-    ngx_int_t             rc;
-    njs_int_t             pending;
-    ngx_str_t            *fname, value;
-    ngx_stream_js_ctx_t  *ctx;
+    ngx_int_t                  rc;
+    njs_int_t                  pending;
+    ngx_str_t                 *fname, value;
+    ngx_stream_js_ctx_t       *ctx;
+    ngx_stream_js_srv_conf_t  *jscf;
 
     fname = &vdata->fname;
 
@@ -1096,6 +1239,17 @@ ngx_stream_js_variable_set(ngx_stream_session_t *s,
         return NGX_ERROR;
     }
 
+    jscf = ngx_stream_get_module_srv_conf(s, ngx_stream_js_module);
+
+    if (jscf->gc_threshold != 0 && value.len != 0) {
+        /* The value may be freed by the VM memory collection. */
+
+        value.data = ngx_pstrdup(s->connection->pool, &value);
+        if (value.data == NULL) {
+            return NGX_ERROR;
+        }
+    }
+
     v->len = value.len;
     v->valid = 1;
     v->no_cacheable = vdata->flags & NGX_NJS_VAR_NOCACHE;
@@ -1261,7 +1415,12 @@ ngx_stream_js_run_event(ngx_stream_session_t *s, ngx_stream_js_ctx_t *ctx,
 
     vm = ctx->engine->u.njs.vm;
 
-    p = ngx_pnalloc(c->pool, len);
+    /*
+     * The data is allocated from the VM pool rather than from
+     * the connection pool to be freed by the VM memory collection.
+     */
+
+    p = njs_mp_alloc(njs_vm_memory_pool(vm), len);
     if (p == NULL) {
         njs_vm_memory_error(vm);
         goto error;
@@ -1271,8 +1430,15 @@ ngx_stream_js_run_event(ngx_stream_session_t *s, ngx_stream_js_ctx_t *ctx,
         ngx_memcpy(p, b->pos, len);
     }
 
-    ret = ngx_js_prop(vm, event->data_type, njs_value_arg(&ctx->args[1]),
-                      p, len);
+    if (event->data_type == NGX_JS_STRING) {
+        ret = njs_vm_value_string_create(vm, njs_value_arg(&ctx->args[1]),
+                                         p, len);
+
+    } else {
+        ret = njs_vm_value_buffer_set(vm, njs_value_arg(&ctx->args[1]),
+                                      p, len);
+    }
+
     if (ret != NJS_OK) {
         goto error;
     }
@@ -1727,6 +1893,7 @@ ngx_stream_js_session_variables(njs_vm_t *vm, njs_object_prop_t *prop,
     ngx_str_t                     name;
     ngx_uint_t                    key;
     ngx_stream_variable_t        *v;
+    ngx_stream_js_srv_conf_t     *jscf;
     ngx_stream_core_main_conf_t  *cmcf;
     ngx_stream_variable_value_t  *vv;
     u_char                        storage[64];
@@ -1801,6 +1968,19 @@ ngx_stream_js_session_variables(njs_vm_t *vm, njs_object_prop_t *prop,
         vv->data = val.start;
         vv->len = val.length;
 
+        jscf = ngx_stream_get_module_srv_conf(s, ngx_stream_js_module);
+
+        if (jscf->gc_threshold != 0 && val.length != 0) {
+            /* The value may be freed by the VM memory collection. */
+
+            vv->data = ngx_pnalloc(s->connection->pool, val.length);
+            if (vv->data == NULL) {
+                return NJS_ERROR;
+            }
+
+            ngx_memcpy(vv->data, val.start, val.length);
+        }
+
         v->set_handler(s, vv, v->data);
 
         return NJS_OK;
@@ -1953,6 +2133,17 @@ ngx_stream_js_ctx(ngx_stream_session_t *s)
 }
 
 
+static ngx_js_loc_conf_t *
+ngx_stream_js_loc_conf(ngx_stream_session_t *s)
+{
+    ngx_stream_js_srv_conf_t  *jscf;
+
+    jscf = ngx_stream_get_module_srv_conf(s, ngx_stream_js_module);
+
+    return (ngx_js_loc_conf_t *) jscf;
+}
+
+
 static njs_int_t
 ngx_js_stream_init(njs_vm_t *vm)
 {
@@ -2959,6 +3150,8 @@ ngx_stream_js_init_conf_vm(ngx_conf_t *cf, ngx_js_loc_conf_t *conf)
     jmcf = ngx_stream_conf_get_module_main_conf(cf, ngx_stream_js_module);
     ngx_stream_js_uptr[NGX_JS_MAIN_CONF_INDEX] = (uintptr_t) jmcf;
 
+    options.main_conf = jmcf;
+
     if (conf->type == NGX_ENGINE_NJS) {
         options.u.njs.metas = &ngx_stream_js_metas;
         options.u.njs.addons = njs_stream_js_addon_modules;
@@ -3535,6 +3728,9 @@ ngx_stream_js_create_main_conf(ngx_conf_t *cf)
      *
      *     jmcf->dicts = NULL;
      *     jmcf->periodics = NULL;
+     *     jmcf->engines = NULL;
+     *     jmcf->fetch_cache = NULL;
+     *     jmcf->fetch_cache_inactive = 0;
      */
 
     return jmcf;
@@ -3551,6 +3747,8 @@ ngx_stream_js_create_srv_conf(ngx_conf_t *cf)
         return NULL;
     }
 
+    conf->gc_threshold = NGX_CONF_UNSET_SIZE;
+
 #if (NGX_STREAM_SSL)
     conf->ssl_verify = NGX_CONF_UNSET;
     conf->ssl_verify_depth = NGX_CONF_UNSET;
@@ -3568,6 +3766,7 @@ ngx_stream_js_merge_srv_conf(ngx_conf_t *cf, void *parent, void *child)
     ngx_conf_merge_str_value(conf->access, prev->access, "");
     ngx_conf_merge_str_value(conf->preread, prev->preread, "");
     ngx_conf_merge_str_value(conf->filter, prev->filter, "");
+    ngx_conf_merge_size_value(conf->gc_threshold, prev->gc_threshold, 0);
 
     if (ngx_js_merge_conf(cf, parent, child, ngx_stream_js_init_conf_vm)
         != NGX_OK)
@@ -3614,6 +3813,14 @@ ngx_stream_js_shared_dict_zone(ngx_conf_t *cf, ngx_command_t *cmd,
 }
 
 
+static char *
+ngx_stream_js_fetch_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+    void *conf)
+{
+    return ngx_js_fetch_cache_zone(cf, cmd, conf, &ngx_stream_js_module);
+}
+
+
 static ngx_int_t
 ngx_stream_js_init(ngx_conf_t *cf)
 {
@@ -0,0 +1,112 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, js_context_reuse directive.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /keep {
+            js_context_reuse 4;
+            js_content test.keep;
+        }
+
+        location /keep_in_file {
+            client_body_in_file_only clean;
+            js_context_reuse 4;
+            js_content test.keep;
+        }
+    }
+}
+
+EOF
+
+$t->write_file('test.js', <<EOF);
+    var saved = {};
+
+    function keep(r) {
+        var s = saved[r.uri];
+
+        if (!s) {
+            saved[r.uri] = {r, headers: r.headersIn, body: r.requestBuffer,
+                            bufs: r.requestBuffers};
+            r.return(200, 'saved');
+            return;
+        }
+
+        r.return(200, `\${s.r.uri}:\${s.headers.host}:`
+                      + `\${s.body}:\${Buffer.concat(s.bufs)}:`
+                      + `\${r.requestText}`);
+    }
+
+    export default {keep};
+
+EOF
+
+$t->try_run('no js_context_reuse')->plan(5);
+
+###############################################################################
+
+like(http_post('/keep', 'REQ-BODY'), qr/saved$/s, 'first request');
+like(http_post('/keep', 'NEW-BODY'),
+	qr/undefined:undefined:REQ-BODY:REQ-BODY:NEW-BODY$/s, 'request detached');
+like(http_post('/keep_in_file', 'REQ-BODY'), qr/saved$/s,
+	'first request in file');
+like(http_post('/keep_in_file', 'NEW-BODY'),
+	qr/undefined:undefined:REQ-BODY:REQ-BODY:NEW-BODY$/s,
+	'request in file detached');
+
+$t->stop();
+
+unlike($t->read_file('error.log'), qr/\[(error|alert|crit)\]/, 'no errors');
+
+###############################################################################
+
+sub http_post {
+	my ($url, $body) = @_;
+
+	my $p = "POST $url HTTP/1.0" . CRLF .
+		"Host: localhost" . CRLF .
+		"Content-Length: " . length($body) . CRLF .
+		CRLF .
+		$body;
+
+	return http($p);
+}
+
+###############################################################################
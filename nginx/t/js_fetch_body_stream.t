@@ -0,0 +1,163 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, streaming request body.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /iterator {
+            js_content test.iterator;
+        }
+
+        location /sync_iterator {
+            js_content test.sync_iterator;
+        }
+
+        location /rejected {
+            js_content test.rejected;
+        }
+
+        location /buffer {
+            js_content test.buffer;
+        }
+
+        location /request {
+            js_content test.request;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        server_name  localhost;
+
+        location /echo {
+            client_body_buffer_size 256k;
+            js_content test.echo;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    function source(chunks, sync) {
+        let i = 0;
+
+        return {
+            next() {
+                let res = (i < chunks.length)
+                          ? {value: chunks[i++], done: false}
+                          : {done: true};
+
+                return sync ? res : Promise.resolve(res);
+            }
+        };
+    }
+
+    async function post(r, body) {
+        try {
+            let reply = await ngx.fetch(`http://127.0.0.1:$p1/echo`,
+                                        {method: 'POST', body});
+            r.return(200, await reply.text());
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    function iterator(r) {
+        return post(r, source(['AAA', Buffer.from('BB'), '', 'C']));
+    }
+
+    function sync_iterator(r) {
+        return post(r, source(['AAA', 'BB'], true));
+    }
+
+    function rejected(r) {
+        return post(r, {next() { return Promise.reject(new Error('oops')); }});
+    }
+
+    function buffer(r) {
+        return post(r, Buffer.from('x'.repeat(100000)));
+    }
+
+    function request(r) {
+        try {
+            new Request(`http://127.0.0.1:$p1/echo`,
+                        {method: 'POST', body: source(['A'])});
+            r.return(200, 'created');
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    function echo(r) {
+        let te = r.headersIn['Transfer-Encoding'] || 'length';
+        let body = r.requestText;
+
+        r.return(200, `\${te}:\${body.length}:\${body.substring(0, 6)}`);
+    }
+
+    export default {njs: test_njs, iterator, sync_iterator, rejected, buffer,
+                    request, echo};
+EOF
+
+$t->try_run('no fetch request body stream')->plan(5);
+
+###############################################################################
+
+like(http_get('/iterator'), qr/chunked:6:AAABBC$/s, 'async iterator');
+like(http_get('/sync_iterator'), qr/chunked:5:AAABB$/s, 'sync iterator');
+like(http_get('/rejected'), qr/request body stream failed$/s,
+	'rejected chunk');
+like(http_get('/buffer'), qr/length:100000:xxxxxx$/s, 'buffer body');
+like(http_get('/request'), qr/invalid Request body$/s, 'Request iterator');
+
+###############################################################################
@@ -0,0 +1,166 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, response cache.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    js_fetch_cache_zone zone=fetch:1m inactive=1m;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /twice {
+            js_content test.twice;
+        }
+
+        location /only_if_cached {
+            js_content test.only_if_cached;
+        }
+
+        location /credentials {
+            js_content test.credentials;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        server_name  localhost;
+
+        location /max_age {
+            add_header Cache-Control "max-age=60";
+            return 200 $request_id;
+        }
+
+        location /no_store {
+            add_header Cache-Control "no-store";
+            return 200 $request_id;
+        }
+
+        location /etag {
+            js_content test.etag;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function twice(r) {
+        let url = `http://127.0.0.1:$p1/\${r.args.loc}?\${r.args.key}`;
+        let out = [];
+
+        for (let mode of ['default', r.args.mode || 'default']) {
+            let reply = await ngx.fetch(url, {cache: mode});
+            out.push(await reply.text());
+        }
+
+        r.return(200, (out[0] == out[1]) ? 'cached' : 'fetched');
+    }
+
+    async function credentials(r) {
+        let url = `http://127.0.0.1:$p1/max_age?\${r.args.key}`;
+        let out = [];
+
+        for (let auth of r.args.auth.split(',')) {
+            let reply = await ngx.fetch(url,
+                                        {headers: {Authorization: auth}});
+            out.push(await reply.text());
+        }
+
+        r.return(200, (out[0] == out[1]) ? 'cached' : 'fetched');
+    }
+
+    async function only_if_cached(r) {
+        try {
+            await ngx.fetch(`http://127.0.0.1:$p1/max_age?only`,
+                            {cache: 'only-if-cached'});
+            r.return(200, 'fetched');
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    function etag(r) {
+        if (r.headersIn['If-None-Match'] == '"v1"') {
+            r.return(304);
+            return;
+        }
+
+        r.headersOut['ETag'] = '"v1"';
+        r.headersOut['Cache-Control'] = 'no-cache';
+        r.return(200, r.variables.request_id);
+    }
+
+    export default {njs: test_njs, twice, credentials, only_if_cached,
+                    etag};
+EOF
+
+$t->try_run('no js_fetch_cache_zone')->plan(10);
+
+###############################################################################
+
+like(http_get('/twice?loc=max_age&key=1'), qr/cached$/s, 'max-age');
+like(http_get('/twice?loc=max_age&key=2&mode=no-store'), qr/fetched$/s,
+	'no-store mode');
+like(http_get('/twice?loc=max_age&key=3&mode=reload'), qr/fetched$/s,
+	'reload mode');
+like(http_get('/twice?loc=no_store&key=4'), qr/fetched$/s,
+	'no-store response');
+like(http_get('/twice?loc=etag&key=5'), qr/cached$/s, 'etag revalidation');
+like(http_get('/twice?loc=etag&key=6&mode=force-cache'), qr/cached$/s,
+	'force-cache mode');
+like(http_get('/twice?loc=etag&key=7&mode=reload'), qr/fetched$/s,
+	'etag reload');
+like(http_get('/credentials?key=8&auth=a,b'), qr/fetched$/s,
+	'different credentials');
+like(http_get('/credentials?key=9&auth=a,a'), qr/cached$/s,
+	'same credentials');
+like(http_get('/only_if_cached'), qr/no cached response/s,
+	'only-if-cached miss');
+
+###############################################################################
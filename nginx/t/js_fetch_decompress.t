@@ -0,0 +1,177 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, response decompression.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+eval { require IO::Compress::Gzip; };
+plan(skip_all => "IO::Compress::Gzip not found") if $@;
+
+my $t = Test::Nginx->new()->has(qw/http gzip/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    js_fetch_cache_zone zone=fetch:1m;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        js_fetch_decompress on;
+        js_fetch_max_response_buffer_size 128k;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /fetch {
+            js_content test.fetch;
+        }
+
+        location /explicit {
+            js_content test.explicit;
+        }
+
+        location /limit {
+            js_fetch_max_response_buffer_size 64k;
+            js_content test.fetch;
+        }
+
+        location /off {
+            js_fetch_decompress off;
+            js_content test.fetch;
+        }
+
+        location /cached {
+            js_content test.cached;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        server_name  localhost;
+
+        gzip on;
+        gzip_min_length 0;
+
+        location /gzip {
+            js_content test.data;
+        }
+
+        location /static {
+            add_header Content-Encoding gzip;
+            alias %%TESTDIR%%/data.gz;
+        }
+
+        location /plain {
+            return 200 $http_accept_encoding;
+        }
+
+        location /gzip_cached {
+            add_header Cache-Control max-age=60;
+            js_content test.data;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function fetch(r) {
+        try {
+            let reply = await ngx.fetch(`http://127.0.0.1:$p1/\${r.args.loc}`);
+            let body = await reply.text();
+
+            r.return(200, `\${body.length}:\${body.substring(0, 6)}`);
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    async function explicit(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/gzip`,
+                                    {headers: {'Accept-Encoding': 'gzip'}});
+        let body = await reply.arrayBuffer();
+
+        r.return(200, `\${reply.headers.get('Content-Encoding')}:`
+                      + `\${body.byteLength < 100000}`);
+    }
+
+    async function cached(r) {
+        let url = `http://127.0.0.1:$p1/gzip_cached`;
+        let out = [];
+
+        for (let enc of [null, 'gzip', null]) {
+            let headers = enc ? {'Accept-Encoding': enc} : {};
+            let reply = await ngx.fetch(url, {headers});
+            let body = await reply.arrayBuffer();
+
+            out.push(`\${reply.headers.get('Content-Encoding')}:`
+                     + `\${body.byteLength}`);
+        }
+
+        r.return(200, out.join('|'));
+    }
+
+    function data(r) {
+        r.headersOut['Content-Type'] = 'text/html';
+        r.return(200, 'x'.repeat(100000));
+    }
+
+    export default {njs: test_njs, fetch, explicit, cached, data};
+EOF
+
+my $data;
+IO::Compress::Gzip::gzip(\('y' x 50000) => \$data);
+$t->write_file('data.gz', $data);
+
+$t->try_run('no js_fetch_decompress')->plan(7);
+
+###############################################################################
+
+like(http_get('/fetch?loc=gzip'), qr/100000:xxxxxx$/s, 'chunked gzip');
+like(http_get('/fetch?loc=static'), qr/50000:yyyyyy$/s, 'gzip with length');
+like(http_get('/fetch?loc=plain'), qr/13:gzip, $/s, 'accept encoding');
+like(http_get('/off?loc=plain'), qr/0:$/s, 'decompress off');
+like(http_get('/explicit'), qr/gzip:true$/s, 'explicit accept encoding');
+like(http_get('/limit?loc=gzip'), qr/body is too large$/s, 'limit');
+like(http_get('/cached'), qr/gzip:100000\|gzip:\d{2,4}\|null:100000$/s,
+	'cached per encoding');
+
+###############################################################################
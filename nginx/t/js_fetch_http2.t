@@ -0,0 +1,256 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, HTTP/2.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+use IO::Socket::INET;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http http_v2/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        js_fetch_http2 on;
+        js_fetch_max_response_buffer_size 128k;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /proto {
+            js_content test.proto;
+        }
+
+        location /parallel {
+            js_content test.parallel;
+        }
+
+        location /post {
+            js_content test.post;
+        }
+
+        location /big {
+            js_content test.big;
+        }
+
+        location /status {
+            js_content test.status;
+        }
+
+        location /refused {
+            js_fetch_timeout 5s;
+            js_content test.refused;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081 http2;
+        server_name  localhost;
+
+        location /loc {
+            add_header X-Conn $connection;
+            return 200 $server_protocol:$http_host:$http_x_test;
+        }
+
+        location /echo {
+            client_body_buffer_size 256k;
+            js_content test.echo;
+        }
+
+        location /data {
+            js_content test.data;
+        }
+
+        location /missing {
+            return 404 missing;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+my $p2 = port(8082);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function proto(r) {
+        try {
+            let reply = await ngx.fetch(`http://127.0.0.1:$p1/loc`,
+                                        {headers: {'X-Test': 'foo'}});
+            r.return(200, await reply.text());
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    async function parallel(r) {
+        let urls = [1, 2, 3, 4].map(() => `http://127.0.0.1:$p1/loc`);
+        let replies = await Promise.all(urls.map(u => ngx.fetch(u)));
+        let conns = new Set(replies.map(reply => reply.headers.get('X-Conn')));
+        let bodies = await Promise.all(replies.map(reply => reply.text()));
+
+        r.return(200, `\${conns.size}:\${new Set(bodies).size}`);
+    }
+
+    async function post(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/echo`,
+                                    {method: 'POST', body: 'x'.repeat(100000)});
+        r.return(200, await reply.text());
+    }
+
+    async function big(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/data`);
+        let body = await reply.text();
+
+        r.return(200, `\${body.length}:\${reply.headers.get('Content-Type')}`);
+    }
+
+    async function status(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/missing`);
+        r.return(200, `\${reply.status}:\${await reply.text()}`);
+    }
+
+    async function refused(r) {
+        try {
+            await ngx.fetch(`http://127.0.0.1:$p2/loc`);
+            r.return(200, 'fetched');
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    function echo(r) {
+        let body = r.requestText;
+        r.return(200, `\${r.variables.server_protocol}:\${body.length}`);
+    }
+
+    function data(r) {
+        r.headersOut['Content-Type'] = 'text/plain';
+        r.return(200, 'x'.repeat(100000));
+    }
+
+    export default {njs: test_njs, proto, parallel, post, big, status, refused,
+                    echo, data};
+EOF
+
+$t->try_run('no js_fetch_http2')->plan(6);
+
+$t->run_daemon(\&refuse_daemon, $p2);
+$t->waitforsocket("127.0.0.1:$p2");
+
+###############################################################################
+
+like(http_get('/proto'), qr/HTTP\/2.0:127.0.0.1:$p1:foo$/s, 'http2');
+like(http_get('/parallel'), qr/1:1$/s, 'single connection');
+like(http_get('/post'), qr/HTTP\/2.0:100000$/s, 'request body');
+like(http_get('/big'), qr/100000:text\/plain$/s, 'response body');
+like(http_get('/status'), qr/404:missing$/s, 'status');
+like(http_get('/refused'), qr/http2 stream refused$/s, 'refused stream');
+
+###############################################################################
+
+# HTTP/2 server refusing every stream with RST_STREAM(REFUSED_STREAM)
+
+sub refuse_daemon {
+	my ($port) = @_;
+
+	my $server = IO::Socket::INET->new(
+		Proto => 'tcp',
+		LocalAddr => "127.0.0.1:$port",
+		Listen => 5,
+		Reuse => 1
+	) or die "Can't create listening socket: $!\n";
+
+	local $SIG{PIPE} = 'IGNORE';
+	local $SIG{CHLD} = 'IGNORE';
+
+	while (my $client = $server->accept()) {
+		if (fork() == 0) {
+			refuse_streams($client);
+			exit 0;
+		}
+
+		$client->close();
+	}
+}
+
+sub refuse_streams {
+	my ($client) = @_;
+
+	$client->autoflush(1);
+
+	return unless read_exact($client, 24);
+
+	# empty SETTINGS
+
+	print $client pack('nCCCN', 0, 0, 0x4, 0, 0);
+
+	while (defined(my $h = read_exact($client, 9))) {
+		my ($hi, $lo, $type, $flags, $sid) = unpack('nCCCN', $h);
+		my $len = ($hi << 8) | $lo;
+
+		last unless defined read_exact($client, $len);
+
+		if ($type == 0x4 && !($flags & 0x1)) {
+			print $client pack('nCCCN', 0, 0, 0x4, 0x1, 0);
+
+		} elsif ($type == 0x1) {
+			print $client pack('nCCCNN', 0, 4, 0x3, 0, $sid, 0x7);
+		}
+	}
+
+	$client->close();
+}
+
+sub read_exact {
+	my ($client, $len) = @_;
+	my $buf = '';
+
+	while (length($buf) < $len) {
+		my $n = $client->sysread($buf, $len - length($buf), length($buf));
+		return undef unless $n;
+	}
+
+	return $buf;
+}
+
+###############################################################################
@@ -66,6 +66,10 @@ http {
             js_fetch_verify_depth 0;
             js_fetch_trusted_certificate myca.crt;
         }
+
+        location /reused {
+            js_content test.reused;
+        }
     }
 
     server {
@@ -78,6 +82,10 @@ http {
         location /loc {
             return 200 "You are at default.example.com.";
         }
+
+        location /reused {
+            return 200 $ssl_session_reused;
+        }
     }
 
     server {
@@ -116,7 +124,20 @@ $t->write_file('test.js', <<EOF);
         .catch(e => r.return(501, e.message))
     }
 
-    export default {njs: test_njs, https};
+    async function reused(r) {
+        let url = `https://default.example.com:$p1/reused`;
+        let n = ngx.fetch_ssl_sessions_reused;
+        let out = '';
+
+        for (let i = 0; i < 2; i++) {
+            let reply = await ngx.fetch(url, {verify: false});
+            out += await reply.text();
+        }
+
+        r.return(200, `\${out}:\${ngx.fetch_ssl_sessions_reused - n}`);
+    }
+
+    export default {njs: test_njs, https, reused};
 EOF
 
 my $d = $t->testdir();
@@ -188,7 +209,7 @@ foreach my $name ('default.example.com', '1.example.com') {
 
 $t->try_run('no njs.fetch');
 
-$t->plan(7);
+$t->plan(8);
 
 $t->run_daemon(\&dns_daemon, port(8981), $t);
 $t->waitforfile($t->testdir . '/' . port(8981));
@@ -209,6 +230,7 @@ like(http_get('/https?domain=default.example.com'),
 	qr/connect failed/s, 'fetch https non trusted CA');
 like(http_get('/https.myca.short?domain=default.example.com'),
 	qr/connect failed/s, 'fetch https CA too far');
+like(http_get('/reused'), qr/(\.r:1|rr:2)$/s, 'fetch https session reused');
 
 ###############################################################################
 
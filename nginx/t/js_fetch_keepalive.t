@@ -0,0 +1,254 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, keepalive connections.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+use IO::Socket::INET;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /keepalive {
+            js_fetch_keepalive 4;
+            js_content test.requests;
+        }
+
+        location /keepalive_chunked {
+            js_fetch_keepalive 4;
+            js_content test.requests;
+        }
+
+        location /keepalive_head {
+            js_fetch_keepalive 4;
+            js_content test.requests;
+        }
+
+        location /keepalive_requests {
+            js_fetch_keepalive 4;
+            js_fetch_keepalive_requests 2;
+            js_content test.requests;
+        }
+
+        location /no_keepalive {
+            js_content test.requests;
+        }
+
+        location /closed_get {
+            js_fetch_keepalive 4;
+            js_content test.closed;
+        }
+
+        location /closed_post {
+            js_fetch_keepalive 4;
+            js_content test.closed;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        listen       127.0.0.1:8082;
+        listen       127.0.0.1:8083;
+        listen       127.0.0.1:8084;
+        listen       127.0.0.1:8085;
+        server_name  localhost;
+
+        location /length {
+            add_header X-Requests $connection_requests;
+            return 200 $connection_requests;
+        }
+
+        location /chunked {
+            js_content test.chunked;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+my $p2 = port(8082);
+my $p3 = port(8083);
+my $p4 = port(8084);
+my $p5 = port(8085);
+my $p6 = port(8086);
+my $p7 = port(8087);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    const ports = {
+        '/keepalive': $p1,
+        '/keepalive_chunked': $p2,
+        '/keepalive_head': $p3,
+        '/keepalive_requests': $p4,
+        '/no_keepalive': $p5,
+        '/closed_get': $p6,
+        '/closed_post': $p7,
+    };
+
+    async function requests(r) {
+        let port = ports[r.uri];
+        let loc = (r.uri == '/keepalive_chunked') ? 'chunked' : 'length';
+        let method = (r.uri == '/keepalive_head') ? 'HEAD' : 'GET';
+        let out = [];
+
+        for (let i = 0; i < 3; i++) {
+            let reply = await ngx.fetch(`http://127.0.0.1:\${port}/\${loc}`,
+                                        {method});
+
+            out.push(Number(reply.headers.get('X-Requests')));
+            await reply.text();
+        }
+
+        r.return(200, JSON.stringify(out));
+    }
+
+    async function closed(r) {
+        let port = ports[r.uri];
+        let method = (r.uri == '/closed_post') ? 'POST' : 'GET';
+        let body = (method == 'POST') ? 'BODY' : undefined;
+        let out = [];
+
+        for (let i = 0; i < 2; i++) {
+            try {
+                let reply = await ngx.fetch(`http://127.0.0.1:\${port}/`,
+                                            {method, body});
+
+                out.push(await reply.text());
+
+            } catch (e) {
+                out.push(e.message);
+            }
+        }
+
+        r.return(200, JSON.stringify(out));
+    }
+
+    function chunked(r) {
+        r.status = 200;
+        r.headersOut['X-Requests'] = r.variables.connection_requests;
+        r.sendHeader();
+        r.send('A');
+        r.send('B');
+        r.finish();
+    }
+
+    export default {njs: test_njs, requests, closed, chunked};
+EOF
+
+$t->try_run('no js_fetch_keepalive')->plan(7);
+
+$t->run_daemon(\&close_daemon, $p6);
+$t->run_daemon(\&close_daemon, $p7);
+$t->waitforsocket("127.0.0.1:$p6");
+$t->waitforsocket("127.0.0.1:$p7");
+
+###############################################################################
+
+like(http_get('/keepalive'), qr/\[1,2,3]$/s, 'keepalive length');
+like(http_get('/keepalive_chunked'), qr/\[1,2,3]$/s, 'keepalive chunked');
+like(http_get('/keepalive_head'), qr/\[1,2,3]$/s, 'keepalive head');
+like(http_get('/keepalive_requests'), qr/\[1,2,1]$/s, 'keepalive requests');
+like(http_get('/no_keepalive'), qr/\[1,1,1]$/s, 'no keepalive');
+like(http_get('/closed_get'), qr/\["ok","ok"]$/s, 'closed keepalive retried');
+like(http_get('/closed_post'), qr/\["ok","prematurely closed connection"]$/s,
+	'closed keepalive post not retried');
+
+###############################################################################
+
+# answers the first request of a connection,
+# closes the connection on the next one
+
+sub close_daemon {
+	my ($port) = @_;
+
+	my $server = IO::Socket::INET->new(
+		Proto => 'tcp',
+		LocalAddr => "127.0.0.1:$port",
+		Listen => 5,
+		Reuse => 1
+	) or die "Can't create listening socket: $!\n";
+
+	local $SIG{PIPE} = 'IGNORE';
+	local $SIG{CHLD} = 'IGNORE';
+
+	while (my $client = $server->accept()) {
+		if (fork() == 0) {
+			$client->autoflush(1);
+
+			if (read_request($client)) {
+				print $client 'HTTP/1.1 200 OK' . CRLF
+					. 'Content-Length: 2' . CRLF . CRLF . 'ok';
+
+				read_request($client);
+			}
+
+			$client->close();
+			exit 0;
+		}
+
+		$client->close();
+	}
+}
+
+sub read_request {
+	my ($client) = @_;
+	my $buf = '';
+
+	while ($buf !~ /\x0d\x0a\x0d\x0a/) {
+		return 0 unless $client->sysread($buf, 1024, length($buf));
+	}
+
+	my ($len) = $buf =~ /Content-Length: (\d+)/i;
+	my $body = length($buf) - index($buf, "\x0d\x0a\x0d\x0a") - 4;
+
+	while ($len && $body < $len) {
+		my $n = $client->sysread($buf, $len - $body, length($buf));
+		return 0 unless $n;
+		$body += $n;
+	}
+
+	return 1;
+}
+
+###############################################################################
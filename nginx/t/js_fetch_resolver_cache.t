@@ -0,0 +1,193 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, resolver cache.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+use IO::Select;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /dns {
+            js_content test.dns;
+
+            resolver   127.0.0.1:%%PORT_8981_UDP%% valid=1s;
+            resolver_timeout 1s;
+
+            js_fetch_resolver_cache 16;
+            js_fetch_resolver_cache_negative 60s;
+            js_fetch_resolver_cache_stale 60s;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        server_name  localhost;
+
+        location /loc {
+            return 200 $http_host;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function dns(r) {
+        try {
+            let reply = await ngx.fetch(`http://\${r.args.domain}:$p1/loc`);
+            r.return(200, await reply.text());
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    export default {njs: test_njs, dns};
+EOF
+
+$t->try_run('no js_fetch_resolver_cache')->plan(4);
+
+$t->run_daemon(\&dns_daemon, port(8981), $t);
+$t->waitforfile($t->testdir . '/' . port(8981));
+
+###############################################################################
+
+like(http_get('/dns?domain=flip'), qr/flip:$p1$/s, 'resolved');
+like(http_get('/dns?domain=neg'), qr/"neg" could not be resolved/s,
+	'not resolved');
+
+# the DNS server answers differently to repeated queries,
+# the names expire in the nginx resolver cache
+
+sleep 2;
+
+like(http_get('/dns?domain=flip'), qr/flip:$p1$/s, 'stale');
+like(http_get('/dns?domain=neg'), qr/"neg" could not be resolved/s,
+	'negative');
+
+###############################################################################
+
+sub reply_handler {
+	my ($recv_data, $seen) = @_;
+
+	my (@name, @rdata);
+
+	use constant NOERROR	=> 0;
+	use constant NXDOMAIN	=> 3;
+
+	use constant A		=> 1;
+	use constant IN		=> 1;
+
+	my ($hdr, $rcode, $ttl) = (0x8180, NOERROR, 1);
+
+	# decode name
+
+	my ($len, $offset) = (undef, 12);
+	while (1) {
+		$len = unpack("\@$offset C", $recv_data);
+		last if $len == 0;
+		$offset++;
+		push @name, unpack("\@$offset A$len", $recv_data);
+		$offset += $len;
+	}
+
+	$offset -= 1;
+	my ($id, $type, $class) = unpack("n x$offset n2", $recv_data);
+
+	my $name = join('.', @name);
+
+	# "flip" is only resolved once, "neg" is resolved starting
+	# from the second query
+
+	$seen->{$name}++ if $type == A;
+	my $n = $seen->{$name} || 0;
+
+	if ($name eq 'flip' && $n <= 1 || $name eq 'neg' && $n > 1) {
+		push @rdata, pack('n3N nC4', 0xc00c, A, IN, $ttl, 4,
+			127, 0, 0, 1) if $type == A;
+
+	} else {
+		$rcode = NXDOMAIN;
+	}
+
+	$len = @name;
+	pack("n6 (C/a*)$len x n2", $id, $hdr | $rcode, 1, scalar @rdata,
+		0, 0, @name, $type, $class) . join('', @rdata);
+}
+
+sub dns_daemon {
+	my ($port, $t) = @_;
+
+	my ($data, $recv_data, %seen);
+	my $socket = IO::Socket::INET->new(
+		LocalAddr => '127.0.0.1',
+		LocalPort => $port,
+		Proto => 'udp',
+	)
+		or die "Can't create listening socket: $!\n";
+
+	my $sel = IO::Select->new($socket);
+
+	local $SIG{PIPE} = 'IGNORE';
+
+	# signal we are ready
+
+	open my $fh, '>', $t->testdir() . '/' . $port;
+	close $fh;
+
+	while (my @ready = $sel->can_read) {
+		foreach my $fh (@ready) {
+			$fh->recv($recv_data, 65536);
+			$data = reply_handler($recv_data, \%seen);
+			$fh->send($data);
+		}
+	}
+}
+
+###############################################################################
@@ -0,0 +1,144 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, streaming response body.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        js_fetch_buffer_size 4k;
+        js_fetch_max_response_buffer_size 16k;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /stream {
+            js_content test.stream;
+        }
+
+        location /stream_text {
+            js_content test.stream_text;
+        }
+
+        location /read {
+            js_content test.read;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        server_name  localhost;
+
+        location /big {
+            js_content test.big;
+        }
+
+        location /chunked {
+            js_content test.chunked;
+        }
+    }
+}
+
+EOF
+
+my $p1 = port(8081);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function stream(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/\${r.args.loc}`,
+                                    {stream: true});
+        let size = 0;
+        let chunk;
+
+        while ((chunk = await reply.read()) !== undefined) {
+            size += chunk.byteLength;
+        }
+
+        r.return(200, `\${reply.status}:\${size}`);
+    }
+
+    async function stream_text(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/big`,
+                                    {stream: true});
+        try {
+            await reply.text();
+            r.return(200, 'read');
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    async function read(r) {
+        let reply = await ngx.fetch(`http://127.0.0.1:$p1/chunked`);
+        let first = await reply.read();
+        let second = await reply.read();
+
+        r.return(200, `\${first.byteLength}:\${second}`);
+    }
+
+    function big(r) {
+        r.return(200, 'x'.repeat(100000));
+    }
+
+    function chunked(r) {
+        r.status = 200;
+        r.sendHeader();
+        r.send('AAAA');
+        r.send('BBBB');
+        r.finish();
+    }
+
+    export default {njs: test_njs, stream, stream_text, read, big, chunked};
+EOF
+
+$t->try_run('no fetch stream')->plan(4);
+
+###############################################################################
+
+like(http_get('/stream?loc=big'), qr/200:100000$/s, 'stream length');
+like(http_get('/stream?loc=chunked'), qr/200:8$/s, 'stream chunked');
+like(http_get('/stream_text'), qr/body is being streamed/s, 'stream text');
+like(http_get('/read'), qr/8:undefined$/s, 'read received body');
+
+###############################################################################
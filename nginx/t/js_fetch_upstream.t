@@ -0,0 +1,138 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for http njs module, fetch method, upstream groups.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http upstream_zone/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    upstream rr {
+        zone rr 64k;
+        server 127.0.0.1:8081;
+        server 127.0.0.1:8082;
+    }
+
+    upstream failover {
+        server 127.0.0.1:8083 max_fails=1 fail_timeout=60s;
+        server 127.0.0.1:8081;
+    }
+
+    upstream backup {
+        server 127.0.0.1:8083;
+        server 127.0.0.1:8082 backup;
+    }
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+
+        location /fetch {
+            js_content test.fetch;
+        }
+
+        location /port {
+            js_content test.port;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8081;
+        listen       127.0.0.1:8082;
+        server_name  localhost;
+
+        location /loc {
+            return 200 $server_port:$http_host;
+        }
+    }
+}
+
+EOF
+
+my $p0 = port(8080);
+my $p1 = port(8081);
+my $p2 = port(8082);
+
+# port 8083 is not listened
+
+port(8083);
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    async function fetch(r) {
+        let out = [];
+
+        try {
+            for (let i = 0; i < 4; i++) {
+                let reply = await ngx.fetch(`http://\${r.args.u}/loc`);
+                out.push(await reply.text());
+            }
+
+            r.return(200, Array.from(new Set(out)).sort().join(','));
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    async function port(r) {
+        try {
+            await ngx.fetch(`http://rr:$p0/loc`);
+            r.return(200, 'upstream');
+
+        } catch (e) {
+            r.return(200, e.message);
+        }
+    }
+
+    export default {njs: test_njs, fetch, port};
+EOF
+
+$t->try_run('no fetch upstream')->plan(4);
+
+###############################################################################
+
+like(http_get('/fetch?u=rr'), qr/^$p1:rr,$p2:rr$/m, 'round-robin');
+like(http_get('/fetch?u=failover'), qr/^$p1:failover$/m, 'failover');
+like(http_get('/fetch?u=backup'), qr/^$p2:backup$/m, 'backup');
+like(http_get('/port'), qr/no resolver defined/,
+	'host with port is not an upstream');
+
+###############################################################################
@@ -0,0 +1,116 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (c) Nginx, Inc.
+
+# Tests for http njs module, module bytecode kept across reloads.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_engine qjs;
+
+    js_import main.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /test {
+            js_content main.test;
+        }
+    }
+}
+
+EOF
+
+$t->write_file('main.js', <<EOF);
+    import lib from 'lib.js';
+
+    function test(r) {
+        r.return(200, `\${lib.version}:\${process.pid}`);
+    }
+
+    export default {test};
+
+EOF
+
+write_lib('1');
+
+$t->try_run('no qjs js_engine')->plan(4);
+
+###############################################################################
+
+my ($pid) = http_get('/test') =~ /1:(\d+)$/s;
+ok($pid, 'started');
+
+like(reload(), qr/1:(?!$pid)\d+$/s, 'unchanged module reloaded');
+
+write_lib('22');
+
+like(reload(), qr/22:\d+$/s, 'changed module reloaded');
+
+$t->stop();
+
+SKIP: {
+skip 'no debug', 1 unless $t->has_module('--with-debug');
+
+my $count = () = $t->read_file('error.log') =~ m/ js module bytecode cached/g;
+is($count, 3, 'unchanged modules not compiled');
+
+}
+
+###############################################################################
+
+sub write_lib {
+	my ($version) = @_;
+
+	$t->write_file('lib.js', <<EOF);
+    export default {version: '$version'};
+
+EOF
+}
+
+sub reload {
+	my $r = http_get('/test');
+	my ($pid) = $r =~ /:(\d+)$/s;
+
+	$t->reload();
+
+	for (1 .. 50) {
+		$r = http_get('/test');
+		last if $r !~ /:$pid$/s;
+		select undef, undef, undef, 0.1;
+	}
+
+	return $r;
+}
+
+###############################################################################
@@ -0,0 +1,112 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (c) Nginx, Inc.
+
+# Tests for http njs module, sharing of VMs with identical imports.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /a {
+            js_import main.js;
+            js_content main.test;
+        }
+
+        location /b {
+            js_import main.js;
+            js_content main.test;
+        }
+
+        location /c {
+            js_import main.js;
+            js_import lib.js;
+            js_content lib.test;
+        }
+    }
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  d;
+
+        js_import main.js;
+
+        location /d {
+            js_content main.test;
+        }
+    }
+}
+
+EOF
+
+$t->write_file('main.js', <<EOF);
+    var n = 0;
+
+    function test(r) {
+        r.return(200, `MAIN:\${++n}`);
+    }
+
+    export default {test};
+
+EOF
+
+$t->write_file('lib.js', <<EOF);
+    function test(r) {
+        r.return(200, "LIB");
+    }
+
+    export default {test};
+
+EOF
+
+$t->try_run('no njs available')->plan(5);
+
+###############################################################################
+
+like(http_get('/a'), qr/MAIN:1$/s, 'location a');
+like(http_get('/b'), qr/MAIN:1$/s, 'location b');
+like(http_get('/c'), qr/LIB$/s, 'location c');
+like(http(<<EOF), qr/MAIN:1$/s, 'server d');
+GET /d HTTP/1.0
+Host: d
+
+EOF
+
+$t->stop();
+
+my $content = $t->read_file('error.log');
+my $count = () = $content =~ m/ js vm init/g;
+ok($count == 2, 'js vm shared between identical imports');
+
+###############################################################################
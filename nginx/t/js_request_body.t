@@ -74,6 +74,16 @@ http {
         location /request_body_cache {
             js_content test.request_body_cache;
         }
+
+        location /buffers {
+            client_body_buffer_size 4k;
+            js_content test.buffers;
+        }
+
+        location /buffers_in_file {
+            client_body_in_file_only clean;
+            js_content test.buffers;
+        }
     }
 }
 
@@ -103,11 +113,20 @@ $t->write_file('test.js', <<EOF);
       `requestText:\${t(r.requestText)} requestBuffer:\${t(r.requestBuffer)}`);
     }
 
-    export default {body, read_body_from_temp_file, request_body_cache};
+    function buffers(r) {
+        let bufs = r.requestBuffers;
+        let body = Buffer.concat(bufs);
+
+        r.return(200, `\${bufs.every(b => Buffer.isBuffer(b))}:`
+                      + `\${body.length}:\${body.slice(0, 10)}`);
+    }
+
+    export default {body, read_body_from_temp_file, request_body_cache,
+                    buffers};
 
 EOF
 
-$t->try_run('no njs request body')->plan(9);
+$t->try_run('no njs request body')->plan(12);
 
 ###############################################################################
 
@@ -123,6 +142,11 @@ like(http_post_big('/read_body_from_temp_file'),
 	qr/200.*^(1234567890){1024}$/ms, 'request body big from temp file');
 like(http_post('/request_body_cache'),
 	qr/requestText:string requestBuffer:buffer$/s, 'request body cache');
+like(http_post('/buffers'), qr/true:8:REQ-BODY$/s, 'request buffers');
+like(http_post_big('/buffers'), qr/true:10240:1234567890$/s,
+	'request buffers big');
+like(http_post_big('/buffers_in_file'), qr/true:10240:1234567890$/s,
+	'request buffers in a file');
 
 $t->stop();
 
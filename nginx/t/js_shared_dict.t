@@ -43,6 +43,9 @@ http {
     js_shared_dict_zone zone=waka:32k timeout=1000s type=number;
     js_shared_dict_zone zone=no_timeout:32k;
     js_shared_dict_zone zone=overflow:32k;
+    js_shared_dict_zone zone=sharded:64k timeout=1000s type=number shards=4;
+    js_shared_dict_zone zone=sharded_big:64m timeout=1000s type=number
+                        shards=2;
 
     server {
         listen       127.0.0.1:8080;
@@ -96,6 +99,10 @@ http {
             js_content test.keys;
         }
 
+        location /many {
+            js_content test.many;
+        }
+
         location /name {
             js_content test.name;
         }
@@ -251,6 +258,29 @@ $t->write_file('test.js', <<'EOF');
         r.return(200, kvs.toSorted().join("|"));
     }
 
+    function many(r) {
+        var i;
+        var dict = ngx.shared[r.args.dict];
+        var n = parseInt(r.args.n);
+
+        for (i = 0; i < n; i++) {
+            dict.set(`k${i}`, i);
+        }
+
+        for (i = 0; i < n; i += 2) {
+            dict.delete(`k${i}`);
+        }
+
+        for (i = 0; i < n; i++) {
+            if (dict.get(`k${i}`) !== ((i % 2) ? i : undefined)) {
+                r.return(200, `failed k${i}`);
+                return;
+            }
+        }
+
+        r.return(200, `size: ${dict.size()}`);
+    }
+
     function name(r) {
         r.return(200, ngx.shared[r.args.dict].name);
     }
@@ -328,13 +358,13 @@ $t->write_file('test.js', <<'EOF');
     }
 
     export default { add, capacity, chain, clear, del, free_space, get, has,
-                     incr, items, keys, name, njs: test_njs, pop, replace, set,
-                     set_clear, size, zones, overflow };
+                     incr, items, keys, many, name, njs: test_njs, pop,
+                     replace, set, set_clear, size, zones, overflow };
 EOF
 
 $t->try_run('no js_shared_dict_zone');
 
-$t->plan(52);
+$t->plan(60);
 
 ###############################################################################
 
@@ -438,6 +468,28 @@ like(http_get('/overflow'), qr/SharedMemoryError/, 'overflow exception');
 
 }
 
+TODO: {
+local $TODO = 'not yet' unless has_version('0.9.3');
+
+like(http_get('/incr?dict=sharded&key=FOO&by=1'), qr/1/, 'incr sharded.FOO');
+like(http_get('/incr?dict=sharded&key=FOO2&by=2'), qr/2/,
+	'incr sharded.FOO2');
+like(http_get('/incr?dict=sharded&key=FOO3&by=3'), qr/3/,
+	'incr sharded.FOO3');
+like(http_get('/size?dict=sharded'), qr/size: 3/, 'no of items in sharded');
+like(http_get('/keys?dict=sharded'), qr/FOO\,FOO2\,FOO3/, 'sharded keys');
+
+http_get('/clear?dict=sharded');
+like(http_get('/size?dict=sharded'), qr/size: 0/,
+	'no of items in sharded after clear');
+
+like(http_get('/many?dict=sharded&n=200'), qr/size: 100/,
+	'sharded many keys');
+like(http_get('/many?dict=sharded_big&n=140000'), qr/size: 70000/,
+	'sharded many keys per shard');
+
+}
+
 ###############################################################################
 
 sub has_version {
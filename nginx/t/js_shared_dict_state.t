@@ -43,6 +43,12 @@ http {
 
     js_shared_dict_zone zone=bar:64k type=string state=bar.json;
     js_shared_dict_zone zone=waka:32k timeout=1000s type=number state=waka.json;
+    js_shared_dict_zone zone=bin:64k type=string state=bin.state
+                        state_format=binary;
+    js_shared_dict_zone zone=bin_num:64k timeout=1000s type=number shards=2
+                        state=bin_num.state state_format=binary;
+    js_shared_dict_zone zone=bin_large:1m type=string state=bin_large.state
+                        state_format=binary;
 
     server {
         listen       127.0.0.1:8080;
@@ -96,6 +102,9 @@ $t->write_file('test.js', <<'EOF');
 
         } else if (v == 'empty') {
             v = '';
+
+        } else if (v == 'large') {
+            v = 'x'.repeat(100000);
         }
 
         return v;
@@ -183,7 +192,7 @@ $t->write_file('test.js', <<'EOF');
     export default { add, clear, del, get, incr, pop, set };
 EOF
 
-$t->try_run('no js_shared_dict_zone with state=')->plan(11);
+$t->try_run('no js_shared_dict_zone with state=')->plan(18);
 
 ###############################################################################
 
@@ -229,6 +238,35 @@ $bar_state = read_state($t, 'bar.json');
 
 is($bar_state->{waka}, undef, 'no bar.waka in state');
 
+http_get('/set?dict=bin&key=foo&value=bar');
+http_get('/set?dict=bin&key=empty&value=empty');
+http_get('/set?dict=bin_num&key=foo&value=42');
+http_get('/incr?dict=bin_num&key=bar&by=5');
+
+for my $key (qw/a b c large d e f/) {
+	my $value = $key eq 'large' ? 'large' : "v$key";
+	http_get("/set?dict=bin_large&key=$key&value=$value");
+}
+
+select undef, undef, undef, 1.1;
+
+like($t->read_file('bin.state'), qr/^NJSD/, 'binary state');
+
+$t->stop();
+$t->run();
+
+like(http_get('/get?dict=bin&key=foo'), qr/bar/, 'get bin.foo from state');
+like(http_get('/get?dict=bin&key=empty'), qr/empty/,
+	'get bin.empty from state');
+like(http_get('/get?dict=bin_num&key=foo'), qr/42/,
+	'get bin_num.foo from state');
+like(http_get('/get?dict=bin_num&key=bar'), qr/5/,
+	'get bin_num.bar from state');
+like(http_get('/get?dict=bin_large&key=large'),
+	qr/\x0d\x0a\x0d\x0a(x{50000}){2}$/s, 'get bin_large.large from state');
+is(join(',', map { http_get("/get?dict=bin_large&key=$_") =~ /(v\w)$/ }
+	qw/a b c d e f/), 'va,vb,vc,vd,ve,vf', 'get bin_large others from state');
+
 ###############################################################################
 
 sub decode_json {
@@ -0,0 +1,157 @@
+#!/usr/bin/perl
+
+# (C) Dmitry Volyntsev
+# (C) Nginx, Inc.
+
+# Tests for stream njs module, VM memory collection.
+
+###############################################################################
+
+use warnings;
+use strict;
+
+use Test::More;
+
+BEGIN { use FindBin; chdir($FindBin::Bin); }
+
+use lib 'lib';
+use Test::Nginx;
+use Test::Nginx::Stream qw/ stream /;
+
+###############################################################################
+
+select STDERR; $| = 1;
+select STDOUT; $| = 1;
+
+my $t = Test::Nginx->new()->has(qw/http stream/)
+	->write_file_expand('nginx.conf', <<'EOF');
+
+%%TEST_GLOBALS%%
+
+daemon off;
+
+events {
+}
+
+http {
+    %%TEST_GLOBALS_HTTP%%
+
+    js_import test.js;
+
+    server {
+        listen       127.0.0.1:8080;
+        server_name  localhost;
+
+        location /njs {
+            js_content test.njs;
+        }
+    }
+}
+
+stream {
+    %%TEST_GLOBALS_STREAM%%
+
+    js_import test.js;
+
+    server {
+        listen      127.0.0.1:8081;
+        js_filter   test.filter;
+        js_context_gc_threshold 256k;
+        proxy_pass  127.0.0.1:8090;
+    }
+
+    server {
+        listen      127.0.0.1:8082;
+        js_filter   test.filter;
+        proxy_pass  127.0.0.1:8090;
+    }
+}
+
+EOF
+
+$t->write_file('test.js', <<EOF);
+    function test_njs(r) {
+        r.return(200, njs.version);
+    }
+
+    function filter(s) {
+        var state = {n: 0, bytes: 0};
+
+        s.on('upload', (data, flags) => {
+            var garbage = [];
+
+            for (var i = 0; i < 2000; i++) {
+                garbage.push({i: i, s: 'x'.repeat(64) + i});
+            }
+
+            state.n++;
+            state.bytes += data.length + garbage.length - 2000;
+
+            if (state.n == 3) {
+                state.size = njs.memoryStats.size;
+            }
+
+            var flat = njs.memoryStats.size < state.size * 2;
+
+            s.send(`\${state.n}:\${state.bytes}:\${flat}`, flags);
+        });
+    }
+
+    export default {njs: test_njs, filter};
+
+EOF
+
+$t->run_daemon(\&stream_daemon, port(8090));
+$t->try_run('no js_context_gc_threshold')->plan(4);
+$t->waitforsocket('127.0.0.1:' . port(8090));
+
+###############################################################################
+
+my ($s, $r);
+
+$s = stream('127.0.0.1:' . port(8081));
+$r = $s->io('abc', read => 1) for 1 .. 50;
+is($r, '50:150:true', 'memory is collected');
+is($s->io('de', read => 1), '51:152:true', 'state is kept');
+
+$s = stream('127.0.0.1:' . port(8082));
+$r = $s->io('abc', read => 1) for 1 .. 50;
+is($r, '50:150:false', 'memory is not collected');
+
+$t->stop();
+
+unlike($t->read_file('error.log'), qr/\[(error|alert|crit)\]/, 'no errors');
+
+###############################################################################
+
+sub stream_daemon {
+	my $server = IO::Socket::INET->new(
+		Proto => 'tcp',
+		LocalAddr => '127.0.0.1:' . port(8090),
+		Listen => 5,
+		Reuse => 1
+	)
+		or die "Can't create listening socket: $!\n";
+
+	local $SIG{PIPE} = 'IGNORE';
+
+	while (my $client = $server->accept()) {
+		$client->autoflush(1);
+
+		log2c("(new connection $client)");
+
+		while ($client->sysread(my $buffer, 65536)) {
+			log2i("$client $buffer");
+			log2o("$client $buffer");
+			$client->syswrite($buffer);
+		}
+
+		close $client;
+	}
+}
+
+sub log2i { Test::Nginx::log_core('|| <<', @_); }
+sub log2o { Test::Nginx::log_core('|| >>', @_); }
+sub log2c { Test::Nginx::log_core('||', @_); }
+
+###############################################################################
@@ -229,6 +229,14 @@ typedef struct {
 } njs_vm_meta_t;
 
 
+typedef struct {
+    size_t                          size;
+    size_t                          evicted;
+    uint64_t                        hits;
+    uint64_t                        misses;
+} njs_vm_regexp_cache_stat_t;
+
+
 typedef njs_int_t (*njs_addon_init_pt)(njs_vm_t *vm);
 
 typedef struct {
@@ -311,6 +319,8 @@ NJS_EXPORT njs_mod_t *njs_vm_add_module(njs_vm_t *vm, njs_str_t *name,
 NJS_EXPORT njs_mod_t *njs_vm_compile_module(njs_vm_t *vm, njs_str_t *name,
     u_char **start, u_char *end);
 NJS_EXPORT njs_int_t njs_vm_reuse(njs_vm_t *vm);
+NJS_EXPORT void njs_vm_reset(njs_vm_t *vm, njs_external_ptr_t external);
+NJS_EXPORT njs_int_t njs_vm_collect(njs_vm_t *vm, void *root, size_t size);
 NJS_EXPORT njs_vm_t *njs_vm_clone(njs_vm_t *vm, njs_external_ptr_t external);
 
 NJS_EXPORT njs_int_t njs_vm_enqueue_job(njs_vm_t *vm, njs_function_t *function,
@@ -338,6 +348,12 @@ NJS_EXPORT njs_int_t njs_vm_call(njs_vm_t *vm, njs_function_t *function,
     const njs_value_t *args, njs_uint_t nargs);
 NJS_EXPORT njs_int_t njs_vm_invoke(njs_vm_t *vm, njs_function_t *function,
     const njs_value_t *args, njs_uint_t nargs, njs_value_t *retval);
+/*
+ * Same as njs_vm_invoke(), but with the explicit "this" value.
+ */
+NJS_EXPORT njs_int_t njs_vm_invoke_method(njs_vm_t *vm,
+    njs_function_t *function, const njs_value_t *this,
+    const njs_value_t *args, njs_uint_t nargs, njs_value_t *retval);
 
 /*
  * Runs the global code.
@@ -405,6 +421,8 @@ NJS_EXPORT void njs_vm_error3(njs_vm_t *vm, unsigned type, const char *fmt,
     ...);
 NJS_EXPORT void njs_vm_exception_get(njs_vm_t *vm, njs_value_t *retval);
 NJS_EXPORT njs_mp_t *njs_vm_memory_pool(njs_vm_t *vm);
+NJS_EXPORT void njs_vm_regexp_cache_stat(njs_vm_t *vm,
+    njs_vm_regexp_cache_stat_t *stat);
 NJS_EXPORT njs_external_ptr_t njs_vm_external_ptr(njs_vm_t *vm);
 
 NJS_EXPORT njs_int_t njs_value_to_integer(njs_vm_t *vm, njs_value_t *value,
@@ -474,6 +492,7 @@ NJS_EXPORT void njs_value_function_set(njs_value_t *value,
     njs_function_t *function);
 NJS_EXPORT void njs_value_external_set(njs_value_t *value,
     njs_external_ptr_t external);
+NJS_EXPORT void njs_value_external_detach(njs_value_t *value);
 
 NJS_EXPORT uint8_t njs_value_bool(const njs_value_t *value);
 NJS_EXPORT double njs_value_number(const njs_value_t *value);
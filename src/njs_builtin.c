@@ -173,6 +173,11 @@ njs_builtin_objects_create(njs_vm_t *vm)
 
     shared->empty_regexp_pattern = pattern;
 
+    ret = njs_regexp_cache_init(vm);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return NJS_ERROR;
+    }
+
     ret = njs_object_hash_init(vm, &shared->array_instance_hash,
                                &njs_array_instance_init);
     if (njs_slow_path(ret != NJS_OK)) {
@@ -130,6 +130,21 @@ static njs_code_name_t  code_names[] = {
     { NJS_VMCODE_GREATER_OR_EQUAL, sizeof(njs_vmcode_3addr_t),
           njs_str("GREATER OR EQUAL") },
 
+    { NJS_VMCODE_LESS_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("LESS NUM        ") },
+    { NJS_VMCODE_GREATER_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("GREATER NUM     ") },
+    { NJS_VMCODE_LESS_OR_EQUAL_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("LESS EQ NUM     ") },
+    { NJS_VMCODE_GREATER_OR_EQUAL_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("GREATER EQ NUM  ") },
+    { NJS_VMCODE_ADDITION_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("ADD NUM         ") },
+    { NJS_VMCODE_EQUAL_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("EQUAL NUM       ") },
+    { NJS_VMCODE_NOT_EQUAL_NUMBER, sizeof(njs_vmcode_3addr_t),
+          njs_str("NOT EQUAL NUM   ") },
+
     { NJS_VMCODE_STRICT_EQUAL, sizeof(njs_vmcode_3addr_t),
           njs_str("STRICT EQUAL    ") },
     { NJS_VMCODE_STRICT_NOT_EQUAL, sizeof(njs_vmcode_3addr_t),
@@ -287,6 +302,56 @@ njs_disassemble(u_char *start, u_char *end, njs_int_t count, njs_arr_t *lines)
             continue;
         }
 
+        switch (operation) {
+        case NJS_VMCODE_IF_LESS_JUMP:
+            type = "JUMP IF LESS     ";
+            break;
+
+        case NJS_VMCODE_IF_GREATER_JUMP:
+            type = "JUMP IF GREATER  ";
+            break;
+
+        case NJS_VMCODE_IF_LESS_OR_EQUAL_JUMP:
+            type = "JUMP IF LESS EQ  ";
+            break;
+
+        case NJS_VMCODE_IF_GREATER_OR_EQUAL_JUMP:
+            type = "JUMP IF GREAT EQ ";
+            break;
+
+        case NJS_VMCODE_IF_NOT_LESS_JUMP:
+            type = "JUMP IF NOT LESS ";
+            break;
+
+        case NJS_VMCODE_IF_NOT_GREATER_JUMP:
+            type = "JUMP IF NOT GREAT";
+            break;
+
+        case NJS_VMCODE_IF_NOT_LESS_OR_EQUAL_JUMP:
+            type = "JUMP IF NOT LE   ";
+            break;
+
+        case NJS_VMCODE_IF_NOT_GREATER_OR_EQUAL_JUMP:
+            type = "JUMP IF NOT GE   ";
+            break;
+
+        default:
+            type = NULL;
+            break;
+        }
+
+        if (type != NULL) {
+            equal = (njs_vmcode_equal_jump_t *) p;
+
+            njs_printf("%5uD | %05uz %s %04Xz %04Xz %z\n",
+                       line, p - start, type, (size_t) equal->value1,
+                       (size_t) equal->value2, (size_t) equal->offset);
+
+            p += sizeof(njs_vmcode_equal_jump_t);
+
+            continue;
+        }
+
         if (operation == NJS_VMCODE_TEST_IF_TRUE) {
             test_jump = (njs_vmcode_test_jump_t *) p;
 
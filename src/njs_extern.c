@@ -216,9 +216,18 @@ njs_external_prop_handler(njs_vm_t *vm, njs_object_prop_t *self,
         ov->object.shared_hash = slots->external_shared_hash;
         ov->object.slots = slots;
 
-        external = njs_vm_external(vm, NJS_PROTO_ID_ANY, value);
+        if (njs_fast_path(njs_is_object_data(value,
+                                             njs_make_tag(NJS_PROTO_ID_ANY))))
+        {
+            external = njs_vm_external(vm, NJS_PROTO_ID_ANY, value);
+
+            njs_set_data(&ov->value, external, njs_value_external_tag(value));
+
+        } else {
+            /* The properties of a detached object are detached. */
+            njs_set_undefined(&ov->value);
+        }
 
-        njs_set_data(&ov->value, external, njs_value_external_tag(value));
         njs_set_object_value(retval, ov);
     }
 
@@ -428,6 +437,58 @@ njs_vm_external(njs_vm_t *vm, njs_int_t proto_id, const njs_value_t *value)
 }
 
 
+/*
+ * Detaches an external object and the objects created for its external
+ * properties, so njs_vm_external() returns NULL for them.  The objects
+ * may be referenced by the VM after the external pointer is freed.
+ */
+
+void
+njs_value_external_detach(njs_value_t *value)
+{
+    njs_value_t         *v;
+    njs_flathsh_elt_t   *elt;
+    njs_object_prop_t   *prop;
+    njs_external_ptr_t  external;
+    njs_flathsh_each_t  lhe;
+
+    if (!njs_is_object_data(value, njs_make_tag(NJS_PROTO_ID_ANY))) {
+        return;
+    }
+
+    external = njs_object_data(value);
+
+    njs_set_undefined(njs_object_value(value));
+
+    if (external == NULL) {
+        return;
+    }
+
+    njs_flathsh_each_init(&lhe, &njs_object_hash_proto);
+
+    for ( ;; ) {
+        elt = njs_flathsh_each(njs_object_hash(value), &lhe);
+        if (elt == NULL) {
+            break;
+        }
+
+        prop = (njs_object_prop_t *) elt;
+
+        if (prop->type != NJS_PROPERTY) {
+            continue;
+        }
+
+        v = njs_prop_value(prop);
+
+        if (njs_is_object_data(v, njs_make_tag(NJS_PROTO_ID_ANY))
+            && njs_object_data(v) == external)
+        {
+            njs_value_external_detach(v);
+        }
+    }
+}
+
+
 njs_int_t
 njs_value_external_tag(const njs_value_t *value)
 {
@@ -156,6 +156,33 @@ njs_flathsh_destroy(njs_flathsh_t *fh, njs_flathsh_query_t *fhq)
 }
 
 
+njs_flathsh_descr_t *
+njs_flathsh_copy(const njs_flathsh_descr_t *src, njs_flathsh_query_t *fhq)
+{
+    size_t               hash_size;
+    njs_flathsh_descr_t  *h;
+
+    hash_size = src->hash_mask + 1;
+
+    h = njs_flathsh_alloc(fhq, hash_size, src->elts_count);
+    if (njs_slow_path(h == NULL)) {
+        return NULL;
+    }
+
+    memcpy(njs_flathsh_chunk(h),
+           njs_flathsh_chunk((njs_flathsh_descr_t *) src),
+           hash_size * sizeof(uint32_t));
+
+    memcpy(njs_hash_elts(h), njs_hash_elts(src),
+           src->elts_count * sizeof(njs_flathsh_elt_t));
+
+    h->elts_count = src->elts_count;
+    h->elts_deleted_count = src->elts_deleted_count;
+
+    return h;
+}
+
+
 static njs_flathsh_descr_t *
 njs_flathsh_alloc(njs_flathsh_query_t *fhq, size_t hash_size, size_t elts_size)
 {
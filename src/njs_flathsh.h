@@ -160,6 +160,13 @@ NJS_EXPORT njs_flathsh_elt_t *njs_flathsh_add_elt(njs_flathsh_t *fh,
     njs_flathsh_query_t *fhq);
 
 NJS_EXPORT njs_flathsh_descr_t *njs_flathsh_new(njs_flathsh_query_t *fhq);
+/*
+ * njs_flathsh_copy() creates a copy of the hash trimmed to its used elements.
+ *
+ * The required njs_flathsh_query_t fields: proto, pool.
+ */
+NJS_EXPORT njs_flathsh_descr_t *njs_flathsh_copy(const njs_flathsh_descr_t *src,
+    njs_flathsh_query_t *fhq);
 NJS_EXPORT void njs_flathsh_destroy(njs_flathsh_t *fh, njs_flathsh_query_t *fhq);
 
 
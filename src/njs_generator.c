@@ -121,6 +121,9 @@ static njs_int_t njs_generate_let(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node, njs_variable_t *var);
 static njs_int_t njs_generate_if_statement(njs_vm_t *vm,
     njs_generator_t *generator, njs_parser_node_t *node);
+static njs_int_t njs_generate_cond_jump(njs_vm_t *vm,
+    njs_generator_t *generator, njs_vmcode_t operation,
+    njs_parser_node_t *cond, njs_jump_off_t *jump_offset);
 static njs_int_t njs_generate_if_statement_cond(njs_vm_t *vm,
     njs_generator_t *generator, njs_parser_node_t *node);
 static njs_int_t njs_generate_if_statement_then(njs_vm_t *vm,
@@ -256,6 +259,8 @@ static njs_int_t njs_generate_operation_assignment_end(njs_vm_t *vm,
     njs_generator_t *generator, njs_parser_node_t *node);
 static njs_int_t njs_generate_object(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node);
+static njs_int_t njs_generate_object_shape(njs_vm_t *vm,
+    njs_parser_node_t *node, njs_flathsh_descr_t **shape);
 static njs_int_t njs_generate_property_accessor(njs_vm_t *vm,
     njs_generator_t *generator, njs_parser_node_t *node);
 static njs_int_t njs_generate_property_accessor_end(njs_vm_t *vm,
@@ -395,6 +400,10 @@ static njs_int_t njs_generate_index_release(njs_vm_t *vm,
     } while (0)
 
 
+#define njs_generate_prop_cache_init(_code)                                   \
+    njs_memzero(&(_code)->cache, sizeof(njs_vmcode_prop_cache_t))
+
+
 #define njs_generate_code_jump(generator, _code, _offset)                     \
     do {                                                                      \
         njs_generate_code(generator, njs_vmcode_jump_t, _code,                \
@@ -1128,25 +1137,101 @@ njs_generate_if_statement(njs_vm_t *vm, njs_generator_t *generator,
 }
 
 
+/*
+ * A comparison into a temporary value which is the last instruction
+ * of the condition is replaced with a fused comparison and jump.
+ * Both forms start with the code and the offset fields.
+ */
+
+static njs_int_t
+njs_generate_cond_jump(njs_vm_t *vm, njs_generator_t *generator,
+    njs_vmcode_t operation, njs_parser_node_t *cond,
+    njs_jump_off_t *jump_offset)
+{
+    njs_bool_t               negate;
+    njs_vmcode_t             fused;
+    njs_vmcode_3addr_t       *last;
+    njs_vmcode_cond_jump_t   *cond_jump;
+    njs_vmcode_equal_jump_t  *cmp_jump;
+
+    negate = (operation == NJS_VMCODE_IF_FALSE_JUMP);
+
+    switch (cond->token_type) {
+    case NJS_TOKEN_LESS:
+        fused = negate ? NJS_VMCODE_IF_NOT_LESS_JUMP
+                       : NJS_VMCODE_IF_LESS_JUMP;
+        break;
+
+    case NJS_TOKEN_GREATER:
+        fused = negate ? NJS_VMCODE_IF_NOT_GREATER_JUMP
+                       : NJS_VMCODE_IF_GREATER_JUMP;
+        break;
+
+    case NJS_TOKEN_LESS_OR_EQUAL:
+        fused = negate ? NJS_VMCODE_IF_NOT_LESS_OR_EQUAL_JUMP
+                       : NJS_VMCODE_IF_LESS_OR_EQUAL_JUMP;
+        break;
+
+    case NJS_TOKEN_GREATER_OR_EQUAL:
+        fused = negate ? NJS_VMCODE_IF_NOT_GREATER_OR_EQUAL_JUMP
+                       : NJS_VMCODE_IF_GREATER_OR_EQUAL_JUMP;
+        break;
+
+    default:
+        fused = operation;
+        break;
+    }
+
+    if (fused != operation
+        && cond->temporary
+        && (size_t) (generator->code_end - generator->code_start)
+           >= sizeof(njs_vmcode_3addr_t))
+    {
+        last = (njs_vmcode_3addr_t *)
+                   (generator->code_end - sizeof(njs_vmcode_3addr_t));
+
+        if (last->code == cond->u.operation && last->dst == cond->index) {
+            cmp_jump = (njs_vmcode_equal_jump_t *) last;
+
+            cmp_jump->code = fused;
+            cmp_jump->offset = 0;
+
+            /* value1 and value2 are at the places of src1 and src2. */
+
+            *jump_offset = njs_code_offset(generator, cmp_jump);
+
+            return NJS_OK;
+        }
+    }
+
+    njs_generate_code(generator, njs_vmcode_cond_jump_t, cond_jump,
+                      operation, cond);
+    cond_jump->cond = cond->index;
+
+    *jump_offset = njs_code_offset(generator, cond_jump);
+
+    return NJS_OK;
+}
+
+
 static njs_int_t
 njs_generate_if_statement_cond(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
-    njs_int_t               ret;
-    njs_jump_off_t          jump_offset;
-    njs_vmcode_cond_jump_t  *cond_jump;
+    njs_int_t       ret;
+    njs_jump_off_t  jump_offset;
 
-    njs_generate_code(generator, njs_vmcode_cond_jump_t, cond_jump,
-                      NJS_VMCODE_IF_FALSE_JUMP, node);
-    cond_jump->cond = node->left->index;
+    ret = njs_generate_cond_jump(vm, generator, NJS_VMCODE_IF_FALSE_JUMP,
+                                 node->left, &jump_offset);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return ret;
+    }
 
     ret = njs_generate_node_index_release(vm, generator, node->left);
     if (njs_slow_path(ret != NJS_OK)) {
         return ret;
     }
 
-    jump_offset = njs_code_offset(generator, cond_jump);
-
     if (node->right != NULL && node->right->token_type == NJS_TOKEN_BRANCHING) {
 
         /* The "then" branch in a case of "if/then/else" statement. */
@@ -1638,16 +1723,20 @@ njs_generate_while_end(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
     njs_int_t                 ret;
+    njs_jump_off_t            jump_offset;
     njs_vmcode_cond_jump_t    *cond_jump;
     njs_generator_loop_ctx_t  *ctx;
 
     ctx = generator->context;
 
-    njs_generate_code(generator, njs_vmcode_cond_jump_t, cond_jump,
-                      NJS_VMCODE_IF_TRUE_JUMP, node->right);
-    cond_jump->offset = ctx->loop_offset - njs_code_offset(generator,
-                                                           cond_jump);
-    cond_jump->cond = node->right->index;
+    ret = njs_generate_cond_jump(vm, generator, NJS_VMCODE_IF_TRUE_JUMP,
+                                 node->right, &jump_offset);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return ret;
+    }
+
+    cond_jump = njs_code_ptr(generator, njs_vmcode_cond_jump_t, jump_offset);
+    cond_jump->offset = ctx->loop_offset - jump_offset;
 
     njs_generate_patch_block_exit(vm, generator);
 
@@ -1705,16 +1794,20 @@ njs_generate_do_while_end(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
     njs_int_t                 ret;
+    njs_jump_off_t            jump_offset;
     njs_vmcode_cond_jump_t    *cond_jump;
     njs_generator_loop_ctx_t  *ctx;
 
     ctx = generator->context;
 
-    njs_generate_code(generator, njs_vmcode_cond_jump_t, cond_jump,
-                      NJS_VMCODE_IF_TRUE_JUMP, node->right);
-    cond_jump->offset = ctx->loop_offset
-                        - njs_code_offset(generator, cond_jump);
-    cond_jump->cond = node->right->index;
+    ret = njs_generate_cond_jump(vm, generator, NJS_VMCODE_IF_TRUE_JUMP,
+                                 node->right, &jump_offset);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return ret;
+    }
+
+    cond_jump = njs_code_ptr(generator, njs_vmcode_cond_jump_t, jump_offset);
+    cond_jump->offset = ctx->loop_offset - jump_offset;
 
     njs_generate_patch_block_exit(vm, generator);
 
@@ -1878,6 +1971,7 @@ njs_generate_for_end(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
     njs_int_t                 ret;
+    njs_jump_off_t            jump_offset;
     njs_parser_node_t         *condition;
     njs_vmcode_cond_jump_t    *cond_jump;
     njs_generator_loop_ctx_t  *ctx;
@@ -1887,11 +1981,15 @@ njs_generate_for_end(njs_vm_t *vm, njs_generator_t *generator,
     condition = node->right->left;
 
     if (condition != NULL) {
-        njs_generate_code(generator, njs_vmcode_cond_jump_t, cond_jump,
-                          NJS_VMCODE_IF_TRUE_JUMP, condition);
-        cond_jump->offset = ctx->loop_offset
-                            - njs_code_offset(generator, cond_jump);
-        cond_jump->cond = condition->index;
+        ret = njs_generate_cond_jump(vm, generator, NJS_VMCODE_IF_TRUE_JUMP,
+                                     condition, &jump_offset);
+        if (njs_slow_path(ret != NJS_OK)) {
+            return ret;
+        }
+
+        cond_jump = njs_code_ptr(generator, njs_vmcode_cond_jump_t,
+                                 jump_offset);
+        cond_jump->offset = ctx->loop_offset - jump_offset;
 
         njs_generate_patch_block_exit(vm, generator);
 
@@ -2302,6 +2400,8 @@ njs_generate_for_in_set_prop_block(njs_vm_t *vm, njs_generator_t *generator,
 
     njs_generate_code(generator, njs_vmcode_prop_set_t, prop_set,
                       opcode, foreach);
+    njs_generate_prop_cache_init(prop_set);
+
     prop_set->object = foreach->left->left->index;
     prop_set->property = prop->index;
     prop_set->value = ctx->index_next_value;
@@ -3021,6 +3121,7 @@ njs_generate_global_property_set(njs_vm_t *vm, njs_generator_t *generator,
     if (var == NULL) {
         njs_generate_code(generator, njs_vmcode_prop_set_t, prop_set,
                           NJS_VMCODE_PROPERTY_ATOM_SET, node_src);
+        njs_generate_prop_cache_init(prop_set);
 
         prop_set->value = node_dst->index;
         prop_set->object = njs_scope_global_this_index();
@@ -3257,6 +3358,8 @@ njs_generate_assignment_end(njs_vm_t *vm, njs_generator_t *generator,
                           opcode, expr);
     }
 
+    njs_generate_prop_cache_init(prop_set);
+
     prop_set->value = expr->index;
     prop_set->object = object->index;
     prop_set->property = prop_index;
@@ -3472,6 +3575,7 @@ njs_generate_operation_assignment_prop(njs_vm_t *vm, njs_generator_t *generator,
 
     njs_generate_code(generator, njs_vmcode_prop_get_t, prop_get,
                       opcode, property);
+    njs_generate_prop_cache_init(prop_get);
 
     prop_get->value = index;
     prop_get->object = object->index;
@@ -3522,6 +3626,7 @@ njs_generate_operation_assignment_end(njs_vm_t *vm, njs_generator_t *generator,
 
     njs_generate_code(generator, njs_vmcode_prop_set_t, prop_set,
                       opcode, expr);
+    njs_generate_prop_cache_init(prop_set);
 
     prop_set->value = node->index;
     prop_set->object = lvalue->left->index;
@@ -3540,6 +3645,8 @@ static njs_int_t
 njs_generate_object(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
+    njs_int_t            ret;
+    njs_flathsh_descr_t  *shape;
     njs_vmcode_object_t  *object;
 
     node->index = njs_generate_object_dest_index(vm, generator, node);
@@ -3547,9 +3654,15 @@ njs_generate_object(njs_vm_t *vm, njs_generator_t *generator,
         return NJS_ERROR;
     }
 
+    ret = njs_generate_object_shape(vm, node, &shape);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return ret;
+    }
+
     njs_generate_code(generator, njs_vmcode_object_t, object,
                       NJS_VMCODE_OBJECT, node);
     object->retval = node->index;
+    object->shape = shape;
 
     /* Initialize object. */
 
@@ -3561,6 +3674,108 @@ njs_generate_object(njs_vm_t *vm, njs_generator_t *generator,
 }
 
 
+/*
+ * An object literal consisting only of "key: value" and method definitions
+ * with static non-index keys gets a prebuilt hash with its keys in
+ * the literal order.  The object is created as a copy of the hash in
+ * a single allocation and PROPERTY_INIT only fills in the values.
+ * All objects created by the literal share the same element layout.
+ */
+
+static njs_int_t
+njs_generate_object_shape(njs_vm_t *vm, njs_parser_node_t *node,
+    njs_flathsh_descr_t **shape)
+{
+    uint32_t             *atom, n;
+    njs_int_t            ret;
+    njs_arr_t            *atoms;
+    njs_flathsh_t        hash;
+    njs_object_prop_t    *prop;
+    njs_parser_node_t    *stmt, *assign, *property;
+    njs_flathsh_query_t  fhq;
+
+    *shape = NULL;
+
+    n = 0;
+
+    for (stmt = node->left; stmt != NULL; stmt = stmt->left) {
+        assign = stmt->right;
+
+        if (assign == NULL
+            || assign->token_type != NJS_TOKEN_ASSIGNMENT
+            || assign->left->token_type != NJS_TOKEN_PROPERTY_INIT)
+        {
+            return NJS_OK;
+        }
+
+        property = assign->left->right;
+
+        if (property->token_type != NJS_TOKEN_STRING
+            || property->u.value.atom_id == NJS_ATOM_STRING_unknown
+            || njs_atom_is_number(property->u.value.atom_id))
+        {
+            return NJS_OK;
+        }
+
+        n++;
+    }
+
+    if (n == 0) {
+        return NJS_OK;
+    }
+
+    atoms = njs_arr_create(vm->mem_pool, n, sizeof(uint32_t));
+    if (njs_slow_path(atoms == NULL)) {
+        return NJS_ERROR;
+    }
+
+    /* Statements are linked in the reverse order. */
+
+    atom = njs_arr_add_multiple(atoms, n);
+    if (njs_slow_path(atom == NULL)) {
+        return NJS_ERROR;
+    }
+
+    for (stmt = node->left; stmt != NULL; stmt = stmt->left) {
+        atom[--n] = stmt->right->left->right->u.value.atom_id;
+    }
+
+    njs_flathsh_init(&hash);
+
+    fhq.replace = 0;
+    fhq.pool = vm->mem_pool;
+    fhq.proto = &njs_object_hash_proto;
+
+    for (n = 0; n < atoms->items; n++) {
+        fhq.key_hash = atom[n];
+
+        ret = njs_flathsh_unique_insert(&hash, &fhq);
+        if (njs_slow_path(ret == NJS_ERROR)) {
+            return NJS_ERROR;
+        }
+
+        if (ret == NJS_DECLINED) {
+            /* Duplicate key. */
+            continue;
+        }
+
+        prop = fhq.value;
+
+        prop->type = NJS_PROPERTY;
+        prop->enumerable = 1;
+        prop->configurable = 1;
+        prop->writable = 1;
+        njs_set_invalid(njs_prop_value(prop));
+    }
+
+    *shape = hash.slot;
+
+    njs_arr_destroy(atoms);
+
+    return NJS_OK;
+}
+
+
 static njs_int_t
 njs_generate_property_accessor(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
@@ -3905,10 +4120,11 @@ static njs_int_t
 njs_generate_3addr_operation_end(njs_vm_t *vm, njs_generator_t *generator,
     njs_parser_node_t *node)
 {
-    njs_bool_t          swap;
-    njs_vmcode_t        opcode;
-    njs_parser_node_t   *left, *right;
-    njs_vmcode_3addr_t  *code;
+    njs_bool_t             swap;
+    njs_vmcode_t           opcode;
+    njs_parser_node_t      *left, *right;
+    njs_vmcode_3addr_t     *code;
+    njs_vmcode_prop_get_t  *prop_get;
 
     left = node->left;
     right = node->right;
@@ -3924,8 +4140,21 @@ njs_generate_3addr_operation_end(njs_vm_t *vm, njs_generator_t *generator,
         opcode = node->u.operation;
     }
 
-    njs_generate_code(generator, njs_vmcode_3addr_t, code,
-                      opcode, node);
+    if (opcode == NJS_VMCODE_PROPERTY_GET
+        || opcode == NJS_VMCODE_PROPERTY_ATOM_GET)
+    {
+        /* njs_vmcode_prop_get_t starts with njs_vmcode_3addr_t layout. */
+
+        njs_generate_code(generator, njs_vmcode_prop_get_t, prop_get,
+                          opcode, node);
+        njs_generate_prop_cache_init(prop_get);
+
+        code = (njs_vmcode_3addr_t *) prop_get;
+
+    } else {
+        njs_generate_code(generator, njs_vmcode_3addr_t, code,
+                          opcode, node);
+    }
 
     swap = *((njs_bool_t *) generator->context);
 
@@ -4181,6 +4410,7 @@ found:
 
     njs_generate_code(generator, njs_vmcode_prop_get_t, prop_get,
                       opcode, node);
+    njs_generate_prop_cache_init(prop_get);
 
     prop_get->value = index;
     prop_get->object = lvalue->left->index;
@@ -4201,6 +4431,7 @@ found:
 
     njs_generate_code(generator, njs_vmcode_prop_set_t, prop_set,
                       opcode, node);
+    njs_generate_prop_cache_init(prop_set);
 
     prop_set->value = index;
     prop_set->object = lvalue->left->index;
@@ -5469,6 +5700,7 @@ njs_generate_global_reference(njs_vm_t *vm, njs_generator_t *generator,
     njs_generate_code(generator, njs_vmcode_prop_get_t, prop_get,
                  exception ? NJS_VMCODE_GLOBAL_GET: NJS_VMCODE_PROPERTY_GET,
                  node);
+    njs_generate_prop_cache_init(prop_get);
 
     prop_get->value = index;
 
@@ -19,6 +19,10 @@
  * sizes of the clusters and large allocations are stored in rbtree blocks
  * to find them on free operations.  The rbtree nodes are sorted by start
  * addresses.
+ *
+ * The pool does not know the layout of the allocations.  njs_mp_collect()
+ * treats any word which points into a busy chunk or a large allocation
+ * as a reference, so unreachable allocations are found conservatively.
  */
 
 
@@ -75,6 +79,13 @@ typedef struct {
     uint32_t                    size;
 
     u_char                      *start;
+
+    /*
+     * Marks of reachable chunks, 4 bytes per page of cluster or a byte
+     * for a large allocation, valid only inside of njs_mp_collect().
+     */
+    uint8_t                     *marks;
+
     njs_mp_page_t               pages[];
 } njs_mp_block_t;
 
@@ -98,6 +109,10 @@ struct njs_mp_s {
     /* rbtree of njs_mp_block_t. */
     njs_rbtree_t                blocks;
 
+    /* Total size and number of clusters and large allocations. */
+    size_t                      size;
+    size_t                      nblocks;
+
     njs_queue_t                 free_pages;
 
     uint8_t                     chunk_size_shift;
@@ -113,7 +128,7 @@ struct njs_mp_s {
 
 
 #define njs_mp_chunk_is_free(map, chunk)                                      \
-    ((map[chunk / 8] & (0x80 >> (chunk & 7))) == 0)
+    (((map)[(chunk) / 8] & (0x80 >> ((chunk) & 7))) == 0)
 
 
 #define njs_mp_chunk_set_free(map, chunk)                                     \
@@ -128,6 +143,20 @@ struct njs_mp_s {
     ((((value) - 1) & (value)) == 0)
 
 
+typedef struct {
+    njs_mp_t                    *mp;
+
+    /* Bounds of the pool memory to filter out non pointers quickly. */
+    u_char                      *low;
+    u_char                      *high;
+
+    /* Stack of ranges to scan, reused for the list of unreachable chunks. */
+    njs_mp_root_t               *stack;
+    njs_uint_t                  items;
+    njs_uint_t                  avail;
+} njs_mp_collect_t;
+
+
 static njs_uint_t njs_mp_shift(njs_uint_t n);
 #if !(NJS_DEBUG_MEMORY)
 static void *njs_mp_alloc_small(njs_mp_t *mp, size_t size);
@@ -142,6 +171,9 @@ static njs_mp_block_t *njs_mp_find_block(njs_rbtree_t *tree,
     u_char *p);
 static const char *njs_mp_chunk_free(njs_mp_t *mp, njs_mp_block_t *cluster,
     u_char *p);
+static njs_int_t njs_mp_collect_mark(njs_mp_collect_t *gc, u_char *p);
+static njs_int_t njs_mp_collect_push(njs_mp_collect_t *gc, void *start,
+    size_t size);
 
 
 njs_mp_t *
@@ -288,24 +320,10 @@ njs_mp_destroy(njs_mp_t *mp)
 void
 njs_mp_stat(njs_mp_t *mp, njs_mp_stat_t *stat)
 {
-    njs_mp_block_t     *block;
-    njs_rbtree_node_t  *node;
-
-    stat->size = 0;
-    stat->nblocks = 0;
+    stat->size = mp->size;
+    stat->nblocks = mp->nblocks;
     stat->cluster_size = mp->cluster_size;
     stat->page_size = mp->page_size;
-
-    node = njs_rbtree_min(&mp->blocks);
-
-    while (njs_rbtree_is_there_successor(&mp->blocks, node)) {
-        block = (njs_mp_block_t *) node;
-
-        stat->nblocks++;
-        stat->size += block->size;
-
-        node = njs_rbtree_node_successor(&mp->blocks, node);
-    }
 }
 
 
@@ -573,6 +591,9 @@ njs_mp_alloc_cluster(njs_mp_t *mp)
 
     njs_rbtree_insert(&mp->blocks, &cluster->node);
 
+    mp->size += mp->cluster_size;
+    mp->nblocks++;
+
     return cluster;
 }
 
@@ -632,6 +653,9 @@ njs_mp_alloc_large(njs_mp_t *mp, size_t alignment, size_t size)
 
     njs_rbtree_insert(&mp->blocks, &block->node);
 
+    mp->size += size;
+    mp->nblocks++;
+
     return p;
 }
 
@@ -701,6 +725,9 @@ njs_mp_free(njs_mp_t *mp, void *p)
         } else if (njs_fast_path(p == block->start)) {
             njs_rbtree_delete(&mp->blocks, &block->node);
 
+            mp->size -= block->size;
+            mp->nblocks--;
+
             if (block->type == NJS_MP_DISCRETE_BLOCK) {
                 njs_free(block);
             }
@@ -847,6 +874,9 @@ njs_mp_chunk_free(njs_mp_t *mp, njs_mp_block_t *cluster,
 
     njs_rbtree_delete(&mp->blocks, &cluster->node);
 
+    mp->size -= mp->cluster_size;
+    mp->nblocks--;
+
     p = cluster->start;
 
     njs_free(cluster);
@@ -854,3 +884,252 @@ njs_mp_chunk_free(njs_mp_t *mp, njs_mp_block_t *cluster,
 
     return NULL;
 }
+
+
+/*
+ * The allocations reachable from the roots and from the cleanup handlers
+ * are marked by scanning them word by word, the rest are freed.  A failure
+ * to allocate the temporary structures leaves the pool intact.
+ */
+
+njs_int_t
+njs_mp_collect(njs_mp_t *mp, njs_mp_root_t *roots, njs_uint_t nroots)
+{
+    size_t             size;
+    u_char             *p, *end, *marks, **word;
+    njs_int_t          ret;
+    njs_uint_t         i, n, npages, chunk, nchunks;
+    njs_mp_root_t      range;
+    njs_mp_page_t      *page;
+    njs_mp_block_t     *block;
+    njs_rbtree_node_t  *node;
+    njs_mp_collect_t   gc;
+
+    if (njs_rbtree_is_empty(&mp->blocks)) {
+        return NJS_OK;
+    }
+
+    npages = mp->cluster_size >> mp->page_size_shift;
+
+    size = 0;
+    gc.high = NULL;
+
+    node = njs_rbtree_min(&mp->blocks);
+    gc.low = ((njs_mp_block_t *) node)->start;
+
+    while (njs_rbtree_is_there_successor(&mp->blocks, node)) {
+        block = (njs_mp_block_t *) node;
+
+        size += (block->type == NJS_MP_CLUSTER_BLOCK) ? npages * 4 : 1;
+        gc.high = block->start + block->size;
+
+        node = njs_rbtree_node_successor(&mp->blocks, node);
+    }
+
+    marks = njs_zalloc(size);
+    if (njs_slow_path(marks == NULL)) {
+        return NJS_ERROR;
+    }
+
+    p = marks;
+    node = njs_rbtree_min(&mp->blocks);
+
+    while (njs_rbtree_is_there_successor(&mp->blocks, node)) {
+        block = (njs_mp_block_t *) node;
+
+        block->marks = p;
+        p += (block->type == NJS_MP_CLUSTER_BLOCK) ? npages * 4 : 1;
+
+        node = njs_rbtree_node_successor(&mp->blocks, node);
+    }
+
+    gc.mp = mp;
+    gc.stack = NULL;
+    gc.items = 0;
+    gc.avail = 0;
+
+    ret = njs_mp_collect_mark(&gc, (u_char *) mp->cleanup);
+    if (njs_slow_path(ret != NJS_OK)) {
+        goto done;
+    }
+
+    for (i = 0; i < nroots; i++) {
+        ret = njs_mp_collect_mark(&gc, roots[i].start);
+        if (njs_slow_path(ret != NJS_OK)) {
+            goto done;
+        }
+
+        ret = njs_mp_collect_push(&gc, roots[i].start, roots[i].size);
+        if (njs_slow_path(ret != NJS_OK)) {
+            goto done;
+        }
+    }
+
+    while (gc.items != 0) {
+        range = gc.stack[--gc.items];
+
+        end = (u_char *) range.start + range.size;
+        word = (u_char **) njs_align_ptr(range.start, sizeof(void *));
+
+        for ( /* void */ ; (u_char *) (word + 1) <= end; word++) {
+            if (*word < gc.low || *word >= gc.high) {
+                continue;
+            }
+
+            ret = njs_mp_collect_mark(&gc, *word);
+            if (njs_slow_path(ret != NJS_OK)) {
+                goto done;
+            }
+        }
+    }
+
+    /* The stack is reused for the list of unreachable allocations. */
+
+    node = njs_rbtree_min(&mp->blocks);
+
+    while (njs_rbtree_is_there_successor(&mp->blocks, node)) {
+        block = (njs_mp_block_t *) node;
+
+        if (block->type != NJS_MP_CLUSTER_BLOCK) {
+            if (block->marks[0] == 0) {
+                ret = njs_mp_collect_push(&gc, block->start, block->size);
+                if (njs_slow_path(ret != NJS_OK)) {
+                    goto done;
+                }
+            }
+
+            goto next;
+        }
+
+        for (n = 0; n < npages; n++) {
+            page = &block->pages[n];
+
+            if (page->size == 0) {
+                continue;
+            }
+
+            size = page->size << mp->chunk_size_shift;
+            nchunks = mp->page_size / size;
+            p = block->start + (n << mp->page_size_shift);
+
+            for (chunk = 0; chunk < nchunks; chunk++) {
+                if (size != mp->page_size
+                    && njs_mp_chunk_is_free(page->map, chunk))
+                {
+                    continue;
+                }
+
+                if (!njs_mp_chunk_is_free(&block->marks[n * 4], chunk)) {
+                    continue;
+                }
+
+                ret = njs_mp_collect_push(&gc, p + chunk * size, size);
+                if (njs_slow_path(ret != NJS_OK)) {
+                    goto done;
+                }
+            }
+        }
+
+    next:
+
+        node = njs_rbtree_node_successor(&mp->blocks, node);
+    }
+
+    for (i = 0; i < gc.items; i++) {
+        njs_mp_free(mp, gc.stack[i].start);
+    }
+
+    njs_debug_alloc("mp collect: %ui freed\n", gc.items);
+
+done:
+
+    if (gc.stack != NULL) {
+        njs_free(gc.stack);
+    }
+
+    njs_free(marks);
+
+    return ret;
+}
+
+
+static njs_int_t
+njs_mp_collect_mark(njs_mp_collect_t *gc, u_char *p)
+{
+    u_char          *start, *marks;
+    njs_mp_t        *mp;
+    njs_uint_t      n, size, chunk;
+    njs_mp_page_t   *page;
+    njs_mp_block_t  *block;
+
+    mp = gc->mp;
+
+    block = njs_mp_find_block(&mp->blocks, p);
+    if (block == NULL) {
+        return NJS_OK;
+    }
+
+    if (block->type != NJS_MP_CLUSTER_BLOCK) {
+        if (block->marks[0] != 0) {
+            return NJS_OK;
+        }
+
+        block->marks[0] = 1;
+
+        return njs_mp_collect_push(gc, block->start, block->size);
+    }
+
+    n = (p - block->start) >> mp->page_size_shift;
+    page = &block->pages[n];
+
+    if (page->size == 0) {
+        return NJS_OK;
+    }
+
+    size = page->size << mp->chunk_size_shift;
+    start = block->start + (n << mp->page_size_shift);
+    chunk = (p - start) / size;
+
+    if (size != mp->page_size && njs_mp_chunk_is_free(page->map, chunk)) {
+        return NJS_OK;
+    }
+
+    marks = &block->marks[n * 4];
+
+    if (!njs_mp_chunk_is_free(marks, chunk)) {
+        return NJS_OK;
+    }
+
+    marks[chunk / 8] |= 0x80 >> (chunk & 7);
+
+    return njs_mp_collect_push(gc, start + chunk * size, size);
+}
+
+
+static njs_int_t
+njs_mp_collect_push(njs_mp_collect_t *gc, void *start, size_t size)
+{
+    njs_mp_root_t  *stack;
+
+    if (gc->items == gc->avail) {
+        gc->avail = (gc->avail != 0) ? gc->avail * 2 : 64;
+
+        stack = njs_malloc(gc->avail * sizeof(njs_mp_root_t));
+        if (njs_slow_path(stack == NULL)) {
+            return NJS_ERROR;
+        }
+
+        if (gc->stack != NULL) {
+            memcpy(stack, gc->stack, gc->items * sizeof(njs_mp_root_t));
+            njs_free(gc->stack);
+        }
+
+        gc->stack = stack;
+    }
+
+    gc->stack[gc->items].start = start;
+    gc->stack[gc->items].size = size;
+    gc->items++;
+
+    return NJS_OK;
+}
@@ -28,6 +28,12 @@ typedef struct {
 } njs_mp_stat_t;
 
 
+typedef struct {
+    void                    *start;
+    size_t                  size;
+} njs_mp_root_t;
+
+
 NJS_EXPORT njs_mp_t *njs_mp_create(size_t cluster_size, size_t page_alignment,
     size_t page_size, size_t min_chunk_size) NJS_MALLOC_LIKE;
 NJS_EXPORT njs_mp_t * njs_mp_fast_create(size_t cluster_size,
@@ -48,6 +54,8 @@ NJS_EXPORT void *njs_mp_zalign(njs_mp_t *mp,
     NJS_MALLOC_LIKE;
 NJS_EXPORT njs_mp_cleanup_t *njs_mp_cleanup_add(njs_mp_t *mp, size_t size);
 NJS_EXPORT void njs_mp_free(njs_mp_t *mp, void *p);
+NJS_EXPORT njs_int_t njs_mp_collect(njs_mp_t *mp, njs_mp_root_t *roots,
+    njs_uint_t nroots);
 
 
 #if (NJS_ALLOC_DEBUG)
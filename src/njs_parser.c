@@ -1299,6 +1299,8 @@ njs_parser_regexp_literal(njs_parser_t *parser, njs_lexer_token_t *token,
                 return NJS_ERROR;
             }
 
+            njs_regexp_pattern_jit(parser->vm, pattern);
+
             value->data.u.data = pattern;
 
             return NJS_OK;
@@ -3259,6 +3261,149 @@ njs_parser_left_hand_side_expression_optional(njs_parser_t *parser,
 }
 
 
+/*
+ * Folds a binary operation on number literals or a concatenation
+ * of string literals into a literal.
+ */
+
+static njs_int_t
+njs_parser_constant_fold(njs_parser_t *parser, njs_parser_node_t *node)
+{
+    u_char             *p;
+    double             num, num1, num2;
+    size_t             length1, length2;
+    int32_t            i32;
+    uint32_t           u32;
+    njs_int_t          ret;
+    njs_value_t        value;
+    njs_parser_node_t  *left, *right;
+    njs_string_prop_t  string1, string2;
+
+    left = node->left;
+    right = node->right;
+
+    if (left->token_type == NJS_TOKEN_STRING
+        && right->token_type == NJS_TOKEN_STRING
+        && node->u.operation == NJS_VMCODE_ADDITION)
+    {
+        length1 = njs_string_prop(parser->vm, &string1, &left->u.value);
+        length2 = njs_string_prop(parser->vm, &string2, &right->u.value);
+
+        p = njs_string_alloc(parser->vm, &value, string1.size + string2.size,
+                             length1 + length2);
+        if (njs_slow_path(p == NULL)) {
+            return NJS_ERROR;
+        }
+
+        p = njs_cpymem(p, string1.start, string1.size);
+        memcpy(p, string2.start, string2.size);
+
+        if (length1 + length2 > NJS_STRING_MAP_STRIDE
+            && string1.size + string2.size != length1 + length2)
+        {
+            njs_string_utf8_offset_map_init(value.string.data->start,
+                                            string1.size + string2.size);
+        }
+
+        ret = njs_atom_atomize_key(parser->vm, &value);
+        if (njs_slow_path(ret != NJS_OK)) {
+            return NJS_ERROR;
+        }
+
+        node->token_type = NJS_TOKEN_STRING;
+        node->u.value = value;
+        node->left = NULL;
+        node->right = NULL;
+
+        return NJS_OK;
+    }
+
+    if (left->token_type != NJS_TOKEN_NUMBER
+        || right->token_type != NJS_TOKEN_NUMBER)
+    {
+        return NJS_OK;
+    }
+
+    num1 = njs_number(&left->u.value);
+    num2 = njs_number(&right->u.value);
+
+    switch (node->u.operation) {
+    case NJS_VMCODE_ADDITION:
+        num = num1 + num2;
+        break;
+
+    case NJS_VMCODE_SUBTRACTION:
+        num = num1 - num2;
+        break;
+
+    case NJS_VMCODE_MULTIPLICATION:
+        num = num1 * num2;
+        break;
+
+    case NJS_VMCODE_DIVISION:
+        num = num1 / num2;
+        break;
+
+    case NJS_VMCODE_REMAINDER:
+        num = fmod(num1, num2);
+        break;
+
+    case NJS_VMCODE_EXPONENTIATION:
+        /* See njs_vmcode_interpreter(). */
+        if (fabs(num1) != 1 || (!isnan(num2) && !isinf(num2))) {
+            num = pow(num1, num2);
+
+        } else {
+            num = NAN;
+        }
+
+        break;
+
+    case NJS_VMCODE_BITWISE_AND:
+        num = njs_number_to_int32(num1) & njs_number_to_int32(num2);
+        break;
+
+    case NJS_VMCODE_BITWISE_OR:
+        num = njs_number_to_int32(num1) | njs_number_to_int32(num2);
+        break;
+
+    case NJS_VMCODE_BITWISE_XOR:
+        num = njs_number_to_int32(num1) ^ njs_number_to_int32(num2);
+        break;
+
+    case NJS_VMCODE_LEFT_SHIFT:
+        u32 = njs_number_to_uint32(num2) & 0x1f;
+        i32 = (uint32_t) njs_number_to_int32(num1) << u32;
+        num = i32;
+        break;
+
+    case NJS_VMCODE_RIGHT_SHIFT:
+        u32 = njs_number_to_uint32(num2) & 0x1f;
+        num = njs_number_to_int32(num1) >> u32;
+        break;
+
+    case NJS_VMCODE_UNSIGNED_RIGHT_SHIFT:
+        u32 = njs_number_to_uint32(num2) & 0x1f;
+        num = njs_number_to_uint32(num1) >> u32;
+        break;
+
+    default:
+        return NJS_OK;
+    }
+
+    node->token_type = NJS_TOKEN_NUMBER;
+    njs_set_number(&node->u.value, num);
+    node->left = NULL;
+    node->right = NULL;
+
+    if (njs_number_is_integer_index(num) && num < 0x80000000) {
+        node->u.value.atom_id = njs_number_atom((uint32_t) num);
+    }
+
+    return NJS_OK;
+}
+
+
 static njs_int_t
 njs_parser_expression_node(njs_parser_t *parser, njs_lexer_token_t *token,
     njs_queue_link_t *current, njs_token_type_t type, njs_vmcode_t operation,
@@ -3270,6 +3415,10 @@ njs_parser_expression_node(njs_parser_t *parser, njs_lexer_token_t *token,
         parser->target->right = parser->node;
         parser->target->right->dest = parser->target;
         parser->node = parser->target;
+
+        if (njs_parser_constant_fold(parser, parser->node) != NJS_OK) {
+            return NJS_ERROR;
+        }
     }
 
     if (token->type != type) {
@@ -3649,6 +3798,10 @@ njs_parser_exponentiation_expression_match(njs_parser_t *parser,
         parser->target->right->dest = parser->target;
         parser->node = parser->target;
 
+        if (njs_parser_constant_fold(parser, parser->node) != NJS_OK) {
+            return NJS_ERROR;
+        }
+
         return njs_parser_stack_pop(parser);
     }
 
@@ -3700,6 +3853,10 @@ njs_parser_multiplicative_expression_match(njs_parser_t *parser,
         parser->target->right = parser->node;
         parser->target->right->dest = parser->target;
         parser->node = parser->target;
+
+        if (njs_parser_constant_fold(parser, parser->node) != NJS_OK) {
+            return NJS_ERROR;
+        }
     }
 
     switch (token->type) {
@@ -3763,6 +3920,10 @@ njs_parser_additive_expression_match(njs_parser_t *parser,
         parser->target->right = parser->node;
         parser->target->right->dest = parser->target;
         parser->node = parser->target;
+
+        if (njs_parser_constant_fold(parser, parser->node) != NJS_OK) {
+            return NJS_ERROR;
+        }
     }
 
     switch (token->type) {
@@ -3822,6 +3983,10 @@ njs_parser_shift_expression_match(njs_parser_t *parser,
         parser->target->right = parser->node;
         parser->target->right->dest = parser->target;
         parser->node = parser->target;
+
+        if (njs_parser_constant_fold(parser, parser->node) != NJS_OK) {
+            return NJS_ERROR;
+        }
     }
 
     switch (token->type) {
@@ -75,6 +75,8 @@ NJS_EXPORT njs_int_t njs_regex_escape(njs_mp_t *mp, njs_str_t *text);
 NJS_EXPORT njs_int_t njs_regex_compile(njs_regex_t *regex, u_char *source,
     size_t len, njs_regex_flags_t flags, njs_regex_compile_ctx_t *ctx,
     njs_trace_t *trace);
+NJS_EXPORT njs_int_t njs_regex_jit_compile(njs_regex_t *regex);
+NJS_EXPORT void njs_regex_free(njs_regex_t *regex);
 NJS_EXPORT njs_bool_t njs_regex_is_valid(njs_regex_t *regex);
 NJS_EXPORT njs_int_t njs_regex_named_captures(njs_regex_t *regex,
     njs_str_t *name, int n);
@@ -15,16 +15,48 @@ struct njs_regexp_group_s {
 };
 
 
+typedef struct {
+    njs_queue_link_t      link;
+    njs_regexp_pattern_t  *pattern;
+    njs_str_t             source;
+    njs_regex_flags_t     flags;
+
+    /* The number of cloned VMs referring to the pattern. */
+    uint32_t              refs;
+    njs_mp_t              *referrer;
+
+    /* The pattern is referred by the VM owning the cache. */
+    uint8_t               owned;        /* 1 bit */
+    uint8_t               evicted;      /* 1 bit */
+} njs_regexp_cache_entry_t;
+
+
 static void *njs_regexp_malloc(size_t size, void *memory_data);
 static void njs_regexp_free(void *p, void *memory_data);
+static njs_regexp_pattern_t *njs_regexp_pattern_alloc(njs_vm_t *vm,
+    njs_mp_t *mp, njs_regex_compile_ctx_t *cctx, u_char *start,
+    size_t length, njs_regex_flags_t flags);
+static njs_int_t njs_regexp_cache_test(njs_flathsh_query_t *fhq, void *data);
+static njs_int_t njs_regexp_cache_ref(njs_vm_t *vm,
+    njs_regexp_cache_entry_t *entry);
+static void njs_regexp_cache_unref(void *data);
+static void njs_regexp_cache_evict(njs_regexp_cache_t *cache);
+static void njs_regexp_cache_entry_free(njs_regexp_cache_entry_t *entry);
+static njs_int_t njs_regexp_cache_entry_disown(
+    njs_regexp_cache_entry_t *entry);
+static void njs_regexp_cache_cleanup(void *data);
 static njs_int_t njs_regexp_prototype_source(njs_vm_t *vm, njs_value_t *args,
     njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
 static int njs_regexp_pattern_compile(njs_vm_t *vm, njs_regex_t *regex,
-    u_char *source, size_t len, njs_regex_flags_t flags);
+    u_char *source, size_t len, njs_regex_flags_t flags,
+    njs_regex_compile_ctx_t *cctx);
 static u_char *njs_regexp_compile_trace_handler(njs_trace_t *trace,
     njs_trace_data_t *td, u_char *start);
 static u_char *njs_regexp_match_trace_handler(njs_trace_t *trace,
     njs_trace_data_t *td, u_char *start);
+static njs_int_t njs_regexp_pattern_jit_compile(
+    njs_regexp_pattern_t *pattern);
+static void njs_regexp_pattern_cleanup(void *data);
 #define NJS_REGEXP_FLAG_TEST           1
 static njs_int_t njs_regexp_exec(njs_vm_t *vm, njs_value_t *r, njs_value_t *s,
     unsigned flags, njs_value_t *retval);
@@ -182,7 +214,7 @@ njs_regexp_create(njs_vm_t *vm, njs_value_t *value, u_char *start,
             length = njs_length("(?:)");
         }
 
-        pattern = njs_regexp_pattern_create(vm, start, length, flags);
+        pattern = njs_regexp_pattern_lookup(vm, start, length, flags);
         if (njs_slow_path(pattern == NULL)) {
             return NJS_ERROR;
         }
@@ -261,6 +293,23 @@ invalid:
 njs_regexp_pattern_t *
 njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
     njs_regex_flags_t flags)
+{
+    njs_int_t  ret;
+
+    ret = njs_regexp_ctx_init(vm);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return NULL;
+    }
+
+    return njs_regexp_pattern_alloc(vm, vm->mem_pool, vm->regex_compile_ctx,
+                                    start, length, flags);
+}
+
+
+static njs_regexp_pattern_t *
+njs_regexp_pattern_alloc(njs_vm_t *vm, njs_mp_t *mp,
+    njs_regex_compile_ctx_t *cctx, u_char *start, size_t length,
+    njs_regex_flags_t flags)
 {
     int                   ret;
     u_char                *p, *end;
@@ -311,14 +360,13 @@ njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
         }
     }
 
-    ret = njs_regex_escape(vm->mem_pool, &text);
+    ret = njs_regex_escape(mp, &text);
     if (njs_slow_path(ret != NJS_OK)) {
         njs_memory_error(vm);
         return NULL;
     }
 
-    pattern = njs_mp_alloc(vm->mem_pool, sizeof(njs_regexp_pattern_t)
-                                          + text.length + 1);
+    pattern = njs_mp_alloc(mp, sizeof(njs_regexp_pattern_t) + text.length + 1);
     if (njs_slow_path(pattern == NULL)) {
         njs_memory_error(vm);
         return NULL;
@@ -332,13 +380,19 @@ njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
     p = njs_cpymem(p, text.start, text.length);
     *p++ = '\0';
 
+    if (text.start != start) {
+        njs_mp_free(mp, text.start);
+    }
+
+    pattern->mem_pool = mp;
     pattern->global = ((flags & NJS_REGEX_GLOBAL) != 0);
     pattern->ignore_case = ((flags & NJS_REGEX_IGNORE_CASE) != 0);
     pattern->multiline = ((flags & NJS_REGEX_MULTILINE) != 0);
     pattern->sticky = ((flags & NJS_REGEX_STICKY) != 0);
 
     ret = njs_regexp_pattern_compile(vm, &pattern->regex[0],
-                                     &pattern->source[0], text.length, flags);
+                                     &pattern->source[0], text.length, flags,
+                                     cctx);
 
     if (njs_fast_path(ret >= 0)) {
         pattern->ncaptures = ret;
@@ -351,7 +405,7 @@ njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
 
     ret = njs_regexp_pattern_compile(vm, &pattern->regex[1],
                                   &pattern->source[0], text.length,
-                                  flags | NJS_REGEX_UTF8);
+                                  flags | NJS_REGEX_UTF8, cctx);
     if (njs_fast_path(ret >= 0)) {
 
         if (njs_slow_path(njs_regex_is_valid(&pattern->regex[0])
@@ -382,7 +436,7 @@ njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
     if (pattern->ngroups != 0) {
         size = sizeof(njs_regexp_group_t) * pattern->ngroups;
 
-        pattern->groups = njs_mp_alloc(vm->mem_pool, size);
+        pattern->groups = njs_mp_alloc(mp, size);
         if (njs_slow_path(pattern->groups == NULL)) {
             njs_memory_error(vm);
             return NULL;
@@ -405,7 +459,7 @@ njs_regexp_pattern_create(njs_vm_t *vm, u_char *start, size_t length,
 
 fail:
 
-    njs_mp_free(vm->mem_pool, pattern);
+    njs_mp_free(mp, pattern);
     return NULL;
 
 nothing_to_repeat:
@@ -418,7 +472,7 @@ nothing_to_repeat:
 
 static int
 njs_regexp_pattern_compile(njs_vm_t *vm, njs_regex_t *regex, u_char *source,
-    size_t len, njs_regex_flags_t flags)
+    size_t len, njs_regex_flags_t flags, njs_regex_compile_ctx_t *cctx)
 {
     njs_int_t            ret;
     njs_trace_handler_t  handler;
@@ -426,8 +480,7 @@ njs_regexp_pattern_compile(njs_vm_t *vm, njs_regex_t *regex, u_char *source,
     handler = vm->trace.handler;
     vm->trace.handler = njs_regexp_compile_trace_handler;
 
-    ret = njs_regex_compile(regex, source, len, flags, vm->regex_compile_ctx,
-                            &vm->trace);
+    ret = njs_regex_compile(regex, source, len, flags, cctx, &vm->trace);
 
     vm->trace.handler = handler;
 
@@ -493,6 +546,485 @@ njs_regexp_match_trace_handler(njs_trace_t *trace, njs_trace_data_t *td,
 }
 
 
+void
+njs_regexp_pattern_jit(njs_vm_t *vm, njs_regexp_pattern_t *pattern)
+{
+    njs_mp_cleanup_t  *cln;
+
+    if (pattern->jit) {
+        return;
+    }
+
+    if (pattern->cached) {
+        /* The JIT code is released with the cache entry. */
+        (void) njs_regexp_pattern_jit_compile(pattern);
+        return;
+    }
+
+    /*
+     * The JIT code is released by the cleanup handler of the pool
+     * the pattern is allocated from, patterns of other VMs are skipped.
+     */
+
+    if (pattern->mem_pool != vm->mem_pool) {
+        return;
+    }
+
+    if (njs_regexp_pattern_jit_compile(pattern) != NJS_OK) {
+        return;
+    }
+
+    cln = njs_mp_cleanup_add(vm->mem_pool, 0);
+    if (njs_slow_path(cln == NULL)) {
+        return;
+    }
+
+    cln->handler = njs_regexp_pattern_cleanup;
+    cln->data = pattern;
+}
+
+
+static njs_int_t
+njs_regexp_pattern_jit_compile(njs_regexp_pattern_t *pattern)
+{
+    njs_int_t   ret;
+    njs_uint_t  i;
+
+    /* When JIT is not available the pattern is matched by the interpreter. */
+
+    pattern->jit = 1;
+
+    ret = NJS_DECLINED;
+
+    for (i = 0; i < 2; i++) {
+        if (njs_regex_is_valid(&pattern->regex[i])
+            && njs_regex_jit_compile(&pattern->regex[i]) == NJS_OK)
+        {
+            ret = NJS_OK;
+        }
+    }
+
+    return ret;
+}
+
+
+static void
+njs_regexp_pattern_cleanup(void *data)
+{
+    njs_regexp_pattern_t  *pattern = data;
+
+    njs_uint_t  i;
+
+    for (i = 0; i < 2; i++) {
+        if (njs_regex_is_valid(&pattern->regex[i])) {
+            njs_regex_free(&pattern->regex[i]);
+        }
+    }
+}
+
+
+const njs_flathsh_proto_t  njs_regexp_cache_proto
+    njs_aligned(64) =
+{
+    njs_regexp_cache_test,
+    njs_flathsh_proto_alloc,
+    njs_flathsh_proto_free,
+};
+
+
+njs_int_t
+njs_regexp_cache_init(njs_vm_t *vm)
+{
+    njs_mp_cleanup_t    *cln;
+    njs_regexp_cache_t  *cache;
+
+    cache = njs_mp_zalloc(vm->mem_pool, sizeof(njs_regexp_cache_t));
+    if (njs_slow_path(cache == NULL)) {
+        return NJS_ERROR;
+    }
+
+    njs_flathsh_init(&cache->hash);
+    njs_queue_init(&cache->lru);
+    njs_queue_init(&cache->evicted);
+
+    cache->mem_pool = vm->mem_pool;
+
+    cln = njs_mp_cleanup_add(vm->mem_pool, 0);
+    if (njs_slow_path(cln == NULL)) {
+        return NJS_ERROR;
+    }
+
+    cln->handler = njs_regexp_cache_cleanup;
+    cln->data = cache;
+
+    vm->shared->regexp_cache = cache;
+
+    return NJS_OK;
+}
+
+
+/*
+ * Patterns created at runtime are cached in the pool of the VM which
+ * compiled the code, so cloned VMs do not compile the same patterns again.
+ * The least recently used pattern is evicted when the cache is full.
+ * An evicted pattern is freed when no cloned VM refers to it.  As RegExp
+ * objects of the VM owning the cache are not tracked, a pattern referred
+ * by the VM is left to it then, like other patterns created at runtime
+ * it is freed with the VM.
+ */
+
+njs_regexp_pattern_t *
+njs_regexp_pattern_lookup(njs_vm_t *vm, u_char *start, size_t length,
+    njs_regex_flags_t flags)
+{
+    u_char                    *p;
+    uint32_t                  hash;
+    njs_int_t                 ret;
+    njs_flathsh_elt_t         *elt;
+    njs_regexp_cache_t        *cache;
+    njs_flathsh_query_t       fhq;
+    njs_regexp_pattern_t      *pattern;
+    njs_regexp_cache_entry_t  *entry;
+
+    cache = vm->shared->regexp_cache;
+
+    if (cache == NULL || length > NJS_REGEXP_CACHE_SOURCE_MAX) {
+        return njs_regexp_pattern_create(vm, start, length, flags);
+    }
+
+    hash = njs_djb_hash(start, length);
+
+    fhq.key.start = start;
+    fhq.key.length = length;
+    fhq.key_hash = njs_djb_hash_add(hash, flags);
+    fhq.proto = &njs_regexp_cache_proto;
+    fhq.data = &flags;
+
+    ret = njs_flathsh_find(&cache->hash, &fhq);
+
+    if (ret == NJS_OK) {
+        entry = ((njs_flathsh_elt_t *) fhq.value)->value[0];
+
+        ret = njs_regexp_cache_ref(vm, entry);
+        if (njs_slow_path(ret != NJS_OK)) {
+            return NULL;
+        }
+
+        njs_queue_remove(&entry->link);
+        njs_queue_insert_head(&cache->lru, &entry->link);
+
+        cache->hits++;
+
+        return entry->pattern;
+    }
+
+    cache->misses++;
+
+    if (cache->generic_ctx == NULL) {
+        cache->generic_ctx = njs_regex_generic_ctx_create(njs_regexp_malloc,
+                                                          njs_regexp_free,
+                                                          cache->mem_pool);
+        if (njs_slow_path(cache->generic_ctx == NULL)) {
+            njs_memory_error(vm);
+            return NULL;
+        }
+
+        cache->compile_ctx = njs_regex_compile_ctx_create(cache->generic_ctx);
+        if (njs_slow_path(cache->compile_ctx == NULL)) {
+            njs_memory_error(vm);
+            return NULL;
+        }
+    }
+
+    pattern = njs_regexp_pattern_alloc(vm, cache->mem_pool, cache->compile_ctx,
+                                       start, length, flags);
+    if (njs_slow_path(pattern == NULL)) {
+        return NULL;
+    }
+
+    if (cache->items == NJS_REGEXP_CACHE_SIZE) {
+        njs_regexp_cache_evict(cache);
+    }
+
+    entry = njs_mp_zalloc(cache->mem_pool,
+                          sizeof(njs_regexp_cache_entry_t) + length);
+    if (njs_slow_path(entry == NULL)) {
+        goto memory_error;
+    }
+
+    p = (u_char *) entry + sizeof(njs_regexp_cache_entry_t);
+    memcpy(p, start, length);
+
+    entry->source.start = p;
+    entry->source.length = length;
+    entry->flags = flags;
+    entry->pattern = pattern;
+
+    fhq.key = entry->source;
+    fhq.replace = 0;
+    fhq.pool = cache->mem_pool;
+
+    ret = njs_flathsh_insert(&cache->hash, &fhq);
+    if (njs_slow_path(ret != NJS_OK)) {
+        njs_mp_free(cache->mem_pool, entry);
+        goto memory_error;
+    }
+
+    elt = fhq.value;
+    elt->value[0] = entry;
+
+    njs_queue_insert_head(&cache->lru, &entry->link);
+    cache->items++;
+
+    pattern->cached = 1;
+
+    ret = njs_regexp_cache_ref(vm, entry);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return NULL;
+    }
+
+    return pattern;
+
+memory_error:
+
+    njs_memory_error(vm);
+
+    return NULL;
+}
+
+
+static njs_int_t
+njs_regexp_cache_test(njs_flathsh_query_t *fhq, void *data)
+{
+    njs_regexp_cache_entry_t  *entry;
+
+    entry = *(njs_regexp_cache_entry_t **) data;
+
+    if (entry->flags == *(njs_regex_flags_t *) fhq->data
+        && njs_strstr_eq(&fhq->key, &entry->source))
+    {
+        return NJS_OK;
+    }
+
+    return NJS_DECLINED;
+}
+
+
+static njs_int_t
+njs_regexp_cache_ref(njs_vm_t *vm, njs_regexp_cache_entry_t *entry)
+{
+    njs_mp_cleanup_t  *cln;
+
+    if (vm->mem_pool == vm->shared->regexp_cache->mem_pool) {
+        entry->owned = 1;
+        return NJS_OK;
+    }
+
+    if (entry->referrer == vm->mem_pool) {
+        return NJS_OK;
+    }
+
+    cln = njs_mp_cleanup_add(vm->mem_pool, 0);
+    if (njs_slow_path(cln == NULL)) {
+        njs_memory_error(vm);
+        return NJS_ERROR;
+    }
+
+    cln->handler = njs_regexp_cache_unref;
+    cln->data = entry;
+
+    entry->refs++;
+    entry->referrer = vm->mem_pool;
+
+    return NJS_OK;
+}
+
+
+static void
+njs_regexp_cache_unref(void *data)
+{
+    njs_regexp_cache_entry_t  *entry = data;
+
+    entry->refs--;
+
+    /*
+     * The referrer is reset, as the pool address may be reused
+     * by another VM.
+     */
+
+    entry->referrer = NULL;
+
+    if (!entry->evicted || entry->refs != 0) {
+        return;
+    }
+
+    if (entry->owned) {
+        (void) njs_regexp_cache_entry_disown(entry);
+        return;
+    }
+
+    njs_regexp_cache_entry_free(entry);
+}
+
+
+static void
+njs_regexp_cache_evict(njs_regexp_cache_t *cache)
+{
+    njs_queue_link_t          *lnk;
+    njs_flathsh_query_t       fhq;
+    njs_regexp_cache_entry_t  *entry;
+
+    lnk = njs_queue_last(&cache->lru);
+    entry = njs_queue_link_data(lnk, njs_regexp_cache_entry_t, link);
+
+    njs_queue_remove(&entry->link);
+    cache->items--;
+
+    fhq.key = entry->source;
+    fhq.key_hash = njs_djb_hash_add(njs_djb_hash(entry->source.start,
+                                                 entry->source.length),
+                                    entry->flags);
+    fhq.proto = &njs_regexp_cache_proto;
+    fhq.pool = cache->mem_pool;
+    fhq.data = &entry->flags;
+
+    (void) njs_flathsh_delete(&cache->hash, &fhq);
+
+    if (entry->refs == 0) {
+        if (!entry->owned) {
+            njs_regexp_cache_entry_free(entry);
+            return;
+        }
+
+        if (njs_regexp_cache_entry_disown(entry) == NJS_OK) {
+            return;
+        }
+    }
+
+    entry->evicted = 1;
+    njs_queue_insert_tail(&cache->evicted, &entry->link);
+}
+
+
+static void
+njs_regexp_cache_entry_free(njs_regexp_cache_entry_t *entry)
+{
+    njs_mp_t              *mp;
+    njs_regexp_pattern_t  *pattern;
+
+    pattern = entry->pattern;
+    mp = pattern->mem_pool;
+
+    if (entry->evicted) {
+        njs_queue_remove(&entry->link);
+    }
+
+    njs_regexp_pattern_cleanup(pattern);
+
+    if (pattern->groups != NULL) {
+        njs_mp_free(mp, pattern->groups);
+    }
+
+    njs_mp_free(mp, pattern);
+    njs_mp_free(mp, entry);
+}
+
+
+/*
+ * The pattern is left to the VM owning the cache, the JIT code
+ * is released by the cleanup handler of the VM pool.
+ */
+
+static njs_int_t
+njs_regexp_cache_entry_disown(njs_regexp_cache_entry_t *entry)
+{
+    njs_mp_t              *mp;
+    njs_mp_cleanup_t      *cln;
+    njs_regexp_pattern_t  *pattern;
+
+    pattern = entry->pattern;
+    mp = pattern->mem_pool;
+
+    if (pattern->jit) {
+        cln = njs_mp_cleanup_add(mp, 0);
+        if (njs_slow_path(cln == NULL)) {
+            return NJS_ERROR;
+        }
+
+        cln->handler = njs_regexp_pattern_cleanup;
+        cln->data = pattern;
+    }
+
+    pattern->cached = 0;
+
+    if (entry->evicted) {
+        njs_queue_remove(&entry->link);
+    }
+
+    njs_mp_free(mp, entry);
+
+    return NJS_OK;
+}
+
+
+static void
+njs_regexp_cache_cleanup(void *data)
+{
+    njs_regexp_cache_t  *cache = data;
+
+    njs_queue_link_t          *lnk;
+    njs_regexp_cache_entry_t  *entry;
+
+    /* The pool memory is freed by the pool, JIT code is released here. */
+
+    for (lnk = njs_queue_first(&cache->lru);
+         lnk != njs_queue_tail(&cache->lru);
+         lnk = njs_queue_next(lnk))
+    {
+        entry = njs_queue_link_data(lnk, njs_regexp_cache_entry_t, link);
+
+        njs_regexp_pattern_cleanup(entry->pattern);
+    }
+
+    for (lnk = njs_queue_first(&cache->evicted);
+         lnk != njs_queue_tail(&cache->evicted);
+         lnk = njs_queue_next(lnk))
+    {
+        entry = njs_queue_link_data(lnk, njs_regexp_cache_entry_t, link);
+
+        njs_regexp_pattern_cleanup(entry->pattern);
+    }
+}
+
+
+void
+njs_vm_regexp_cache_stat(njs_vm_t *vm, njs_vm_regexp_cache_stat_t *stat)
+{
+    njs_queue_link_t    *lnk;
+    njs_regexp_cache_t  *cache;
+
+    cache = vm->shared->regexp_cache;
+
+    if (cache == NULL) {
+        njs_memzero(stat, sizeof(njs_vm_regexp_cache_stat_t));
+        return;
+    }
+
+    stat->size = cache->items;
+    stat->evicted = 0;
+
+    for (lnk = njs_queue_first(&cache->evicted);
+         lnk != njs_queue_tail(&cache->evicted);
+         lnk = njs_queue_next(lnk))
+    {
+        stat->evicted++;
+    }
+
+    stat->hits = cache->hits;
+    stat->misses = cache->misses;
+}
+
+
 njs_regexp_t *
 njs_regexp_alloc(njs_vm_t *vm, njs_regexp_pattern_t *pattern)
 {
@@ -902,6 +1434,15 @@ njs_regexp_builtin_exec(njs_vm_t *vm, njs_value_t *r, njs_value_t *s,
         goto not_found;
     }
 
+    if (njs_slow_path(++pattern->execs == NJS_REGEXP_JIT_THRESHOLD)) {
+        njs_regexp_pattern_jit(vm, pattern);
+    }
+
+    ret = njs_regexp_ctx_init(vm);
+    if (njs_slow_path(ret != NJS_OK)) {
+        return NJS_ERROR;
+    }
+
     match_data = njs_regex_match_data(&pattern->regex[type],
                                       vm->regex_generic_ctx);
     if (njs_slow_path(match_data == NULL)) {
@@ -8,6 +8,21 @@
 #define _NJS_REGEXP_H_INCLUDED_
 
 
+/*
+ * Patterns of the compiled code are JIT compiled at once, patterns created
+ * at runtime are JIT compiled after NJS_REGEXP_JIT_THRESHOLD executions.
+ */
+#define NJS_REGEXP_JIT_THRESHOLD  64
+
+
+/*
+ * The maximum number of cached runtime patterns and the maximum length
+ * of a pattern source to be cached, see njs_regexp_pattern_lookup().
+ */
+#define NJS_REGEXP_CACHE_SIZE        128
+#define NJS_REGEXP_CACHE_SOURCE_MAX  4096
+
+
 njs_int_t njs_regexp_init(njs_vm_t *vm);
 njs_int_t njs_regexp_create(njs_vm_t *vm, njs_value_t *value, u_char *start,
     size_t length, njs_regex_flags_t flags);
@@ -16,6 +31,10 @@ njs_regexp_pattern_t *njs_regexp_pattern_create(njs_vm_t *vm,
     u_char *string, size_t length, njs_regex_flags_t flags);
 njs_int_t njs_regexp_match(njs_vm_t *vm, njs_regex_t *regex,
     const u_char *subject, size_t off, size_t len, njs_regex_match_data_t *d);
+void njs_regexp_pattern_jit(njs_vm_t *vm, njs_regexp_pattern_t *pattern);
+njs_int_t njs_regexp_cache_init(njs_vm_t *vm);
+njs_regexp_pattern_t *njs_regexp_pattern_lookup(njs_vm_t *vm, u_char *start,
+    size_t length, njs_regex_flags_t flags);
 njs_regexp_t *njs_regexp_alloc(njs_vm_t *vm, njs_regexp_pattern_t *pattern);
 njs_int_t njs_regexp_prototype_exec(njs_vm_t *vm, njs_value_t *args,
     njs_uint_t nargs, njs_index_t unused, njs_value_t *retval);
@@ -27,6 +46,15 @@ njs_int_t njs_regexp_to_string(njs_vm_t *vm, njs_value_t *retval,
     const njs_value_t *regexp);
 
 
+/*
+ * Regex contexts of a cloned VM are created on first use, so that
+ * requests which do not run regular expressions do not pay for them.
+ */
+#define njs_regexp_ctx_init(vm)                                               \
+    (njs_fast_path((vm)->regex_generic_ctx != NULL) ? NJS_OK                  \
+                                                    : njs_regexp_init(vm))
+
+
 extern const njs_object_init_t  njs_regexp_instance_init;
 extern const njs_object_type_init_t  njs_regexp_type_init;
 
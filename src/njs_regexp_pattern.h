@@ -23,6 +23,10 @@ struct njs_regexp_pattern_s {
     /* A zero-terminated C string. */
     u_char                *source;
 
+    /* The pool of the VM which created the pattern. */
+    njs_mp_t              *mem_pool;
+    uint32_t              execs;
+
     uint16_t              ncaptures;
     uint16_t              ngroups;
 
@@ -30,9 +34,26 @@ struct njs_regexp_pattern_s {
     uint8_t               ignore_case;  /* 1 bit */
     uint8_t               multiline;    /* 1 bit */
     uint8_t               sticky;       /* 1 bit */
+    uint8_t               jit;          /* 1 bit */
+    uint8_t               cached;       /* 1 bit */
 
     njs_regexp_group_t    *groups;
 };
 
 
+struct njs_regexp_cache_s {
+    njs_flathsh_t            hash;
+    njs_queue_t              lru;
+    njs_queue_t              evicted;
+    njs_uint_t               items;
+
+    njs_mp_t                 *mem_pool;
+    njs_regex_generic_ctx_t  *generic_ctx;
+    njs_regex_compile_ctx_t  *compile_ctx;
+
+    uint64_t                 hits;
+    uint64_t                 misses;
+};
+
+
 #endif /* _NJS_REGEXP_PATTERN_H_INCLUDED_ */
@@ -2554,7 +2554,7 @@ njs_string_prototype_search(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
             (void) njs_string_prop(vm, &string, value);
 
             if (string.size != 0) {
-                pattern = njs_regexp_pattern_create(vm, string.start,
+                pattern = njs_regexp_pattern_lookup(vm, string.start,
                                                     string.size, 0);
                 if (njs_slow_path(pattern == NULL)) {
                     return NJS_ERROR;
@@ -2573,6 +2573,11 @@ njs_string_prototype_search(njs_vm_t *vm, njs_value_t *args, njs_uint_t nargs,
         n = (string.length != 0);
 
         if (njs_regex_is_valid(&pattern->regex[n])) {
+            ret = njs_regexp_ctx_init(vm);
+            if (njs_slow_path(ret != NJS_OK)) {
+                return NJS_ERROR;
+            }
+
             ret = njs_regexp_match(vm, &pattern->regex[n], string.start,
                                    0, string.size, vm->single_match_data);
             if (ret >= 0) {
@@ -2689,6 +2694,11 @@ njs_string_match_multiple(njs_vm_t *vm, njs_value_t *args,
 
     if (njs_regex_is_valid(&pattern->regex[type])) {
 
+        ret = njs_regexp_ctx_init(vm);
+        if (njs_slow_path(ret != NJS_OK)) {
+            return NJS_ERROR;
+        }
+
         array = njs_array_alloc(vm, 0, 0, NJS_ARRAY_SPARE);
         if (njs_slow_path(array == NULL)) {
             return NJS_ERROR;
@@ -34,6 +34,9 @@
  */
 #define NJS_STRING_MAP_STRIDE  32
 
+/* The minimal size of concatenated strings allocated with spare room. */
+#define NJS_STRING_CONCAT_MIN  256
+
 #define njs_string_map_offset(size)  njs_align_size((size), sizeof(uint32_t))
 
 #define njs_string_map_start(p)                                               \
@@ -8,7 +8,9 @@
 #include <njs_main.h>
 
 
-static njs_int_t njs_vm_protos_init(njs_vm_t *vm, njs_value_t *global);
+static size_t njs_vm_protos_size(njs_vm_t *vm);
+static njs_int_t njs_vm_protos_init(njs_vm_t *vm, njs_value_t *global,
+    void *protos);
 
 
 const njs_str_t  njs_entry_empty =          njs_str("");
@@ -108,7 +110,7 @@ njs_vm_create(njs_vm_opt_t *options)
         }
     }
 
-    ret = njs_vm_protos_init(vm, &vm->global_value);
+    ret = njs_vm_protos_init(vm, &vm->global_value, NULL);
     if (njs_slow_path(ret != NJS_OK)) {
         return NULL;
     }
@@ -382,9 +384,72 @@ njs_vm_reuse(njs_vm_t *vm)
 }
 
 
+void
+njs_vm_reset(njs_vm_t *vm, njs_external_ptr_t external)
+{
+    /*
+     * Prepares a started VM for the next invocation: the jobs left over
+     * by the previous caller are dropped.  The memory they occupy is
+     * released only with the VM pool.
+     */
+
+    njs_queue_init(&vm->jobs);
+
+    njs_set_invalid(&vm->exception);
+
+    vm->levels[NJS_LEVEL_LOCAL] = NULL;
+    vm->external = external;
+}
+
+
+njs_int_t
+njs_vm_collect(njs_vm_t *vm, void *root, size_t size)
+{
+    njs_uint_t     n;
+    njs_mp_root_t  roots[2];
+
+    /*
+     * Frees the VM memory not reachable from the VM and from the memory
+     * range given by the caller, which holds the values kept outside
+     * of the VM.  The values referenced only by the native stack are not
+     * seen, so it is allowed only when no function is running.
+     */
+
+    if (vm->top_frame != NULL && vm->top_frame->previous != NULL) {
+        return NJS_DECLINED;
+    }
+
+    /*
+     * The spare frame memory keeps the values of returned calls, which
+     * would retain garbage, and the memory is scanned with the frame.
+     */
+
+    if (vm->top_frame != NULL) {
+        njs_memzero(vm->top_frame->free, vm->top_frame->free_size);
+    }
+
+    vm->concat_pos = NULL;
+    vm->concat_end = NULL;
+
+    roots[0].start = vm;
+    roots[0].size = sizeof(njs_vm_t);
+
+    n = 1;
+
+    if (root != NULL) {
+        roots[1].start = root;
+        roots[1].size = size;
+        n++;
+    }
+
+    return njs_mp_collect(vm->mem_pool, roots, n);
+}
+
+
 njs_vm_t *
 njs_vm_clone(njs_vm_t *vm, njs_external_ptr_t external)
 {
+    size_t       size;
     njs_mp_t     *nmp;
     njs_vm_t     *nvm;
     njs_int_t    ret;
@@ -401,7 +466,15 @@ njs_vm_clone(njs_vm_t *vm, njs_external_ptr_t external)
         return NULL;
     }
 
-    nvm = njs_mp_align(nmp, sizeof(njs_value_t), sizeof(njs_vm_t));
+    /*
+     * The VM and its copy of constructors and prototypes are allocated
+     * as a single block.
+     */
+
+    size = njs_align_size(sizeof(njs_vm_t), sizeof(njs_value_t));
+
+    nvm = njs_mp_align(nmp, sizeof(njs_value_t),
+                       size + njs_vm_protos_size(vm));
     if (njs_slow_path(nvm == NULL)) {
         goto fail;
     }
@@ -422,7 +495,7 @@ njs_vm_clone(njs_vm_t *vm, njs_external_ptr_t external)
         goto fail;
     }
 
-    ret = njs_vm_protos_init(nvm, &nvm->global_value);
+    ret = njs_vm_protos_init(nvm, &nvm->global_value, (u_char *) nvm + size);
     if (njs_slow_path(ret != NJS_OK)) {
         goto fail;
     }
@@ -470,7 +543,6 @@ fail:
 njs_int_t
 njs_vm_runtime_init(njs_vm_t *vm)
 {
-    njs_int_t    ret;
     njs_frame_t  *frame;
 
     if (vm->active_frame == NULL) {
@@ -487,10 +559,14 @@ njs_vm_runtime_init(njs_vm_t *vm)
         vm->active_frame = frame;
     }
 
-    ret = njs_regexp_init(vm);
-    if (njs_slow_path(ret != NJS_OK)) {
-        return NJS_ERROR;
-    }
+    /* Regex contexts are created on first use by njs_regexp_ctx_init(). */
+
+    vm->regex_generic_ctx = NULL;
+    vm->regex_compile_ctx = NULL;
+    vm->single_match_data = NULL;
+
+    vm->concat_pos = NULL;
+    vm->concat_end = NULL;
 
     njs_flathsh_init(&vm->values_hash);
 
@@ -567,8 +643,16 @@ njs_vm_constructors_init(njs_vm_t *vm)
 }
 
 
+static size_t
+njs_vm_protos_size(njs_vm_t *vm)
+{
+    return vm->shared->constructors->items
+           * (sizeof(njs_function_t) + sizeof(njs_object_prototype_t));
+}
+
+
 static njs_int_t
-njs_vm_protos_init(njs_vm_t *vm, njs_value_t *global)
+njs_vm_protos_init(njs_vm_t *vm, njs_value_t *global, void *protos)
 {
     size_t  ctor_size, proto_size;
 
@@ -577,12 +661,16 @@ njs_vm_protos_init(njs_vm_t *vm, njs_value_t *global)
     ctor_size = vm->constructors_size * sizeof(njs_function_t);
     proto_size = vm->constructors_size * sizeof(njs_object_prototype_t);
 
-    vm->constructors = njs_mp_alloc(vm->mem_pool, ctor_size + proto_size);
-    if (njs_slow_path(vm->constructors == NULL)) {
-        njs_memory_error(vm);
-        return NJS_ERROR;
+    if (protos == NULL) {
+        protos = njs_mp_alloc(vm->mem_pool, ctor_size + proto_size);
+        if (njs_slow_path(protos == NULL)) {
+            njs_memory_error(vm);
+            return NJS_ERROR;
+        }
     }
 
+    vm->constructors = protos;
+
     vm->prototypes = (njs_object_prototype_t *)
                                      ((u_char *) vm->constructors + ctor_size);
 
@@ -629,6 +717,15 @@ njs_vm_invoke(njs_vm_t *vm, njs_function_t *function, const njs_value_t *args,
 }
 
 
+njs_int_t
+njs_vm_invoke_method(njs_vm_t *vm, njs_function_t *function,
+    const njs_value_t *this, const njs_value_t *args, njs_uint_t nargs,
+    njs_value_t *retval)
+{
+    return njs_function_call(vm, function, this, args, nargs, retval);
+}
+
+
 void
 njs_vm_scopes_restore(njs_vm_t *vm, njs_native_frame_t *native)
 {
@@ -160,6 +160,13 @@ struct njs_vm_s {
 
     njs_vm_shared_t          *shared;
 
+    /*
+     * The unused tail of the buffer of the last concatenated string,
+     * appended to when the string is concatenated further.
+     */
+    u_char                   *concat_pos;
+    u_char                   *concat_end;
+
     njs_regex_generic_ctx_t  *regex_generic_ctx;
     njs_regex_compile_ctx_t  *regex_compile_ctx;
     njs_regex_match_data_t   *single_match_data;
@@ -237,6 +244,7 @@ struct njs_vm_shared_s {
     njs_exotic_slots_t       global_slots;
 
     njs_regexp_pattern_t     *empty_regexp_pattern;
+    njs_regexp_cache_t       *regexp_cache;
 };
 
 
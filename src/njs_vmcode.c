@@ -13,7 +13,8 @@ struct njs_property_next_s {
     njs_array_t  *array;
 };
 
-static njs_jump_off_t njs_vmcode_object(njs_vm_t *vm, njs_value_t *retval);
+static njs_jump_off_t njs_vmcode_object(njs_vm_t *vm, u_char *pc,
+    njs_value_t *retval);
 static njs_jump_off_t njs_vmcode_array(njs_vm_t *vm, u_char *pc,
     njs_value_t *retval);
 static njs_jump_off_t njs_vmcode_function(njs_vm_t *vm, u_char *pc);
@@ -65,9 +66,13 @@ static njs_jump_off_t njs_values_equal(njs_vm_t *vm, njs_value_t *val1,
     njs_value_t *val2);
 static njs_jump_off_t njs_primitive_values_compare(njs_vm_t *vm,
     njs_value_t *val1, njs_value_t *val2);
+static njs_jump_off_t njs_vmcode_compare(njs_vm_t *vm, njs_value_t *val1,
+    njs_value_t *val2, njs_vmcode_t operation);
 static njs_jump_off_t njs_function_frame_create(njs_vm_t *vm,
     njs_value_t *value, const njs_value_t *this, uintptr_t nargs,
     njs_bool_t ctor);
+static void njs_vmcode_prop_cache_update(njs_vmcode_prop_cache_t *cache,
+    njs_object_t *object, uint32_t atom_id, njs_bool_t set);
 
 
 #define njs_vmcode_operand(vm, index, _retval)                                \
@@ -79,6 +84,65 @@ static njs_jump_off_t njs_function_frame_create(njs_vm_t *vm,
     } while (0)
 
 
+/*
+ * Returns the object whose own properties can be looked up through
+ * an inline cache, or NULL.  Exotic objects are excluded because they
+ * may resolve the key before their own hash is consulted.
+ */
+
+njs_inline njs_object_t *
+njs_vmcode_prop_cache_object(njs_value_t *value, uint32_t atom_id)
+{
+    if ((value->type == NJS_OBJECT || value->type == NJS_FUNCTION)
+        && !njs_atom_is_number(atom_id))
+    {
+        return njs_object(value);
+    }
+
+    return NULL;
+}
+
+
+njs_inline njs_object_prop_t *
+njs_vmcode_prop_cache_find(njs_vmcode_prop_cache_t *cache,
+    njs_object_t *object, uint32_t atom_id, njs_bool_t set)
+{
+    uint32_t             n;
+    njs_uint_t           i;
+    njs_object_prop_t    *prop;
+    njs_flathsh_descr_t  *h;
+
+    if (object == NULL) {
+        return NULL;
+    }
+
+    h = object->hash.slot;
+    if (h == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < NJS_PROP_CACHE_SIZE; i++) {
+        n = cache->index[i];
+
+        if (n == 0 || n > h->elts_count) {
+            continue;
+        }
+
+        prop = (njs_object_prop_t *) &njs_hash_elts(h)[n - 1];
+
+        if (njs_fast_path(prop->atom_id == atom_id
+                          && prop->type == NJS_PROPERTY
+                          && njs_is_valid(njs_prop_value(prop))
+                          && (!set || prop->writable)))
+        {
+            return prop;
+        }
+    }
+
+    return NULL;
+}
+
+
 njs_int_t
 njs_vmcode_interpreter(njs_vm_t *vm, u_char *pc, njs_value_t *rval,
     void *promise_cap, void *async_ctx)
@@ -98,9 +162,11 @@ njs_vmcode_interpreter(njs_vm_t *vm, u_char *pc, njs_value_t *rval,
     njs_jump_off_t               ret;
     njs_vmcode_1addr_t           *put_arg;
     njs_vmcode_await_t           *await;
+    njs_object_t                 *object;
     njs_native_frame_t           *previous, *native;
     njs_property_next_t          *next;
     njs_vmcode_import_t          *import;
+    njs_object_prop_t            *prop;
     njs_vmcode_generic_t         *vmcode;
     njs_vmcode_variable_t        *var;
     njs_vmcode_prop_get_t        *get;
@@ -151,6 +217,14 @@ njs_vmcode_interpreter(njs_vm_t *vm, u_char *pc, njs_value_t *rval,
         NJS_GOTO_ROW(NJS_VMCODE_IF_TRUE_JUMP),
         NJS_GOTO_ROW(NJS_VMCODE_IF_FALSE_JUMP),
         NJS_GOTO_ROW(NJS_VMCODE_IF_EQUAL_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_LESS_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_GREATER_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_LESS_OR_EQUAL_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_GREATER_OR_EQUAL_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_NOT_LESS_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_NOT_GREATER_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_NOT_LESS_OR_EQUAL_JUMP),
+        NJS_GOTO_ROW(NJS_VMCODE_IF_NOT_GREATER_OR_EQUAL_JUMP),
         NJS_GOTO_ROW(NJS_VMCODE_PROPERTY_INIT),
         NJS_GOTO_ROW(NJS_VMCODE_RETURN),
         NJS_GOTO_ROW(NJS_VMCODE_FUNCTION_FRAME),
@@ -226,6 +300,13 @@ njs_vmcode_interpreter(njs_vm_t *vm, u_char *pc, njs_value_t *rval,
         NJS_GOTO_ROW(NJS_VMCODE_VOID),
         NJS_GOTO_ROW(NJS_VMCODE_DELETE),
         NJS_GOTO_ROW(NJS_VMCODE_DEBUGGER),
+        NJS_GOTO_ROW(NJS_VMCODE_LESS_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_GREATER_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_LESS_OR_EQUAL_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_GREATER_OR_EQUAL_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_ADDITION_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_EQUAL_NUMBER),
+        NJS_GOTO_ROW(NJS_VMCODE_NOT_EQUAL_NUMBER),
     };
 
 #endif
@@ -254,9 +335,21 @@ NEXT_LBL;
         get = (njs_vmcode_prop_get_t *) pc;
         njs_vmcode_operand(vm, get->value, retval);
 
-        ret = njs_value_property(vm, value1, value2->atom_id, retval);
-        if (njs_slow_path(ret == NJS_ERROR)) {
-            goto error;
+        object = njs_vmcode_prop_cache_object(value1, value2->atom_id);
+        prop = njs_vmcode_prop_cache_find(&get->cache, object,
+                                          value2->atom_id, 0);
+
+        if (njs_fast_path(prop != NULL)) {
+            njs_value_assign(retval, njs_prop_value(prop));
+
+        } else {
+            ret = njs_value_property(vm, value1, value2->atom_id, retval);
+            if (njs_slow_path(ret == NJS_ERROR)) {
+                goto error;
+            }
+
+            njs_vmcode_prop_cache_update(&get->cache, object, value2->atom_id,
+                                         0);
         }
 
         pc += sizeof(njs_vmcode_prop_get_t);
@@ -425,9 +518,22 @@ NEXT_LBL;
         get = (njs_vmcode_prop_get_t *) pc;
         njs_vmcode_operand(vm, get->value, retval);
 
-        ret = njs_value_property_val(vm, value1, value2, retval);
-        if (njs_slow_path(ret == NJS_ERROR)) {
-            goto error;
+        object = njs_vmcode_prop_cache_object(value1, value2->atom_id);
+        prop = njs_vmcode_prop_cache_find(&get->cache, object,
+                                          value2->atom_id, 0);
+
+        if (njs_fast_path(prop != NULL)) {
+            njs_value_assign(retval, njs_prop_value(prop));
+            ret = NJS_OK;
+
+        } else {
+            ret = njs_value_property_val(vm, value1, value2, retval);
+            if (njs_slow_path(ret == NJS_ERROR)) {
+                goto error;
+            }
+
+            njs_vmcode_prop_cache_update(&get->cache, object, value2->atom_id,
+                                         0);
         }
 
         pc += sizeof(njs_vmcode_prop_get_t);
@@ -454,12 +560,98 @@ NEXT_LBL;
         pc += try_return->offset;
         NEXT;
 
+/*
+ * A generic instruction which sees two number operands is rewritten
+ * in place to its quickened variant and dispatched again.  The quickened
+ * variant reverts the instruction back to the generic one as soon as
+ * an operand of another type is seen.  Bytecode is shared between cloned
+ * VMs, so the variants must be correct for any operands.
+ */
+
+#define NJS_QUICKEN(quick)                                                    \
+        if (njs_is_number(value1) && njs_is_number(value2)) {                 \
+            vmcode->code = quick;                                             \
+            NEXT;                                                             \
+        }
+
+#define NJS_PRE_QUICK(generic)                                                \
+        njs_vmcode_operand(vm, vmcode->operand3, value2);                     \
+        njs_vmcode_operand(vm, vmcode->operand2, value1);                     \
+                                                                              \
+        if (njs_slow_path(!njs_is_number(value1)                              \
+                          || !njs_is_number(value2)))                         \
+        {                                                                     \
+            vmcode->code = generic;                                           \
+            NEXT;                                                             \
+        }                                                                     \
+                                                                              \
+        njs_vmcode_operand(vm, vmcode->operand1, retval);                     \
+        pc += sizeof(njs_vmcode_3addr_t)
+
+    CASE (NJS_VMCODE_LESS_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_LESS);
+
+        njs_set_boolean(retval, njs_number(value1) < njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_GREATER_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_GREATER);
+
+        njs_set_boolean(retval, njs_number(value1) > njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_LESS_OR_EQUAL_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_LESS_OR_EQUAL);
+
+        njs_set_boolean(retval, njs_number(value1) <= njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_GREATER_OR_EQUAL_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_GREATER_OR_EQUAL);
+
+        njs_set_boolean(retval, njs_number(value1) >= njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_ADDITION_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_ADDITION);
+
+        njs_set_number(retval, njs_number(value1) + njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_EQUAL_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_EQUAL);
+
+        njs_set_boolean(retval, njs_number(value1) == njs_number(value2));
+        NEXT;
+
+    CASE (NJS_VMCODE_NOT_EQUAL_NUMBER):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_QUICK(NJS_VMCODE_NOT_EQUAL);
+
+        njs_set_boolean(retval, njs_number(value1) != njs_number(value2));
+        NEXT;
+
     CASE (NJS_VMCODE_LESS):
         njs_vmcode_debug_opcode();
 
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_LESS_NUMBER);
+
         if (njs_slow_path(!njs_is_primitive(value1))) {
             ret = njs_value_to_primitive(vm, &primitive1, value1, 0);
             if (ret != NJS_OK) {
@@ -499,6 +691,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_GREATER_NUMBER);
+
         if (njs_slow_path(!njs_is_primitive(value1))) {
             ret = njs_value_to_primitive(vm, &primitive1, value1, 0);
             if (ret != NJS_OK) {
@@ -538,6 +732,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_LESS_OR_EQUAL_NUMBER);
+
         if (njs_slow_path(!njs_is_primitive(value1))) {
             ret = njs_value_to_primitive(vm, &primitive1, value1, 0);
             if (ret != NJS_OK) {
@@ -577,6 +773,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_GREATER_OR_EQUAL_NUMBER);
+
         if (njs_slow_path(!njs_is_primitive(value1))) {
             ret = njs_value_to_primitive(vm, &primitive1, value1, 0);
             if (ret != NJS_OK) {
@@ -616,6 +814,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_ADDITION_NUMBER);
+
         if (njs_slow_path(!njs_is_primitive(value1))) {
             hint = njs_is_date(value1);
             ret = njs_value_to_primitive(vm, &primitive1, value1, hint);
@@ -725,6 +925,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_EQUAL_NUMBER);
+
         ret = njs_values_equal(vm, value1, value2);
         if (njs_slow_path(ret < 0)) {
             goto error;
@@ -742,6 +944,8 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand3, value2);
         njs_vmcode_operand(vm, vmcode->operand2, value1);
 
+        NJS_QUICKEN(NJS_VMCODE_NOT_EQUAL_NUMBER);
+
         ret = njs_values_equal(vm, value1, value2);
         if (njs_slow_path(ret < 0)) {
             goto error;
@@ -1166,7 +1370,7 @@ NEXT_LBL;
 
         njs_vmcode_operand(vm, vmcode->operand1, retval);
 
-        ret = njs_vmcode_object(vm, retval);
+        ret = njs_vmcode_object(vm, pc, retval);
         if (njs_slow_path(ret < 0 && ret >= NJS_PREEMPT)) {
             goto error;
         }
@@ -1303,9 +1507,23 @@ NEXT_LBL;
         njs_vmcode_operand(vm, vmcode->operand2, value1);
         njs_vmcode_operand(vm, vmcode->operand1, retval);
 
-        ret = njs_value_property_set(vm, value1, value2->atom_id, retval);
-        if (njs_slow_path(ret == NJS_ERROR)) {
-            goto error;
+        set = (njs_vmcode_prop_set_t *) pc;
+
+        object = njs_vmcode_prop_cache_object(value1, value2->atom_id);
+        prop = njs_vmcode_prop_cache_find(&set->cache, object,
+                                          value2->atom_id, 1);
+
+        if (njs_fast_path(prop != NULL)) {
+            njs_value_assign(njs_prop_value(prop), retval);
+
+        } else {
+            ret = njs_value_property_set(vm, value1, value2->atom_id, retval);
+            if (njs_slow_path(ret == NJS_ERROR)) {
+                goto error;
+            }
+
+            njs_vmcode_prop_cache_update(&set->cache, object, value2->atom_id,
+                                         1);
         }
 
         ret = sizeof(njs_vmcode_prop_set_t);
@@ -1425,6 +1643,101 @@ NEXT_LBL;
 
         BREAK;
 
+/*
+ * Fused comparison and conditional jump instructions emitted by
+ * the generator in place of a comparison into a temporary value
+ * immediately followed by a conditional jump on this value.
+ */
+
+#define NJS_PRE_COMPARE(op, operation)                                        \
+        njs_vmcode_operand(vm, vmcode->operand3, value2);                     \
+        njs_vmcode_operand(vm, vmcode->operand2, value1);                     \
+                                                                              \
+        if (njs_fast_path(njs_is_number(value1)                               \
+                          && njs_is_number(value2)))                          \
+        {                                                                     \
+            ret = (njs_number(value1) op njs_number(value2));                 \
+                                                                              \
+        } else {                                                              \
+            ret = njs_vmcode_compare(vm, value1, value2, operation);          \
+            if (njs_slow_path(ret == NJS_ERROR)) {                            \
+                goto error;                                                   \
+            }                                                                 \
+        }
+
+#define NJS_COMPARE_JUMP(cond)                                                \
+        if (cond) {                                                           \
+            equal = (njs_vmcode_equal_jump_t *) pc;                           \
+            ret = equal->offset;                                              \
+                                                                              \
+        } else {                                                              \
+            ret = sizeof(njs_vmcode_equal_jump_t);                            \
+        }
+
+    CASE (NJS_VMCODE_IF_LESS_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(<, NJS_VMCODE_LESS);
+        NJS_COMPARE_JUMP(ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_GREATER_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(>, NJS_VMCODE_GREATER);
+        NJS_COMPARE_JUMP(ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_LESS_OR_EQUAL_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(<=, NJS_VMCODE_LESS_OR_EQUAL);
+        NJS_COMPARE_JUMP(ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_GREATER_OR_EQUAL_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(>=, NJS_VMCODE_GREATER_OR_EQUAL);
+        NJS_COMPARE_JUMP(ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_NOT_LESS_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(<, NJS_VMCODE_LESS);
+        NJS_COMPARE_JUMP(!ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_NOT_GREATER_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(>, NJS_VMCODE_GREATER);
+        NJS_COMPARE_JUMP(!ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_NOT_LESS_OR_EQUAL_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(<=, NJS_VMCODE_LESS_OR_EQUAL);
+        NJS_COMPARE_JUMP(!ret);
+
+        BREAK;
+
+    CASE (NJS_VMCODE_IF_NOT_GREATER_OR_EQUAL_JUMP):
+        njs_vmcode_debug_opcode();
+
+        NJS_PRE_COMPARE(>=, NJS_VMCODE_GREATER_OR_EQUAL);
+        NJS_COMPARE_JUMP(!ret);
+
+        BREAK;
+
     CASE (NJS_VMCODE_PROPERTY_INIT):
         njs_vmcode_debug_opcode();
 
@@ -1890,19 +2203,33 @@ error:
 
 
 static njs_jump_off_t
-njs_vmcode_object(njs_vm_t *vm, njs_value_t *retval)
+njs_vmcode_object(njs_vm_t *vm, u_char *pc, njs_value_t *retval)
 {
-    njs_object_t  *object;
+    njs_object_t         *object;
+    njs_flathsh_query_t  fhq;
+    njs_vmcode_object_t  *code;
+
+    code = (njs_vmcode_object_t *) pc;
 
     object = njs_object_alloc(vm);
+    if (njs_slow_path(object == NULL)) {
+        return NJS_ERROR;
+    }
 
-    if (njs_fast_path(object != NULL)) {
-        njs_set_object(retval, object);
+    if (code->shape != NULL) {
+        fhq.pool = vm->mem_pool;
+        fhq.proto = &njs_object_hash_proto;
 
-        return sizeof(njs_vmcode_object_t);
+        object->hash.slot = njs_flathsh_copy(code->shape, &fhq);
+        if (njs_slow_path(object->hash.slot == NULL)) {
+            njs_memory_error(vm);
+            return NJS_ERROR;
+        }
     }
 
-    return NJS_ERROR;
+    njs_set_object(retval, object);
+
+    return sizeof(njs_vmcode_object_t);
 }
 
 
@@ -2387,12 +2714,23 @@ njs_vmcode_debugger(njs_vm_t *vm, njs_value_t *retval)
 }
 
 
+/*
+ * Repeated concatenation, as in "s += chunk", is made linear by allocating
+ * long ASCII results with spare room and appending the following operands
+ * in place.  The new string shares the buffer with the previous one,
+ * which is safe as strings are immutable and each string has its own size.
+ * Only the latest result ending at vm->concat_pos can be appended to,
+ * the room is reserved when such a result is appended to the first time.
+ * UTF-8 strings are not appended to as their offset map follows the data.
+ */
+
 static njs_jump_off_t
 njs_string_concat(njs_vm_t *vm, njs_value_t *val1, njs_value_t *val2,
     njs_value_t *retval)
 {
     u_char             *start;
-    size_t             size, length;
+    size_t             size, length, capacity;
+    njs_string_t       *string;
     njs_string_prop_t  string1, string2;
 
     (void) njs_string_prop(vm, &string1, val1);
@@ -2401,11 +2739,64 @@ njs_string_concat(njs_vm_t *vm, njs_value_t *val1, njs_value_t *val2,
     length = string1.length + string2.length;
     size = string1.size + string2.size;
 
+    if (size != length
+        || size < NJS_STRING_CONCAT_MIN
+        || size > NJS_STRING_MAX_LENGTH)
+    {
+        goto copy;
+    }
+
+    capacity = size;
+
+    if (string1.size != 0 && string1.start + string1.size == vm->concat_pos) {
+
+        if ((size_t) (vm->concat_end - vm->concat_pos) >= string2.size) {
+            string = njs_mp_alloc(vm->mem_pool, sizeof(njs_string_t));
+            if (njs_slow_path(string == NULL)) {
+                njs_memory_error(vm);
+                return NJS_ERROR;
+            }
+
+            (void) memcpy(vm->concat_pos, string2.start, string2.size);
+            vm->concat_pos += string2.size;
+
+            string->start = string1.start;
+            string->size = size;
+            string->length = length;
+
+            retval->type = NJS_STRING;
+            retval->truth = 1;
+            retval->atom_id = NJS_ATOM_STRING_unknown;
+            retval->string.data = string;
+
+            return sizeof(njs_vmcode_3addr_t);
+        }
+
+        capacity = njs_max(size, njs_min(size * 2, NJS_STRING_MAX_LENGTH));
+    }
+
+    start = njs_string_alloc(vm, retval, capacity, capacity);
+    if (njs_slow_path(start == NULL)) {
+        return NJS_ERROR;
+    }
+
+    retval->string.data->size = size;
+    retval->string.data->length = length;
+
+    vm->concat_pos = start + size;
+    vm->concat_end = start + capacity;
+
+    goto done;
+
+copy:
+
     start = njs_string_alloc(vm, retval, size, length);
     if (njs_slow_path(start == NULL)) {
         return NJS_ERROR;
     }
 
+done:
+
     (void) memcpy(start, string1.start, string1.size);
     (void) memcpy(start + string1.size, string2.start, string2.size);
 
@@ -2531,6 +2922,56 @@ njs_primitive_values_compare(njs_vm_t *vm, njs_value_t *val1, njs_value_t *val2)
 }
 
 
+/*
+ * Returns the result of a relational "operation" as 1 or 0, or NJS_ERROR.
+ */
+static njs_jump_off_t
+njs_vmcode_compare(njs_vm_t *vm, njs_value_t *val1, njs_value_t *val2,
+    njs_vmcode_t operation)
+{
+    njs_int_t    ret;
+    njs_value_t  primitive1, primitive2;
+
+    if (njs_slow_path(!njs_is_primitive(val1))) {
+        ret = njs_value_to_primitive(vm, &primitive1, val1, 0);
+        if (ret != NJS_OK) {
+            return NJS_ERROR;
+        }
+
+        val1 = &primitive1;
+    }
+
+    if (njs_slow_path(!njs_is_primitive(val2))) {
+        ret = njs_value_to_primitive(vm, &primitive2, val2, 0);
+        if (ret != NJS_OK) {
+            return NJS_ERROR;
+        }
+
+        val2 = &primitive2;
+    }
+
+    if (njs_slow_path(njs_is_symbol(val1) || njs_is_symbol(val2))) {
+        njs_symbol_conversion_failed(vm, 0);
+        return NJS_ERROR;
+    }
+
+    switch (operation) {
+    case NJS_VMCODE_LESS:
+        return (njs_primitive_values_compare(vm, val1, val2) > 0);
+
+    case NJS_VMCODE_GREATER:
+        return (njs_primitive_values_compare(vm, val2, val1) > 0);
+
+    case NJS_VMCODE_LESS_OR_EQUAL:
+        return (njs_primitive_values_compare(vm, val2, val1) == 0);
+
+    default:
+        /* NJS_VMCODE_GREATER_OR_EQUAL. */
+        return (njs_primitive_values_compare(vm, val1, val2) == 0);
+    }
+}
+
+
 static njs_jump_off_t
 njs_function_frame_create(njs_vm_t *vm, njs_value_t *value,
     const njs_value_t *this, uintptr_t nargs, njs_bool_t ctor)
@@ -3002,3 +3443,43 @@ njs_throw_cannot_property(njs_vm_t *vm, njs_value_t *object, njs_value_t *key,
 
     return NJS_OK;
 }
+
+
+static void
+njs_vmcode_prop_cache_update(njs_vmcode_prop_cache_t *cache,
+    njs_object_t *object, uint32_t atom_id, njs_bool_t set)
+{
+    njs_int_t            ret;
+    njs_object_prop_t    *prop;
+    njs_flathsh_query_t  fhq;
+
+    if (cache->misses >= NJS_PROP_CACHE_MISSES_MAX) {
+        return;
+    }
+
+    cache->misses++;
+
+    if (object == NULL) {
+        return;
+    }
+
+    fhq.key_hash = atom_id;
+    fhq.proto = &njs_object_hash_proto;
+
+    ret = njs_flathsh_unique_find(&object->hash, &fhq);
+    if (ret != NJS_OK) {
+        return;
+    }
+
+    prop = fhq.value;
+
+    if (prop->type != NJS_PROPERTY
+        || !njs_is_valid(njs_prop_value(prop))
+        || (set && !prop->writable))
+    {
+        return;
+    }
+
+    cache->index[cache->misses % NJS_PROP_CACHE_SIZE] =
+                (njs_flathsh_elt_t *) prop - njs_hash_elts(object->hash.slot) + 1;
+}
@@ -36,6 +36,14 @@ enum {
     NJS_VMCODE_IF_TRUE_JUMP,
     NJS_VMCODE_IF_FALSE_JUMP,
     NJS_VMCODE_IF_EQUAL_JUMP,
+    NJS_VMCODE_IF_LESS_JUMP,
+    NJS_VMCODE_IF_GREATER_JUMP,
+    NJS_VMCODE_IF_LESS_OR_EQUAL_JUMP,
+    NJS_VMCODE_IF_GREATER_OR_EQUAL_JUMP,
+    NJS_VMCODE_IF_NOT_LESS_JUMP,
+    NJS_VMCODE_IF_NOT_GREATER_JUMP,
+    NJS_VMCODE_IF_NOT_LESS_OR_EQUAL_JUMP,
+    NJS_VMCODE_IF_NOT_GREATER_OR_EQUAL_JUMP,
     NJS_VMCODE_PROPERTY_INIT,
     NJS_VMCODE_RETURN,
     NJS_VMCODE_FUNCTION_FRAME,
@@ -111,6 +119,18 @@ enum {
     NJS_VMCODE_VOID,
     NJS_VMCODE_DELETE,
     NJS_VMCODE_DEBUGGER,
+
+    /*
+     * Quickened variants are never emitted by the generator, the interpreter
+     * rewrites generic instructions in place once number operands are seen.
+     */
+    NJS_VMCODE_LESS_NUMBER,
+    NJS_VMCODE_GREATER_NUMBER,
+    NJS_VMCODE_LESS_OR_EQUAL_NUMBER,
+    NJS_VMCODE_GREATER_OR_EQUAL_NUMBER,
+    NJS_VMCODE_ADDITION_NUMBER,
+    NJS_VMCODE_EQUAL_NUMBER,
+    NJS_VMCODE_NOT_EQUAL_NUMBER,
     NJS_VMCODES
 };
 
@@ -154,6 +174,8 @@ typedef struct {
 typedef struct {
     njs_vmcode_t               code;
     njs_index_t                retval;
+    /* Prebuilt hash with the object literal keys, or NULL. */
+    njs_flathsh_descr_t        *shape;
 } njs_vmcode_object_t;
 
 
@@ -234,11 +256,28 @@ typedef struct {
 } njs_vmcode_test_jump_t;
 
 
+#define NJS_PROP_CACHE_SIZE             2
+#define NJS_PROP_CACHE_MISSES_MAX       32
+
+/*
+ * Inline cache of the own property element positions seen by a property
+ * access instruction.  An index is 1-based, 0 means an empty entry.
+ * Entries are validated against the object hash on every use, so they
+ * never need to be invalidated.
+ */
+
+typedef struct {
+    uint32_t                   index[NJS_PROP_CACHE_SIZE];
+    uint32_t                   misses;
+} njs_vmcode_prop_cache_t;
+
+
 typedef struct {
     njs_vmcode_t               code;
     njs_index_t                value;
     njs_index_t                object;
     njs_index_t                property;
+    njs_vmcode_prop_cache_t    cache;
 } njs_vmcode_prop_get_t;
 
 
@@ -247,6 +286,7 @@ typedef struct {
     njs_index_t                value;
     njs_index_t                object;
     njs_index_t                property;
+    njs_vmcode_prop_cache_t    cache;
 } njs_vmcode_prop_set_t;
 
 
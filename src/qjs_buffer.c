@@ -2421,6 +2421,36 @@ qjs_buffer_create(JSContext *ctx, u_char *start, size_t size)
 }
 
 
+/*
+ * Creates a Buffer over the memory not owned by the engine,
+ * the memory should outlive the value.
+ */
+
+JSValue
+qjs_buffer_view(JSContext *ctx, u_char *start, size_t size)
+{
+    JSValue  ab, ret, proto;
+
+    ab = JS_NewArrayBuffer(ctx, start, size, NULL, NULL, 0);
+    if (JS_IsException(ab)) {
+        return ab;
+    }
+
+    ret = qjs_new_uint8_array(ctx, 1, &ab);
+    JS_FreeValue(ctx, ab);
+
+    if (JS_IsException(ret)) {
+        return ret;
+    }
+
+    proto = JS_GetClassProto(ctx, QJS_CORE_CLASS_ID_BUFFER);
+    JS_SetPrototype(ctx, ret, proto);
+    JS_FreeValue(ctx, proto);
+
+    return ret;
+}
+
+
 JSValue
 qjs_buffer_chb_alloc(JSContext *ctx, njs_chb_t *chain)
 {
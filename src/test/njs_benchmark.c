@@ -321,6 +321,12 @@ static njs_benchmark_test_t  njs_test[] =
       njs_str("undefined"),
       1 },
 
+    { "string += 10K",
+      njs_str("var s = ''; for (var i = 0; i < 10000; i++) { s += 'abcdef' };"
+              "s.length"),
+      njs_str("60000"),
+      1 },
+
     { "JSON.parse",
       njs_str("JSON.parse('{\"a\":123, \"XXX\":[3,4,null]}').a"),
       njs_str("123"),
@@ -417,6 +423,15 @@ static njs_benchmark_test_t  njs_test[] =
       njs_str("2000000"),
       1 },
 
+    { "object property get/set 10M",
+      njs_str("var objs = [{a:1, b:2}, {b:2, a:1}];"
+              "function f(o) { o.b = o.a + o.b; return o.a }"
+              "var count = 0;"
+              "for (var i = 0; i < 10000000; i++) { count += f(objs[i & 1]); }"
+              "count"),
+      njs_str("10000000"),
+      1 },
+
     { "typed array 10M",
       njs_str("var arr = new Uint8Array(10**7);"
               "var count = 0, length = arr.length;"
@@ -445,6 +460,38 @@ static njs_benchmark_test_t  njs_test[] =
       njs_str("10001"),
       1 },
 
+    { "regexp exec 100K",
+      njs_str("var re = /^\\/api\\/v(\\d+)\\/users\\/([a-z0-9-]+)(?:\\/(\\w+))?\\/?$/i;"
+              "var uri = '/api/v2/users/a3f0-9c1e/orders/';"
+              "var n = 0;"
+              "for (var i = 0; i < 100000; i++) { n += re.exec(uri)[1].length }"
+              "n"),
+      njs_str("100000"),
+      1 },
+
+    { "regexp new RegExp 100K",
+      njs_str("var hosts = ['example\\\\.com', 'example\\\\.org', 'example\\\\.net'];"
+              "var n = 0;"
+              "for (var i = 0; i < 100000; i++) {"
+              "    var re = new RegExp('^(?:[a-z0-9-]+\\\\.)*' + hosts[i % 3] + '$',"
+              "                        'i');"
+              "    n += re.test('api.Example.org');"
+              "}"
+              "n"),
+      njs_str("33333"),
+      1 },
+
+    { "regexp replace 100K",
+      njs_str("var re = new RegExp('(^|;)\\\\s*(session|token)=([^;]*)', 'g');"
+              "var cookie = 'lang=en; session=0123456789abcdef; token=xyz; t=1';"
+              "var n = 0;"
+              "for (var i = 0; i < 100000; i++) {"
+              "    n += cookie.replace(re, '$1$2=*').length"
+              "}"
+              "n"),
+      njs_str("3000000"),
+      1 },
+
     { "simple 100K split",
       njs_str("'a '.repeat(100000).split(' ').length"),
       njs_str("100001"),
@@ -2098,6 +2098,72 @@ static njs_unit_test_t  njs_test[] =
     { njs_str("1 < 'abc'"),
       njs_str("false") },
 
+    { njs_str("function f(a, b) { return [a < b, a > b, a <= b, a >= b,"
+              "                          a == b, a != b] }"
+              "[[1, 2], [2, 2], ['10', '9'], [NaN, 1], [3, 1],"
+              " [{valueOf() {return 1}}, 1], [1, NaN], [null, 0],"
+              " [-0, 0], [2, '2']]"
+              ".map(v => f(v[0], v[1]).map(Number).join('')).join()"),
+      njs_str("101001,001110,101001,000001,010101,"
+              "001110,000001,001101,001110,001110") },
+
+    { njs_str("function f(a, b) { return a + b }"
+              "[f(1, 2), f('1', 2), f(1, 2), f(1, {}), f(0.5, 0.25),"
+              " f(1, null), f(1, 2)].join()"),
+      njs_str("3,12,3,1[object Object],0.75,1,3") },
+
+    { njs_str("var s = 0;"
+              "for (var i = 0; i < 100; i++) { s = s + (i < 50 ? i : '') }"
+              "s"),
+      njs_str("1225") },
+
+    { njs_str("var r = [];"
+              "[1, NaN, 'b', {valueOf() { return 2 }}].forEach(a => {"
+              "    if (a < 2) { r.push('<') }"
+              "    if (a > 1) { r.push('>') }"
+              "    if (a <= 1) { r.push('<=') }"
+              "    if (a >= 2) { r.push('>=') }"
+              "    if (!(a < 2)) { r.push('!<') }"
+              "});"
+              "r.join()"),
+      njs_str("<,<=,!<,!<,>,>=,!<") },
+
+    { njs_str("var n = 0, i = 5; while (i > 0) { i--; n++ } n"),
+      njs_str("5") },
+
+    { njs_str("var n = 0; do { n++ } while (n <= 10); n"),
+      njs_str("11") },
+
+    { njs_str("var i = 0, s = ''; for (; 'aa' >= s;) { s += 'a'; i++ } i"),
+      njs_str("3") },
+
+    { njs_str("var r = [], a = {valueOf() { r.push('a'); return 1 }},"
+              "    b = {valueOf() { r.push('b'); return 2 }};"
+              "if (a > b) {} if (a <= b) {} r.join('')"),
+      njs_str("abab") },
+
+    { njs_str("if (Symbol() < 1) {}"),
+      njs_str("TypeError: Cannot convert a Symbol value to a number") },
+
+    { njs_str("var i; for (i = 0; i < NaN; i++) {} i"),
+      njs_str("0") },
+
+    /* Constant folding. */
+
+    { njs_str("[1024 * 1024, 2 ** 10, 1 ** Infinity, 1 << 31, -1 >>> 0,"
+              " -1 >> 1, 5 % 0, 7 / 2, 1 - 1 - 1, 0xff & 0x0f | 0x30 ^ 3,"
+              " 1 / (-0 * 1)]"),
+      njs_str("1048576,1024,NaN,-2147483648,4294967295,-1,NaN,3.5,-1,63,"
+              "-Infinity") },
+
+    { njs_str("['a' + 'b' + 1 + 2, 1 + 2 + 'a', 'α' + 'β', ('α' + 'βγ')[2],"
+              " ('α'.repeat(40) + 'β' + 'γ')[41]]"),
+      njs_str("ab12,3a,αβ,γ,γ") },
+
+    { njs_str("var a = [0, 1, 2, 3]; [a[1 + 2], a[-1 + 1], a[2 - 3],"
+              " ({ab: 1})['a' + 'b'], 'a' + 'b' in {ab: 1}]"),
+      njs_str("3,0,,1,true") },
+
     /**/
 
     { njs_str("[] === []"),
@@ -2897,6 +2963,25 @@ static njs_unit_test_t  njs_test[] =
                  "for (var a in o) {arr.push(a)}; arr"),
       njs_str("b") },
 
+    { njs_str("function f(v) { return {b:v, a:v + 1, b:v + 2, c() { return this.a }} }"
+              "var o1 = f(1), o2 = f(10);"
+              "njs.dump([Object.keys(o1), o1.b, o2.b, o2.c()])"),
+      njs_str("[['b','a','c'],3,12,11]") },
+
+    { njs_str("function f(v) { return {a:v, b:v} }"
+              "var o1 = f(1), o2 = f(2); delete o1.a; o1.c = 3; o2.d = 4;"
+              "njs.dump([o1, o2, f(5)])"),
+      njs_str("[{b:1,c:3},{a:2,b:2,d:4},{a:5,b:5}]") },
+
+    { njs_str("function f(v) { return {a:v, 1:v, b:v} }"
+              "Object.keys(f(1)).join()"),
+      njs_str("1,a,b") },
+
+    { njs_str("var e; function f(v) { return {a:1, b:v(), c:3} }"
+              "try { f(() => { throw 'x' }) } catch (ex) { e = ex }"
+              "njs.dump([e, f(() => 2)])"),
+      njs_str("['x',{a:1,b:2,c:3}]") },
+
     { njs_str("var a = []; for (var k in new Uint8Array([1,2,3])) { a.push(k); }; a"),
       njs_str("0,1,2") },
 
@@ -8154,6 +8239,26 @@ static njs_unit_test_t  njs_test[] =
                  "String.prototype.concat.apply(s, a.slice(1))"),
       njs_str("RangeError: invalid string length") },
 
+    { njs_str("var a = 'x'.repeat(300); var b = a + 'y'; var c = a + 'z';"
+              "b.slice(-1) + c.slice(-1) + b.length + c.length + a.length"),
+      njs_str("yz301301300") },
+
+    { njs_str("var a = 'x'.repeat(300); var b = a + 'yy'; var c = b + 'z';"
+              "var d = b + 'w'; [b.slice(-3), c.slice(-3), d.slice(-3)]"),
+      njs_str("xyy,yyz,yyw") },
+
+    { njs_str("var s = ''; for (var i = 0; i < 10000; i++) { s += i % 10 };"
+              "[s.length, s.slice(0, 12), s.slice(-3), s[5000]]"),
+      njs_str("10000,012345678901,789,0") },
+
+    { njs_str("var s = 'x'.repeat(300); var t = s + 'α'; var u = s + 'β';"
+              "[t.length, u.length, t.slice(-2), u.slice(-2), (t + 'y')[301]]"),
+      njs_str("301,301,xα,xβ,y") },
+
+    { njs_str("var s = 'x'.repeat(300); s += 'y'; var t = s + 'z'; s += 'w';"
+              "[s.slice(-3), t.slice(-3), s.length, t.length]"),
+      njs_str("xyw,xyz,302,302") },
+
     { njs_str("var a = 'abcdefgh'; a.substr(3, 15)"),
       njs_str("defgh") },
 
@@ -9877,6 +9982,9 @@ static njs_unit_test_t  njs_test[] =
     { njs_str("'a'.repeat(2147483647)"),
       njs_str("RangeError: invalid string length") },
 
+    { njs_str("var s = 'x'.repeat(2**30); s + s"),
+      njs_str("RangeError: invalid string length") },
+
     { njs_str("'a'.repeat(2147483648)"),
       njs_str("RangeError: invalid string length") },
 
@@ -12086,6 +12194,11 @@ static njs_unit_test_t  njs_test[] =
     { njs_str("/\\?+/"),
       njs_str("/\\?+/") },
 
+    { njs_str("var first = new RegExp('ab+c');"
+              "for (var i = 0; i < 300; i++) { new RegExp('q' + i); }"
+              "first.exec('xxabbbc')"),
+      njs_str("abbbc") },
+
     { njs_str("var r = new RegExp(); r"),
       njs_str("/(?:)/") },
 
@@ -14928,6 +15041,50 @@ static njs_unit_test_t  njs_test[] =
                  "Object.defineProperty(o, 'a', { value: 1, writable:1 }); o.a = 2; o.a"),
       njs_str("2") },
 
+    /* Inline property caches. */
+
+    { njs_str("function get(o) { return o.a }"
+              "var objs = [{a:1}, {b:0, a:2}, {c:0, b:0, a:3}, {a:4}, {}];"
+              "var r = []; for (var i = 0; i < 3; i++) {"
+              "    r.push(objs.map(get).join())"
+              "}; r[2]"),
+      njs_str("1,2,3,4,") },
+
+    { njs_str("function get(o) { return o.a }"
+              "var o = {a:1, b:2}, r = [get(o), get(o)];"
+              "delete o.a; r.push(get(o));"
+              "o.a = 3; r.push(get(o));"
+              "Object.defineProperty(o, 'a', {get() { return 4 }});"
+              "r.push(get(o)); r.join()"),
+      njs_str("1,1,,3,4") },
+
+    { njs_str("function get(o) { return o.a }"
+              "var p = {a:'proto'}, o = Object.create(p), r = [get(o), get(o)];"
+              "o.a = 'own'; r.push(get(o), get(o));"
+              "delete o.a; r.push(get(o)); r.join()"),
+      njs_str("proto,proto,own,own,proto") },
+
+    { njs_str("function set(o, v) { o.a = v }"
+              "var o = {a:1}; set(o, 2); set(o, 3);"
+              "Object.freeze(o); set(o, 4)"),
+      njs_str("TypeError: Cannot assign to read-only property \"a\" of object") },
+
+    { njs_str("function set(o, v) { o.a = v }"
+              "var o = {a:1}, r = []; set(o, 2); set(o, 3);"
+              "Object.defineProperty(o, 'a', {set(v) { r.push(v) }});"
+              "set(o, 4); r.join()"),
+      njs_str("4") },
+
+    { njs_str("function set(o, v) { o.a = v; return o.a }"
+              "var r = []; for (var i = 0; i < 64; i++) {"
+              "    var o = {}; o['k' + i] = i; r.push(set(o, i))"
+              "}; r.reduce((a, v) => a + v)"),
+      njs_str("2016") },
+
+    { njs_str("var r = []; for (var i = 0; i < 3; i++) { r.push(Math.PI.toFixed(2)) }"
+              "r.join()"),
+      njs_str("3.14,3.14,3.14") },
+
     { njs_str("var o = {};"
                  "Object.defineProperty(o, new String('a'), { value: 1}); o.a"),
       njs_str("1") },
@@ -20869,6 +21026,10 @@ static njs_unit_test_t  njs_shared_test[] =
     { njs_str("isNaN(function(){})"),
       njs_str("true") },
 
+    { njs_str("[new RegExp('a+').exec('xaay')[0], 'xyz'.search(/z/),"
+              " 'aXbX'.match(/X/g).length, 'a,b'.split(/,/).join()].join()"),
+      njs_str("aa,2,2,a,b") },
+
     { njs_str("var a = $r.uri; $r.uri = $r2.uri; $r2.uri = a; $r2.uri + $r.uri"),
       njs_str("АБВαβγ") },
 
@@ -22856,6 +23017,438 @@ njs_string_to_index_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
 }
 
 
+static njs_int_t
+njs_vm_reset_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
+{
+    u_char              *start;
+    njs_vm_t            *nvm;
+    njs_int_t           ret;
+    njs_str_t           s;
+    njs_uint_t          i;
+    njs_function_t      *func;
+    njs_opaque_value_t  retval;
+
+    static const njs_str_t  name = njs_str("inc");
+    static const njs_str_t  script =
+        njs_str("var n = 0;"
+                "function inc() { Promise.resolve().then(() => n = -1);"
+                "                 return ++n }");
+    static const njs_str_t  expected[] = {
+        njs_str("1"),
+        njs_str("2"),
+        njs_str("3"),
+    };
+
+    start = script.start;
+
+    ret = njs_vm_compile(vm, &start, start + script.length);
+    if (ret != NJS_OK) {
+        njs_printf("njs_vm_reset_test: njs_vm_compile() failed\n");
+        return NJS_ERROR;
+    }
+
+    nvm = njs_vm_clone(vm, NULL);
+    if (nvm == NULL) {
+        njs_printf("njs_vm_reset_test: njs_vm_clone() failed\n");
+        return NJS_ERROR;
+    }
+
+    ret = njs_vm_start(nvm, njs_value_arg(&retval));
+    if (ret != NJS_OK) {
+        njs_printf("njs_vm_reset_test: njs_vm_start() failed\n");
+        goto fail;
+    }
+
+    for (i = 0; i < njs_nitems(expected); i++) {
+        njs_vm_reset(nvm, (njs_external_ptr_t) &expected[i]);
+
+        if (njs_vm_pending(nvm) || njs_vm_external_ptr(nvm) != &expected[i]) {
+            njs_printf("njs_vm_reset_test: VM state is not reset\n");
+            stat->failed++;
+            continue;
+        }
+
+        func = njs_vm_function(nvm, &name);
+        if (func == NULL) {
+            njs_printf("njs_vm_reset_test: njs_vm_function() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_invoke(nvm, func, NULL, 0, njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_vm_reset_test: njs_vm_invoke() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_value_string(nvm, &s, njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_vm_reset_test: njs_vm_value_string() failed\n");
+            goto fail;
+        }
+
+        if (!njs_strstr_eq(&expected[i], &s)) {
+            njs_printf("njs_vm_reset_test:\n"
+                       "expected: \"%V\"\n     got: \"%V\"\n",
+                       &expected[i], &s);
+
+            stat->failed++;
+            continue;
+        }
+
+        stat->passed++;
+    }
+
+    njs_vm_destroy(nvm);
+
+    return NJS_OK;
+
+fail:
+
+    njs_vm_destroy(nvm);
+
+    return NJS_ERROR;
+}
+
+
+#define NJS_COLLECT_TEST_SIZE  (256 * 1024)
+
+
+static njs_int_t
+njs_vm_collect_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
+{
+    void                *p;
+    u_char              *start;
+    u_char              buf[64];
+    size_t              size;
+    njs_vm_t            *nvm;
+    njs_int_t           ret;
+    njs_str_t           s, expected;
+    njs_uint_t          i;
+    njs_mp_stat_t       ms;
+    njs_function_t      *func;
+    njs_opaque_value_t  retval, roots[2];
+
+    static const njs_str_t  name = njs_str("f");
+    static const njs_str_t  script =
+        njs_str("var keep = {a: [1, 2, 3], s: 'x'.repeat(1000)};"
+                "var count = (function() { var n = 0; return () => ++n })();"
+                "function f(v) {"
+                "    var g = [];"
+                "    for (var i = 0; i < 1000; i++) {"
+                "        g.push({i: i, s: 'y'.repeat(100) + i});"
+                "    }"
+                "    keep.last = g[999].s.slice(-3);"
+                "    return `${count()}:${keep.a}:${keep.s.length}:`"
+                "           + `${keep.last}:${g.length}:${v}`;"
+                "}");
+
+    start = script.start;
+
+    ret = njs_vm_compile(vm, &start, start + script.length);
+    if (ret != NJS_OK) {
+        njs_printf("njs_vm_collect_test: njs_vm_compile() failed\n");
+        return NJS_ERROR;
+    }
+
+    nvm = njs_vm_clone(vm, NULL);
+    if (nvm == NULL) {
+        njs_printf("njs_vm_collect_test: njs_vm_clone() failed\n");
+        return NJS_ERROR;
+    }
+
+    ret = njs_vm_start(nvm, njs_value_arg(&retval));
+    if (ret != NJS_OK) {
+        njs_printf("njs_vm_collect_test: njs_vm_start() failed\n");
+        goto fail;
+    }
+
+    func = njs_vm_function(nvm, &name);
+    if (func == NULL) {
+        njs_printf("njs_vm_collect_test: njs_vm_function() failed\n");
+        goto fail;
+    }
+
+    /* The values kept outside of the VM, as nginx does. */
+
+    ret = njs_vm_value_string_create(nvm, njs_value_arg(&roots[0]),
+                                     (u_char *) "arg", 3);
+    if (ret != NJS_OK) {
+        njs_printf("njs_vm_collect_test: "
+                   "njs_vm_value_string_create() failed\n");
+        goto fail;
+    }
+
+    for (i = 1; i <= 10; i++) {
+        ret = njs_vm_invoke(nvm, func, njs_value_arg(&roots[0]), 1,
+                            njs_value_arg(&roots[1]));
+        if (ret != NJS_OK) {
+            njs_printf("njs_vm_collect_test: njs_vm_invoke() failed\n");
+            goto fail;
+        }
+
+        /*
+         * A block referenced only by the native stack, which is not
+         * scanned, is garbage.
+         */
+
+        p = njs_mp_zalloc(njs_vm_memory_pool(nvm), NJS_COLLECT_TEST_SIZE);
+        if (p == NULL) {
+            njs_printf("njs_vm_collect_test: njs_mp_zalloc() failed\n");
+            goto fail;
+        }
+
+        njs_mp_stat(njs_vm_memory_pool(nvm), &ms);
+        size = ms.size;
+
+        ret = njs_vm_collect(nvm, roots, sizeof(roots));
+        if (ret != NJS_OK) {
+            njs_printf("njs_vm_collect_test: njs_vm_collect() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_value_string(nvm, &s, njs_value_arg(&roots[1]));
+        if (ret != NJS_OK) {
+            njs_printf("njs_vm_collect_test: njs_vm_value_string() failed\n");
+            goto fail;
+        }
+
+        expected.start = buf;
+        expected.length = njs_sprintf(buf, buf + sizeof(buf),
+                                      "%ui:1,2,3:1000:999:1000:arg", i)
+                          - buf;
+
+        if (!njs_strstr_eq(&expected, &s)) {
+            njs_printf("njs_vm_collect_test:\n"
+                       "expected: \"%V\"\n     got: \"%V\"\n",
+                       &expected, &s);
+            stat->failed++;
+            continue;
+        }
+
+        njs_mp_stat(njs_vm_memory_pool(nvm), &ms);
+
+        if (ms.size + NJS_COLLECT_TEST_SIZE > size) {
+            njs_printf("njs_vm_collect_test: garbage is not freed "
+                       "%uz -> %uz\n", size, ms.size);
+            stat->failed++;
+            continue;
+        }
+
+        stat->passed++;
+    }
+
+    njs_vm_destroy(nvm);
+
+    return NJS_OK;
+
+fail:
+
+    njs_vm_destroy(nvm);
+
+    return NJS_ERROR;
+}
+
+
+static njs_int_t
+njs_regexp_pattern_cache_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
+{
+    u_char                      *start;
+    njs_vm_t                    *nvm[2];
+    njs_int_t                   ret;
+    njs_str_t                   s;
+    njs_uint_t                  i;
+    njs_vm_opt_t                options;
+    njs_function_t              *func;
+    njs_opaque_value_t          retval;
+    njs_vm_regexp_cache_stat_t  cs;
+
+    static const njs_str_t  cold = njs_str("cold");
+    static const njs_str_t  script =
+        njs_str("function run(c, n, m) {"
+                "    var r = 0;"
+                "    for (var i = 0; i < n; i++) {"
+                "        var re = new RegExp(c + (i % m) + 'b', 'g');"
+                "        r += re.test('x' + c + (i % m) + 'b');"
+                "    }"
+                "    return r;"
+                "}"
+                "function hot() { return run('a', 64, 16) }"
+                "function cold() { return run('c', 200, 200) }");
+
+    static const struct {
+        njs_uint_t  vm;
+        njs_str_t   name;
+        njs_str_t   expected;
+    } tests[] = {
+        { 0, njs_str("hot"), njs_str("64") },
+        { 1, njs_str("hot"), njs_str("64") },
+        { 1, njs_str("cold"), njs_str("200") },
+    };
+
+    start = script.start;
+    nvm[0] = NULL;
+    nvm[1] = NULL;
+
+    ret = njs_vm_compile(vm, &start, start + script.length);
+    if (ret != NJS_OK) {
+        njs_printf("njs_regexp_pattern_cache_test: "
+                   "njs_vm_compile() failed\n");
+        return NJS_ERROR;
+    }
+
+    for (i = 0; i < njs_nitems(nvm); i++) {
+        nvm[i] = njs_vm_clone(vm, NULL);
+        if (nvm[i] == NULL) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_clone() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_start(nvm[i], njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_start() failed\n");
+            goto fail;
+        }
+    }
+
+    for (i = 0; i < njs_nitems(tests); i++) {
+        func = njs_vm_function(nvm[tests[i].vm], &tests[i].name);
+        if (func == NULL) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_function() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_invoke(nvm[tests[i].vm], func, NULL, 0,
+                            njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_invoke() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_value_string(nvm[tests[i].vm], &s,
+                                  njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_value_string() failed\n");
+            goto fail;
+        }
+
+        if (!njs_strstr_eq(&tests[i].expected, &s)) {
+            njs_printf("njs_regexp_pattern_cache_test: %V()\n"
+                       "expected: \"%V\"\n     got: \"%V\"\n",
+                       &tests[i].name, &tests[i].expected, &s);
+
+            stat->failed++;
+            continue;
+        }
+
+        stat->passed++;
+    }
+
+    njs_vm_regexp_cache_stat(vm, &cs);
+
+    /*
+     * The first VM compiles 16 patterns, the second one reuses them,
+     * the 200 cold patterns evict the hot ones referred by both VMs,
+     * the cache holds up to 128 patterns.
+     */
+
+    if (cs.size != 128 || cs.hits != 48 + 64
+        || cs.misses != 16 + 200)
+    {
+        njs_printf("njs_regexp_pattern_cache_test: unexpected stat\n"
+                   "size: %uz hits: %uL misses: %uL\n",
+                   cs.size, cs.hits, cs.misses);
+
+        stat->failed++;
+
+    } else {
+        stat->passed++;
+    }
+
+    for (i = 0; i < njs_nitems(nvm); i++) {
+        njs_vm_destroy(nvm[i]);
+        nvm[i] = NULL;
+    }
+
+    /*
+     * The patterns evicted while referred only by the VM owning
+     * the cache are left to the VM rather than kept by the cache.
+     */
+
+    njs_vm_opt_init(&options);
+
+    options.init = 1;
+
+    nvm[0] = njs_vm_create(&options);
+    if (nvm[0] == NULL) {
+        njs_printf("njs_regexp_pattern_cache_test: "
+                   "njs_vm_create() failed\n");
+        return NJS_ERROR;
+    }
+
+    start = script.start;
+
+    ret = njs_vm_compile(nvm[0], &start, start + script.length);
+    if (ret != NJS_OK) {
+        njs_printf("njs_regexp_pattern_cache_test: "
+                   "njs_vm_compile() failed\n");
+        goto fail;
+    }
+
+    ret = njs_vm_start(nvm[0], njs_value_arg(&retval));
+    if (ret != NJS_OK) {
+        njs_printf("njs_regexp_pattern_cache_test: njs_vm_start() failed\n");
+        goto fail;
+    }
+
+    func = njs_vm_function(nvm[0], &cold);
+    if (func == NULL) {
+        njs_printf("njs_regexp_pattern_cache_test: "
+                   "njs_vm_function() failed\n");
+        goto fail;
+    }
+
+    for (i = 0; i < 2; i++) {
+        ret = njs_vm_invoke(nvm[0], func, NULL, 0, njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_regexp_pattern_cache_test: "
+                       "njs_vm_invoke() failed\n");
+            goto fail;
+        }
+    }
+
+    njs_vm_regexp_cache_stat(nvm[0], &cs);
+
+    if (cs.size != 128 || cs.evicted != 0) {
+        njs_printf("njs_regexp_pattern_cache_test: unexpected stat\n"
+                   "size: %uz evicted: %uz\n", cs.size, cs.evicted);
+
+        stat->failed++;
+
+    } else {
+        stat->passed++;
+    }
+
+    njs_vm_destroy(nvm[0]);
+
+    return NJS_OK;
+
+fail:
+
+    for (i = 0; i < njs_nitems(nvm); i++) {
+        if (nvm[i] != NULL) {
+            njs_vm_destroy(nvm[i]);
+        }
+    }
+
+    return NJS_ERROR;
+}
+
+
 #ifdef NJS_HAVE_ADDR2LINE
 static njs_int_t
 njs_addr2line_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
@@ -22893,6 +23486,117 @@ njs_addr2line_test(njs_vm_t *vm, njs_opts_t *opts, njs_stat_t *stat)
 #endif
 
 
+static njs_int_t
+njs_external_detach_test(njs_vm_t *unused, njs_opts_t *opts,
+    njs_stat_t *stat)
+{
+    u_char              *start;
+    njs_vm_t            *vm;
+    njs_int_t           ret;
+    njs_str_t           s;
+    njs_uint_t          i;
+    njs_vm_opt_t        options;
+    njs_function_t      *func;
+    njs_opaque_value_t  value, retval;
+
+    static const njs_str_t  name = njs_str("f");
+    static const njs_str_t  request = njs_str("$r");
+    static const njs_str_t  script =
+        njs_str("var r = $r, p = $r.props;"
+                "function f() { return [r.uri, p.a, r.props.a, r.vars.p,"
+                "                       $r2.props.a].map(String).join() }");
+    static const njs_str_t  expected[] = {
+        njs_str("АБВ,1,1,pval,2"),
+        njs_str("undefined,undefined,undefined,undefined,2"),
+    };
+
+    njs_vm_opt_init(&options);
+
+    options.init = 1;
+    options.addons = njs_unit_test_addon_external_modules;
+
+    vm = njs_vm_create(&options);
+    if (vm == NULL) {
+        njs_printf("njs_external_detach_test: njs_vm_create() failed\n");
+        return NJS_ERROR;
+    }
+
+    ret = njs_externals_init(vm);
+    if (ret != NJS_OK) {
+        njs_printf("njs_external_detach_test: njs_externals_init() failed\n");
+        goto fail;
+    }
+
+    start = script.start;
+
+    ret = njs_vm_compile(vm, &start, start + script.length);
+    if (ret != NJS_OK) {
+        njs_printf("njs_external_detach_test: njs_vm_compile() failed\n");
+        goto fail;
+    }
+
+    ret = njs_vm_start(vm, njs_value_arg(&retval));
+    if (ret != NJS_OK) {
+        njs_printf("njs_external_detach_test: njs_vm_start() failed\n");
+        goto fail;
+    }
+
+    for (i = 0; i < njs_nitems(expected); i++) {
+        if (i == 1) {
+            ret = njs_vm_value(vm, &request, njs_value_arg(&value));
+            if (ret != NJS_OK) {
+                njs_printf("njs_external_detach_test: "
+                           "njs_vm_value() failed\n");
+                goto fail;
+            }
+
+            njs_value_external_detach(njs_value_arg(&value));
+        }
+
+        func = njs_vm_function(vm, &name);
+        if (func == NULL) {
+            njs_printf("njs_external_detach_test: "
+                       "njs_vm_function() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_invoke(vm, func, NULL, 0, njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_external_detach_test: njs_vm_invoke() failed\n");
+            goto fail;
+        }
+
+        ret = njs_vm_value_string(vm, &s, njs_value_arg(&retval));
+        if (ret != NJS_OK) {
+            njs_printf("njs_external_detach_test: "
+                       "njs_vm_value_string() failed\n");
+            goto fail;
+        }
+
+        if (!njs_strstr_eq(&expected[i], &s)) {
+            njs_printf("njs_external_detach_test:\n"
+                       "expected: \"%V\"\n     got: \"%V\"\n",
+                       &expected[i], &s);
+
+            stat->failed++;
+            continue;
+        }
+
+        stat->passed++;
+    }
+
+    njs_vm_destroy(vm);
+
+    return NJS_OK;
+
+fail:
+
+    njs_vm_destroy(vm);
+
+    return NJS_ERROR;
+}
+
+
 static njs_int_t
 njs_vm_internal_api_test(njs_unit_test_t unused[], size_t num, njs_str_t *name,
     njs_opts_t *opts, njs_stat_t *stat)
@@ -22915,6 +23619,14 @@ njs_vm_internal_api_test(njs_unit_test_t unused[], size_t num, njs_str_t *name,
           njs_str("njs_sort_test") },
         { njs_string_to_index_test,
           njs_str("njs_string_to_index_test") },
+        { njs_vm_reset_test,
+          njs_str("njs_vm_reset_test") },
+        { njs_regexp_pattern_cache_test,
+          njs_str("njs_regexp_pattern_cache_test") },
+        { njs_external_detach_test,
+          njs_str("njs_external_detach_test") },
+        { njs_vm_collect_test,
+          njs_str("njs_vm_collect_test") },
 #ifdef NJS_HAVE_ADDR2LINE
         { njs_addr2line_test,
           njs_str("njs_addr2line_test") },
@@ -181,6 +181,14 @@ declare class Response {
      * (status in the range 200-299).
      */
     readonly ok: boolean;
+    /**
+     * Returns a Promise that resolves with the next chunk of the body
+     * as ArrayBuffer, or with undefined when the body is read completely.
+     * A response fetched with the `stream` option is received while
+     * it is read, otherwise the whole body is returned as a single chunk.
+     * @since 0.9.3
+     */
+    read(): Promise<ArrayBuffer | undefined>;
     /**
      * A boolean value, true if the response is the result
      * of a redirect.
@@ -212,8 +220,11 @@ declare class Response {
 interface NgxFetchOptions {
     /**
      * Request body, by default is empty.
+     * An async iterator body is sent with the chunked transfer encoding
+     * as the chunks are produced (since 0.9.3), such a request is always
+     * made over HTTP/1.1, even if HTTP/2 is enabled.
      */
-    body?: string,
+    body?: NjsStringOrBuffer | AsyncIterator<NjsStringOrBuffer>,
     /**
      * The buffer size for reading the response, by default is 16384 (4096 before 0.7.4).
      * Nginx specific.
@@ -234,6 +245,20 @@ interface NgxFetchOptions {
      * Request method, by default the GET method is used.
      */
     method?: string;
+    /**
+     * If true, the Promise resolves as soon as the response headers are
+     * received, and the body is read with `Response.read()` as it arrives.
+     * No more than `buffer_size` bytes of the body are buffered,
+     * `max_response_body_size` is not applied.
+     * A streamed request is always made over HTTP/1.1,
+     * even if HTTP/2 is enabled.
+     * With the njs engine, the chunks read are released only when
+     * the request is finished, so the memory used grows with the body
+     * size; use the QuickJS engine to read large bodies in bounded memory.
+     * Nginx specific.
+     * @since 0.9.3
+     */
+    stream?: boolean;
     /**
      * Enables or disables verification of the HTTPS server certificate,
      * by default is true.
@@ -437,6 +462,12 @@ interface NgxObject {
      * @since 0.5.1
      */
     fetch(init: NjsStringOrBuffer | Request, options?: NgxFetchOptions): Promise<Response>;
+    /**
+     * A number of HTTPS fetch handshakes in the current worker process
+     * which resumed a previously saved TLS session.
+     * @since 0.9.3
+     */
+    readonly fetch_ssl_sessions_reused: number;
     /**
      * Writes a string to the error log with the specified level
      * of logging.
@@ -362,6 +362,16 @@ interface NginxHTTPRequest {
      * @since 0.5.0
      */
     readonly requestBuffer?: Buffer;
+    /**
+     * Client request body as an array of buffers which reference the body
+     * memory without copying, unless the context may be reused
+     * (see js_context_reuse), then the data is copied. A part of the body
+     * written to a temporary file is mapped from the file.
+     * The property is available only in the js_content directive.
+     *
+     * @since 0.9.3
+     */
+    readonly requestBuffers?: Buffer[];
     /**
      * The same as `requestBuffer`, but returns a string.
      *